@@ -5,7 +5,9 @@ HDRS := $(SRC_DIR)/definitions.h \
 		$(SRC_DIR)/utils/str_builder.h \
 		$(SRC_DIR)/utils/math.h \
 		$(SRC_DIR)/utils/hash.h \
+		$(SRC_DIR)/utils/intern.h \
 		$(SRC_DIR)/utils/iomux.h \
+		$(SRC_DIR)/utils/histogram.h \
 		$(SRC_DIR)/utils/ansi_codes.h \
 		$(SRC_DIR)/memory/dyn_arena.h \
 		$(SRC_DIR)/memory/arena.h \
@@ -14,9 +16,12 @@ HDRS := $(SRC_DIR)/definitions.h \
 		$(SRC_DIR)/containers/dict.h \
 		$(SRC_DIR)/containers/vector.h \
 		$(SRC_DIR)/containers/ring_queue.h \
+		$(SRC_DIR)/containers/mpsc_queue.h \
 		$(SRC_DIR)/containers/bytebuffer.h \
 		$(SRC_DIR)/containers/object_pool.h \
 		$(SRC_DIR)/containers/_array_internal.h \
+		$(SRC_DIR)/containers/_dict_internal.h \
+		$(SRC_DIR)/containers/dict_template.h \
 		$(SRC_DIR)/network/packet.h \
 		$(SRC_DIR)/network/decoders.h \
 		$(SRC_DIR)/network/utils.h \
@@ -27,6 +32,9 @@ HDRS := $(SRC_DIR)/definitions.h \
 		$(SRC_DIR)/network/encoders.h \
 		$(SRC_DIR)/network/security.h \
 		$(SRC_DIR)/network/compression.h \
+		$(SRC_DIR)/network/forwarding.h \
+		$(SRC_DIR)/network/capture.h \
+		$(SRC_DIR)/network/metrics.h \
 		$(SRC_DIR)/network/common_types.h \
 		$(SRC_DIR)/platform/platform.h \
 		$(SRC_DIR)/platform/socket.h \
@@ -43,4 +51,5 @@ HDRS := $(SRC_DIR)/definitions.h \
 		$(SRC_DIR)/data/nbt/nbt_internal.h \
 		$(SRC_DIR)/registry/registry.h \
 		$(SRC_DIR)/resource/resource_id.h \
-		$(SRC_DIR)/event/event.h
+		$(SRC_DIR)/event/event.h \
+		$(SRC_DIR)/event/channel.h
@@ -1,13 +1,15 @@
 MAIN_SRC := $(SRC_DIR)/main.c
 
 SRCS := $(SRC_DIR)/logger.c \
-		$(SRC_DIR)/logger1.c \
+		$(SRC_DIR)/trace.c \
 		$(SRC_DIR)/utils/string.c \
 		$(SRC_DIR)/utils/str_builder.c \
 		$(SRC_DIR)/utils/bitwise.c \
 		$(SRC_DIR)/utils/math.c \
 		$(SRC_DIR)/utils/hash.c \
+		$(SRC_DIR)/utils/intern.c \
 		$(SRC_DIR)/utils/iomux.c \
+		$(SRC_DIR)/utils/histogram.c \
 		$(SRC_DIR)/memory/dyn_arena.c \
 		$(SRC_DIR)/memory/arena.c \
 		$(SRC_DIR)/memory/memory_common.c \
@@ -15,6 +17,7 @@ SRCS := $(SRC_DIR)/logger.c \
 		$(SRC_DIR)/containers/dict-init.c \
 		$(SRC_DIR)/containers/vector.c \
 		$(SRC_DIR)/containers/ring_queue.c \
+		$(SRC_DIR)/containers/mpsc_queue.c \
 		$(SRC_DIR)/containers/bytebuffer.c \
 		$(SRC_DIR)/containers/object_pool.c \
 		$(SRC_DIR)/network/handlers.c \
@@ -27,6 +30,9 @@ SRCS := $(SRC_DIR)/logger.c \
 		$(SRC_DIR)/network/sender.c \
 		$(SRC_DIR)/network/security.c \
 		$(SRC_DIR)/network/compression.c \
+		$(SRC_DIR)/network/forwarding.c \
+		$(SRC_DIR)/network/capture.c \
+		$(SRC_DIR)/network/metrics.c \
 		$(SRC_DIR)/platform/linux/platform_linux.c \
 		$(SRC_DIR)/platform/linux/network_linux.c \
 		$(SRC_DIR)/platform/linux/signal-handler.c \
@@ -45,5 +51,6 @@ SRCS := $(SRC_DIR)/logger.c \
 		$(SRC_DIR)/data/nbt/serial.c \
 		$(SRC_DIR)/registry/registry.c \
 		$(SRC_DIR)/resource/resource_id.c \
-		$(SRC_DIR)/event/event.c
+		$(SRC_DIR)/event/event.c \
+		$(SRC_DIR)/event/channel.c
 
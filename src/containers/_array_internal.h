@@ -7,14 +7,54 @@
 
 #include "definitions.h"
 
-struct data_block {
-    u32 capacity;
-    void* data;
-    struct data_block* next;
-    struct data_block* prev;
-};
-
-struct data_block* alloc_block(Arena* arena, u64 capacity, u64 stride, i32 mem_tag);
-struct data_block* get_block_from_index(struct data_block* start, u64 index, u64* out_blk_local_index);
+/*
+  Segmented arrays store elements in segments of power-of-two sizes, and never move them.
+  Segment 0 holds 2^base_log2 elements, and each segment k > 0 holds 2^(base_log2 + k - 1)
+  elements, so the capacity doubles with each new segment.
+  Segment k > 0 starts at the global index 2^(base_log2 + k - 1), which makes finding the segment
+  of an element a matter of a few bit operations.
+ */
+
+/** Maximum number of segments of a segmented array. */
+#define SEGMENT_MAX_COUNT 32
+
+/**
+ * Computes the base-2 logarithm of the smallest power of two greater than or equal to @p n.
+ */
+static inline u32 segment_base_log2(u64 n) {
+    if (n <= 1)
+        return 0;
+    return 64 - __builtin_clzll(n - 1);
+}
+
+/**
+ * Gets the segment of a segmented array holding the element at the specified index.
+ *
+ * @param index The global index of the element.
+ * @param base_log2 The base-2 logarithm of the capacity of the first segment.
+ * @param[out] out_local_index The index of the element inside its segment.
+ * @return The index of the segment.
+ */
+static inline u32 segment_of(u64 index, u32 base_log2, u64* out_local_index) {
+    u64 quotient = index >> base_log2;
+    if (quotient == 0) {
+        *out_local_index = index;
+        return 0;
+    }
+    u32 segment = 64 - __builtin_clzll(quotient);
+    *out_local_index = index - ((u64) 1 << (base_log2 + segment - 1));
+    return segment;
+}
+
+/**
+ * Gets the number of elements a segment of a segmented array can hold.
+ *
+ * @param segment The index of the segment.
+ * @param base_log2 The base-2 logarithm of the capacity of the first segment.
+ * @return The capacity of the segment.
+ */
+static inline u64 segment_capacity(u32 segment, u32 base_log2) {
+    return (u64) 1 << (base_log2 + (segment ? segment - 1 : 0));
+}
 
 #endif /* ! _ARRAY_INTERNAL_H */
@@ -0,0 +1,213 @@
+#ifndef _DICT_INTERNAL_H
+#define _DICT_INTERNAL_H
+
+#include "definitions.h"
+#include "dict.h"
+#include "logger.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/*
+  Dictionaries are open-addressing tables in the style of Swiss tables.
+  Each slot has a control byte, stored in a separate array:
+  - CTRL_EMPTY if the slot has never been used since the last rehash,
+  - CTRL_DELETED (a tombstone) if the mapping of the slot was removed,
+  - the 7 highest bits of the key's hash (H2) if the slot holds a mapping.
+  Slots are grouped by GROUP_WIDTH, and all control bytes of a group are compared at once.
+  The remaining bits of the hash (H1) select the first group to probe; groups are then probed
+  quadratically (triangular numbers), which visits all groups since their count is a power of two.
+  A search stops at the first group containing an empty slot.
+ */
+
+#define GROUP_WIDTH 16
+
+#define CTRL_EMPTY ((u8) 0x80)
+#define CTRL_DELETED ((u8) 0xFE)
+
+/** Minimum capacity of a dictionary, a single group. */
+#define MIN_CAPACITY GROUP_WIDTH
+
+/** Maximum load of a table, counting tombstones. */
+#define max_load(capacity) ((capacity) - (capacity) / 8)
+
+static inline bool ctrl_is_full(u8 ctrl) {
+    return (ctrl & 0x80) == 0;
+}
+
+/**
+ * Spreads the bits of a hash, so H1 and H2 are both usable even with weak hash functions.
+ */
+static inline u64 dict_mix_hash(u64 hash) {
+    hash *= 0x9E3779B97F4A7C15ULL;
+    return hash ^ (hash >> 32);
+}
+
+/**
+ * Computes the control byte of a slot holding a key with the given (mixed) hash.
+ */
+static inline u8 ctrl_h2(u64 hash) {
+    return hash >> 57;
+}
+
+/**
+ * Computes the index of the first slot of the first group to probe for the given (mixed) hash.
+ */
+static inline u64 first_group(u64 capacity, u64 hash) {
+    return hash & (capacity - 1) & ~(u64) (GROUP_WIDTH - 1);
+}
+
+/**
+ * Computes the capacity of a table able to store at least @p count mappings.
+ */
+static inline u64 capacity_for(u64 count) {
+    u64 min = count + count / 7 + 1;
+    if (min <= MIN_CAPACITY)
+        return MIN_CAPACITY;
+    return 1ULL << (64 - __builtin_clzll(min - 1));
+}
+
+/**
+ * Computes the size of the memory region of a table: control bytes, then slots.
+ */
+static inline u64 table_size(const Dict* dict, u64 capacity) {
+    return capacity + capacity * dict->slot_stride;
+}
+
+/**
+ * Computes the layout of slots from the strides of keys and values.
+ * Values are aligned on 8 bytes, so they can be accessed directly with @ref dict_ref.
+ */
+static inline void init_layout(Dict* dict, u64 key_stride, u64 value_stride) {
+    dict->key_stride = key_stride;
+    dict->value_stride = value_stride;
+    dict->value_offset = (key_stride + 7) & ~7ULL;
+    dict->slot_stride = (dict->value_offset + value_stride + 7) & ~7ULL;
+}
+
+/**
+ * Sets up a table in the given memory region, with all slots empty.
+ */
+static inline void init_table(Dict* dict, void* base, u64 capacity) {
+    dict->control = base;
+    dict->slots = (u8*) base + capacity;
+    dict->capacity = capacity;
+    dict->size = 0;
+    dict->tombstones = 0;
+    for (u64 i = 0; i < capacity; i++) {
+        dict->control[i] = CTRL_EMPTY;
+    }
+}
+
+/* Group operations: each returns a bit mask, with bit i set if slot i of the group matches. */
+
+#ifdef __SSE2__
+
+static inline u32 group_match(const u8* group, u8 h2) {
+    __m128i ctrl = _mm_loadu_si128((const __m128i*) group);
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(h2)));
+}
+
+static inline u32 group_match_empty(const u8* group) {
+    return group_match(group, CTRL_EMPTY);
+}
+
+static inline u32 group_match_free(const u8* group) {
+    // Both empty and deleted slots have their highest bit set.
+    return _mm_movemask_epi8(_mm_loadu_si128((const __m128i*) group));
+}
+
+#else
+
+static inline u32 group_match(const u8* group, u8 h2) {
+    u32 mask = 0;
+    for (u32 i = 0; i < GROUP_WIDTH; i++) {
+        mask |= (u32) (group[i] == h2) << i;
+    }
+    return mask;
+}
+
+static inline u32 group_match_empty(const u8* group) {
+    return group_match(group, CTRL_EMPTY);
+}
+
+static inline u32 group_match_free(const u8* group) {
+    u32 mask = 0;
+    for (u32 i = 0; i < GROUP_WIDTH; i++) {
+        mask |= (u32) (group[i] >> 7) << i;
+    }
+    return mask;
+}
+
+#endif
+
+/* Operations shared by @ref Dict and the dictionaries generated by DICT_DEFINE. */
+
+/**
+ * Searches the first free slot on the probing sequence of the given (mixed) hash.
+ *
+ * @return The index of the slot, or `-1` if the table is full.
+ */
+static inline i64 table_find_free(const u8* control, u64 capacity, u64 hash) {
+    u64 mask = capacity - 1;
+    u64 pos = first_group(capacity, hash);
+
+    for (u64 step = GROUP_WIDTH; step <= capacity; step += GROUP_WIDTH) {
+        u32 free_slots = group_match_free(control + pos);
+        if (free_slots)
+            return pos + __builtin_ctz(free_slots);
+        pos = (pos + step) & mask;
+    }
+    return -1;
+}
+
+/**
+ * Computes the capacity of the table to rehash into before inserting a mapping.
+ *
+ * Dynamic tables grow if more than half of the maximum load would be mappings, and are only
+ * cleaned of their tombstones otherwise. Fixed tables can only be cleaned.
+ *
+ * @return The new capacity, or 0 if the table is fixed and full.
+ */
+static inline u64 table_rehash_capacity(u64 capacity, u64 size, u64 tombstones, bool fixed) {
+    if (capacity == 0)
+        return MIN_CAPACITY;
+    if (fixed)
+        return tombstones > 0 ? capacity : 0;
+    return size + 1 > max_load(capacity) / 2 ? capacity << 1 : capacity;
+}
+
+/**
+ * Allocates the memory needed to rehash a table.
+ *
+ * Dynamic tables are moved to a new region, while fixed tables are rehashed in place, from a
+ * temporary copy of their region.
+ *
+ * @param[in,out] region The region of the table. Set to the region to rehash into.
+ * @param[out] out_old Set to the region to move mappings from, to free once they are moved.
+ * @return @ref FALSE if memory could not be allocated, in which case nothing was changed.
+ */
+static inline bool table_prepare_rehash(
+    u8** region, u8** out_old, u64 old_size, u64 new_size, bool fixed) {
+    u64 bytes = fixed ? old_size : new_size;
+    u8* allocated = malloc(bytes);
+    if (!allocated) {
+        log_errorf("Could not allocate %zu bytes to rehash a dictionary.", (size_t) bytes);
+        return FALSE;
+    }
+
+    if (fixed) {
+        memcpy(allocated, *region, bytes);
+        *out_old = allocated;
+    } else {
+        *out_old = *region;
+        *region = allocated;
+    }
+    return TRUE;
+}
+
+#endif /* ! _DICT_INTERNAL_H */
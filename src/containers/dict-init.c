@@ -1,33 +1,38 @@
 #include "dict.h"
+#include "_dict_internal.h"
+#include "logger.h"
 #include "utils/hash.h"
 #include "memory/mem_tags.h"
 
 #include <stdlib.h>
 
-#define DEFAULT_CAP 4
-
 void dict_init_fixed(Dict* map, const Comparator* cmp, Arena* arena, u64 capacity, u64 key_stride, u64 value_stride) {
-    map->base = arena_callocate(
-        arena, capacity * (sizeof(u64) + key_stride + value_stride), ALLOC_TAG_DICT);
+    init_layout(map, key_stride, value_stride);
+    u64 table_capacity = capacity_for(capacity);
+    void* base = arena_allocate(arena, table_size(map, table_capacity), ALLOC_TAG_DICT);
+    init_table(map, base, table_capacity);
     map->comparator = cmp;
-    map->key_stride = key_stride;
-    map->value_stride = value_stride;
-    map->capacity = capacity;
-    map->size = 0;
     map->fixed = TRUE;
 }
 
-void dict_init(Dict* map, const Comparator* cmp, u64 key_stride, u64 value_stride) {
-    map->base = calloc(DEFAULT_CAP, sizeof(u64) + key_stride + value_stride);
+bool dict_init(Dict* map, const Comparator* cmp, u64 key_stride, u64 value_stride) {
+    init_layout(map, key_stride, value_stride);
     map->comparator = cmp;
-    map->key_stride = key_stride;
-    map->value_stride = value_stride;
-    map->capacity = DEFAULT_CAP;
-    map->size = 0;
     map->fixed = FALSE;
+
+    u64 bytes = table_size(map, MIN_CAPACITY);
+    void* base = malloc(bytes);
+    if (!base) {
+        log_errorf("Could not allocate %zu bytes for a dictionary.", (size_t) bytes);
+        // An empty table without slots: the first insertion tries to allocate it again.
+        init_table(map, NULL, 0);
+        return FALSE;
+    }
+    init_table(map, base, MIN_CAPACITY);
+    return TRUE;
 }
 
 void dict_destroy(Dict* map) {
     if (!map->fixed)
-        free(map->base);
+        free(map->control);
 }
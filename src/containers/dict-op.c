@@ -1,125 +1,126 @@
-#include "utils/bitwise.h"
 #include "dict.h"
+#include "_dict_internal.h"
 #include "utils/hash.h"
 
 #include <stdlib.h>
 #include <string.h>
 
-#define MAX_LOAD_FACTOR 0.75
-#define MIN_LOAD_FACTOR 0.25
-#define MIN_CAPACITY 4
-
-static struct node get_node_base(const Dict* dict, u64 idx, void* base, u64 capacity) {
-    struct node node = {
-        .hash = 0,
-        .hashp = NULL,
-        .key = NULL,
-        .value = NULL,
-    };
-    if (idx >= capacity) {
-        return node;
-    }
+/** Dynamic dictionaries are shrunk when less than 1/8 of their slots hold a mapping. */
+#define SHRINK_DIVISOR 8
 
-    u64 total_stride = sizeof(u64) + dict->key_stride + dict->value_stride;
-    void* ptr = offset(base, idx * total_stride);
-    node.hashp = ptr;
-    node.hash = *node.hashp;
-    node.key = offset(ptr, sizeof(u64));
-    node.value = offset(ptr, sizeof(u64) + dict->key_stride);
-    return node;
+static u64 hash_key(const Dict* map, const void* key) {
+    return dict_mix_hash(cmp_hash(map->comparator, key, map->key_stride));
 }
 
-static struct node get_node(const Dict* dict, u64 idx) {
-    return get_node_base(dict, idx, dict->base, dict->capacity);
+static void* slot_key(const Dict* map, u64 idx) {
+    return (u8*) map->slots + idx * map->slot_stride;
 }
 
-static u64 idx_iter(u64 cap, u64 idx) {
-    return (5 * idx + 1) % cap;
+static void* slot_value(const Dict* map, u64 idx) {
+    return (u8*) slot_key(map, idx) + map->value_offset;
 }
 
-static i64 get_elem(const Dict* map, const void* key, struct node* out_node) {
-    u64 h = cmp_hash(map->comparator, key, map->key_stride);
-    u64 idx = h % map->capacity;
-    struct node n = get_node(map, idx);
-    u64 count = 0;
-
-    while (n.hash == 0 || n.hash != h || cmp_compare(map->comparator, n.key, key, map->key_stride)) {
-        if (n.hash != 0)
-            count++;
-        if (count == map->size)
-            return FALSE;
-        idx = idx_iter(map->capacity, idx);
-        n = get_node(map, idx);
+/**
+ * Searches the slot holding the given key.
+ *
+ * @param[out] out_free If not `NULL`, set to the first free slot found on the probing sequence,
+ * or to `-1` if there is none. It is only meaningful if the key is not found.
+ */
+static i64 find_slot(const Dict* map, const void* key, u64 hash, i64* out_free) {
+    u8 h2 = ctrl_h2(hash);
+    u64 mask = map->capacity - 1;
+    u64 pos = first_group(map->capacity, hash);
+    i64 first_free = -1;
+
+    for (u64 step = GROUP_WIDTH; step <= map->capacity; step += GROUP_WIDTH) {
+        const u8* group = map->control + pos;
+        u32 matches = group_match(group, h2);
+        while (matches) {
+            u64 idx = pos + __builtin_ctz(matches);
+            if (cmp_compare(map->comparator, slot_key(map, idx), key, map->key_stride) == 0)
+                return idx;
+            matches &= matches - 1;
+        }
+        if (out_free && first_free < 0) {
+            u32 free_slots = group_match_free(group);
+            if (free_slots)
+                first_free = pos + __builtin_ctz(free_slots);
+        }
+        if (group_match_empty(group))
+            break;
+        pos = (pos + step) & mask;
     }
-    *out_node = n;
-    return idx;
+    if (out_free)
+        *out_free = first_free;
+    return -1;
 }
 
-static void rehash_nodes(Dict* map, void* old_base, void* new_base, u64 new_capacity) {
-    u64 total_stride = sizeof(u64) + map->key_stride + map->value_stride;
-    for (u64 i = 0; i < map->capacity; i++) {
-        struct node n = get_node_base(map, i, old_base, map->capacity);
-        if (n.hash == 0)
+/**
+ * Moves all mappings to a new table, dropping tombstones.
+ *
+ * Fixed dictionaries are rehashed in place, using a temporary copy of the table.
+ *
+ * @return @ref FALSE if memory could not be allocated, in which case the table is left untouched.
+ */
+static bool rehash(Dict* map, u64 new_capacity) {
+    u64 old_capacity = map->capacity;
+    u64 size = map->size;
+    u8* table = map->control;
+    u8* old_control;
+    if (!table_prepare_rehash(&table,
+                              &old_control,
+                              table_size(map, old_capacity),
+                              table_size(map, new_capacity),
+                              map->fixed))
+        return FALSE;
+    init_table(map, table, new_capacity);
+
+    u8* old_slots = old_control + old_capacity;
+    for (u64 i = 0; i < old_capacity; i++) {
+        if (!ctrl_is_full(old_control[i]))
             continue;
 
-        u64 ni = n.hash % new_capacity;
-        while (TRUE) {
-            struct node new = get_node_base(map, i, new_base, new_capacity);
-            if (new.hash == 0) {
-                memcpy(new.hashp, n.hashp, total_stride);
-                break;
-            } else
-                ni = idx_iter(new_capacity, ni);
-        }
+        const void* slot = old_slots + i * map->slot_stride;
+        u64 hash = hash_key(map, slot);
+        u64 idx = table_find_free(map->control, map->capacity, hash);
+        map->control[idx] = ctrl_h2(hash);
+        memcpy(slot_key(map, idx), slot, map->slot_stride);
     }
-}
-
-static void resize(Dict* map, u64 new_capacity) {
-    u64 total_stride = sizeof(u64) + map->key_stride + map->value_stride;
-    void* new_base = calloc(new_capacity, total_stride);
-    void* old_base = map->base;
-
-    rehash_nodes(map, old_base, new_base, new_capacity);
-
-    free(old_base);
-    map->capacity = new_capacity;
-    map->base = new_base;
-}
+    map->size = size;
 
-static void grow(Dict* map) {
-    resize(map, map->capacity << 1);
-}
-
-static void shrink(Dict* map) {
-    if (map->capacity > MIN_CAPACITY)
-        resize(map, map->capacity >> 1);
+    free(old_control);
+    return TRUE;
 }
 
 i64 dict_put(Dict* map, const void* key, const void* value) {
     if (key == NULL)
         return -1;
 
-    u64 h = cmp_hash(map->comparator, key, map->key_stride);
-    u64 idx = h % map->capacity;
-    struct node n = get_node(map, idx);
-
-    bool same_key = cmp_compare(map->comparator, n.key, key, map->key_stride) == 0;
-    while (n.hash != 0 && (n.hash != h || !same_key)) {
-        idx = idx_iter(map->capacity, idx);
-        n = get_node(map, idx);
-        same_key = cmp_compare(map->comparator, n.key, key, map->key_stride) == 0;
+    u64 hash = hash_key(map, key);
+    i64 idx;
+    i64 found = find_slot(map, key, hash, &idx);
+    if (found >= 0) {
+        memcpy(slot_value(map, found), value, map->value_stride);
+        return found;
     }
 
-    if (n.hash == 0) {
-        memcpy(n.key, key, map->key_stride);
-        *n.hashp = h;
+    // Reusing a tombstone does not increase the load of the table.
+    if (idx < 0 || (map->control[idx] == CTRL_EMPTY &&
+                    map->size + map->tombstones >= max_load(map->capacity))) {
+        // A table without slots could not be allocated by dict_init.
+        u64 capacity =
+            table_rehash_capacity(map->capacity, map->size, map->tombstones, map->fixed);
+        if (capacity == 0 || !rehash(map, capacity))
+            return -1;
+        idx = table_find_free(map->control, map->capacity, hash);
     }
-    memcpy(n.value, value, map->value_stride);
-    map->size++;
-
-    if (!map->fixed && map->size >= map->capacity * MAX_LOAD_FACTOR)
-        grow(map);
 
+    if (map->control[idx] == CTRL_DELETED)
+        map->tombstones--;
+    map->control[idx] = ctrl_h2(hash);
+    memcpy(slot_key(map, idx), key, map->key_stride);
+    memcpy(slot_value(map, idx), value, map->value_stride);
+    map->size++;
     return idx;
 }
 
@@ -127,18 +128,26 @@ i64 dict_remove(Dict* map, const void* key, void* out_value) {
     if (key == NULL || map->size == 0)
         return -1;
 
-    struct node n;
-    i64 idx = get_elem(map, key, &n);
-    if (idx == -1)
+    i64 idx = find_slot(map, key, hash_key(map, key), NULL);
+    if (idx < 0)
         return -1;
 
     if (out_value)
-        memcpy(out_value, n.value, map->value_stride);
-
-    *n.hashp = 0;
+        memcpy(out_value, slot_value(map, idx), map->value_stride);
+
+    // If the group still has an empty slot, it was never full, so no search ever went past it:
+    // the slot can be marked empty instead of leaving a tombstone.
+    if (group_match_empty(map->control + (idx & ~(i64) (GROUP_WIDTH - 1)))) {
+        map->control[idx] = CTRL_EMPTY;
+    } else {
+        map->control[idx] = CTRL_DELETED;
+        map->tombstones++;
+    }
     map->size--;
-    if (!map->fixed && map->size <= map->capacity * MIN_LOAD_FACTOR)
-        shrink(map);
+
+    // A dictionary which could not be shrunk keeps working with its larger table.
+    if (!map->fixed && map->capacity > MIN_CAPACITY && map->size <= map->capacity / SHRINK_DIVISOR)
+        rehash(map, map->capacity >> 1);
     return idx;
 }
 
@@ -146,34 +155,34 @@ i64 dict_get(Dict* map, const void* key, void* out_value) {
     if (key == NULL || map->size == 0)
         return -1;
 
-    struct node n;
-    i64 idx = get_elem(map, key, &n);
-    if (idx == -1)
+    i64 idx = find_slot(map, key, hash_key(map, key), NULL);
+    if (idx < 0)
         return -1;
 
     if (out_value)
-        memcpy(out_value, n.value, map->value_stride);
+        memcpy(out_value, slot_value(map, idx), map->value_stride);
 
     return idx;
 }
 
 void* dict_ref(Dict* dict, i64 idx) {
-    if (dict->size == 0 || idx < 0 || idx > (i64) dict->capacity)
+    if (dict->size == 0 || idx < 0 || idx >= (i64) dict->capacity)
         return NULL;
 
-    struct node n = get_node(dict, idx);
-    if (n.hash == 0)
+    if (!ctrl_is_full(dict->control[idx]))
         return NULL;
-    return n.value;
+    return slot_value(dict, idx);
 }
 
 void dict_foreach(const Dict* map, action action, void* data) {
     u64 j = 0;
-    for (u64 i = 0; i < map->capacity && j < map->size; i++) {
-        struct node node = get_node(map, i);
-        if (node.hash != 0) {
-            action(map, j, node.key, node.value, data);
+    for (u64 pos = 0; pos < map->capacity && j < map->size; pos += GROUP_WIDTH) {
+        u32 full = ~group_match_free(map->control + pos) & ((1u << GROUP_WIDTH) - 1);
+        while (full) {
+            u64 idx = pos + __builtin_ctz(full);
+            action(map, j, slot_key(map, idx), slot_value(map, idx), data);
             j++;
+            full &= full - 1;
         }
     }
 }
@@ -13,8 +13,9 @@
  * No real type checking is done.
  *
  * Some functions (namely @ref dict_put, @ref dict_get and @dict_remove) return indexes to
- * mappings. These indexes should only be used when dealing with fixed dictionaries, as mapping
- * indexes of dynamic dictionaries might change when the underlying table is resized.
+ * mappings. These indexes are only valid until the next call to @ref dict_put or
+ * @ref dict_remove: dynamic dictionaries move their mappings when their table is resized, and
+ * fixed dictionaries move them when @ref dict_put rehashes the table to drop removed mappings.
  *
  * Dictionaries make use of *hash* and *comparison* functions.
  */
@@ -25,30 +26,26 @@
 #include "memory/arena.h"
 #include "utils/hash.h"
 
-/**
- * Internal structure used by dictionaries to group elements.
- *
- * The implementation does not use this structure to store elements.
- */
-struct node {
-    u64 hash;    /**< Cached hash. */
-    u64* hashp;  /**< Pointer to the hash stored in the dict. */
-    void* key;   /**< Pointer to the key stored in the dict.*/
-    void* value; /**< Pointer to the value stored in the dict.*/
-};
-
 typedef u64 (*hash_function)(const void* key);
 
 /**
  * Structure representing a dictionary.
+ *
+ * Mappings are stored in an open-addressing table of power-of-two capacity. Each slot has a
+ * control byte, kept apart from the keys and values, so lookups scan the control bytes of
+ * 16 slots at once and only compare keys whose hash matches.
  */
 typedef struct Dict {
-    void* base;                   /**< Memory region containing elements of the dictionnary. */
+    u8* control;                  /**< Control bytes of the slots (empty, deleted, or part of the key's hash). */
+    void* slots;                  /**< Memory region containing the key-value pairs. */
     const Comparator* comparator; /**< Comparison and hashing functions used to search and add key-value pairs. */
-    u64 capacity;                 /**< maximum number of elements that can be stored in the dict. */
+    u64 capacity;                 /**< Number of slots of the table. */
     u64 size;                     /**< number of elements in the dict. */
+    u64 tombstones;               /**< Number of slots whose mapping was removed. */
     u64 key_stride;               /**< Size (in bytes) of keys. */
     u64 value_stride;             /**< Size (in bytes) of values. */
+    u64 value_offset;             /**< Offset (in bytes) of values inside slots. */
+    u64 slot_stride;              /**< Size (in bytes) of slots. */
     bool fixed;                   /**< True if the underlying array cannot be resized. */
 } Dict;
 
@@ -61,8 +58,10 @@ typedef struct Dict {
  * @param cmp Comparison and hashing functions used to put elements in and get elements from the dictionnary.
  * @param key_stride The size in bytes of keys.
  * @param value_stride The size in bytes of values.
+ * @return @ref FALSE if the table could not be allocated. The dictionary is still usable, and
+ * empty: its table is allocated by the first call to @ref dict_put.
  */
-void dict_init(Dict* map, const Comparator* cmp, u64 key_stride, u64 value_stride);
+bool dict_init(Dict* map, const Comparator* cmp, u64 key_stride, u64 value_stride);
 /**
  * Initializes a fixed dictionary.
  *
@@ -71,6 +70,7 @@ void dict_init(Dict* map, const Comparator* cmp, u64 key_stride, u64 value_strid
  * @param[out] map The dictionary structure to initialize.
  * @param cmp Comparison and hashing functions used to put elements in and get elements from the dictionnary.
  * @param arena The arena to use to allocate underlying memory.
+ * @param capacity The maximum number of mappings the dictionary must be able to hold.
  * @param key_stride The size in bytes of keys.
  * @param value_stride The size in bytes of values.
  */
@@ -78,7 +78,7 @@ void dict_init_fixed(
     Dict* map, const Comparator* cmp, Arena* arena, u64 capacity, u64 key_stride, u64 value_stride);
 
 /**
- * Inserts a mapping between a key and a value inside a dictionary.
+ * Destroys a dictionary, releasing its underlying memory.
  *
  * If the given dictionary is fixed, this function does nothing.
  * @param map The dictionary to destroy.
@@ -92,7 +92,9 @@ void dict_destroy(Dict* map);
  * @param map The dictionary to remove the mapping from.
  * @param key A pointer to the key to create a mapping for.
  * @param value A pointer to the value to create a mapping for.
- * @return The index of the newly created mapping inside the dictionary, or `-1` if the insertion failed.
+ * If a mapping with the same key already exists, its value is replaced.
+ * @return The index of the newly created mapping inside the dictionary, or `-1` if the insertion failed
+ * (i.e. the dictionary is fixed and full, or the table could not be resized).
  */
 i64 dict_put(Dict* map, const void* key, const void* value);
 /**
@@ -132,7 +134,7 @@ void* dict_ref(Dict* dict, i64 idx);
  * An action on a dictionary's mapping.
  *
  * @param dict The dictionary in which the mapping is stored.
- * @param idx The index of the mapping inside the dictionary.
+ * @param idx The position of the mapping in the iteration, from `0` to `dict->size - 1`.
  * @param [in] key The mapping's key.
  * @param [in] value The mapping's value.
  * @param data Arbitrary data / context to use when processing the mapping.
@@ -0,0 +1,242 @@
+/**
+ * @file
+ *
+ * Type-specialized dictionaries.
+ *
+ * @ref DICT_DEFINE generates a dictionary type and its functions for a given key type, value type,
+ * hash function and equality function. Keys and values are stored and compared with their own types,
+ * and all functions are `static inline`, so hashing and comparison calls can be inlined instead of
+ * going through a @ref Comparator and `memcpy`s of runtime strides.
+ *
+ * Generated dictionaries use the same table layout as @ref Dict, and share its probing and resizing
+ * code (see `_dict_internal.h`).
+ *
+ * Example:
+ * @code
+ * static inline u64 code_hash(const u32* code) { return *code; }
+ * static inline bool code_equals(const u32* lhs, const u32* rhs) { return *lhs == *rhs; }
+ *
+ * DICT_DEFINE(CodeMap, codemap, u32, string, code_hash, code_equals)
+ *
+ * CodeMap map;
+ * codemap_init(&map);
+ * u32 code = 3;
+ * string name = str_create_view("three");
+ * codemap_put(&map, &code, &name);
+ * string* ref = codemap_ref(&map, &code);
+ * codemap_destroy(&map);
+ * @endcode
+ */
+#ifndef DICT_TEMPLATE_H
+#define DICT_TEMPLATE_H
+
+#include "_dict_internal.h"
+#include "definitions.h"
+#include "memory/arena.h"
+#include "memory/mem_tags.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Defines a type-specialized dictionary.
+ *
+ * The following functions are generated, prefixed by @p prefix:
+ * - `bool init(type* map)`: initializes a dynamic dictionary, resized automatically. Returns
+ *   @ref FALSE if its table could not be allocated; the table is then allocated by the first `put`.
+ * - `void init_fixed(type* map, Arena* arena, u64 capacity)`: initializes a fixed dictionary,
+ *   able to hold at least @p capacity mappings, allocated with @p arena.
+ * - `void destroy(type* map)`: releases the memory of a dynamic dictionary.
+ * - `V* ref(const type* map, const K* key)`: retrieves the value mapped to a key, or `NULL`.
+ * - `V* put(type* map, const K* key, const V* value)`: inserts or replaces a mapping, and returns a
+ *   pointer to the stored value, or `NULL` if the dictionary is fixed and full, or could not be
+ *   resized.
+ * - `bool remove(type* map, const K* key, V* out_value)`: removes a mapping, and copies its value to
+ *   @p out_value if it is not `NULL`.
+ * - `slot* next(const type* map, u64* cursor)`: iterates over mappings. The cursor must be set to `0`
+ *   before the first call. Returns `NULL` once all mappings have been visited.
+ *
+ * Pointers returned by `ref`, `put` and `next` are invalidated by insertions and removals.
+ * Dynamic dictionaries grow when needed, but never shrink.
+ *
+ * @param type The name of the dictionary type. The type of its slots is `type##_slot`.
+ * @param prefix The prefix of the generated functions.
+ * @param K The type of keys.
+ * @param V The type of values.
+ * @param hash The hash function of keys, as `u64 hash(const K* key)`.
+ * @param eq The equality function of keys, as `bool eq(const K* lhs, const K* rhs)`.
+ */
+#define DICT_DEFINE(type, prefix, K, V, hash, eq)                                                  \
+    typedef K type##_key;                                                                          \
+    typedef V type##_value;                                                                        \
+                                                                                                   \
+    typedef struct type##_slot {                                                                   \
+        type##_key key;                                                                            \
+        type##_value value;                                                                        \
+    } type##_slot;                                                                                 \
+                                                                                                   \
+    typedef struct type {                                                                          \
+        u8* control;                                                                               \
+        type##_slot* slots;                                                                        \
+        u64 capacity;                                                                              \
+        u64 size;                                                                                  \
+        u64 tombstones;                                                                            \
+        bool fixed;                                                                                \
+    } type;                                                                                        \
+                                                                                                   \
+    static inline void prefix##_setup(type* map, void* base, u64 capacity) {                       \
+        map->control = base;                                                                       \
+        map->slots = (type##_slot*) ((u8*) base + capacity);                                       \
+        map->capacity = capacity;                                                                  \
+        map->size = 0;                                                                             \
+        map->tombstones = 0;                                                                       \
+        memset(map->control, CTRL_EMPTY, capacity);                                                \
+    }                                                                                              \
+                                                                                                   \
+    static inline bool prefix##_init(type* map) {                                                  \
+        map->fixed = FALSE;                                                                        \
+        u64 bytes = MIN_CAPACITY * (1 + sizeof(type##_slot));                                      \
+        void* base = malloc(bytes);                                                                \
+        if (!base) {                                                                               \
+            log_errorf("Could not allocate %zu bytes for a dictionary.", (size_t) bytes);          \
+            prefix##_setup(map, NULL, 0);                                                          \
+            return FALSE;                                                                          \
+        }                                                                                          \
+        prefix##_setup(map, base, MIN_CAPACITY);                                                   \
+        return TRUE;                                                                               \
+    }                                                                                              \
+                                                                                                   \
+    static inline void prefix##_init_fixed(type* map, Arena* arena, u64 capacity) {                \
+        u64 table_capacity = capacity_for(capacity);                                               \
+        prefix##_setup(map,                                                                        \
+                       arena_allocate(arena,                                                       \
+                                      table_capacity * (1 + sizeof(type##_slot)),                  \
+                                      ALLOC_TAG_DICT),                                             \
+                       table_capacity);                                                            \
+        map->fixed = TRUE;                                                                         \
+    }                                                                                              \
+                                                                                                   \
+    static inline void prefix##_destroy(type* map) {                                               \
+        if (!map->fixed)                                                                           \
+            free(map->control);                                                                    \
+    }                                                                                              \
+                                                                                                   \
+    static inline i64 prefix##_find(                                                               \
+        const type* map, const type##_key* key, u64 h, i64* out_free) {                            \
+        u8 h2 = ctrl_h2(h);                                                                        \
+        u64 mask = map->capacity - 1;                                                              \
+        u64 pos = first_group(map->capacity, h);                                                   \
+        i64 first_free = -1;                                                                       \
+        for (u64 step = GROUP_WIDTH; step <= map->capacity; step += GROUP_WIDTH) {                 \
+            const u8* group = map->control + pos;                                                  \
+            u32 matches = group_match(group, h2);                                                  \
+            while (matches) {                                                                      \
+                u64 idx = pos + __builtin_ctz(matches);                                            \
+                if (eq(&map->slots[idx].key, key))                                                 \
+                    return idx;                                                                    \
+                matches &= matches - 1;                                                            \
+            }                                                                                      \
+            if (out_free && first_free < 0) {                                                      \
+                u32 free_slots = group_match_free(group);                                          \
+                if (free_slots)                                                                    \
+                    first_free = pos + __builtin_ctz(free_slots);                                  \
+            }                                                                                      \
+            if (group_match_empty(group))                                                          \
+                break;                                                                             \
+            pos = (pos + step) & mask;                                                             \
+        }                                                                                          \
+        if (out_free)                                                                              \
+            *out_free = first_free;                                                                \
+        return -1;                                                                                 \
+    }                                                                                              \
+                                                                                                   \
+    static inline bool prefix##_rehash(type* map, u64 new_capacity) {                              \
+        u64 old_capacity = map->capacity;                                                          \
+        u64 size = map->size;                                                                      \
+        u8* table = map->control;                                                                  \
+        u8* old_control;                                                                           \
+        if (!table_prepare_rehash(&table,                                                          \
+                                  &old_control,                                                    \
+                                  old_capacity * (1 + sizeof(type##_slot)),                        \
+                                  new_capacity * (1 + sizeof(type##_slot)),                        \
+                                  map->fixed))                                                     \
+            return FALSE;                                                                          \
+        prefix##_setup(map, table, new_capacity);                                                  \
+        const type##_slot* old_slots = (const type##_slot*) (old_control + old_capacity);          \
+        for (u64 i = 0; i < old_capacity; i++) {                                                   \
+            if (!ctrl_is_full(old_control[i]))                                                     \
+                continue;                                                                          \
+            u64 h = dict_mix_hash(hash(&old_slots[i].key));                                        \
+            i64 idx = table_find_free(map->control, map->capacity, h);                             \
+            map->control[idx] = ctrl_h2(h);                                                        \
+            map->slots[idx] = old_slots[i];                                                        \
+        }                                                                                          \
+        map->size = size;                                                                          \
+        free(old_control);                                                                         \
+        return TRUE;                                                                               \
+    }                                                                                              \
+                                                                                                   \
+    static inline type##_value* prefix##_ref(const type* map, const type##_key* key) {             \
+        if (map->size == 0)                                                                        \
+            return NULL;                                                                           \
+        i64 idx = prefix##_find(map, key, dict_mix_hash(hash(key)), NULL);                         \
+        return idx < 0 ? NULL : &map->slots[idx].value;                                            \
+    }                                                                                              \
+                                                                                                   \
+    static inline type##_value* prefix##_put(                                                      \
+        type* map, const type##_key* key, const type##_value* value) {                             \
+        u64 h = dict_mix_hash(hash(key));                                                          \
+        i64 idx = -1;                                                                              \
+        i64 found = prefix##_find(map, key, h, &idx);                                              \
+        if (found >= 0) {                                                                          \
+            map->slots[found].value = *value;                                                      \
+            return &map->slots[found].value;                                                       \
+        }                                                                                          \
+        if (idx < 0 || (map->control[idx] == CTRL_EMPTY &&                                         \
+                        map->size + map->tombstones >= max_load(map->capacity))) {                 \
+            u64 capacity =                                                                         \
+                table_rehash_capacity(map->capacity, map->size, map->tombstones, map->fixed);      \
+            if (capacity == 0 || !prefix##_rehash(map, capacity))                                  \
+                return NULL;                                                                       \
+            idx = table_find_free(map->control, map->capacity, h);                                 \
+        }                                                                                          \
+        if (map->control[idx] == CTRL_DELETED)                                                     \
+            map->tombstones--;                                                                     \
+        map->control[idx] = ctrl_h2(h);                                                            \
+        map->slots[idx].key = *key;                                                                \
+        map->slots[idx].value = *value;                                                            \
+        map->size++;                                                                               \
+        return &map->slots[idx].value;                                                             \
+    }                                                                                              \
+                                                                                                   \
+    static inline bool prefix##_remove(                                                            \
+        type* map, const type##_key* key, type##_value* out_value) {                               \
+        if (map->size == 0)                                                                        \
+            return FALSE;                                                                          \
+        i64 idx = prefix##_find(map, key, dict_mix_hash(hash(key)), NULL);                         \
+        if (idx < 0)                                                                               \
+            return FALSE;                                                                          \
+        if (out_value)                                                                             \
+            *out_value = map->slots[idx].value;                                                    \
+        if (group_match_empty(map->control + (idx & ~(i64) (GROUP_WIDTH - 1)))) {                  \
+            map->control[idx] = CTRL_EMPTY;                                                        \
+        } else {                                                                                   \
+            map->control[idx] = CTRL_DELETED;                                                      \
+            map->tombstones++;                                                                     \
+        }                                                                                          \
+        map->size--;                                                                               \
+        return TRUE;                                                                               \
+    }                                                                                              \
+                                                                                                   \
+    static inline type##_slot* prefix##_next(const type* map, u64* cursor) {                       \
+        for (u64 i = *cursor; i < map->capacity; i++) {                                            \
+            if (ctrl_is_full(map->control[i])) {                                                   \
+                *cursor = i + 1;                                                                   \
+                return &map->slots[i];                                                             \
+            }                                                                                      \
+        }                                                                                          \
+        *cursor = map->capacity;                                                                   \
+        return NULL;                                                                               \
+    }
+
+#endif /* ! DICT_TEMPLATE_H */
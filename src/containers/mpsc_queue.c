@@ -0,0 +1,82 @@
+#include "mpsc_queue.h"
+#include "memory/mem_tags.h"
+
+#include <string.h>
+
+struct cell {
+    _Atomic u64 sequence;
+    u8 data[];
+};
+
+static struct cell* get_cell(const MPSCQueue* queue, u64 position) {
+    return (struct cell*) (queue->cells + (position & queue->mask) * queue->cell_stride);
+}
+
+MPSCQueue mpscq_create(u32 capacity, u32 stride, Arena* arena) {
+    u64 size = capacity < 2 ? 2 : 1ULL << (64 - __builtin_clzll((u64) capacity - 1));
+
+    MPSCQueue queue = {
+        .mask        = size - 1,
+        .cell_stride = (sizeof(struct cell) + stride + 7) & ~7ULL,
+        .stride      = stride,
+        .tail        = 0,
+    };
+    atomic_init(&queue.head, 0);
+    queue.cells = arena_allocate(arena, size * queue.cell_stride, ALLOC_TAG_UNKNOWN);
+    for (u64 i = 0; i < size; i++) {
+        atomic_init(&get_cell(&queue, i)->sequence, i);
+    }
+    return queue;
+}
+
+bool mpscq_try_enqueue(MPSCQueue* queue, const void* value) {
+    u64 position = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    struct cell* cell;
+    while (TRUE) {
+        cell = get_cell(queue, position);
+        u64 sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        i64 diff = (i64) (sequence - position);
+        if (diff == 0) {
+            // The cell is free: claim the position.
+            if (atomic_compare_exchange_weak_explicit(
+                    &queue->head, &position, position + 1, memory_order_relaxed, memory_order_relaxed))
+                break;
+        } else if (diff < 0) {
+            // The cell still holds the element enqueued one lap ago.
+            return FALSE;
+        } else {
+            // Another producer claimed the position.
+            position = atomic_load_explicit(&queue->head, memory_order_relaxed);
+        }
+    }
+
+    memcpy(cell->data, value, queue->stride);
+    atomic_store_explicit(&cell->sequence, position + 1, memory_order_release);
+    return TRUE;
+}
+
+bool mpscq_dequeue(MPSCQueue* queue, void* out_value) {
+    struct cell* cell = get_cell(queue, queue->tail);
+    u64 sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+    if (sequence != queue->tail + 1)
+        return FALSE;
+
+    if (out_value)
+        memcpy(out_value, cell->data, queue->stride);
+    // Hand the cell over to the producer of the next lap.
+    atomic_store_explicit(&cell->sequence, queue->tail + queue->mask + 1, memory_order_release);
+    queue->tail++;
+    return TRUE;
+}
+
+u32 mpscq_dequeue_batch(MPSCQueue* queue, void* out_values, u32 max) {
+    u32 count = 0;
+    while (count < max && mpscq_dequeue(queue, (u8*) out_values + (u64) count * queue->stride))
+        count++;
+    return count;
+}
+
+bool mpscq_is_empty(const MPSCQueue* queue) {
+    const struct cell* cell = get_cell(queue, queue->tail);
+    return atomic_load_explicit(&cell->sequence, memory_order_acquire) != queue->tail + 1;
+}
@@ -0,0 +1,99 @@
+/**
+ * @file
+ *
+ * Bounded lock-free multi-producer single-consumer queue.
+ *
+ * Any number of threads can enqueue elements concurrently, and a single thread dequeues them.
+ * Neither side ever takes a lock: each cell of the queue carries a sequence number telling
+ * whether it is free for the producer claiming its position, or ready for the consumer.
+ *
+ * The queue is bounded: enqueuing fails instead of overwriting elements when it is full, so
+ * callers decide how to apply backpressure.
+ */
+#ifndef MPSC_QUEUE_H
+#define MPSC_QUEUE_H
+
+#include "definitions.h"
+#include "memory/arena.h"
+
+#include <stdatomic.h>
+
+/** Size of a cache line, used to keep producer and consumer positions apart. */
+#define MPSCQ_CACHE_LINE 64
+
+/**
+ * Structure representing a bounded MPSC queue.
+ *
+ * Positions only grow; the cell of a position is `position & mask`.
+ * The cell at position `p` holds sequence number `p` when it is free for the producer of position `p`,
+ * and `p + 1` once its element is written and can be read by the consumer.
+ */
+typedef struct MPSCQueue {
+    u8* cells;       /**< Cells of the queue, each a sequence number followed by an element. */
+    u64 mask;        /**< Capacity of the queue minus one. */
+    u64 cell_stride; /**< Size of a cell, in bytes. */
+    u32 stride;      /**< Size of an element, in bytes. */
+
+    /** Next position claimed by a producer. */
+    _Alignas(MPSCQ_CACHE_LINE) _Atomic u64 head;
+    /** Next position read by the consumer. Only accessed by the consumer. */
+    _Alignas(MPSCQ_CACHE_LINE) u64 tail;
+} MPSCQueue;
+
+/**
+ * Creates a queue.
+ *
+ * @param capacity The minimum number of elements the queue can hold. It is rounded up to a power
+ * of two.
+ * @param stride The size of an element, in bytes.
+ * @param[in] arena The arena used to allocate the queue's cells.
+ * @return The new queue.
+ */
+MPSCQueue mpscq_create(u32 capacity, u32 stride, Arena* arena);
+
+/**
+ * Adds an element at the end of the queue, without blocking.
+ *
+ * Safe to call from any number of threads at the same time.
+ *
+ * @param[in] queue The queue to add an element to.
+ * @param[in] value A pointer to the element to copy into the queue.
+ * @return @ref TRUE if the element was added, @ref FALSE if the queue is full.
+ */
+bool mpscq_try_enqueue(MPSCQueue* queue, const void* value);
+
+/**
+ * Removes the first element of the queue.
+ *
+ * Must only be called by the consumer thread.
+ *
+ * @param[in] queue The queue to remove an element from.
+ * @param[out] out_value A pointer to a buffer to copy the removed element into.
+ * @return @ref TRUE if an element was removed, @ref FALSE if the queue is empty.
+ */
+bool mpscq_dequeue(MPSCQueue* queue, void* out_value);
+
+/**
+ * Removes up to @p max elements from the start of the queue.
+ *
+ * Must only be called by the consumer thread.
+ *
+ * @param[in] queue The queue to remove elements from.
+ * @param[out] out_values A buffer to copy the removed elements into, able to hold @p max elements.
+ * @param max The maximum number of elements to remove.
+ * @return The number of removed elements.
+ */
+u32 mpscq_dequeue_batch(MPSCQueue* queue, void* out_values, u32 max);
+
+/**
+ * Checks whether the queue has an element ready to be dequeued.
+ *
+ * Must only be called by the consumer thread. An element whose producer has claimed its position
+ * but not finished writing it is not ready.
+ *
+ * @param[in] queue The queue to check.
+ * @return @ref TRUE if @ref mpscq_dequeue would fail.
+ */
+bool mpscq_is_empty(const MPSCQueue* queue);
+
+#endif /* ! MPSC_QUEUE_H */
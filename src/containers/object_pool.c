@@ -3,61 +3,64 @@
 #include "logger.h"
 #include "memory/mem_tags.h"
 #include "utils/bitwise.h"
+#include "utils/math.h"
 
 #include <stdlib.h>
+#include <string.h>
 
-struct PoolObj {
-    bool is_allocated;
-    void* object;
-};
+#define BITMAP_WORD_BITS 64
 
-void objpool_init(ObjectPool* pool, Arena* arena, u32 capacity, u32 stride) {
-    pool->start = alloc_block(arena, capacity, stride, ALLOC_TAG_POOL);
-    pool->next_insert_index = 0;
-    pool->capacity = capacity;
-    pool->size = 0;
-    pool->stride = stride;
-    pool->arena = NULL;
+static u64 bitmap_words(u64 capacity) {
+    return (capacity + BITMAP_WORD_BITS - 1) / BITMAP_WORD_BITS;
 }
 
-void objpool_init_dynamic(ObjectPool* pool, Arena* arena, u32 initial_capacity, u32 stride) {
-    pool->start = alloc_block(arena, initial_capacity, stride, ALLOC_TAG_POOL);
-    pool->next_insert_index = 0;
-    pool->capacity = initial_capacity;
-    pool->size = 0;
-    pool->stride = stride;
-    pool->arena = NULL;
+static bool alloc_segment(ObjectPool* pool, Arena* arena, u64 capacity) {
+    if (pool->segment_count == OBJPOOL_MAX_SEGMENTS) {
+        log_error("Object pool has reached its maximum number of segments !");
+        return FALSE;
+    }
+
+    struct pool_segment* segment = &pool->segments[pool->segment_count];
+    segment->slots = arena_allocate(arena, capacity * pool->stride, ALLOC_TAG_POOL);
+    segment->occupancy =
+        arena_callocate(arena, bitmap_words(capacity) * sizeof(u64), ALLOC_TAG_POOL);
+    pool->segment_count++;
+    pool->capacity += capacity;
+    return TRUE;
 }
 
-static void set_allocated(const struct data_block* blk, u64 index, bool allocated, u64 stride) {
-    bool* ptr = offset(blk->data, index * (stride + sizeof(bool)));
-    *ptr = allocated;
+static void init(ObjectPool* pool, Arena* arena, u32 capacity, u32 stride) {
+    // Slots must be able to hold the index of the next free slot.
+    if (stride < sizeof(i64))
+        stride = sizeof(i64);
+
+    *pool = (ObjectPool){
+        .base_log2 = segment_base_log2(capacity),
+        .free_head = -1,
+        .stride = ceil_u64(stride, sizeof(uintptr_t)),
+    };
+    alloc_segment(pool, arena, capacity);
 }
 
-static bool is_allocated(const struct data_block* blk, u64 index, u64 stride) {
-    const bool* ptr = offset(blk->data, index * (stride + sizeof(bool)));
-    return *ptr;
+void objpool_init(ObjectPool* pool, Arena* arena, u32 capacity, u32 stride) {
+    init(pool, arena, capacity, stride);
 }
 
-static void* get_obj(const struct data_block* blk, u64 index, u64 stride) {
-    return offset(blk->data, index * (stride + sizeof(bool)) + sizeof(bool));
+void objpool_init_dynamic(ObjectPool* pool, Arena* arena, u32 initial_capacity, u32 stride) {
+    // The first segment of dynamic pools is filled entirely before growing.
+    u64 capacity = segment_capacity(0, segment_base_log2(initial_capacity));
+    init(pool, arena, capacity, stride);
+    pool->arena = arena;
 }
 
-static void update_next_available(ObjectPool* pool) {
-    u64 global_index = pool->next_insert_index;
-    u64 i;
-    struct data_block* blk = get_block_from_index(pool->start, pool->next_insert_index, &i);
-    while (blk) {
-        while (i < blk->capacity) {
-            if (!is_allocated(blk, i, pool->stride)) {
-                pool->next_insert_index = global_index;
-                return;
-            }
-            i++;
-            global_index++;
-        }
-        blk = blk->next;
-    }
+static void* get_slot(const ObjectPool* pool, u64 index, u64** out_word, u64* out_bit) {
+    u64 local_index;
+    u32 segment_index = segment_of(index, pool->base_log2, &local_index);
+    const struct pool_segment* segment = &pool->segments[segment_index];
+
+    *out_word = &segment->occupancy[local_index / BITMAP_WORD_BITS];
+    *out_bit = (u64) 1 << (local_index % BITMAP_WORD_BITS);
+    return offsetu(segment->slots, local_index * pool->stride);
 }
 
 static bool ensure_capacity(ObjectPool* pool, u64 size) {
@@ -65,87 +68,96 @@ static bool ensure_capacity(ObjectPool* pool, u64 size) {
         return TRUE;
 
     if (!objpool_is_dynamic(pool)) {
-        log_error("Cannot resize a static vector !");
+        log_error("Cannot resize a static object pool !");
         return FALSE;
     }
 
-    struct data_block* blk =
-        alloc_block(pool->arena, pool->capacity >> 1, pool->stride, ALLOC_TAG_POOL);
-    struct data_block* last = pool->start;
-    while (last->next)
-        last = last->next;
-    blk->prev = last;
-    last->next = blk;
-    pool->capacity += blk->capacity;
-    return TRUE;
+    return alloc_segment(
+        pool, pool->arena, segment_capacity(pool->segment_count, pool->base_log2));
 }
 
 void objpool_clear(ObjectPool* pool) {
-    for (struct data_block* blk = pool->start; blk; blk = blk->next) {
-        for (u64 i = 0; i < blk->capacity; i++) {
-            set_allocated(blk, i, FALSE, pool->stride);
-        }
+    for (u32 i = 0; i < pool->segment_count; i++) {
+        u64 words = bitmap_words(segment_capacity(i, pool->base_log2));
+        if (i == 0 && !objpool_is_dynamic(pool))
+            words = bitmap_words(pool->capacity);
+        memset(pool->segments[i].occupancy, 0, words * sizeof(u64));
     }
     pool->size = 0;
-    pool->next_insert_index = 0;
+    pool->next_unused = 0;
+    pool->free_head = -1;
 }
 
 void* objpool_add(ObjectPool* pool, i64* out_index) {
-    u32 index = pool->next_insert_index;
-    if (!ensure_capacity(pool, index + 1))
-        return NULL;
-
-    u64 local_index;
-    struct data_block* blk = get_block_from_index(pool->start, index, &local_index);
-    void* ptr = get_obj(blk, local_index, pool->stride);
-    set_allocated(blk, local_index, TRUE, pool->stride);
+    u64 index;
+    u64* word;
+    u64 bit;
+    void* ptr;
+    if (pool->free_head >= 0) {
+        index = pool->free_head;
+        ptr = get_slot(pool, index, &word, &bit);
+        pool->free_head = *(i64*) ptr;
+    } else {
+        if (!ensure_capacity(pool, pool->next_unused + 1))
+            return NULL;
+        index = pool->next_unused++;
+        ptr = get_slot(pool, index, &word, &bit);
+    }
 
+    *word |= bit;
     if (out_index)
         *out_index = index;
-    update_next_available(pool);
     pool->size++;
     return ptr;
 }
 
 bool objpool_remove(ObjectPool* pool, i64 idx) {
-    if (idx < 0 || idx >= pool->capacity)
+    if (idx < 0 || idx >= pool->next_unused)
         return FALSE;
 
-    u64 local_index;
-    struct data_block* blk = get_block_from_index(pool->start, idx, &local_index);
-
-    if (!is_allocated(blk, local_index, pool->stride))
+    u64* word;
+    u64 bit;
+    void* ptr = get_slot(pool, idx, &word, &bit);
+    if (!(*word & bit))
         return FALSE;
 
-    set_allocated(blk, local_index, FALSE, pool->stride);
-    if (idx < pool->next_insert_index)
-        pool->next_insert_index = idx;
+    *word &= ~bit;
+    *(i64*) ptr = pool->free_head;
+    pool->free_head = idx;
     pool->size--;
     return TRUE;
 }
 
 void* objpool_get(ObjectPool* pool, i64 index) {
-    if (index < 0 || index >= pool->capacity)
+    if (index < 0 || index >= pool->next_unused)
         return NULL;
 
-    u64 local_index;
-    struct data_block* blk = get_block_from_index(pool->start, index, &local_index);
-
-    if (!is_allocated(blk, local_index, pool->stride))
+    u64* word;
+    u64 bit;
+    void* ptr = get_slot(pool, index, &word, &bit);
+    if (!(*word & bit))
         return NULL;
-    return get_obj(blk, local_index, pool->stride);
+    return ptr;
 }
 
 void objpool_foreach(const ObjectPool* pool, void (*action)(void*, i64, void*), void* user_data) {
-    u64 size = objpool_size(pool);
-    u64 cap = objpool_cap(pool);
-    u64 i = 0;
-    for (u64 j = 0; j < cap && i < size; ++j) {
-        u64 local_index;
-        struct data_block* blk = get_block_from_index(pool->start, j, &local_index);
-        if (is_allocated(blk, local_index, pool->stride)) {
-            action(get_obj(blk, local_index, pool->stride), j, user_data);
-            i++;
+    u64 start = 0;
+    for (u32 i = 0; i < pool->segment_count && start < pool->next_unused; i++) {
+        const struct pool_segment* segment = &pool->segments[i];
+        u64 capacity = segment_capacity(i, pool->base_log2);
+        u64 used = min_u64(capacity, pool->next_unused - start);
+
+        for (u64 w = 0; w < bitmap_words(used); w++) {
+            // Iterate over set bits only, so empty parts of sparse pools are skipped quickly.
+            u64 word = segment->occupancy[w];
+            while (word) {
+                u64 local_index = w * BITMAP_WORD_BITS + __builtin_ctzll(word);
+                word &= word - 1;
+                action(offsetu(segment->slots, local_index * pool->stride),
+                       start + local_index,
+                       user_data);
+            }
         }
+        start += capacity;
     }
 }
@@ -15,19 +15,36 @@
 #include "definitions.h"
 #include "memory/arena.h"
 
-struct data_block;
+/** Maximum number of segments of an object pool. */
+#define OBJPOOL_MAX_SEGMENTS 32
+
+/**
+ * Segment of an object pool, storing a power-of-two number of slots.
+ */
+struct pool_segment {
+    void* slots;     /**< Slots of the segment. */
+    u64* occupancy;  /**< Bitmap of the slots storing an element. */
+};
 
 /**
  * Structure representing a pool of objects.
+ *
+ * Slots are stored in segments which double in size, and are never moved: pointers to elements
+ * stay valid until they are removed. Finding the slot of an index takes constant time.
+ *
+ * Free slots form an intrusive linked list: each free slot stores the index of the next one,
+ * so adding and removing elements take constant time.
  */
 typedef struct ObjectPool {
-    Arena* arena;             /**< The arena used to allocate new blocks to grow the pool. */
-    struct data_block* start; /**< First block storing elements of this pool. */
-    u32 next_insert_index;    /**< The next index of the current block at which a new element is
-                                 inserted. */
-    u32 capacity;             /**< The total capacity of this vector. */
-    u32 size;                 /**< The number of elements stored inside this vector. */
-    u32 stride;               /**< The size in bytes of elements. */
+    Arena* arena;       /**< The arena used to allocate new segments to grow the pool. */
+    struct pool_segment segments[OBJPOOL_MAX_SEGMENTS]; /**< Directory of segments. */
+    u32 segment_count;  /**< Number of allocated segments. */
+    u32 base_log2;      /**< Base-2 logarithm of the capacity of the first segment. */
+    i64 free_head;      /**< Index of the first free slot which was previously used, or -1. */
+    u32 next_unused;    /**< Index of the first slot which was never used. */
+    u32 capacity;       /**< The total capacity of this pool. */
+    u32 size;           /**< The number of elements stored inside this pool. */
+    u32 stride;         /**< The size in bytes of slots, a multiple of the alignment of arena allocations. */
 } ObjectPool;
 
 /**
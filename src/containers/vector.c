@@ -9,25 +9,26 @@
 #include <stdlib.h>
 #include <string.h>
 
-struct data_block* alloc_block(Arena* arena, u64 capacity, u64 stride, i32 mem_tag) {
-    struct data_block* blk = arena_allocate(arena, sizeof *blk, mem_tag);
-    *blk = (struct data_block){
-        .capacity = capacity,
-        .data = arena_allocate(arena, stride * capacity, mem_tag),
-    };
-    return blk;
+static void* get_segment(const Vector* vector, u32 segment) {
+    return segment == 0 ? vector->first : vector->directory[segment];
 }
 
-struct data_block* get_block_from_index(struct data_block* start, u64 index, u64* out_blk_local_index) {
-    while (index >= start->capacity) {
-        index -= start->capacity;
-        start = start->next;
-    }
-
-    if(out_blk_local_index)
-        *out_blk_local_index = index;
+/**
+ * Gets the slot of an element, without checking the index against the size of the vector.
+ */
+static void* get_slot(const Vector* vector, u64 index) {
+    u64 local_index;
+    u32 segment = segment_of(index, vector->base_log2, &local_index);
+    return offsetu(get_segment(vector, segment), local_index * vector->stride);
+}
 
-    return start;
+static void* allocate(Vector* vector, u64 bytes, bool zeroed) {
+    if (vector->dyn_arena) {
+        return zeroed ? dynarena_callocate(vector->dyn_arena, bytes, ALLOC_TAG_VECTOR)
+                      : dynarena_allocate(vector->dyn_arena, bytes, ALLOC_TAG_VECTOR);
+    }
+    return zeroed ? arena_callocate(vector->arena, bytes, ALLOC_TAG_VECTOR)
+                  : arena_allocate(vector->arena, bytes, ALLOC_TAG_VECTOR);
 }
 
 static bool ensure_capacity(Vector* vector, u64 size) {
@@ -39,201 +40,160 @@ static bool ensure_capacity(Vector* vector, u64 size) {
         return FALSE;
     }
 
-    struct data_block* blk = alloc_block(vector->arena, vector->capacity >> 1, vector->stride, ALLOC_TAG_VECTOR);
-    blk->prev = vector->current;
-    vector->current->next = blk;
-    vector->capacity += blk->capacity;
-
-    if (vector->next_insert_index == vector->current->capacity) {
-        vector->current = vector->current->next;
-        vector->next_insert_index = 0;
+    if (vector->segment_count == SEGMENT_MAX_COUNT) {
+        log_error("Vector has reached its maximum number of segments !");
+        return FALSE;
     }
-    return TRUE;
-}
-
-static void register_addition(Vector* vector) {
-    vector->size++;
-    vector->next_insert_index++;
-}
-
-static void register_removal(Vector* vector) {
-    vector->size--;
 
-    if (vector->next_insert_index == 0) {
-        vector->current = vector->current->prev;
-        vector->next_insert_index = vector->current->capacity;
+    if (!vector->directory) {
+        vector->directory = allocate(vector, SEGMENT_MAX_COUNT * sizeof *vector->directory, TRUE);
     }
 
-    vector->next_insert_index--;
+    u64 capacity = segment_capacity(vector->segment_count, vector->base_log2);
+    vector->directory[vector->segment_count] = allocate(vector, capacity * vector->stride, FALSE);
+    vector->segment_count++;
+    vector->capacity += capacity;
+    return TRUE;
 }
 
-static void
-shift_elements_backwards(Vector* vector, struct data_block* blk, u64 start, u64 global_index) {
+/**
+ * Moves the elements at and after the specified index one slot forward.
+ *
+ * Elements are moved segment by segment, from the last one.
+ */
+static void shift_elements_forwards(Vector* vector, u64 index) {
     u64 stride = vector->stride;
-    global_index += 1;
-    start += 1;
-    if (start == blk->capacity) {
-        blk = blk->next;
-        start = 0;
-    }
-
-    u64 total_to_shift = vector->size - global_index;
-    while (total_to_shift > 0) {
-        u64 end = clamp(start + total_to_shift, start, blk->capacity);
-        void* src = offset(blk->data, start * stride);
-
-        // Copy the first element of the block to the end of the previous block
-        if (start == 0) {
-            struct data_block* prev = blk->prev;
-            if (prev) {
-                void* prev_dst = offset(prev->data, (prev->capacity - 1) * stride);
-                memcpy(prev_dst, src, stride);
-            }
-            src = offset(src, stride);
-            start++;
-            total_to_shift--;
-        }
-        u64 to_shift = end - start;
-
-        void* dst = offset(src, -stride);
-        memmove(dst, src, to_shift * stride);
-        total_to_shift -= to_shift;
-        start = 0;
-        blk = blk->next;
+    u64 end = vector->size;
+    while (end > index) {
+        u64 local_index;
+        segment_of(end - 1, vector->base_log2, &local_index);
+        u64 segment_start = end - 1 - local_index;
+        u64 start = segment_start > index ? segment_start : index;
+
+        // The last element may go to the next segment.
+        memcpy(get_slot(vector, end), get_slot(vector, end - 1), stride);
+        void* src = get_slot(vector, start);
+        memmove(offsetu(src, stride), src, (end - 1 - start) * stride);
+        end = start;
     }
 }
 
-static void shift_elements_forwards(Vector* vector, u64 global_index) {
+/**
+ * Moves the elements after the specified index one slot backwards, overwriting the element at
+ * the index.
+ *
+ * Elements are moved segment by segment, from the first one.
+ */
+static void shift_elements_backwards(Vector* vector, u64 index) {
     u64 stride = vector->stride;
-
-    struct data_block* blk = vector->current;
-    u64 total_to_shift = vector->size - global_index;
-    u64 end = vector->next_insert_index;
-    while (total_to_shift > 0) {
-        u64 start = sub_no_underflow(end, total_to_shift);
-        void* src = offset(blk->data, start * stride);
-
-        // Copy the last element of the block to the start of the next block
-        if (end == blk->capacity) {
-            struct data_block* next = blk->next;
-            if (next) {
-                void* next_dst = next->data; // Index 0, so no offset is necessary
-                memcpy(next_dst, src, stride);
-            }
-            src = offset(src, stride);
-            total_to_shift--;
-            end--;
-        }
-        u64 to_shift = end - start;
-
-        void* dst = offset(src, stride);
-        memmove(dst, src, to_shift * stride);
-
-        total_to_shift -= to_shift;
-        blk = blk->prev;
-        end = blk->capacity;
+    u64 start = index + 1;
+    while (start < vector->size) {
+        u64 local_index;
+        u32 segment = segment_of(start, vector->base_log2, &local_index);
+        u64 segment_end = start - local_index + segment_capacity(segment, vector->base_log2);
+        u64 end = min_u64(segment_end, vector->size);
+
+        // The first element may go to the previous segment.
+        void* src = get_slot(vector, start);
+        memcpy(get_slot(vector, start - 1), src, stride);
+        memmove(src, offsetu(src, stride), (end - start - 1) * stride);
+        start = end;
     }
 }
 
 void vect_init_dynamic(Vector* vector, Arena* arena, u64 initial_capacity, u64 stride) {
-    vector->start = alloc_block(arena, initial_capacity, stride, ALLOC_TAG_VECTOR);
-    vector->current = vector->start;
-    vector->next_insert_index = 0;
-    vector->capacity = initial_capacity;
-    vector->size = 0;
-    vector->stride = stride;
-    vector->arena = arena;
+    u32 base_log2 = segment_base_log2(initial_capacity);
+    u64 capacity = segment_capacity(0, base_log2);
+    *vector = (Vector){
+        .first = arena_allocate(arena, capacity * stride, ALLOC_TAG_VECTOR),
+        .directory = NULL,
+        .segment_count = 1,
+        .base_log2 = base_log2,
+        .capacity = capacity,
+        .size = 0,
+        .stride = stride,
+        .arena = arena,
+    };
+}
+void vect_init_dynarena(Vector* vector, DynamicArena* arena, u64 initial_capacity, u64 stride) {
+    u32 base_log2 = segment_base_log2(initial_capacity);
+    u64 capacity = segment_capacity(0, base_log2);
+    *vector = (Vector){
+        .first = dynarena_allocate(arena, capacity * stride, ALLOC_TAG_VECTOR),
+        .directory = NULL,
+        .segment_count = 1,
+        .base_log2 = base_log2,
+        .capacity = capacity,
+        .size = 0,
+        .stride = stride,
+        .dyn_arena = arena,
+    };
 }
 void vect_init(Vector* vector, Arena* arena, u64 capacity, u64 stride) {
-    vector->start = alloc_block(arena, capacity, stride, ALLOC_TAG_VECTOR);
-    vector->current = vector->start;
-    vector->next_insert_index = 0;
-    vector->capacity = capacity;
-    vector->size = 0;
-    vector->stride = stride;
-    vector->arena = NULL;
+    *vector = (Vector){
+        .first = arena_allocate(arena, capacity * stride, ALLOC_TAG_VECTOR),
+        .directory = NULL,
+        .segment_count = 1,
+        .base_log2 = segment_base_log2(capacity),
+        .capacity = capacity,
+        .size = 0,
+        .stride = stride,
+        .arena = NULL,
+    };
 }
 
 void vect_clear(Vector* vector) {
     vector->size = 0;
-    vector->current = vector->start;
-    vector->next_insert_index = 0;
 }
 
 void vect_add(Vector* vector, const void* element) {
-    u64 stride = vector->stride;
-
-    if (!ensure_capacity(vector, vector->size + 1))
-        return;
-
-    void* dst = offset(vector->current->data, vector->next_insert_index * stride);
-    memcpy(dst, element, stride);
-    register_addition(vector);
+    void* dst = vect_reserve(vector);
+    if (dst)
+        memcpy(dst, element, vector->stride);
 }
 void vect_insert(Vector* vector, const void* element, u64 idx) {
-
+    if (idx > vector->size)
+        return;
     if (!ensure_capacity(vector, vector->size + 1))
         return;
 
-    u64 stride = vector->stride;
-    u64 local_index;
-    struct data_block* blk = get_block_from_index(vector->start, idx, &local_index);
-
     shift_elements_forwards(vector, idx);
-    void* target_addr = offset(blk->data, local_index * stride);
-    memcpy(target_addr, element, stride);
-
-    register_addition(vector);
+    memcpy(get_slot(vector, idx), element, vector->stride);
+    vector->size++;
 }
 
 void* vect_reserve(Vector* vector) {
-    u64 stride = vector->stride;
-
     if (!ensure_capacity(vector, vector->size + 1))
         return NULL;
 
-    void* dst = offset(vector->current->data, vector->next_insert_index * stride);
-    register_addition(vector);
-    return dst;
+    return get_slot(vector, vector->size++);
 }
 
 bool vect_remove(Vector* vector, u64 idx, void* out) {
-    u64 size = vector->size;
-    if (idx >= size)
+    if (idx >= vector->size)
         return FALSE;
 
-    u64 stride = vector->stride;
-
-    u64 local_index;
-    struct data_block* blk = get_block_from_index(vector->start, idx, &local_index);
-
-    void* address = offset(blk->data, local_index * stride);
-
     if (out)
-        memcpy(out, address, stride);
-
-    shift_elements_backwards(vector, blk, local_index, idx);
-
-    register_removal(vector);
+        memcpy(out, get_slot(vector, idx), vector->stride);
 
+    shift_elements_backwards(vector, idx);
+    vector->size--;
     return TRUE;
 }
 
 bool vect_pop(Vector* vector, void* out) {
     bool res = vect_peek(vector, out);
     if (res)
-        register_removal(vector);
+        vector->size--;
     return res;
 }
 
 bool vect_peek(const Vector* vector, void* out) {
     if (vect_size(vector) == 0)
         return FALSE;
-    u64 stride = vect_stride(vector);
-    void* src = offset(vector->current->data, vector->next_insert_index * stride);
 
     if (out)
-        memcpy(out, src, stride);
+        memcpy(out, get_slot(vector, vector->size - 1), vector->stride);
     return TRUE;
 }
 
@@ -245,13 +205,8 @@ bool vect_get(const Vector* vector, u64 index, void* out) {
 }
 
 void* vect_ref(const Vector* vector, u64 index) {
-    u64 size = vector->size;
-    if (index >= size)
+    if (index >= vector->size)
         return NULL;
 
-    u64 stride = vector->stride;
-    u64 local_index;
-    struct data_block* blk = get_block_from_index(vector->start, index, &local_index);
-
-    return offset(blk->data, local_index * stride);
+    return get_slot(vector, index);
 }
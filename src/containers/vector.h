@@ -7,18 +7,25 @@
 
 #include "definitions.h"
 #include "memory/arena.h"
+#include "memory/dyn_arena.h"
 
-struct data_block;
-
+/**
+ * Vector storing elements in segments of power-of-two sizes.
+ *
+ * Static vectors have a single segment. Dynamic vectors add a segment as large as all the
+ * previous ones when they are full, so existing elements are never copied, and pointers to them
+ * stay valid. Finding the segment of an index takes a couple of bit operations.
+ */
 typedef struct vector {
-    struct data_block* start;   /**< Array of blocks storing elements of this vector. */
-    struct data_block* current; /**< The next block in which a new element is inserted. */
-    u32 next_insert_index;        /**< The next index of the current block at which a new element is
-                                     inserted. */
+    void* first;      /**< First segment, always allocated. */
+    void** directory; /**< Other segments, allocated when the vector grows for the first time. */
+    u32 segment_count;            /**< Number of allocated segments. */
+    u32 base_log2;                /**< Base-2 logarithm of the capacity of the first segment. */
     u32 capacity;                 /**< The total capacity of this vector. */
     u32 size;                     /**< The number of elements stored inside this vector. */
     u32 stride;                   /**< The size in bytes of elements. */
     Arena* arena;                 /**< The arena used to allocate new blocks to grow the vector. */
+    DynamicArena* dyn_arena;      /**< Or the dynamic arena used to allocate new blocks. */
 } Vector;
 
 /**
@@ -41,6 +48,16 @@ void vect_init(Vector* vector, Arena* arena, u64 capacity, u64 stride);
 */
 void vect_init_dynamic(Vector* vector, Arena* arena, u64 initial_capacity, u64 stride);
 
+/**
+* Initializes a new dynamic vector, which grows in a dynamic arena.
+*
+* @param[out] vector A pointer to the dynamic vector structure to initialize.
+* @param[in] arena The dynamic arena to use for memory allocations. This is kept by the vector.
+* @param[in] initial_capacity The initial capacity of the vector.
+* @param[in] stride The size in bytes of the elements stored inside the vector.
+*/
+void vect_init_dynarena(Vector* vector, DynamicArena* arena, u64 initial_capacity, u64 stride);
+
 /**
  * Removes all the elements inside the specified vector.
  *
@@ -151,7 +168,7 @@ void* vect_ref(const Vector* vector, u64 index);
  */
 #define vect_add_imm(vector, elem, type)                                                           \
     {                                                                                              \
-        typeof(elem) holder = elem;                                                                \
+        type holder = elem;                                                                        \
         vect_add(vector, &holder);                                                                 \
     }
 
@@ -165,14 +182,14 @@ void* vect_ref(const Vector* vector, u64 index);
  */
 #define vect_insert_imm(vector, elem, idx, type)                                                   \
     {                                                                                              \
-        typeof(elem) holder = elem;                                                                \
+        type holder = elem;                                                                        \
         vect_insert(vector, &holder, idx);                                                         \
     }
 
 #define vect_size(vector) ((vector)->size)
 #define vect_cap(vector) ((vector)->capacity)
 #define vect_stride(vector) ((vector)->stride)
-#define vect_is_dynamic(vector) ((vector)->arena != NULL)
+#define vect_is_dynamic(vector) ((vector)->arena != NULL || (vector)->dyn_arena != NULL)
 
 
 #endif /* ! VECTOR_H */
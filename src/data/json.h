@@ -3,7 +3,7 @@
 
 #include "utils/string.h"
 #include "containers/dict.h"
-#include "memory/arena.h"
+#include "memory/dyn_arena.h"
 #include "containers/vector.h"
 #include "containers/bytebuffer.h"
 
@@ -31,12 +31,20 @@ typedef struct json_node {
     } data;
 } JSONNode;
 
+/**
+ * A JSON tree.
+ *
+ * Nodes, arrays and strings are allocated from a dynamic arena, so the size of a tree
+ * is only limited by the memory available. Objects own a dictionary table, which is
+ * freed by @ref json_destroy.
+ */
 typedef struct json {
     JSONNode* root;
-    Arena* arena;
+    /** Arena of the tree. `NULL` when the tree is destroyed or could not be parsed. */
+    DynamicArena* arena;
 } JSON;
 
-void json_create(JSON* out_json, Arena* arena);
+void json_create(JSON* out_json, DynamicArena* arena);
 void json_destroy(JSON* json);
 
 JSONNode* json_node_create(JSON* json, enum JSONType type);
@@ -93,8 +101,25 @@ bool json_get_float(const JSONNode* node, f64* out);
 bool json_get_bool(const JSONNode* node, bool* out);
 bool json_is_null(const JSONNode* node);
 
-void json_stringify(JSON* json, string* out, Arena* arena);
+/**
+ * Converts a JSON tree to text.
+ *
+ * @param[in] json The tree to convert.
+ * @param[out] out The text of the tree, allocated from @p arena.
+ * @param[in] arena The arena used to allocate the text.
+ */
+void json_stringify(JSON* json, string* out, DynamicArena* arena);
 
-JSON json_parse(ByteBuffer* buffer, Arena* arena);
+/**
+ * Parses a JSON tree from the readable contents of a byte buffer.
+ *
+ * The tree's nodes and strings are allocated from @p arena. Temporary parsing data
+ * is allocated from a separate dynamic arena, and freed before returning.
+ *
+ * @param[in] buffer The buffer to read the JSON text from.
+ * @param[in] arena The arena used to allocate the tree.
+ * @return The parsed tree. Its `arena` is `NULL` if the text is not valid JSON.
+ */
+JSON json_parse(ByteBuffer* buffer, DynamicArena* arena);
 
 #endif /* ! JSON_H */
@@ -1,3 +1,5 @@
+#define LOG_SUBSYSTEM LOG_SUBSYSTEM_JSON
+
 #include "data/json.h"
 #include "json_internal.h"
 
@@ -5,10 +7,11 @@
 #include "containers/vector.h"
 #include "logger.h"
 #include "memory/mem_tags.h"
-#include "utils/str_builder.h"
 #include "utils/string.h"
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 static const char* TYPES[_JSON_COUNT] = {
     [JSON_NULL] = "JSON_NULL",
@@ -20,22 +23,42 @@ static const char* TYPES[_JSON_COUNT] = {
     [JSON_BOOL] = "JSON_BOOL",
 };
 
-static void
-json_node_stringify(JSON* json, const JSONNode* node, StringBuilder* builder, size_t level);
+/**
+ * Text output of the stringifier.
+ *
+ * When `text` is `NULL`, characters are only counted, which gives the size of the buffer
+ * to allocate before writing them.
+ */
+typedef struct json_writer {
+    char* text;
+    u64 length;
+} JSONWriter;
+
+static void json_node_stringify(const JSONNode* node, JSONWriter* writer, size_t level);
+
+static string copy_string(DynamicArena* arena, const char* chars, u64 length) {
+    string copy = {
+        .base = dynarena_allocate(arena, length + 1, ALLOC_TAG_STRING),
+        .length = length,
+    };
+    memcpy(copy.base, chars, length);
+    copy.base[length] = 0;
+    return copy;
+}
 
 JSONNode* json_node_create(JSON* json, enum JSONType type) {
-    Arena* arena = json->arena;
+    DynamicArena* arena = json->arena;
 
-    JSONNode* node = arena_allocate(arena, sizeof(JSONNode), ALLOC_TAG_JSON);
+    JSONNode* node = dynarena_allocate(arena, sizeof(JSONNode), ALLOC_TAG_JSON);
     node->type = type;
     switch (type) {
     case JSON_OBJECT:
-        node->data.obj = arena_allocate(arena, sizeof(Dict), ALLOC_TAG_JSON);
+        node->data.obj = dynarena_allocate(arena, sizeof(Dict), ALLOC_TAG_JSON);
         dict_init(node->data.obj, &CMP_STRING, sizeof(string), sizeof(JSONNode*));
         break;
     case JSON_ARRAY:
-        node->data.array = arena_allocate(arena, sizeof(Vector), ALLOC_TAG_JSON);
-        vect_init_dynamic(node->data.array, arena, 4, sizeof(JSONNode*));
+        node->data.array = dynarena_allocate(arena, sizeof(Vector), ALLOC_TAG_JSON);
+        vect_init_dynarena(node->data.array, arena, 4, sizeof(JSONNode*));
         break;
     case JSON_STRING:
         node->data.string = (string){0};
@@ -53,7 +76,7 @@ JSONNode* json_node_create(JSON* json, enum JSONType type) {
     return node;
 }
 
-void json_create(JSON* out_json, Arena* arena) {
+void json_create(JSON* out_json, DynamicArena* arena) {
     out_json->arena = arena;
     out_json->root = NULL;
 }
@@ -96,7 +119,7 @@ void json_node_destroy(JSONNode* node) {
 void json_destroy(JSON* json) {
     if (json->root) {
         json_node_destroy(json->root);
-        arena_free_ptr(json->arena, json->root);
+        dynarena_free_ptr(json->arena, json->root);
     }
     json->arena = NULL;
     json->root = NULL;
@@ -170,7 +193,7 @@ void json_set_str(JSON* json, JSONNode* node, const string* value) {
         return;
     }
 
-    node->data.string = str_create_copy(value, json->arena);
+    node->data.string = copy_string(json->arena, value->base, value->length);
 }
 
 void json_set_cstr(JSON* json, JSONNode* node, const char* value) {
@@ -181,7 +204,7 @@ void json_set_cstr(JSON* json, JSONNode* node, const char* value) {
         return;
     }
 
-    node->data.string = str_create(value, json->arena);
+    node->data.string = copy_string(json->arena, value, strlen(value));
 }
 void json_set_int(JSONNode* node, long value) {
     if (!json_check_type(node, JSON_INT))
@@ -201,88 +224,104 @@ void json_set_bool(JSONNode* node, bool value) {
     node->data.boolean = value;
 }
 
-static void add_padding(StringBuilder* builder, size_t level) {
+static void write_chars(JSONWriter* writer, const char* chars, u64 length) {
+    if (writer->text)
+        memcpy(writer->text + writer->length, chars, length);
+    writer->length += length;
+}
+
+static void write_cstr(JSONWriter* writer, const char* cstr) {
+    write_chars(writer, cstr, strlen(cstr));
+}
+
+static void write_char(JSONWriter* writer, char c) {
+    write_chars(writer, &c, 1);
+}
+
+static void add_padding(JSONWriter* writer, size_t level) {
     for (size_t i = 0; i < level; i++) {
-        strbuild_appends(builder, "    ");
+        write_chars(writer, "    ", 4);
     }
 }
 
-static void
-json_array_stringify(JSON* json, const JSONNode* array, StringBuilder* builder, size_t level) {
+static void json_array_stringify(const JSONNode* array, JSONWriter* writer, size_t level) {
     Vector* vector = array->data.array;
-    strbuild_appendc(builder, '[');
+    write_char(writer, '[');
     for (size_t i = 0; i < vector->size; i++) {
         JSONNode* elem;
-        strbuild_appendc(builder, '\n');
-        add_padding(builder, level + 1);
+        write_char(writer, '\n');
+        add_padding(writer, level + 1);
         if (vect_get(vector, i, &elem))
-            json_node_stringify(json, elem, builder, level + 1);
+            json_node_stringify(elem, writer, level + 1);
         if (i < vector->size - 1)
-            strbuild_appendc(builder, ',');
+            write_char(writer, ',');
     }
-    strbuild_appendc(builder, '\n');
-    add_padding(builder, level);
-    strbuild_appendc(builder, ']');
+    write_char(writer, '\n');
+    add_padding(writer, level);
+    write_char(writer, ']');
 }
 
 struct stringify_data {
-    JSON* json;
-    StringBuilder* builder;
-    bool linebreaks;
+    JSONWriter* writer;
     size_t level;
 };
 
 static void foreach_stringify(const Dict* dict, size_t idx, void* key, void* value, void* data) {
-    (void) dict;
     struct stringify_data* sdata = data;
     string* name = key;
     JSONNode* node = *(JSONNode**) value;
 
-    add_padding(sdata->builder, sdata->level);
+    add_padding(sdata->writer, sdata->level);
 
-    strbuild_appendc(sdata->builder, '\"');
-    strbuild_append(sdata->builder, name);
-    strbuild_appends(sdata->builder, "\": ");
-    json_node_stringify(sdata->json, node, sdata->builder, sdata->level);
+    write_char(sdata->writer, '\"');
+    write_chars(sdata->writer, name->base, name->length);
+    write_chars(sdata->writer, "\": ", 3);
+    json_node_stringify(node, sdata->writer, sdata->level);
     if (idx < dict->size - 1)
-        strbuild_appendc(sdata->builder, ',');
-    strbuild_appendc(sdata->builder, '\n');
+        write_char(sdata->writer, ',');
+    write_char(sdata->writer, '\n');
 }
 
-static void
-json_node_stringify(JSON* json, const JSONNode* node, StringBuilder* builder, size_t level) {
+static void json_node_stringify(const JSONNode* node, JSONWriter* writer, size_t level) {
     if (!node)
         return;
     switch (node->type) {
     case JSON_BOOL:
-        strbuild_appends(builder, node->data.boolean ? "true" : "false");
+        write_cstr(writer, node->data.boolean ? "true" : "false");
         break;
     case JSON_INT: {
-        strbuild_appendf(builder, "%li", node->data.number);
+        char number[24];
+        snprintf(number, sizeof number, "%li", node->data.number);
+        write_cstr(writer, number);
         break;
     }
     case JSON_FLOAT: {
-        strbuild_appendf(builder, "%g", node->data.fnumber);
+        // The shortest of two representations which reads back as the same number.
+        char number[32];
+        snprintf(number, sizeof number, "%.15g", node->data.fnumber);
+        if (strtod(number, NULL) != node->data.fnumber)
+            snprintf(number, sizeof number, "%.17g", node->data.fnumber);
+        write_cstr(writer, number);
         break;
     }
     case JSON_NULL:
-        strbuild_appends(builder, "null");
+        write_chars(writer, "null", 4);
         break;
     case JSON_STRING:
-        strbuild_appendc(builder, '\"');
-        strbuild_append(builder, &node->data.string);
-        strbuild_appendc(builder, '\"');
+        write_char(writer, '\"');
+        write_chars(writer, node->data.string.base, node->data.string.length);
+        write_char(writer, '\"');
         break;
     case JSON_ARRAY:
-        json_array_stringify(json, node, builder, level);
+        json_array_stringify(node, writer, level);
         break;
 
     case JSON_OBJECT: {
-        struct stringify_data data = {.json = json, .builder = builder, .level = level + 1};
-        strbuild_appends(builder, "{\n");
+        struct stringify_data data = {.writer = writer, .level = level + 1};
+        write_chars(writer, "{\n", 2);
         dict_foreach(node->data.obj, &foreach_stringify, &data);
-        add_padding(builder, level);
-        strbuild_appendc(builder, '}');
+        add_padding(writer, level);
+        write_char(writer, '}');
         break;
     }
     default:
@@ -290,12 +329,22 @@ json_node_stringify(JSON* json, const JSONNode* node, StringBuilder* builder, si
     }
 }
 
-void json_stringify(JSON* json, string* out, Arena* arena) {
-    Arena scratch = *arena;
-    StringBuilder builder = strbuild_create(&scratch);
-    json_node_stringify(json, json->root, &builder, 0);
-    strbuild_appendc(&builder, '\n');
-    *out = strbuild_to_string(&builder, arena);
+void json_stringify(JSON* json, string* out, DynamicArena* arena) {
+    // The tree is walked twice: once to measure the text, once to write it.
+    JSONWriter writer = {0};
+    json_node_stringify(json->root, &writer, 0);
+    write_char(&writer, '\n');
+
+    writer.text = dynarena_allocate(arena, writer.length + 1, ALLOC_TAG_STRING);
+    writer.length = 0;
+    json_node_stringify(json->root, &writer, 0);
+    write_char(&writer, '\n');
+    writer.text[writer.length] = 0;
+
+    *out = (string){
+        .base = writer.text,
+        .length = writer.length,
+    };
 }
 
 JSONNode* json_get_obj(const JSONNode* node, const string* name) {
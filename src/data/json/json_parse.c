@@ -1,19 +1,22 @@
+#define LOG_SUBSYSTEM LOG_SUBSYSTEM_JSON
+
 #include "data/json.h"
 #include "json_internal.h"
 
 #include "containers/bytebuffer.h"
 #include "containers/vector.h"
 #include "logger.h"
-#include "memory/arena.h"
+#include "memory/dyn_arena.h"
+#include "memory/mem_tags.h"
 #include "utils/string.h"
 
 #include <ctype.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <utils/str_builder.h>
 
 #define JSON_MAX_NESTING 32
+#define JSON_MAX_NUMBER_LENGTH 63
 
 enum JSONToken {
     TOK_LBRACE,
@@ -40,6 +43,18 @@ typedef union tok_value {
     string str;
 } TokenValue;
 
+/**
+ * Characters of the string being read, before it is copied in the tree's arena.
+ *
+ * Grows by doubling in the parser's scratch arena, and is reused for every string.
+ */
+typedef struct char_buffer {
+    DynamicArena* arena;
+    char* chars;
+    u64 length;
+    u64 capacity;
+} CharBuffer;
+
 typedef struct parse_info {
     Vector* tok_list;
     Vector* tok_values;
@@ -87,64 +102,102 @@ static bool token_has_value(enum JSONToken token) {
     return token >= TOK_STRING;
 }
 
-static bool lex_string(ByteBuffer* buffer, TokenValue* value, Arena* arena) {
+static void char_buffer_add(CharBuffer* buffer, char c) {
+    if (buffer->length == buffer->capacity) {
+        u64 capacity = buffer->capacity ? buffer->capacity * 2 : 64;
+        char* chars = dynarena_allocate(buffer->arena, capacity, ALLOC_TAG_STRING);
+        if (buffer->length > 0)
+            memcpy(chars, buffer->chars, buffer->length);
+        buffer->chars = chars;
+        buffer->capacity = capacity;
+    }
+    buffer->chars[buffer->length++] = c;
+}
+
+static bool
+lex_string(ByteBuffer* buffer, TokenValue* value, DynamicArena* arena, CharBuffer* chars) {
     char c;
-    Arena scratch = *arena;
-    StringBuilder builder = strbuild_create(&scratch);
+    bool closed = FALSE;
+    chars->length = 0;
     bytebuf_read(buffer, 1, NULL);
-    while (bytebuf_read(buffer, 1, &c) == 1 && c != '"') {
-        strbuild_appendc(&builder, c);
-        if (c == '\\') {
-            bytebuf_read(buffer, 1, NULL);
-            strbuild_appendc(&builder, c);
+    while (bytebuf_read(buffer, 1, &c) == 1) {
+        if (c == '"') {
+            closed = TRUE;
+            break;
         }
+        char_buffer_add(chars, c);
+        if (c == '\\' && bytebuf_read(buffer, 1, &c) == 1)
+            char_buffer_add(chars, c);
     }
-    if (c != '"')
+    if (!closed)
         return FALSE;
 
-    value->str = strbuild_to_string(&builder, arena);
+    // Escape sequences are kept as-is, so strings are written back unchanged.
+    value->str = (string){
+        .base = dynarena_allocate(arena, chars->length + 1, ALLOC_TAG_STRING),
+        .length = chars->length,
+    };
+    if (chars->length > 0)
+        memcpy(value->str.base, chars->chars, chars->length);
+    value->str.base[chars->length] = 0;
 
     return TRUE;
 }
 
-static bool is_valid_number_char(char c, bool frac, bool exponent) {
-    return (c >= '0' && c <= '9') || (!frac && c == '.') || (!exponent && (c == 'e' || c == 'E'));
+static bool is_valid_number_char(char c, char previous, bool frac, bool exponent) {
+    if (c >= '0' && c <= '9')
+        return TRUE;
+    switch (c) {
+    case '.':
+        return !frac && !exponent;
+    case 'e':
+    case 'E':
+        return !exponent;
+    case '-':
+        return previous == 0 || previous == 'e' || previous == 'E';
+    case '+':
+        return previous == 'e' || previous == 'E';
+    default:
+        return FALSE;
+    }
 }
 
-static enum JSONToken lex_number(ByteBuffer* buffer, TokenValue* value, Arena* arena) {
+static enum JSONToken lex_number(ByteBuffer* buffer, TokenValue* value) {
+    char number[JSON_MAX_NUMBER_LENGTH + 1];
+    u64 length = 0;
     bool frac = FALSE;
     bool exponent = FALSE;
 
-    Arena scratch = *arena;
-    StringBuilder builder = strbuild_create(&scratch);
     char c;
-    while (bytebuf_peek(buffer, 1, &c) == 1 && is_valid_number_char(c, frac, exponent)) {
-        bytebuf_read(buffer, 1, &c);
-        strbuild_appendc(&builder, c);
-    }
-    if (c == '.') {
-        if (frac)
+    while (bytebuf_peek(buffer, 1, &c) == 1
+           && is_valid_number_char(c, length > 0 ? number[length - 1] : 0, frac, exponent)) {
+        if (length == JSON_MAX_NUMBER_LENGTH) {
+            log_error("JSON: Lexical error: Number is too long.");
             return TOK_ERROR;
-        frac = TRUE;
-    }
-    if (c == 'e' || c == 'E') {
-        if(exponent)
-            return TOK_ERROR;
-        exponent = TRUE;
+        }
+        bytebuf_read(buffer, 1, NULL);
+        if (c == '.')
+            frac = TRUE;
+        else if (c == 'e' || c == 'E')
+            exponent = TRUE;
+        number[length++] = c;
     }
+    number[length] = 0;
 
-    string parse_res = strbuild_to_string(&builder, &scratch);
-
+    char* end;
     enum JSONToken token;
-    if (frac) {
-        value->floating = strtod(str_printable_buffer(&parse_res), NULL);
+    if (frac || exponent) {
+        value->floating = strtod(number, &end);
         token = TOK_FLOAT;
     } else {
-        value->integer = strtol(str_printable_buffer(&parse_res), NULL, 10);
+        value->integer = strtol(number, &end, 10);
         token = TOK_INT;
     }
+    if (end != number + length) {
+        log_errorf("JSON: Lexical error: Invalid number '%s'.", number);
+        return TOK_ERROR;
+    }
 
-    arena_restore(arena);
     return token;
 }
 
@@ -173,7 +226,8 @@ static bool lex_null(ByteBuffer* buffer) {
     return memcmp(tmp, "null", 4) == 0;
 }
 
-static enum JSONToken lex_token(ByteBuffer* buffer, TokenValue* value, Arena* arena) {
+static enum JSONToken
+lex_token(ByteBuffer* buffer, TokenValue* value, DynamicArena* arena, CharBuffer* chars) {
     char c;
     if (bytebuf_peek(buffer, 1, &c) < 1)
         return TOK_EOF;
@@ -203,7 +257,7 @@ static enum JSONToken lex_token(ByteBuffer* buffer, TokenValue* value, Arena* ar
         bytebuf_read(buffer, 1, NULL);
         return TOK_COLON;
     case '"':
-        if (lex_string(buffer, value, arena))
+        if (lex_string(buffer, value, arena, chars))
             return TOK_STRING;
         else
             return TOK_ERROR;
@@ -223,17 +277,22 @@ static enum JSONToken lex_token(ByteBuffer* buffer, TokenValue* value, Arena* ar
         return TOK_EOF;
     default:
         if ((c >= '0' && c <= '9') || c == '-')
-            return lex_number(buffer, value, arena);
+            return lex_number(buffer, value);
         log_errorf("JSON: Lexical error: Unknown character '%c'.", c);
         return TOK_ERROR;
     }
 }
 
-static bool json_lex(ByteBuffer* buffer, Vector* tok_list, Vector* tok_values, Arena* arena) {
+static bool json_lex(ByteBuffer* buffer,
+                     Vector* tok_list,
+                     Vector* tok_values,
+                     DynamicArena* arena,
+                     DynamicArena* scratch) {
     enum JSONToken token;
     TokenValue value;
+    CharBuffer chars = {.arena = scratch};
     do {
-        token = lex_token(buffer, &value, arena);
+        token = lex_token(buffer, &value, arena, &chars);
         vect_add(tok_list, &token);
         if (token_has_value(token))
             vect_add(tok_values, &value);
@@ -391,15 +450,17 @@ static JSONNode* json_analyze(ParsingInfo* info, u32 nesting_level) {
     }
 }
 
-JSON json_parse(ByteBuffer* buffer, Arena* arena) {
+JSON json_parse(ByteBuffer* buffer, DynamicArena* arena) {
     JSON json;
     json_create(&json, arena);
     Vector tok_list, tok_values;
 
-    vect_init_dynamic(&tok_list, arena, 16, sizeof(enum JSONToken));
-    vect_init_dynamic(&tok_values, arena, 4, sizeof(TokenValue));
+    // Token lists are only needed while parsing, string values are kept in the tree's arena.
+    DynamicArena scratch = dynarena_create(BLK_TAG_UNKNOWN);
+    vect_init_dynarena(&tok_list, &scratch, 16, sizeof(enum JSONToken));
+    vect_init_dynarena(&tok_values, &scratch, 4, sizeof(TokenValue));
 
-    bool success = json_lex(buffer, &tok_list, &tok_values, arena);
+    bool success = json_lex(buffer, &tok_list, &tok_values, arena, &scratch);
 
     if (!success) {
         json_destroy(&json);
@@ -422,5 +483,6 @@ JSON json_parse(ByteBuffer* buffer, Arena* arena) {
     json_set_root(&json, root);
 
 end:
+    dynarena_destroy(&scratch);
     return json;
 }
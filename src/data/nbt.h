@@ -15,6 +15,7 @@
  * #### Initialization
  * Trees can be created by calling the @ref nbt_create function.
  * By default, a newly created NBT tree will contain an empty compound tag.
+ * Trees are allocated in a @ref DynamicArena, so they can hold any number of tags.
  *
  * #### Tag creation
  * You can add child tags to compound tags by calling @ref nbt_put, @ref nbt_put_simple or
@@ -81,8 +82,8 @@
  * @endcode
  * First, we create a new NBT tree :
  * @code{c}
- * Arena arena = arena_create(1 << 15);
- * NBT nbt = nbt_create(&arena, 1024);
+ * DynamicArena arena = dynarena_create(BLK_TAG_UNKNOWN);
+ * NBT nbt = nbt_create(&arena);
  * @endcode
  *
  * Next, we add the first compound tag (named "data"):
@@ -131,8 +132,8 @@
  *
  * Complete code:
  * @code{c}
- * Arena arena = arena_create(1 << 15);
- * NBT nbt = nbt_create(&arena, 1024);
+ * DynamicArena arena = dynarena_create(BLK_TAG_UNKNOWN);
+ * NBT nbt = nbt_create(&arena);
  *
  * string name = str_create_const("data");
  * nbt_put(&nbt, &name, NBT_COMPOUND);
@@ -208,7 +209,7 @@ union NBTSimpleValue {
 
 typedef struct NBT {
     Vector tags;
-    Arena* arena;
+    DynamicArena* arena;
     Vector stack;
 } NBT;
 
@@ -217,11 +218,10 @@ typedef struct NBT {
 /**
 * Creates a new NBT tree.
 *
-* @param[in] arena The arena used to allocate memory for the NBT tree.
-* @param[in] max_token_count Maximum amount of tags (nodes) in this NBT tree.
+* @param[in] arena The dynamic arena used to allocate memory for the NBT tree.
 * @return The newly initialized NBT tree.
 */
-NBT nbt_create(Arena* arena, u64 max_token_count);
+NBT nbt_create(DynamicArena* arena);
 
 /**
 * Adds a simple value tag to the current NBT list.
@@ -362,13 +362,12 @@ enum NBTStatus nbt_to_string(const NBT* nbt, Arena* arena, string* out_str);
 * This function initializes and populates a new NBT tree by reading a file.
 * The file can be compressed using gzip.
 *
-* @param[in] arena The arena used to allocate memory for the tree.
-* @param[in] max_token_count The maximum amount of tags to parse.
+* @param[in] arena The dynamic arena used to allocate memory for the tree.
 * @param[in] path The path to the file to read.
 * @param[out] out_nbt A pointer to an uninitialized NBT tree.
 * @return @ref TRUE if the parsing completed successfully, @ref FALSE if an error occured.
 */
-enum NBTStatus nbt_parse(Arena* arena, i64 max_token_count, const string* path, NBT* out_nbt);
+enum NBTStatus nbt_parse(DynamicArena* arena, const string* path, NBT* out_nbt);
 
 /**
 * Moves the current tag pointer to the child tag with the given name.
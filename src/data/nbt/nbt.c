@@ -2,6 +2,8 @@
 // Created by bmorino on 20/12/2024.
 //
 
+#define LOG_SUBSYSTEM LOG_SUBSYSTEM_NBT
+
 #include "data/nbt.h"
 #include "definitions.h"
 #include "nbt_internal.h"
@@ -12,6 +14,15 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+/** Initial capacity of the tag array and of the selection stack of trees. They grow as needed. */
+#define NBT_INITIAL_CAPACITY 64
+
+static string copy_string(DynamicArena* arena, const string* str) {
+    string copy = nbt_alloc_string(arena, str->length);
+    str_copy(&copy, str);
+    return copy;
+}
+
 static NBTTag* get_current_tag(NBT* nbt) {
     i64 idx;
     if (!vect_peek(&nbt->stack, &idx))
@@ -61,9 +72,9 @@ bool is_not_array(const enum NBTTagType type) {
              type == NBT_LONG_ARRAY);
 }
 
-NBT nbt_create(Arena* arena, u64 max_token_count) {
+NBT nbt_create(DynamicArena* arena) {
     NBT nbt;
-    nbt_init_empty(arena, max_token_count, &nbt);
+    nbt_init_empty(arena, &nbt);
 
     NBTTag* root = vect_reserve(&nbt.tags);
     *root = (NBTTag){
@@ -77,10 +88,17 @@ NBT nbt_create(Arena* arena, u64 max_token_count) {
     return nbt;
 }
 
-void nbt_init_empty(Arena* arena, u64 max_token_count, NBT* out_nbt) {
+void nbt_init_empty(DynamicArena* arena, NBT* out_nbt) {
     out_nbt->arena = arena;
-    vect_init_dynamic(&out_nbt->tags, arena, max_token_count, sizeof(NBTTag));
-    vect_init(&out_nbt->stack, arena, 512, sizeof(i64));
+    vect_init_dynarena(&out_nbt->tags, arena, NBT_INITIAL_CAPACITY, sizeof(NBTTag));
+    vect_init_dynarena(&out_nbt->stack, arena, NBT_INITIAL_CAPACITY, sizeof(i64));
+}
+
+string nbt_alloc_string(DynamicArena* arena, u64 length) {
+    return (string){
+        .base = dynarena_callocate(arena, length + 1, ALLOC_TAG_STRING),
+        .length = length,
+    };
 }
 
 void nbt_add_tag(NBT* nbt, NBTTag* tag) {
@@ -141,7 +159,7 @@ enum NBTStatus nbt_push_str(NBT* nbt, const string* str) {
 
     NBTTag new_tag = {
         .type = tag->data.list.elem_type,
-        .data.str = str_create_copy(str, nbt->arena),
+        .data.str = copy_string(nbt->arena, str),
     };
     vect_add(&nbt->tags, &new_tag);
     tag->data.list.size++;
@@ -174,7 +192,7 @@ nbt_put_simple(NBT* nbt, const string* name, enum NBTTagType type, union NBTSimp
     NBTTag new_tag = {
         .type = type,
         .data.simple = value,
-        .name = str_create_copy(name, nbt->arena),
+        .name = copy_string(nbt->arena, name),
     };
     vect_add(&nbt->tags, &new_tag);
     tag->data.compound.size++;
@@ -187,8 +205,8 @@ enum NBTStatus nbt_put_str(NBT* nbt, const string* name, const string* str) {
 
     NBTTag new_tag = {
         .type = tag->data.list.elem_type,
-        .data.str = str_create_copy(str, nbt->arena),
-        .name = str_create_copy(name, nbt->arena),
+        .data.str = copy_string(nbt->arena, str),
+        .name = copy_string(nbt->arena, name),
     };
     vect_add(&nbt->tags, &new_tag);
     tag->data.compound.size++;
@@ -202,7 +220,7 @@ enum NBTStatus nbt_put(NBT* nbt, const string* name, enum NBTTagType type) {
 
     NBTTag new_tag = {
         .type = type,
-        .name = str_create_copy(name, nbt->arena),
+        .name = copy_string(nbt->arena, name),
     };
     if (type == NBT_COMPOUND)
         new_tag.data.compound.total_tag_length = 1;
@@ -37,11 +37,19 @@ bool is_not_array(const enum NBTTagType type);
 /**
 * Initializes a NBT tree without any root component.
 *
-* @param[in] arena The arena used to allocate memory for the NBT tree.
-* @param[in] max_token_count Maximum amount of tags (nodes) in this NBT tree.
+* @param[in] arena The dynamic arena used to allocate memory for the NBT tree.
 * @param[out] out_nbt A pointer to the NBT tree to initialize. Cannot be `NULL`.
 */
-void nbt_init_empty(Arena* arena, u64 max_token_count, NBT* out_nbt);
+void nbt_init_empty(DynamicArena* arena, NBT* out_nbt);
+
+/**
+* Allocates a string in the arena of a NBT tree.
+*
+* @param[in] arena The dynamic arena of the NBT tree.
+* @param[in] length The number of characters of the string, excluding the null-terminator.
+* @return The new string, filled with null characters.
+*/
+string nbt_alloc_string(DynamicArena* arena, u64 length);
 
 /**
 * Adds a new tag to the underlying array of the tree.
@@ -1,12 +1,14 @@
 //
 // Created by bmorino on 20/12/2024.
 //
+#define LOG_SUBSYSTEM LOG_SUBSYSTEM_NBT
+
 #include "containers/vector.h"
 #include "data/nbt.h"
 #include "data/nbt/nbt_internal.h"
 #include "definitions.h"
 #include "logger.h"
-#include "memory/arena.h"
+#include "memory/dyn_arena.h"
 #include "utils/bitwise.h"
 #include "utils/string.h"
 #include "utils/iomux.h"
@@ -23,7 +25,7 @@ typedef struct NBTWriteContext {
 
 typedef struct NBTReadContext {
     Vector stack;
-    Arena* arena;
+    DynamicArena* arena;
     NBT* nbt;
 } NBTReadContext;
 
@@ -168,12 +170,12 @@ static bool prune_parsing_stack(NBTReadContext* ctx) {
     return TRUE;
 }
 
-static bool read_string(Arena* arena, IOMux fd, string* out_str) {
+static bool read_string(DynamicArena* arena, IOMux fd, string* out_str) {
     u16 name_length;
     if(!ensure_read(fd, &name_length, sizeof name_length))
         return FALSE;
     name_length = untoh16(name_length);
-    *out_str = str_alloc(name_length + 1, arena);
+    *out_str = nbt_alloc_string(arena, name_length);
     if(!ensure_read(fd, out_str->base, name_length))
         return FALSE;
     out_str->length = name_length;
@@ -293,7 +295,9 @@ enum NBTStatus nbt_write(const NBT* nbt, const string* path) {
     NBTWriteContext ctx = {
         .nbt = nbt,
     };
-    vect_init(&ctx.stack, nbt->arena, 512, sizeof(NBTTagMetadata));
+    // The stack is only needed while writing.
+    DynamicArenaSave save = dynarena_save(nbt->arena);
+    vect_init_dynarena(&ctx.stack, nbt->arena, 64, sizeof(NBTTagMetadata));
     for (u32 i = 0; i < nbt->tags.size; i++) {
         ctx.current_index = i;
         nbt_write_tag(&ctx, fd);
@@ -308,6 +312,7 @@ enum NBTStatus nbt_write(const NBT* nbt, const string* path) {
             parent = vect_ref(&ctx.stack, ctx.stack.size - 1);
         }
     }
+    dynarena_restore(nbt->arena, save);
     iomux_close(fd);
     return NBTE_OK;
 }
@@ -410,7 +415,7 @@ static bool nbt_parse_tag(IOMux fd, NBTReadContext* ctx, enum NBTTagType type) {
     return TRUE;
 }
 
-enum NBTStatus nbt_parse(Arena* arena, i64 max_token_count, const string* path, NBT* out_nbt) {
+enum NBTStatus nbt_parse(DynamicArena* arena, const string* path, NBT* out_nbt) {
     IOMux fd = iomux_gz_open(path, "rb");
     if(fd == -1) {
         log_errorf("NBT: IO Error: %s", strerror(errno));
@@ -421,9 +426,9 @@ enum NBTStatus nbt_parse(Arena* arena, i64 max_token_count, const string* path,
         .arena = arena,
         .nbt = out_nbt,
     };
-    vect_init(&ctx.stack, arena, 512, sizeof(NBTTagMetadata));
+    vect_init_dynarena(&ctx.stack, arena, 64, sizeof(NBTTagMetadata));
 
-    nbt_init_empty(arena, max_token_count, out_nbt);
+    nbt_init_empty(arena, out_nbt);
 
     do {
         const enum NBTTagType type = parse_type(fd, &ctx);
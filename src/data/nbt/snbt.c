@@ -1,3 +1,5 @@
+#define LOG_SUBSYSTEM LOG_SUBSYSTEM_NBT
+
 #include "data/nbt.h"
 #include "nbt_internal.h"
 #include "utils/iomux.h"
@@ -126,13 +128,13 @@ enum NBTStatus nbt_write_snbt(const NBT* nbt, const string* path) {
         return NBTE_IO;
     }
 
-    Arena scratch = arena_create(1 << 18, BLK_TAG_UNKNOWN);
+    DynamicArena scratch = dynarena_create(BLK_TAG_UNKNOWN);
 
     SNBTContext ctx = {
         .pretty_print = TRUE,
         .spaces_per_indent = 4,
     };
-    vect_init(&ctx.stack, &scratch, 512, sizeof(SNBTMetadata));
+    vect_init_dynarena(&ctx.stack, &scratch, 64, sizeof(SNBTMetadata));
 
     for (u32 i = 0; i < nbt->tags.size; i++) {
         const NBTTag* tag = nbt_ref(nbt, i);
@@ -162,7 +164,7 @@ enum NBTStatus nbt_write_snbt(const NBT* nbt, const string* path) {
         }
     }
 
-    arena_destroy(&scratch);
+    dynarena_destroy(&scratch);
     iomux_close(fd);
     return NBTE_OK;
 }
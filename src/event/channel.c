@@ -0,0 +1,126 @@
+#include "channel.h"
+
+#include <sched.h>
+
+/** Number of times a producer retries to push an item before waiting for the channel to drain. */
+#define PUSH_SPIN_COUNT 64
+
+/*
+  Wake-ups rely on each side publishing its state before checking the other's:
+  a sleeping side sets its flag, then checks the queue again under the mutex;
+  the other side modifies the queue, then reads the flag, and only takes the mutex if it is set.
+  The sequentially consistent fences make sure at least one of them sees the other's write.
+ */
+
+void channel_init(Channel* channel, u32 capacity, u32 stride, Arena* arena) {
+    channel->queue = mpscq_create(capacity, stride, arena);
+    pthread_mutex_init(&channel->mutex, NULL);
+    pthread_cond_init(&channel->not_empty, NULL);
+    pthread_cond_init(&channel->not_full, NULL);
+    atomic_init(&channel->idle, FALSE);
+    atomic_init(&channel->blocked_producers, 0);
+    atomic_init(&channel->notified, FALSE);
+    atomic_init(&channel->closed, FALSE);
+}
+
+void channel_destroy(Channel* channel) {
+    pthread_mutex_destroy(&channel->mutex);
+    pthread_cond_destroy(&channel->not_empty);
+    pthread_cond_destroy(&channel->not_full);
+}
+
+/**
+ * Sleeps until the consumer pops items, unless @p item can be pushed.
+ *
+ * @return @ref TRUE if @p item was pushed.
+ */
+static bool wait_for_space(Channel* channel, const void* item) {
+    pthread_mutex_lock(&channel->mutex);
+    atomic_fetch_add(&channel->blocked_producers, 1);
+    atomic_thread_fence(memory_order_seq_cst);
+
+    bool pushed = mpscq_try_enqueue(&channel->queue, item);
+    if (!pushed && !atomic_load(&channel->closed))
+        pthread_cond_wait(&channel->not_full, &channel->mutex);
+
+    atomic_fetch_sub(&channel->blocked_producers, 1);
+    pthread_mutex_unlock(&channel->mutex);
+    return pushed;
+}
+
+static void wake_consumer(Channel* channel) {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (!atomic_load_explicit(&channel->idle, memory_order_relaxed))
+        return;
+    pthread_mutex_lock(&channel->mutex);
+    pthread_cond_signal(&channel->not_empty);
+    pthread_mutex_unlock(&channel->mutex);
+}
+
+static void wake_producers(Channel* channel) {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&channel->blocked_producers, memory_order_relaxed) == 0)
+        return;
+    pthread_mutex_lock(&channel->mutex);
+    pthread_cond_broadcast(&channel->not_full);
+    pthread_mutex_unlock(&channel->mutex);
+}
+
+/**
+ * Sleeps until the channel has items, is closed, or the consumer is notified.
+ */
+static void wait_for_items(Channel* channel) {
+    pthread_mutex_lock(&channel->mutex);
+    atomic_store(&channel->idle, TRUE);
+    atomic_thread_fence(memory_order_seq_cst);
+    while (mpscq_is_empty(&channel->queue) && !atomic_load(&channel->closed) &&
+           !atomic_load(&channel->notified))
+        pthread_cond_wait(&channel->not_empty, &channel->mutex);
+    atomic_store(&channel->idle, FALSE);
+    pthread_mutex_unlock(&channel->mutex);
+}
+
+bool channel_push(Channel* channel, const void* item) {
+    u32 attempts = 0;
+    while (TRUE) {
+        if (atomic_load_explicit(&channel->closed, memory_order_relaxed))
+            return FALSE;
+        if (mpscq_try_enqueue(&channel->queue, item))
+            break;
+        if (++attempts < PUSH_SPIN_COUNT) {
+            sched_yield();
+            continue;
+        }
+        if (wait_for_space(channel, item))
+            break;
+    }
+
+    wake_consumer(channel);
+    return TRUE;
+}
+
+u32 channel_pop_batch(Channel* channel, void* out_items, u32 max) {
+    while (TRUE) {
+        u32 count = mpscq_dequeue_batch(&channel->queue, out_items, max);
+        if (count > 0) {
+            wake_producers(channel);
+            return count;
+        }
+        if (atomic_exchange(&channel->notified, FALSE) || atomic_load(&channel->closed))
+            return 0;
+        wait_for_items(channel);
+    }
+}
+
+void channel_notify(Channel* channel) {
+    atomic_store(&channel->notified, TRUE);
+    wake_consumer(channel);
+}
+
+void channel_close(Channel* channel) {
+    pthread_mutex_lock(&channel->mutex);
+    atomic_store(&channel->closed, TRUE);
+    pthread_cond_broadcast(&channel->not_empty);
+    pthread_cond_broadcast(&channel->not_full);
+    pthread_mutex_unlock(&channel->mutex);
+}
@@ -0,0 +1,88 @@
+/**
+ * @file
+ * @ingroup event
+ *
+ * Blocking channels, used to hand events and tasks over to the threads of the event sub-system.
+ *
+ * A channel is a bounded lock-free MPSC queue (see @ref MPSCQueue) with the ability to wait:
+ * the consumer sleeps while the channel is empty, and producers sleep while it is full,
+ * so nothing is ever dropped. The wait mutex is only taken when one side actually sleeps.
+ */
+#ifndef CHANNEL_H
+#define CHANNEL_H
+
+#include "containers/mpsc_queue.h"
+#include "definitions.h"
+#include "memory/arena.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+typedef struct Channel {
+    MPSCQueue queue;
+    pthread_mutex_t mutex;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    _Atomic bool idle;               /**< Whether the consumer sleeps. */
+    _Atomic u32 blocked_producers;   /**< Number of producers sleeping. */
+    _Atomic bool notified;           /**< Whether the consumer was notified, see @ref channel_notify. */
+    _Atomic bool closed;
+} Channel;
+
+/**
+ * Initializes a channel.
+ *
+ * @param[out] channel The channel to initialize.
+ * @param capacity The minimum number of items the channel can hold.
+ * @param stride The size of an item, in bytes.
+ * @param[in] arena The arena used to allocate the channel's queue.
+ */
+void channel_init(Channel* channel, u32 capacity, u32 stride, Arena* arena);
+
+/**
+ * Releases the synchronization primitives of a channel.
+ *
+ * No thread may use the channel anymore.
+ */
+void channel_destroy(Channel* channel);
+
+/**
+ * Adds an item at the end of a channel, waiting for the consumer if the channel is full.
+ *
+ * Safe to call from any number of threads at the same time.
+ *
+ * @param[in] channel The channel to push an item to.
+ * @param[in] item A pointer to the item to copy into the channel.
+ * @return @ref TRUE if the item was added, @ref FALSE if the channel is closed.
+ */
+bool channel_push(Channel* channel, const void* item);
+
+/**
+ * Removes up to @p max items from the start of a channel, waiting for items if the channel is empty.
+ *
+ * Must only be called by the consumer thread.
+ *
+ * @param[in] channel The channel to pop items from.
+ * @param[out] out_items A buffer able to hold @p max items.
+ * @param max The maximum number of items to remove.
+ * @return The number of removed items, `0` once the channel is closed and empty, or if the consumer
+ * was notified while the channel was empty.
+ */
+u32 channel_pop_batch(Channel* channel, void* out_items, u32 max);
+
+/**
+ * Wakes the consumer up, even if the channel is empty: its current or next call to
+ * @ref channel_pop_batch returns as soon as the channel is empty.
+ *
+ * This lets producers hand over items through other means when they must not wait for the channel.
+ */
+void channel_notify(Channel* channel);
+
+/**
+ * Closes a channel: pushing fails, and the consumer stops waiting once the channel is empty.
+ *
+ * All waiting threads are woken up.
+ */
+void channel_close(Channel* channel);
+
+#endif /* ! CHANNEL_H */
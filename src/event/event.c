@@ -1,74 +1,355 @@
+#define LOG_SUBSYSTEM LOG_SUBSYSTEM_EVENT
+
 #include "event.h"
-#include "containers/dict.h"
-#include "containers/ring_queue.h"
+#include "channel.h"
+#include "containers/dict_template.h"
 #include "containers/vector.h"
 #include "logger.h"
 #include "memory/arena.h"
 #include "memory/mem_tags.h"
+#include "platform/mc_thread.h"
+#include "trace.h"
+#include "utils/hash.h"
 
-#include <pthread.h>
 #include <stdio.h>
+#include <stdlib.h>
 
+#define EVENT_ARENA_SIZE (96L << 20)
+#define DEFERRED_ARENA_SIZE (64L << 20)
 #define MAX_EVENT_COUNT 256
-#define MAX_TRIGGERED_EVENTS 32
+#define MAX_LISTENER_COUNT 256
+#define MAX_EXECUTOR_COUNT 16
+#define EVENT_WORKER_COUNT 4
+#define EVENT_QUEUE_CAPACITY 4096
+#define EXECUTOR_QUEUE_CAPACITY 1024
+/** Maximum number of events (or tasks) dequeued at once. */
+#define EVENT_BATCH_SIZE 64
+#define MAX_PAYLOAD_RINGS 64
+#define PAYLOAD_RING_SIZE (1L << 20)
+
+/*
+  Triggered events go through a lock-free channel: producers never wait for listeners,
+  unless the channel is full.
+  The handling thread pops events in batches, resolves their listeners while holding the
+  registration mutex, then runs the listeners without any lock.
+  Listener arrays are allocated once per event type and only appended to, so the listeners
+  resolved for a batch stay valid while it is dispatched.
+
+  Listeners which do not run on the handling thread are turned into tasks, pushed to the channel
+  of an executor. Each executor is a thread running its tasks in order:
+  - workers run listeners with the worker affinity. Events with a key always go to the same worker,
+    so they stay in order; events without a key are spread over all workers.
+  - named serial executors run all the listeners registered on them, in the order events were triggered.
+
+  The handling thread and executors must not wait for the event queue to drain: the handling thread
+  would wait for itself, and an executor could wait for the handling thread while it waits for the
+  executor's tasks to drain. Events they trigger are deferred instead: appended to a list, which the
+  handling thread swaps with an empty one and dispatches before popping events from the queue.
+
+  Event payloads are allocated in a ring buffer owned by the producer thread. Each payload has a
+  reference count: one for the triggered event, released once listeners of the handling thread
+  have run, and one per task pushed to an executor. Only the owner of a ring moves its head and tail:
+  when allocating, it first reclaims the payloads at the tail whose count dropped to zero.
+  Rings are handed over to other threads when their owner exits.
+ */
+
+typedef struct Executor Executor;
 
 typedef struct EventListener {
     void* user_data;
     event_listener handler;
+    enum EventAffinityType affinity;
+    /** The executor running the listener, for @ref EVENT_AFFINITY_SERIAL. */
+    Executor* executor;
 } EventListener;
 
 typedef struct EventEntry {
-    Vector listeners;
+    EventListener* listeners;
+    u32 listener_count;
     string name;
 } EventEntry;
 
+static inline u64 event_code_hash(const u32* code) {
+    return hash_u32(*code);
+}
+
+static inline bool event_code_equals(const u32* lhs, const u32* rhs) {
+    return *lhs == *rhs;
+}
+
+DICT_DEFINE(EventRegistry, evreg, u32, EventEntry, event_code_hash, event_code_equals)
+
 typedef struct TriggeredEvent {
     EventInfo info;
     u32 code;
 } TriggeredEvent;
 
+/**
+ * Header preceding each payload.
+ */
+struct payload_header {
+    /** Size of the block in the ring, header included. */
+    u64 block_size;
+    u64 payload_size;
+    _Atomic u32 references;
+    bool heap;
+};
+
+/** Size of payload headers. Blocks are multiples of this size, so padding can hold a header. */
+#define PAYLOAD_HEADER_SIZE 32
+
+_Static_assert(sizeof(struct payload_header) <= PAYLOAD_HEADER_SIZE, "Payload header is too large");
+
+typedef struct PayloadRing {
+    u8* buffer;
+    u64 head; /**< Number of bytes allocated since the creation of the ring. */
+    u64 tail; /**< Number of bytes reclaimed since the creation of the ring. */
+    /** Whether a thread owns the ring, protected by the registration mutex. */
+    bool in_use;
+} PayloadRing;
+
+/**
+ * Call of a listener, run by an executor.
+ */
+typedef struct EventTask {
+    event_listener handler;
+    void* user_data;
+    TriggeredEvent event;
+} EventTask;
+
+struct Executor {
+    string name;
+    Channel tasks;
+    MCThread thread;
+};
+
+/**
+ * Listeners of a dequeued event, resolved before the event is dispatched.
+ */
+typedef struct ListenerSpan {
+    const EventListener* listeners;
+    u32 count;
+    bool registered;
+} ListenerSpan;
+
 typedef struct EventContext {
     Arena arena;
-    Dict event_registry;
+    EventRegistry event_registry;
+    /** Protects the event registry, listener arrays and executors. */
     pthread_mutex_t mutex;
-    pthread_cond_t cond_var;
-    RingQueue queue;
-    bool running;
+    Channel queue;
+
+    Executor workers[EVENT_WORKER_COUNT];
+    bool workers_started;
+    u32 next_worker;
+    Executor executors[MAX_EXECUTOR_COUNT];
+    u32 executor_count;
+
+    PayloadRing rings[MAX_PAYLOAD_RINGS];
+    u32 ring_count;
+    /** Ring of the calling thread. Its destructor hands the ring over when the thread exits. */
+    pthread_key_t ring_key;
+
+    Arena deferred_arena;
+    pthread_mutex_t deferred_mutex;
+    Vector deferred; /**< Events deferred since the last swap, protected by the deferred mutex. */
+    Vector draining; /**< Deferred events being dispatched by the handling thread. */
+    _Atomic u64 deferred_count;
 } EventContext;
 
 static EventContext ctx;
 
+/** Whether the calling thread is the event handling thread or an executor. */
+static _Thread_local bool dispatching_thread;
+
+static struct payload_header* payload_header(void* payload) {
+    return (struct payload_header*) ((u8*) payload - PAYLOAD_HEADER_SIZE);
+}
+
+static void retain_payload(void* payload) {
+    if (payload)
+        atomic_fetch_add_explicit(&payload_header(payload)->references, 1, memory_order_relaxed);
+}
+
+static void release_payload(void* payload) {
+    if (!payload)
+        return;
+    struct payload_header* header = payload_header(payload);
+    // Ring blocks may be reused as soon as the count drops to zero: read the header before.
+    bool heap = header->heap;
+    if (atomic_fetch_sub_explicit(&header->references, 1, memory_order_acq_rel) == 1 && heap)
+        free(header);
+}
+
+static struct payload_header* ring_header(const PayloadRing* ring, u64 position) {
+    return (struct payload_header*) (ring->buffer + position % PAYLOAD_RING_SIZE);
+}
+
+/**
+ * Reclaims the released payloads at the tail of a ring.
+ */
+static void ring_reclaim(PayloadRing* ring) {
+    while (ring->tail != ring->head) {
+        struct payload_header* header = ring_header(ring, ring->tail);
+        if (atomic_load_explicit(&header->references, memory_order_acquire) != 0)
+            break;
+        ring->tail += header->block_size;
+    }
+}
+
+static struct payload_header* ring_allocate(PayloadRing* ring, u64 block_size) {
+    ring_reclaim(ring);
+
+    // Blocks are contiguous: skip the end of the buffer if the block does not fit.
+    u64 offset = ring->head % PAYLOAD_RING_SIZE;
+    u64 padding = offset + block_size > PAYLOAD_RING_SIZE ? PAYLOAD_RING_SIZE - offset : 0;
+    if (ring->head - ring->tail + padding + block_size > PAYLOAD_RING_SIZE)
+        return NULL;
+
+    if (padding > 0) {
+        struct payload_header* header = ring_header(ring, ring->head);
+        header->block_size = padding;
+        atomic_init(&header->references, 0);
+        ring->head += padding;
+    }
+    struct payload_header* header = ring_header(ring, ring->head);
+    header->block_size = block_size;
+    header->heap = FALSE;
+    ring->head += block_size;
+    return header;
+}
+
+static void release_ring(void* ring) {
+    pthread_mutex_lock(&ctx.mutex);
+    ((PayloadRing*) ring)->in_use = FALSE;
+    pthread_mutex_unlock(&ctx.mutex);
+}
+
+/**
+ * Retrieves the ring of the calling thread, or takes one over.
+ *
+ * @return The ring, or `NULL` if all rings are in use.
+ */
+static PayloadRing* get_local_ring(void) {
+    PayloadRing* ring = pthread_getspecific(ctx.ring_key);
+    if (ring)
+        return ring;
+
+    pthread_mutex_lock(&ctx.mutex);
+    for (u32 i = 0; i < ctx.ring_count; i++) {
+        if (!ctx.rings[i].in_use) {
+            ring = &ctx.rings[i];
+            break;
+        }
+    }
+    if (!ring && ctx.ring_count < MAX_PAYLOAD_RINGS) {
+        ring = &ctx.rings[ctx.ring_count++];
+        ring->buffer = arena_allocate(&ctx.arena, PAYLOAD_RING_SIZE, ALLOC_TAG_UNKNOWN);
+        ring->head = 0;
+        ring->tail = 0;
+    }
+    if (ring)
+        ring->in_use = TRUE;
+    pthread_mutex_unlock(&ctx.mutex);
+
+    if (ring)
+        pthread_setspecific(ctx.ring_key, ring);
+    return ring;
+}
+
+void* event_payload_alloc(u64 size) {
+    u64 block_size = (PAYLOAD_HEADER_SIZE + size + PAYLOAD_HEADER_SIZE - 1) & ~(u64) (PAYLOAD_HEADER_SIZE - 1);
+
+    struct payload_header* header = NULL;
+    if (block_size <= PAYLOAD_RING_SIZE) {
+        PayloadRing* ring = get_local_ring();
+        if (ring)
+            header = ring_allocate(ring, block_size);
+    }
+    if (!header) {
+        header = malloc(PAYLOAD_HEADER_SIZE + size);
+        if (!header)
+            return NULL;
+        header->block_size = 0;
+        header->heap = TRUE;
+    }
+    header->payload_size = size;
+    atomic_init(&header->references, 1);
+    return (u8*) header + PAYLOAD_HEADER_SIZE;
+}
+
 static void register_builtin_events(void) {
     event_register_event(BEVENT_STOP, str_create_view("STOP"));
 }
 
 void event_system_init(void) {
-    ctx.arena = arena_create(1L << 20, BLK_TAG_EVENT);
-
-    dict_init_fixed(
-                    &ctx.event_registry, NULL, &ctx.arena, MAX_EVENT_COUNT, sizeof(u32), sizeof(EventEntry));
-    ctx.queue = rqueue_create(MAX_TRIGGERED_EVENTS, sizeof(TriggeredEvent), &ctx.arena);
+    ctx.arena = arena_create_reserved(EVENT_ARENA_SIZE, BLK_TAG_EVENT, FALSE);
 
+    evreg_init_fixed(&ctx.event_registry, &ctx.arena, MAX_EVENT_COUNT);
+    channel_init(&ctx.queue, EVENT_QUEUE_CAPACITY, sizeof(TriggeredEvent), &ctx.arena);
     pthread_mutex_init(&ctx.mutex, 0);
-    pthread_cond_init(&ctx.cond_var, 0);
+    ctx.workers_started = FALSE;
+    ctx.next_worker = 0;
+    ctx.executor_count = 0;
+    ctx.ring_count = 0;
+    pthread_key_create(&ctx.ring_key, &release_ring);
+
+    ctx.deferred_arena = arena_create_reserved(DEFERRED_ARENA_SIZE, BLK_TAG_EVENT, FALSE);
+    pthread_mutex_init(&ctx.deferred_mutex, 0);
+    vect_init_dynamic(&ctx.deferred, &ctx.deferred_arena, 64, sizeof(TriggeredEvent));
+    vect_init_dynamic(&ctx.draining, &ctx.deferred_arena, 64, sizeof(TriggeredEvent));
+    atomic_init(&ctx.deferred_count, 0);
 
     register_builtin_events();
 
-    ctx.running = TRUE;
     log_debug("Event subsystem initialized.");
 }
 
+static void* run_executor(void* arg) {
+    Executor* executor = arg;
+    char thread_name[16];
+    snprintf(thread_name, sizeof thread_name, "ev:%s", executor->name.base);
+    mcthread_set_name(thread_name);
+    dispatching_thread = TRUE;
+
+    EventTask batch[EVENT_BATCH_SIZE];
+    u32 count;
+    while ((count = channel_pop_batch(&executor->tasks, batch, EVENT_BATCH_SIZE)) > 0) {
+        for (u32 i = 0; i < count; i++) {
+            TRACE_SCOPE("run_listener");
+            const EventTask* task = &batch[i];
+            task->handler(task->event.code, task->user_data, task->event.info);
+            release_payload(task->event.info.payload);
+        }
+    }
+    return NULL;
+}
+
+static void start_executor(Executor* executor, string name) {
+    executor->name = str_create_copy(&name, &ctx.arena);
+    channel_init(&executor->tasks, EXECUTOR_QUEUE_CAPACITY, sizeof(EventTask), &ctx.arena);
+    mcthread_create(&executor->thread, &run_executor, executor);
+}
+
+/**
+ * Runs the remaining tasks of an executor, then stops its thread.
+ */
+static void stop_executor(Executor* executor) {
+    channel_close(&executor->tasks);
+    mcthread_join(&executor->thread, NULL);
+    channel_destroy(&executor->tasks);
+}
+
 static void broadcast_stop_event(void) {
     u32 code          = BEVENT_STOP;
-    i64 idx           = dict_get(&ctx.event_registry, &code, NULL);
-    EventEntry* entry = dict_ref(&ctx.event_registry, idx);
+    EventEntry* entry = evreg_ref(&ctx.event_registry, &code);
 
     EventInfo info = {
         .event_data = {},
         .sender     = NULL,
     };
-    for (u32 i = 0; i < entry->listeners.size; i++) {
-        EventListener* listener = vect_ref(&entry->listeners, i);
+    for (u32 i = 0; i < entry->listener_count; i++) {
+        EventListener* listener = &entry->listeners[i];
         listener->handler(BEVENT_STOP, listener->user_data, info);
     }
 }
@@ -76,30 +357,85 @@ static void broadcast_stop_event(void) {
 void event_system_cleanup(void) {
     broadcast_stop_event();
 
+    if (ctx.workers_started) {
+        for (u32 i = 0; i < EVENT_WORKER_COUNT; i++) {
+            stop_executor(&ctx.workers[i]);
+        }
+    }
+    for (u32 i = 0; i < ctx.executor_count; i++) {
+        stop_executor(&ctx.executors[i]);
+    }
+
+    // Release the heap payloads of events which were never handled.
+    TriggeredEvent e;
+    while (mpscq_dequeue(&ctx.queue.queue, &e)) {
+        release_payload(e.info.payload);
+    }
+    for (u64 i = 0; i < ctx.deferred.size; i++) {
+        vect_get(&ctx.deferred, i, &e);
+        release_payload(e.info.payload);
+    }
+
+    pthread_key_delete(ctx.ring_key);
+    channel_destroy(&ctx.queue);
     arena_destroy(&ctx.arena);
+    arena_destroy(&ctx.deferred_arena);
 
     pthread_mutex_destroy(&ctx.mutex);
-    pthread_cond_destroy(&ctx.cond_var);
+    pthread_mutex_destroy(&ctx.deferred_mutex);
 }
 
 void event_register_event(u32 code, string name) {
     pthread_mutex_lock(&ctx.mutex);
 
-    i64 idx = dict_get(&ctx.event_registry, &code, NULL);
-    if (idx >= 0) {
+    if (evreg_ref(&ctx.event_registry, &code)) {
         log_errorf("Can not register the already registered event %u.", code);
         pthread_mutex_unlock(&ctx.mutex);
         return;
     }
     EventEntry e;
     e.name = name;
-    vect_init(&e.listeners, &ctx.arena, 256, sizeof(EventListener));
-    dict_put(&ctx.event_registry, &code, &e);
+    e.listeners = arena_allocate(&ctx.arena, MAX_LISTENER_COUNT * sizeof(EventListener), ALLOC_TAG_UNKNOWN);
+    e.listener_count = 0;
+    if (!evreg_put(&ctx.event_registry, &code, &e))
+        log_errorf("Can not register event %u, too many events are registered.", code);
 
     pthread_mutex_unlock(&ctx.mutex);
 }
 
+/**
+ * Finds the serial executor with the given name, or starts it.
+ * Must be called with the registration mutex held.
+ */
+static Executor* get_executor(string name) {
+    for (u32 i = 0; i < ctx.executor_count; i++) {
+        if (str_compare(&ctx.executors[i].name, &name) == 0)
+            return &ctx.executors[i];
+    }
+    if (ctx.executor_count == MAX_EXECUTOR_COUNT)
+        return NULL;
+
+    Executor* executor = &ctx.executors[ctx.executor_count++];
+    start_executor(executor, name);
+    log_debugf("Started event executor '%s'.", executor->name.base);
+    return executor;
+}
+
+static void start_workers(void) {
+    char name[8];
+    for (u32 i = 0; i < EVENT_WORKER_COUNT; i++) {
+        snprintf(name, sizeof name, "w%u", i);
+        start_executor(&ctx.workers[i], str_create_view(name));
+    }
+    ctx.workers_started = TRUE;
+    log_debugf("Started %u event workers.", EVENT_WORKER_COUNT);
+}
+
 void event_register_listener(u32 code, event_listener handler, void* data) {
+    event_register_listener_on(code, handler, data, EVENT_ON_MAIN);
+}
+
+void event_register_listener_on(u32 code, event_listener handler, void* data, EventAffinity affinity) {
     if(code == BEVENT_STOP) {
         log_error("The STOP event cannot be listened to.");
         return;
@@ -112,73 +448,187 @@ void event_register_listener(u32 code, event_listener handler, void* data) {
 
     pthread_mutex_lock(&ctx.mutex);
 
-    i64 idx = dict_get(&ctx.event_registry, &code, NULL);
-    if (idx == -1) {
+    EventEntry* e = evreg_ref(&ctx.event_registry, &code);
+    if (!e) {
         log_errorf("Cannot register listener for unregistered event %u.", code);
         pthread_mutex_unlock(&ctx.mutex);
         return;
     }
-    EventEntry* e = dict_ref(&ctx.event_registry, idx);
+    if (e->listener_count == MAX_LISTENER_COUNT) {
+        log_errorf("Cannot register listener for event %u, too many listeners are registered.", code);
+        pthread_mutex_unlock(&ctx.mutex);
+        return;
+    }
 
     EventListener listener = {
         .user_data = data,
         .handler   = handler,
+        .affinity  = affinity.type,
+        .executor  = NULL,
     };
-    vect_add(&e->listeners, &listener);
+    switch (affinity.type) {
+    case EVENT_AFFINITY_MAIN:
+        break;
+    case EVENT_AFFINITY_WORKER:
+        if (!ctx.workers_started)
+            start_workers();
+        break;
+    case EVENT_AFFINITY_SERIAL:
+        listener.executor = get_executor(affinity.executor);
+        if (!listener.executor) {
+            log_errorf("Cannot register listener for event %u, too many executors are running.", code);
+            pthread_mutex_unlock(&ctx.mutex);
+            return;
+        }
+        break;
+    }
+    e->listeners[e->listener_count] = listener;
+    e->listener_count++;
 
     pthread_mutex_unlock(&ctx.mutex);
 }
 
+/**
+ * Triggers an event from the handling thread or an executor.
+ */
+static void defer_event(const TriggeredEvent* e) {
+    if (atomic_load(&ctx.queue.closed)) {
+        log_warnf("Event %u triggered after the event handling thread stopped.", e->code);
+        release_payload(e->info.payload);
+        return;
+    }
+
+    pthread_mutex_lock(&ctx.deferred_mutex);
+    vect_add(&ctx.deferred, e);
+    atomic_store(&ctx.deferred_count, ctx.deferred.size);
+    pthread_mutex_unlock(&ctx.deferred_mutex);
+
+    channel_notify(&ctx.queue);
+}
+
 void event_trigger(u32 event, EventInfo info) {
     TriggeredEvent e = {
         .code = event,
         .info = info,
     };
-    pthread_mutex_lock(&ctx.mutex);
+    e.info.payload_size = info.payload ? payload_header(info.payload)->payload_size : 0;
 
-    rqueue_enqueue(&ctx.queue, &e);
+    if (dispatching_thread) {
+        defer_event(&e);
+        return;
+    }
+    if (!channel_push(&ctx.queue, &e)) {
+        log_warnf("Event %u triggered after the event handling thread stopped.", event);
+        release_payload(info.payload);
+        return;
+    }
+    log_tracef("New event received (%u).", event);
+}
 
-    pthread_mutex_unlock(&ctx.mutex);
+static Executor* pick_worker(const EventInfo* info) {
+    if (info->key == 0)
+        return &ctx.workers[ctx.next_worker++ % EVENT_WORKER_COUNT];
+    return &ctx.workers[hash_u64(info->key) % EVENT_WORKER_COUNT];
+}
 
-    log_tracef("New event received (%u).", event);
-    pthread_cond_signal(&ctx.cond_var);
+static void run_listener(const EventListener* listener, const TriggeredEvent* e) {
+    if (listener->affinity == EVENT_AFFINITY_MAIN) {
+        listener->handler(e->code, listener->user_data, e->info);
+        return;
+    }
+
+    EventTask task = {
+        .handler   = listener->handler,
+        .user_data = listener->user_data,
+        .event     = *e,
+    };
+    retain_payload(e->info.payload);
+    Executor* executor =
+        listener->affinity == EVENT_AFFINITY_WORKER ? pick_worker(&e->info) : listener->executor;
+    channel_push(&executor->tasks, &task);
 }
 
-static bool process_event_queue(void) {
-    bool stop_event = FALSE;
-    while (ctx.queue.length > 0) {
-        const TriggeredEvent* e = rqueue_peek(&ctx.queue);
+/**
+ * Runs or dispatches the listeners of a batch of dequeued events.
+ *
+ * @return @ref FALSE if the batch contains a STOP event.
+ */
+static bool dispatch_batch(const TriggeredEvent* batch, u32 count) {
+    TRACE_SCOPE("dispatch_events");
+    ListenerSpan spans[EVENT_BATCH_SIZE];
 
-        i64 idx = dict_get(&ctx.event_registry, &e->code, NULL);
-        if (idx == -1) {
+    pthread_mutex_lock(&ctx.mutex);
+    for (u32 i = 0; i < count; i++) {
+        EventEntry* entry = evreg_ref(&ctx.event_registry, &batch[i].code);
+        spans[i] = (ListenerSpan){
+            .listeners  = entry ? entry->listeners : NULL,
+            .count      = entry ? entry->listener_count : 0,
+            .registered = entry != NULL,
+        };
+    }
+    pthread_mutex_unlock(&ctx.mutex);
+
+    bool stop_event = FALSE;
+    for (u32 i = 0; i < count; i++) {
+        const TriggeredEvent* e = &batch[i];
+        if (!spans[i].registered) {
             log_errorf("An unregistered event (%u) was triggered!.", e->code);
+            release_payload(e->info.payload);
             continue;
         }
 
         if(e->code == BEVENT_STOP)
             stop_event = TRUE;
 
-        EventEntry* entry = dict_ref(&ctx.event_registry, idx);
-
         // Notify each listener
-        for (u32 i = 0; i < entry->listeners.size; i++) {
-            EventListener* listener = vect_ref(&entry->listeners, i);
-            listener->handler(e->code, listener->user_data, e->info);
-            //log_tracef("Notified %p of event %u.", listener->user_data, e->code);
+        for (u32 j = 0; j < spans[i].count; j++) {
+            run_listener(&spans[i].listeners[j], e);
         }
-        rqueue_dequeue(&ctx.queue, NULL);
+        release_payload(e->info.payload);
     }
     return !stop_event;
 }
 
-void event_handle(void) {
-    while (ctx.running) {
-        pthread_mutex_lock(&ctx.mutex);
-        if (ctx.queue.length == 0)
-            pthread_cond_wait(&ctx.cond_var, &ctx.mutex);
-
-        ctx.running = process_event_queue();
+/**
+ * Dispatches the events deferred since the last call.
+ *
+ * @return @ref FALSE if a STOP event was dispatched.
+ */
+static bool dispatch_deferred(void) {
+    if (atomic_load(&ctx.deferred_count) == 0)
+        return TRUE;
+
+    pthread_mutex_lock(&ctx.deferred_mutex);
+    Vector deferred = ctx.deferred;
+    ctx.deferred = ctx.draining;
+    ctx.draining = deferred;
+    atomic_store(&ctx.deferred_count, 0);
+    pthread_mutex_unlock(&ctx.deferred_mutex);
+
+    TriggeredEvent batch[EVENT_BATCH_SIZE];
+    bool running = TRUE;
+    for (u64 i = 0; i < ctx.draining.size && running;) {
+        u32 count = 0;
+        while (count < EVENT_BATCH_SIZE && i < ctx.draining.size) {
+            vect_get(&ctx.draining, i++, &batch[count++]);
+        }
+        running = dispatch_batch(batch, count);
+    }
+    vect_clear(&ctx.draining);
+    return running;
+}
 
-        pthread_mutex_unlock(&ctx.mutex);
+void event_handle(void) {
+    TriggeredEvent batch[EVENT_BATCH_SIZE];
+    dispatching_thread = TRUE;
+
+    while (dispatch_deferred()) {
+        u32 count = channel_pop_batch(&ctx.queue, batch, EVENT_BATCH_SIZE);
+        // Nothing was popped if the handling thread was notified of deferred events.
+        if (count > 0 && !dispatch_batch(batch, count))
+            break;
     }
+    dispatching_thread = FALSE;
+    // Release producers waiting for space, they now drop their events.
+    channel_close(&ctx.queue);
 }
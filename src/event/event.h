@@ -25,6 +25,13 @@ typedef struct EventInfo {
      * Should ideally be a structure representing the thread which triggered the event.
      */
     void* sender;
+    /**
+     * Ordering key of the event, e.g. the identifier of a player.
+     *
+     * Listeners running on workers handle events with the same non-zero key in the order they
+     * were triggered. Events without a key (`0`) can be handled in any order by workers.
+     */
+    u64 key;
     /**
      * Some data used by event listeners. Can be anything.
      */
@@ -46,6 +53,15 @@ typedef struct EventInfo {
         bool bools[16];
         char chars[16];
     } event_data;
+    /**
+     * Payload of the event, allocated with @ref event_payload_alloc, or `NULL`.
+     *
+     * The payload is released once all listeners of the event have run: listeners must copy
+     * whatever they need to keep.
+     */
+    void* payload;
+    /** Size of the payload, in bytes. Set by @ref event_trigger. */
+    u64 payload_size;
 } EventInfo;
 
 /**
@@ -56,6 +72,32 @@ enum BuiltinEvents {
     _BEVENT_COUNT
 };
 
+/**
+ * Kinds of threads event listeners can run on.
+ */
+enum EventAffinityType {
+    EVENT_AFFINITY_MAIN = 0, /**< The event handling thread, in the order events were triggered. */
+    EVENT_AFFINITY_WORKER,   /**< Any worker of the event worker pool, ordered by event key only. */
+    EVENT_AFFINITY_SERIAL,   /**< A named serial executor, in the order events were triggered. */
+};
+
+/**
+ * Where an event listener runs.
+ */
+typedef struct EventAffinity {
+    enum EventAffinityType type;
+    /** The name of the serial executor, for @ref EVENT_AFFINITY_SERIAL. */
+    string executor;
+} EventAffinity;
+
+/** Affinity of listeners running on the event handling thread. */
+#define EVENT_ON_MAIN ((EventAffinity){.type = EVENT_AFFINITY_MAIN})
+/** Affinity of listeners running on the worker pool. */
+#define EVENT_ON_WORKER ((EventAffinity){.type = EVENT_AFFINITY_WORKER})
+/** Affinity of listeners running on the serial executor named @p name (a C string). */
+#define EVENT_ON_EXECUTOR(name)                                                                    \
+    ((EventAffinity){.type = EVENT_AFFINITY_SERIAL, .executor = str_create_view(name)})
+
 /**
  * Event handling function. 
  *
@@ -107,12 +149,42 @@ void event_register_event(u32 code, string name);
  * @param[in] data Custom user data to pass to the event listener when the event is triggered.
  */
 void event_register_listener(u32 code, event_listener listener, void* data);
+/**
+ * Registers a new event listener for a specific event type, running on the given threads.
+ *
+ * Listeners running on the event handling thread are called like those registered with
+ * @ref event_register_listener. Other listeners are called asynchronously, and may run at the same
+ * time as other listeners of the same event.
+ * Serial executors are created the first time a listener is registered on them.
+ *
+ * @param code The event type ID to register a listener for.
+ * @param[in] listener A pointer to the event listening function.
+ * @param[in] data Custom user data to pass to the event listener when the event is triggered.
+ * @param affinity The threads on which @p listener runs.
+ */
+void event_register_listener_on(u32 code, event_listener listener, void* data, EventAffinity affinity);
+
+/**
+ * Allocates the payload of an event.
+ *
+ * Payloads are written directly into a ring buffer owned by the calling thread, and released
+ * once all listeners of the event have run, so triggering events with a payload does not allocate
+ * memory. If the ring buffer is full, or the payload is too large, it is allocated on the heap.
+ *
+ * The returned payload must be set as @ref EventInfo.payload of exactly one event, triggered
+ * by the calling thread.
+ *
+ * @param size The size of the payload, in bytes.
+ * @return A pointer to the payload, aligned on 16 bytes.
+ */
+void* event_payload_alloc(u64 size);
 
 /**
  * Triggers an event.
  *
  * @param event The ID of the event to trigger.
- * @param info Custom data to pass to event listeners.
+ * @param info Custom data to pass to event listeners. If it has a payload, its ownership is
+ * transferred to the event sub-system.
  */
 void event_trigger(u32 event, EventInfo info);
 
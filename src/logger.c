@@ -1,96 +1,1271 @@
 #include "logger.h"
 
-#ifndef MC_CPLX_LOGGER
-
+#include "definitions.h"
+#include "memory/arena.h"
+#include "memory/mem_tags.h"
+#include "platform/mc_cond_var.h"
 #include "platform/mc_mutex.h"
+#include "platform/mc_thread.h"
+#include "platform/platform.h"
+#include "trace.h"
+
+#include <errno.h>
 #include <stdarg.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 
-#define LOGGER_ARENA_SIZE 262144
+/** Maximum number of threads owning a ring at the same time. Other threads log synchronously. */
+#define LOGGER_MAX_RINGS 64
+#define LOGGER_RING_SIZE (256L << 10)
+#define LOGGER_ARENA_SIZE (LOGGER_MAX_RINGS * (LOGGER_RING_SIZE + (32L << 10)))
+/** Maximum size of a record, arguments included. Longer string arguments are truncated. */
+#define LOGGER_RECORD_MAX_SIZE 4096
+/** Bytes of a record kept for the arguments following a string argument. */
+#define LOGGER_STRING_RESERVE 64
+/** Maximum length of a formatted message. */
+#define LOGGER_MSG_MAX_SIZE 8192
+/** Size of the buffer holding formatted messages until they are written. */
+#define LOGGER_TEXT_SIZE (256L << 10)
+/** Number of buffers written at once, three per message. */
+#define LOGGER_CHUNK_COUNT 768
+/** Number of format strings remembered by each ring. */
+#define LOGGER_SIGNATURE_COUNT 64
+/** Maximum number of conversions of a remembered format string. */
+#define LOGGER_SIGNATURE_MAX_ARGS 8
+/** How long the logger thread sleeps when nobody wakes it up. */
+#define LOGGER_POLL_INTERVAL_NS 5000000L
+/** Interval between two scans of the limiters by the logger thread, in nanoseconds. */
+#define LOGGER_LIMITER_SCAN_NS (LOG_LIMIT_WINDOW_NS / 4)
 
-static char* names[_LOG_LEVEL_COUNT] = {
-    [LOG_LEVEL_FATAL] = "[FATAL]",
-    [LOG_LEVEL_ERROR] = "[ERROR]",
-    [LOG_LEVEL_WARN]  = "[ WARN]",
-    [LOG_LEVEL_INFO]  = "[ INFO]",
-#ifdef DEBUG
-    [LOG_LEVEL_DEBUG] = "[DEBUG]",
-#endif
-#ifdef TRACE
-    [LOG_LEVEL_TRACE] = "[TRACE]",
-#endif
+/*
+  Each thread writes its messages into its own ring, and only the logger thread reads them:
+  a ring is a single-producer single-consumer queue, and logging never takes a lock.
+
+  A record holds the message timestamp, the format string, and the raw arguments: integers and
+  pointers in 8-byte slots, and the contents of strings, which may not outlive the call.
+  Each ring remembers the conversions of the last format strings its owner used, so callers only
+  parse a format string once. Formatting is done by the logger thread, which parses the format
+  string again to read the arguments back.
+
+  The logger thread merges the records of all rings by timestamp, then writes them to the console
+  in batches.
+  Producers only wake it up for errors or when their ring fills up, otherwise it polls the rings
+  every few milliseconds.
+ */
+
+typedef struct Affix {
+    const char* text;
+    u64 length;
+} Affix;
+
+#define AFFIX(text) {text, sizeof(text) - 1}
+
+static const Affix prefixes[_LOG_LEVEL_COUNT] = {
+    [LOG_LEVEL_FATAL] = AFFIX("\x1b[91;1m[FATAL] "),
+    [LOG_LEVEL_ERROR] = AFFIX("\x1b[31m[ERROR] "),
+    [LOG_LEVEL_WARN]  = AFFIX("\x1b[33m[ WARN] "),
+    [LOG_LEVEL_INFO]  = AFFIX("\x1b[0m[ INFO] "),
+    [LOG_LEVEL_DEBUG] = AFFIX("\x1b[32;3m[DEBUG] "),
+    [LOG_LEVEL_TRACE] = AFFIX("\x1b[30;3m[TRACE] "),
 };
 
-static char* colors[_LOG_LEVEL_COUNT] = {
-    [LOG_LEVEL_FATAL] = "\x1b[91;1m",
-    [LOG_LEVEL_ERROR] = "\x1b[31m",
-    [LOG_LEVEL_WARN]  = "\x1b[33m",
-    [LOG_LEVEL_INFO]  = "\x1b[0m",
-#ifdef DEBUG
-    [LOG_LEVEL_DEBUG] = "\x1b[32;3m",
-#endif
-#ifdef TRACE
-    [LOG_LEVEL_TRACE] = "\x1b[30;3m",
+static const Affix suffix = AFFIX("\x1b[0m\n");
+
+#if defined(TRACE)
+#define LOG_DEFAULT_LEVEL LOG_LEVEL_TRACE
+#elif defined(DEBUG)
+#define LOG_DEFAULT_LEVEL LOG_LEVEL_DEBUG
+#else
+#define LOG_DEFAULT_LEVEL LOG_LEVEL_INFO
 #endif
+
+_Atomic u8 log_levels[_LOG_SUBSYSTEM_COUNT] = {[0 ... _LOG_SUBSYSTEM_COUNT - 1] = LOG_DEFAULT_LEVEL};
+
+/** Levels set by @ref logger_parse_levels, restored by @ref logger_cycle_verbosity. */
+static u8 configured_levels[_LOG_SUBSYSTEM_COUNT] = {[0 ... _LOG_SUBSYSTEM_COUNT - 1] = LOG_DEFAULT_LEVEL};
+
+static const char* level_names[_LOG_LEVEL_COUNT] = {
+    [LOG_LEVEL_FATAL] = "fatal",
+    [LOG_LEVEL_ERROR] = "error",
+    [LOG_LEVEL_WARN]  = "warn",
+    [LOG_LEVEL_INFO]  = "info",
+    [LOG_LEVEL_DEBUG] = "debug",
+    [LOG_LEVEL_TRACE] = "trace",
+};
+
+static const char* subsystem_names[_LOG_SUBSYSTEM_COUNT] = {
+    [LOG_SUBSYSTEM_CORE]     = "core",
+    [LOG_SUBSYSTEM_NETWORK]  = "network",
+    [LOG_SUBSYSTEM_EVENT]    = "event",
+    [LOG_SUBSYSTEM_MEMORY]   = "memory",
+    [LOG_SUBSYSTEM_NBT]      = "nbt",
+    [LOG_SUBSYSTEM_JSON]     = "json",
+    [LOG_SUBSYSTEM_REGISTRY] = "registry",
+    [LOG_SUBSYSTEM_PLATFORM] = "platform",
+};
+
+enum RecordKind {
+    RECORD_MESSAGE,
+    /** Fills the end of a ring, the next record starts at the beginning. */
+    RECORD_PADDING,
+};
+
+struct log_record {
+    /** Size of the record in the ring, arguments included. */
+    u32 size;
+    u8 kind;
+    u8 level;
+    u64 timestamp;
+    const char* format;
+    u8 arguments[];
+};
+
+/** Arguments of the conversions understood by the logger. */
+enum ArgKind {
+    ARG_NONE, /**< `%%` */
+    ARG_INVALID,
+    ARG_INT,
+    ARG_LONG,
+    ARG_LLONG,
+    ARG_SIZE,
+    ARG_INTMAX,
+    ARG_PTRDIFF,
+    ARG_DOUBLE,
+    ARG_LDOUBLE,
+    ARG_STRING,
+    ARG_POINTER,
 };
 
-typedef struct logger_ctx {
+/** What a conversion reads from the arguments of a call. */
+typedef struct ArgSpec {
+    /** See @ref ArgKind. */
+    u8 kind;
+    /** Number of `*` width and precision arguments. */
+    u8 stars;
+    bool precision_star;
+    /** Literal precision, or -1. */
+    i32 precision;
+} ArgSpec;
+
+typedef struct Conversion {
+    /** First character after the conversion. */
+    const char* end;
+    ArgSpec arg;
+    char specifier;
+    /** Whether the conversion has no flags, width or precision. */
+    bool plain;
+} Conversion;
+
+/** The conversions of a format string, remembered by rings to avoid parsing it on each call. */
+typedef struct Signature {
+    const char* format;
+    u32 count;
+    ArgSpec args[LOGGER_SIGNATURE_MAX_ARGS];
+} Signature;
+
+typedef struct LogRing {
+    u8* buffer;
+    /** Number of bytes written since the creation of the ring. Only moved by the owner. */
+    _Alignas(64) _Atomic u64 head;
+    /** Number of bytes written out by the logger thread. */
+    _Alignas(64) _Atomic u64 tail;
+    /** Last value of the tail seen by the owner. */
+    _Alignas(64) u64 cached_tail;
+    /** Format strings used by the owner, indexed by a hash of their address. */
+    Signature* signatures;
+    /** Whether a thread owns the ring, protected by the mutex. */
+    bool in_use;
+} LogRing;
+
+typedef struct RingCursor {
+    u64 timestamp;
+    u32 ring;
+} RingCursor;
+
+typedef struct LoggerCtx {
+    Arena arena;
+    LogRing rings[LOGGER_MAX_RINGS];
+    _Atomic u32 ring_count;
+    /** Ring of the calling thread. Its destructor hands the ring over when the thread exits. */
+    MCThreadKey ring_key;
+    /** Incremented on each initialization, invalidates the rings cached by threads. */
+    _Atomic u32 generation;
+    _Atomic bool running;
+
+    MCThread thread;
     MCMutex mutex;
+    MCCondVar wake;
+    _Alignas(64) _Atomic bool idle;
+
+    // Owned by the logger thread.
+    u64 cursors[LOGGER_MAX_RINGS];
+    u64 limits[LOGGER_MAX_RINGS];
+    RingCursor heap[LOGGER_MAX_RINGS];
+    u32 heap_size;
+    char* text;
+    u64 text_length;
+    ConsoleChunk chunks[LOGGER_CHUNK_COUNT];
+    u32 chunk_count;
+    enum ConsoleStream stream;
 } LoggerCtx;
 
 static LoggerCtx ctx;
 
+static _Thread_local LogRing* local_ring;
+static _Thread_local u32 local_generation;
+/** Set on the logger thread, and while taking a ring over, since allocating may log. */
+static _Thread_local bool bypass_rings;
+/** Limiters which suppressed messages, scanned by the logger thread to log their summaries. */
+static LogLimiter* _Atomic limiters;
+
+static void* logger_run(void* arg);
+
+static void release_ring(void* ring) {
+    mcmutex_lock(&ctx.mutex);
+    ((LogRing*) ring)->in_use = FALSE;
+    mcmutex_unlock(&ctx.mutex);
+}
+
 void logger_system_init(void) {
+    ctx.arena = arena_create_reserved(LOGGER_ARENA_SIZE + LOGGER_TEXT_SIZE, BLK_TAG_UNKNOWN, FALSE);
+    ctx.text  = arena_allocate(&ctx.arena, LOGGER_TEXT_SIZE, ALLOC_TAG_UNKNOWN);
+    ctx.text_length = 0;
+    ctx.chunk_count = 0;
+    ctx.stream      = CONSOLE_STDOUT;
+    atomic_store(&ctx.ring_count, 0);
+    mcthread_create_attachment(&ctx.ring_key, &release_ring);
+
     mcmutex_create(&ctx.mutex);
+    mcvar_create(&ctx.wake);
+    atomic_store(&ctx.idle, FALSE);
+
+    atomic_fetch_add(&ctx.generation, 1);
+    atomic_store(&ctx.running, TRUE);
+    mcthread_create(&ctx.thread, &logger_run, NULL);
 }
 
 void logger_system_cleanup(void) {
+    mcmutex_lock(&ctx.mutex);
+    atomic_store(&ctx.running, FALSE);
+    mcvar_signal(&ctx.wake);
+    mcmutex_unlock(&ctx.mutex);
+    // The logger thread writes out all pending messages before exiting.
+    mcthread_join(&ctx.thread, NULL);
+
+    mcthread_destroy_attachment(ctx.ring_key);
+    mcvar_destroy(&ctx.wake);
     mcmutex_destroy(&ctx.mutex);
+    arena_destroy(&ctx.arena);
 }
 
-void _log_msg(enum LogLevel lvl, char* msg) {
-    if (lvl < LOG_LEVEL_FATAL || lvl >= _LOG_LEVEL_COUNT)
+void logger_set_level(enum LogSubsystem subsystem, enum LogLevel lvl) {
+    for (u32 i = 0; i < _LOG_SUBSYSTEM_COUNT; i++) {
+        if (subsystem == _LOG_SUBSYSTEM_COUNT || subsystem == i)
+            atomic_store_explicit(&log_levels[i], lvl, memory_order_relaxed);
+    }
+}
+
+static i32 find_name(const char** names, u32 count, const char* name, u64 length) {
+    for (u32 i = 0; i < count; i++) {
+        if (strlen(names[i]) == length && strncmp(names[i], name, length) == 0)
+            return (i32) i;
+    }
+    return -1;
+}
+
+/** Number of calls to @ref logger_cycle_verbosity since the levels were configured, modulo 3. */
+static u32 verbosity_step;
+
+bool logger_parse_levels(const char* spec) {
+    static const char* separators = ", \t\r\n";
+    u8 levels[_LOG_SUBSYSTEM_COUNT];
+    memcpy(levels, configured_levels, sizeof levels);
+
+    const char* item = spec + strspn(spec, separators);
+    while (*item) {
+        u64 length        = strcspn(item, separators);
+        const char* equal = memchr(item, '=', length);
+        const char* level = equal ? equal + 1 : item;
+        i32 lvl           = find_name(level_names, _LOG_LEVEL_COUNT, level, item + length - level);
+        if (lvl < 0) {
+            log_errorf("Invalid log level '%.*s'.", (int) (item + length - level), level);
+            return FALSE;
+        }
+
+        if (equal) {
+            i32 subsystem = find_name(subsystem_names, _LOG_SUBSYSTEM_COUNT, item, equal - item);
+            if (subsystem < 0) {
+                log_errorf("Invalid log subsystem '%.*s'.", (int) (equal - item), item);
+                return FALSE;
+            }
+            levels[subsystem] = lvl;
+        } else {
+            memset(levels, lvl, sizeof levels);
+        }
+        item += length;
+        item += strspn(item, separators);
+    }
+
+    memcpy(configured_levels, levels, sizeof levels);
+    verbosity_step = 0;
+    for (u32 i = 0; i < _LOG_SUBSYSTEM_COUNT; i++) {
+        logger_set_level(i, levels[i]);
+    }
+    return TRUE;
+}
+
+/** File last passed to @ref logger_load_levels. */
+static const char* levels_path;
+
+bool logger_load_levels(const char* path) {
+    levels_path = path;
+    FILE* file  = fopen(path, "r");
+    if (!file) {
+        log_errorf("Could not open log level file '%s': %s", path, strerror(errno));
+        return FALSE;
+    }
+    char spec[4096];
+    u64 length   = fread(spec, 1, sizeof spec - 1, file);
+    spec[length] = 0;
+    fclose(file);
+    return logger_parse_levels(spec);
+}
+
+void logger_reload_levels(void) {
+    if (!levels_path) {
+        log_warn("No log level file to reload.");
+        return;
+    }
+    if (logger_load_levels(levels_path))
+        logger_dump_levels();
+}
+
+void logger_cycle_verbosity(void) {
+    verbosity_step = (verbosity_step + 1) % 3;
+    for (u32 i = 0; i < _LOG_SUBSYSTEM_COUNT; i++) {
+        u8 lvl = configured_levels[i];
+        if (verbosity_step == 1 && lvl < LOG_LEVEL_DEBUG)
+            lvl = LOG_LEVEL_DEBUG;
+        else if (verbosity_step == 2)
+            lvl = LOG_LEVEL_TRACE;
+        logger_set_level(i, lvl);
+    }
+    logger_dump_levels();
+}
+
+void logger_dump_levels(void) {
+    char levels[256];
+    u64 length = 0;
+    for (u32 i = 0; i < _LOG_SUBSYSTEM_COUNT && length < sizeof levels; i++) {
+        u8 lvl = atomic_load_explicit(&log_levels[i], memory_order_relaxed);
+        length += snprintf(levels + length, sizeof levels - length, " %s=%s", subsystem_names[i], level_names[lvl]);
+    }
+    // Always shown, whatever the levels are.
+    _log_msgf(LOG_LEVEL_INFO, "Log levels:%s", levels);
+}
+
+static void limiter_summarize(LogLimiter* limiter) {
+    u32 suppressed = atomic_exchange_explicit(&limiter->suppressed, 0, memory_order_relaxed);
+    if (suppressed > 0)
+        _log_msgf(limiter->level, "%u similar messages suppressed: %s", suppressed, limiter->message);
+}
+
+/**
+ * Starts a new window if the current one is over, logging the summary of the previous one.
+ */
+static void limiter_roll_window(LogLimiter* limiter, u64 now) {
+    u64 start = atomic_load_explicit(&limiter->window_start, memory_order_relaxed);
+    // Only one thread starts the new window.
+    if (now - start >= LOG_LIMIT_WINDOW_NS &&
+        atomic_compare_exchange_strong_explicit(
+            &limiter->window_start, &start, now, memory_order_relaxed, memory_order_relaxed)) {
+        atomic_store_explicit(&limiter->passed, 0, memory_order_relaxed);
+        limiter_summarize(limiter);
+    }
+}
+
+static void limiter_suppress(LogLimiter* limiter) {
+    atomic_fetch_add_explicit(&limiter->suppressed, 1, memory_order_relaxed);
+    if (atomic_load_explicit(&limiter->listed, memory_order_relaxed) ||
+        atomic_exchange_explicit(&limiter->listed, TRUE, memory_order_relaxed))
         return;
 
-    FILE* stream;
-    switch (lvl) {
-    case LOG_LEVEL_FATAL:
-    case LOG_LEVEL_ERROR:
-        stream = stderr;
+    // Limiters are static: once listed, they stay listed.
+    LogLimiter* head = atomic_load_explicit(&limiters, memory_order_relaxed);
+    do {
+        limiter->next = head;
+    } while (!atomic_compare_exchange_weak_explicit(
+        &limiters, &head, limiter, memory_order_release, memory_order_relaxed));
+}
+
+bool _log_limit(LogLimiter* limiter) {
+    // Sampling does not need the time.
+    if (limiter->sample > 1 &&
+        atomic_fetch_add_explicit(&limiter->calls, 1, memory_order_relaxed) % limiter->sample != 0) {
+        limiter_suppress(limiter);
+        return FALSE;
+    }
+
+    limiter_roll_window(limiter, get_monotonic_ns());
+
+    if (atomic_fetch_add_explicit(&limiter->passed, 1, memory_order_relaxed) < limiter->burst)
+        return TRUE;
+    limiter_suppress(limiter);
+    return FALSE;
+}
+
+/**
+ * Logs the summaries of the listed limiters whose window is over, or of all of them if the
+ * logger is stopping.
+ */
+static void summarize_limiters(bool stopping) {
+    u64 now = get_monotonic_ns();
+    for (LogLimiter* limiter = atomic_load_explicit(&limiters, memory_order_acquire); limiter;
+         limiter             = limiter->next) {
+        if (stopping)
+            limiter_summarize(limiter);
+        else
+            limiter_roll_window(limiter, now);
+    }
+}
+
+static enum ConsoleStream get_stream(enum LogLevel lvl) {
+    return lvl <= LOG_LEVEL_ERROR ? CONSOLE_STDERR : CONSOLE_STDOUT;
+}
+
+/**
+ * Formats and writes a message on the calling thread.
+ *
+ * Used before the logging system is initialized, after it is cleaned up, by the logger thread,
+ * and by threads that could not take a ring over.
+ */
+static void log_direct(enum LogLevel lvl, const char* format, va_list args) {
+    char message[LOGGER_MSG_MAX_SIZE];
+    i32 length = vsnprintf(message, sizeof message, format, args);
+    if (length < 0)
+        length = 0;
+    else if ((u64) length >= sizeof message)
+        length = sizeof message - 1;
+
+    ConsoleChunk chunks[3] = {
+        {prefixes[lvl].text, prefixes[lvl].length},
+        {message, length},
+        {suffix.text, suffix.length},
+    };
+    if (get_stream(lvl) == CONSOLE_STDOUT)
+        fflush(stdout);
+    platform_console_write(get_stream(lvl), chunks, 3);
+}
+
+static void log_direct_string(enum LogLevel lvl, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    log_direct(lvl, format, args);
+    va_end(args);
+}
+
+/**
+ * Parses a conversion specification.
+ *
+ * @param[in] c The character following the `%` sign.
+ */
+static Conversion parse_conversion(const char* c) {
+    Conversion conversion = {.arg = {.kind = ARG_INVALID, .precision = -1}};
+    if (*c == '%') {
+        conversion.arg.kind = ARG_NONE;
+        conversion.end      = c + 1;
+        return conversion;
+    }
+
+    const char* start = c;
+    while (*c == '-' || *c == '+' || *c == ' ' || *c == '#' || *c == '0' || *c == '\'')
+        c++;
+    if (*c == '*') {
+        conversion.arg.stars++;
+        c++;
+    } else {
+        while (*c >= '0' && *c <= '9')
+            c++;
+    }
+    if (*c == '.') {
+        c++;
+        if (*c == '*') {
+            conversion.arg.stars++;
+            conversion.arg.precision_star = TRUE;
+            c++;
+        } else {
+            conversion.arg.precision = 0;
+            while (*c >= '0' && *c <= '9')
+                conversion.arg.precision = conversion.arg.precision * 10 + (*c++ - '0');
+        }
+    }
+    conversion.plain = c == start;
+
+    enum ArgKind integer = ARG_INT;
+    bool long_double     = FALSE;
+    switch (*c) {
+    case 'h':
+        c += c[1] == 'h' ? 2 : 1;
+        // The argument is converted to a shorter type.
+        conversion.plain = FALSE;
+        break;
+    case 'l':
+        integer = c[1] == 'l' ? ARG_LLONG : ARG_LONG;
+        c += c[1] == 'l' ? 2 : 1;
+        break;
+    case 'z':
+        integer = ARG_SIZE;
+        c++;
+        break;
+    case 'j':
+        integer = ARG_INTMAX;
+        c++;
+        break;
+    case 't':
+        integer = ARG_PTRDIFF;
+        c++;
+        break;
+    case 'L':
+        long_double = TRUE;
+        c++;
+        break;
+    }
+
+    switch (*c) {
+    case 'd':
+    case 'i':
+    case 'o':
+    case 'u':
+    case 'x':
+    case 'X':
+        if (!long_double)
+            conversion.arg.kind = integer;
+        break;
+    case 'c':
+        if (!long_double && integer == ARG_INT)
+            conversion.arg.kind = ARG_INT;
+        break;
+    case 'f':
+    case 'F':
+    case 'e':
+    case 'E':
+    case 'g':
+    case 'G':
+    case 'a':
+    case 'A':
+        conversion.arg.kind = long_double ? ARG_LDOUBLE : ARG_DOUBLE;
+        break;
+    case 's':
+        if (!long_double && integer == ARG_INT)
+            conversion.arg.kind = ARG_STRING;
+        break;
+    case 'p':
+        conversion.arg.kind = ARG_POINTER;
         break;
     default:
-        stream = stdout;
+        // `%n`, wide strings and unknown conversions.
         break;
     }
+    conversion.specifier = *c;
+    conversion.end       = *c ? c + 1 : c;
+    return conversion;
+}
 
-    fprintf(stream, "%s%s %s\x1b[0m\n", colors[lvl], names[lvl], msg);
+static u64 align_slot(u64 size) {
+    return (size + 7) & ~7UL;
 }
 
-void _log_msgf(enum LogLevel lvl, char* msg, ...) {
-    if (lvl < LOG_LEVEL_FATAL || lvl >= _LOG_LEVEL_COUNT)
-        return;
+/**
+ * Copies a string argument: its length, or `UINT32_MAX` for `NULL`, followed by its characters.
+ *
+ * @return The end of the copy.
+ */
+static u8* encode_string(u8* out, const u8* end, const char* string, i32 precision) {
+    u32 length = UINT32_MAX;
+    u64 size   = sizeof(u32);
+    if (string) {
+        u64 room = end - out - sizeof(u32) - 1;
+        if (room > LOGGER_STRING_RESERVE * 2)
+            room -= LOGGER_STRING_RESERVE;
+        if (precision >= 0 && (u64) precision < room)
+            room = precision;
+        length = strnlen(string, room);
+        memcpy(out + sizeof(u32), string, length);
+        out[sizeof(u32) + length] = 0;
+        size += length + 1;
+    }
+    memcpy(out, &length, sizeof(u32));
+    return out + align_slot(size);
+}
 
-    va_list args;
-    va_start(args, msg);
+/**
+ * Copies the arguments of a conversion into a record.
+ *
+ * @return The end of the copy, or `NULL` if the arguments do not fit in the record.
+ */
+static u8* encode_value(u8* out, const u8* end, const ArgSpec* arg, va_list* args) {
+    // Two stars and a long double.
+    if (end - out < 32)
+        return NULL;
+
+    i32 precision = arg->precision;
+    for (u32 i = 0; i < arg->stars; i++) {
+        i64 star = va_arg(*args, int);
+        if (arg->precision_star)
+            precision = (i32) star;
+        memcpy(out, &star, sizeof star);
+        out += sizeof star;
+    }
+
+    u64 slot = 0;
+    switch (arg->kind) {
+    case ARG_INT:
+        slot = (u64) (i64) va_arg(*args, int);
+        break;
+    case ARG_LONG:
+        slot = (u64) va_arg(*args, long);
+        break;
+    case ARG_LLONG:
+        slot = (u64) va_arg(*args, long long);
+        break;
+    case ARG_SIZE:
+        slot = (u64) va_arg(*args, size_t);
+        break;
+    case ARG_INTMAX:
+        slot = (u64) va_arg(*args, intmax_t);
+        break;
+    case ARG_PTRDIFF:
+        slot = (u64) va_arg(*args, ptrdiff_t);
+        break;
+    case ARG_POINTER:
+        slot = (u64) (uintptr_t) va_arg(*args, void*);
+        break;
+    case ARG_DOUBLE: {
+        f64 value = va_arg(*args, f64);
+        memcpy(&slot, &value, sizeof value);
+        break;
+    }
+    case ARG_LDOUBLE: {
+        long double value = va_arg(*args, long double);
+        memcpy(out, &value, sizeof value);
+        return out + align_slot(sizeof value);
+    }
+    case ARG_STRING:
+        return encode_string(out, end, va_arg(*args, const char*), precision);
+    default:
+        break;
+    }
+    memcpy(out, &slot, sizeof slot);
+    return out + sizeof slot;
+}
 
-    FILE* stream;
-    switch (lvl) {
-    case LOG_LEVEL_FATAL:
-    case LOG_LEVEL_ERROR:
-        stream = stderr;
+/**
+ * Finds the conversions of a format string in the signatures of a ring, parsing it if needed.
+ *
+ * @return The signature, or `NULL` if the format string has too many conversions.
+ */
+static const Signature* get_signature(LogRing* ring, const char* format) {
+    u64 index            = ((uintptr_t) format * 0x9E3779B97F4A7C15ULL) >> 32;
+    Signature* signature = &ring->signatures[index % LOGGER_SIGNATURE_COUNT];
+    if (signature->format == format)
+        return signature;
+
+    u32 count = 0;
+    ArgSpec args[LOGGER_SIGNATURE_MAX_ARGS];
+    const char* c = format;
+    while ((c = strchr(c, '%'))) {
+        Conversion conversion = parse_conversion(c + 1);
+        c = conversion.end;
+        if (conversion.arg.kind == ARG_NONE)
+            continue;
+        if (conversion.arg.kind == ARG_INVALID)
+            break;
+        if (count == LOGGER_SIGNATURE_MAX_ARGS)
+            return NULL;
+        args[count++] = conversion.arg;
+    }
+    signature->format = format;
+    signature->count  = count;
+    memcpy(signature->args, args, count * sizeof *args);
+    return signature;
+}
+
+/**
+ * Copies the arguments of a call into a record.
+ *
+ * Conversions which do not fit in the record are dropped with all the following ones.
+ *
+ * @return The end of the arguments.
+ */
+static u8* encode_arguments(LogRing* ring, u8* out, const u8* end, const char* format, va_list* args) {
+    const Signature* signature = get_signature(ring, format);
+    if (signature) {
+        for (u32 i = 0; i < signature->count; i++) {
+            u8* next = encode_value(out, end, &signature->args[i], args);
+            if (!next)
+                break;
+            out = next;
+        }
+        return out;
+    }
+
+    const char* c = format;
+    while ((c = strchr(c, '%'))) {
+        Conversion conversion = parse_conversion(c + 1);
+        c = conversion.end;
+        if (conversion.arg.kind == ARG_NONE)
+            continue;
+        u8* next = conversion.arg.kind == ARG_INVALID ? NULL : encode_value(out, end, &conversion.arg, args);
+        if (!next)
+            break;
+        out = next;
+    }
+    return out;
+}
+
+static u64 load_slot(const u8* slot) {
+    u64 value;
+    memcpy(&value, slot, sizeof value);
+    return value;
+}
+
+/**
+ * Formats a single conversion with the arguments copied by @ref encode_arguments.
+ *
+ * @return The number of characters written, without the null terminator.
+ */
+static u64 format_conversion(
+    char* out, u64 room, const char* spec, const ArgSpec* arg, const i32* stars, const u8* value) {
+
+#define FORMAT_VALUE(value)                                                                        \
+    (arg->stars == 0   ? snprintf(out, room, spec, value)                                          \
+     : arg->stars == 1 ? snprintf(out, room, spec, stars[0], value)                                \
+                       : snprintf(out, room, spec, stars[0], stars[1], value))
+
+    i32 written = 0;
+    switch (arg->kind) {
+    case ARG_INT:
+        written = FORMAT_VALUE((int) load_slot(value));
+        break;
+    case ARG_LONG:
+        written = FORMAT_VALUE((long) load_slot(value));
+        break;
+    case ARG_LLONG:
+        written = FORMAT_VALUE((long long) load_slot(value));
+        break;
+    case ARG_SIZE:
+        written = FORMAT_VALUE((size_t) load_slot(value));
+        break;
+    case ARG_INTMAX:
+        written = FORMAT_VALUE((intmax_t) load_slot(value));
         break;
+    case ARG_PTRDIFF:
+        written = FORMAT_VALUE((ptrdiff_t) load_slot(value));
+        break;
+    case ARG_POINTER:
+        written = FORMAT_VALUE((void*) (uintptr_t) load_slot(value));
+        break;
+    case ARG_DOUBLE: {
+        f64 number;
+        memcpy(&number, value, sizeof number);
+        written = FORMAT_VALUE(number);
+        break;
+    }
+    case ARG_LDOUBLE: {
+        long double number;
+        memcpy(&number, value, sizeof number);
+        written = FORMAT_VALUE(number);
+        break;
+    }
+    case ARG_STRING: {
+        u32 length;
+        memcpy(&length, value, sizeof length);
+        const char* string = length == UINT32_MAX ? NULL : (const char*) value + sizeof length;
+        written = FORMAT_VALUE(string);
+        break;
+    }
     default:
-        stream = stdout;
         break;
     }
+#undef FORMAT_VALUE
 
+    if (written < 0)
+        return 0;
+    return (u64) written < room ? (u64) written : room - 1;
+}
+
+static u64 append_text(char* out, u64 room, const char* text, u64 length) {
+    if (length >= room)
+        length = room - 1;
+    memcpy(out, text, length);
+    return length;
+}
+
+/**
+ * Formats the most common conversions, strings and decimal integers without flags, without
+ * going through snprintf.
+ *
+ * @return The number of characters written, or -1 if the conversion is not handled.
+ */
+static i64 format_plain(char* out, u64 room, const Conversion* conversion, const u8* value) {
+    if (!conversion->plain)
+        return -1;
+
+    u8 kind = conversion->arg.kind;
+    if (kind == ARG_STRING) {
+        u32 length;
+        memcpy(&length, value, sizeof length);
+        if (length == UINT32_MAX)
+            return append_text(out, room, "(null)", 6);
+        return append_text(out, room, (const char*) value + sizeof length, length);
+    }
+
+    bool is_signed = conversion->specifier == 'd' || conversion->specifier == 'i';
+    if ((!is_signed && conversion->specifier != 'u') || kind < ARG_INT || kind > ARG_PTRDIFF)
+        return -1;
+    u64 number = load_slot(value);
+    if (kind == ARG_INT && !is_signed)
+        number = (u32) number;
+    bool negative = is_signed && (i64) number < 0;
+    if (negative)
+        number = -number;
+
+    char digits[20];
+    u32 count = 0;
+    do {
+        digits[sizeof digits - ++count] = (char) ('0' + number % 10);
+        number /= 10;
+    } while (number > 0);
+    if (negative)
+        digits[sizeof digits - ++count] = '-';
+    return append_text(out, room, digits + sizeof digits - count, count);
+}
+
+/**
+ * Formats the message of a record.
+ *
+ * @param[in] record The record to format.
+ * @param[out] out The buffer receiving the message, not null-terminated.
+ * @param capacity The size of @p out.
+ * @return The length of the message.
+ */
+static u64 format_record(const struct log_record* record, char* out, u64 capacity) {
+    const u8* argument = record->arguments;
+    const u8* end      = (const u8*) record + record->size;
+    const char* c      = record->format;
+    u64 length         = 0;
+
+    while (*c && length < capacity - 1) {
+        const char* percent = strchr(c, '%');
+        if (!percent) {
+            length += append_text(out + length, capacity - length, c, strlen(c));
+            break;
+        }
+        length += append_text(out + length, capacity - length, c, percent - c);
+
+        Conversion conversion = parse_conversion(percent + 1);
+        const ArgSpec* arg    = &conversion.arg;
+        c                     = conversion.end;
+        if (arg->kind == ARG_NONE) {
+            length += append_text(out + length, capacity - length, "%", 1);
+            continue;
+        }
+        u64 spec_length = conversion.end - percent;
+        if (arg->kind == ARG_INVALID || spec_length >= 32) {
+            length += append_text(out + length, capacity - length, percent, strlen(percent));
+            break;
+        }
+
+        // The arguments of conversions that did not fit in the record are missing.
+        u64 value_size = arg->kind == ARG_LDOUBLE ? align_slot(sizeof(long double)) : 8;
+        if ((u64) (end - argument) < arg->stars * 8 + value_size)
+            break;
+        i32 stars[2] = {0};
+        for (u32 i = 0; i < arg->stars; i++) {
+            stars[i] = (i32) load_slot(argument);
+            argument += 8;
+        }
+
+        i64 written = format_plain(out + length, capacity - length, &conversion, argument);
+        if (written < 0) {
+            char spec[32];
+            memcpy(spec, percent, spec_length);
+            spec[spec_length] = 0;
+            written = format_conversion(out + length, capacity - length, spec, arg, stars, argument);
+        }
+        length += written;
+
+        if (arg->kind == ARG_STRING) {
+            u32 string_length;
+            memcpy(&string_length, argument, sizeof string_length);
+            argument += string_length == UINT32_MAX ? align_slot(sizeof(u32))
+                                                    : align_slot(sizeof(u32) + string_length + 1);
+        } else {
+            argument += value_size;
+        }
+    }
+    return length;
+}
+
+/*
+  Producer side.
+ */
+
+static void wake_logger(void) {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (!atomic_load_explicit(&ctx.idle, memory_order_relaxed))
+        return;
+    mcmutex_lock(&ctx.mutex);
+    mcvar_signal(&ctx.wake);
+    mcmutex_unlock(&ctx.mutex);
+}
+
+/**
+ * Takes over a ring no thread owns, or creates one.
+ *
+ * @return The ring, or `NULL` if all rings are in use.
+ */
+static LogRing* take_ring(void) {
+    bypass_rings = TRUE;
     mcmutex_lock(&ctx.mutex);
 
-    fprintf(stream, "%s%s ", colors[lvl], names[lvl]);
-    vfprintf(stream, msg, args);
-    puts("\x1b[0m");
+    LogRing* ring = NULL;
+    u32 count     = atomic_load_explicit(&ctx.ring_count, memory_order_relaxed);
+    for (u32 i = 0; i < count; i++) {
+        if (!ctx.rings[i].in_use) {
+            ring = &ctx.rings[i];
+            break;
+        }
+    }
+    if (!ring && count < LOGGER_MAX_RINGS) {
+        u8* buffer            = arena_allocate(&ctx.arena, LOGGER_RING_SIZE, ALLOC_TAG_UNKNOWN);
+        Signature* signatures = arena_callocate(
+            &ctx.arena, LOGGER_SIGNATURE_COUNT * sizeof(Signature), ALLOC_TAG_UNKNOWN);
+        if (buffer && signatures) {
+            ring             = &ctx.rings[count];
+            ring->buffer     = buffer;
+            ring->signatures = signatures;
+            atomic_store_explicit(&ring->head, 0, memory_order_relaxed);
+            atomic_store_explicit(&ring->tail, 0, memory_order_relaxed);
+            ring->cached_tail = 0;
+            atomic_store_explicit(&ctx.ring_count, count + 1, memory_order_release);
+        }
+    }
+    if (ring)
+        ring->in_use = TRUE;
+
     mcmutex_unlock(&ctx.mutex);
+    if (ring) {
+        mcthread_attach_data(ctx.ring_key, ring);
+        local_ring       = ring;
+        local_generation = atomic_load_explicit(&ctx.generation, memory_order_relaxed);
+    }
+    bypass_rings = FALSE;
+    return ring;
+}
+
+static LogRing* get_local_ring(void) {
+    if (bypass_rings || !atomic_load_explicit(&ctx.running, memory_order_relaxed))
+        return NULL;
+    if (local_ring && local_generation == atomic_load_explicit(&ctx.generation, memory_order_relaxed))
+        return local_ring;
+    return take_ring();
+}
+
+static bool ring_has_room(LogRing* ring, u64 end) {
+    if (end - ring->cached_tail <= LOGGER_RING_SIZE)
+        return TRUE;
+    ring->cached_tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    return end - ring->cached_tail <= LOGGER_RING_SIZE;
+}
+
+/**
+ * Reserves a record of the maximum size at the head of a ring, waiting for the logger thread
+ * if the ring is full.
+ *
+ * @param[out] out_position The position of the record in the ring.
+ * @return The record, or `NULL` if the logging system stopped while waiting.
+ */
+static struct log_record* ring_reserve(LogRing* ring, u64* out_position) {
+    u64 head    = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    u64 offset  = head % LOGGER_RING_SIZE;
+    u64 padding = LOGGER_RING_SIZE - offset < LOGGER_RECORD_MAX_SIZE ? LOGGER_RING_SIZE - offset : 0;
+
+    while (!ring_has_room(ring, head + padding + LOGGER_RECORD_MAX_SIZE)) {
+        if (!atomic_load_explicit(&ctx.running, memory_order_relaxed))
+            return NULL;
+        wake_logger();
+        mcthread_yield();
+    }
+
+    if (padding > 0) {
+        // Published with the next record.
+        struct log_record* filler = (struct log_record*) (ring->buffer + offset);
+        filler->size              = padding;
+        filler->kind              = RECORD_PADDING;
+        head += padding;
+    }
+    *out_position = head;
+    return (struct log_record*) (ring->buffer + head % LOGGER_RING_SIZE);
+}
+
+/**
+ * Waits until the logger thread wrote a ring out up to a position.
+ */
+static void wait_written(LogRing* ring, u64 position) {
+    while (atomic_load_explicit(&ring->tail, memory_order_acquire) < position &&
+           atomic_load_explicit(&ctx.running, memory_order_relaxed)) {
+        wake_logger();
+        mcthread_yield();
+    }
+}
+
+static void ring_commit(LogRing* ring, enum LogLevel lvl, u64 position, u64 size) {
+    u64 head = position + size;
+    atomic_store_explicit(&ring->head, head, memory_order_release);
+
+    if (lvl <= LOG_LEVEL_ERROR || !ring_has_room(ring, head + LOGGER_RING_SIZE / 2))
+        wake_logger();
+    // The server usually stops right after a fatal error.
+    if (lvl == LOG_LEVEL_FATAL)
+        logger_flush();
+}
+
+static struct log_record* begin_record(LogRing* ring, enum LogLevel lvl, const char* format, u64* out_position) {
+    struct log_record* record = ring_reserve(ring, out_position);
+    if (!record)
+        return NULL;
+    record->kind      = RECORD_MESSAGE;
+    record->level     = lvl;
+    record->timestamp = get_monotonic_ns();
+    record->format    = format;
+    return record;
+}
+
+void _log_msg(enum LogLevel lvl, char* msg) {
+    if (lvl < LOG_LEVEL_FATAL || lvl >= _LOG_LEVEL_COUNT)
+        return;
+
+    LogRing* ring = get_local_ring();
+    u64 position;
+    struct log_record* record = ring ? begin_record(ring, lvl, "%s", &position) : NULL;
+    if (!record) {
+        log_direct_string(lvl, "%s", msg);
+        return;
+    }
+    u8* end      = encode_string(record->arguments, (u8*) record + LOGGER_RECORD_MAX_SIZE, msg, -1);
+    record->size = end - (u8*) record;
+    ring_commit(ring, lvl, position, record->size);
+}
+
+void _log_msgf(enum LogLevel lvl, char* format, ...) {
+    if (lvl < LOG_LEVEL_FATAL || lvl >= _LOG_LEVEL_COUNT)
+        return;
+
+    va_list args;
+    va_start(args, format);
+    LogRing* ring = get_local_ring();
+    u64 position;
+    struct log_record* record = ring ? begin_record(ring, lvl, format, &position) : NULL;
+    if (record) {
+        u8* end = encode_arguments(ring, record->arguments, (u8*) record + LOGGER_RECORD_MAX_SIZE, format, &args);
+        record->size = end - (u8*) record;
+        ring_commit(ring, lvl, position, record->size);
+    } else {
+        log_direct(lvl, format, args);
+    }
     va_end(args);
 }
 
-#endif
+void logger_flush(void) {
+    if (bypass_rings || !atomic_load_explicit(&ctx.running, memory_order_relaxed))
+        return;
+
+    u32 count = atomic_load_explicit(&ctx.ring_count, memory_order_acquire);
+    u64 heads[LOGGER_MAX_RINGS];
+    for (u32 i = 0; i < count; i++) {
+        heads[i] = atomic_load_explicit(&ctx.rings[i].head, memory_order_relaxed);
+    }
+    for (u32 i = 0; i < count; i++) {
+        wait_written(&ctx.rings[i], heads[i]);
+    }
+}
+
+/*
+  Logger thread.
+ */
+
+static void flush_output(void) {
+    if (ctx.chunk_count > 0) {
+        TRACE_SCOPE("write_logs");
+        // Keep messages in order with what other modules print directly.
+        if (ctx.stream == CONSOLE_STDOUT)
+            fflush(stdout);
+        platform_console_write(ctx.stream, ctx.chunks, ctx.chunk_count);
+    }
+    ctx.chunk_count = 0;
+    ctx.text_length = 0;
+}
+
+static void output_record(const struct log_record* record) {
+    enum ConsoleStream stream = get_stream(record->level);
+    if (stream != ctx.stream || ctx.chunk_count + 3 > LOGGER_CHUNK_COUNT ||
+        LOGGER_TEXT_SIZE - ctx.text_length < LOGGER_MSG_MAX_SIZE) {
+        flush_output();
+        ctx.stream = stream;
+    }
+
+    char* message = ctx.text + ctx.text_length;
+    u64 length    = format_record(record, message, LOGGER_MSG_MAX_SIZE);
+    ctx.text_length += length;
+
+    const Affix* prefix         = &prefixes[record->level];
+    ctx.chunks[ctx.chunk_count++] = (ConsoleChunk){prefix->text, prefix->length};
+    ctx.chunks[ctx.chunk_count++] = (ConsoleChunk){message, length};
+    ctx.chunks[ctx.chunk_count++] = (ConsoleChunk){suffix.text, suffix.length};
+}
+
+/**
+ * Skips the padding at the cursor of a ring.
+ *
+ * @return @ref TRUE if a record is available at the cursor.
+ */
+static bool skip_padding(u32 index) {
+    LogRing* ring = &ctx.rings[index];
+    while (ctx.cursors[index] < ctx.limits[index]) {
+        const struct log_record* record =
+            (const struct log_record*) (ring->buffer + ctx.cursors[index] % LOGGER_RING_SIZE);
+        if (record->kind != RECORD_PADDING)
+            return TRUE;
+        ctx.cursors[index] += record->size;
+    }
+    return FALSE;
+}
+
+static const struct log_record* cursor_record(u32 index) {
+    return (const struct log_record*) (ctx.rings[index].buffer + ctx.cursors[index] % LOGGER_RING_SIZE);
+}
+
+static void heap_sift_down(u32 index) {
+    RingCursor* heap = ctx.heap;
+    while (TRUE) {
+        u32 smallest = index;
+        u32 left     = index * 2 + 1;
+        u32 right    = left + 1;
+        if (left < ctx.heap_size && heap[left].timestamp < heap[smallest].timestamp)
+            smallest = left;
+        if (right < ctx.heap_size && heap[right].timestamp < heap[smallest].timestamp)
+            smallest = right;
+        if (smallest == index)
+            return;
+        RingCursor tmp  = heap[index];
+        heap[index]     = heap[smallest];
+        heap[smallest]  = tmp;
+        index           = smallest;
+    }
+}
+
+static void heap_push(u32 ring) {
+    RingCursor* heap = ctx.heap;
+    u32 index        = ctx.heap_size++;
+    heap[index]      = (RingCursor){cursor_record(ring)->timestamp, ring};
+    while (index > 0 && heap[(index - 1) / 2].timestamp > heap[index].timestamp) {
+        RingCursor tmp         = heap[index];
+        heap[index]            = heap[(index - 1) / 2];
+        heap[(index - 1) / 2] = tmp;
+        index                  = (index - 1) / 2;
+    }
+}
+
+/**
+ * Writes out the records published in all rings, merged by timestamp.
+ *
+ * @return The number of written records.
+ */
+static u32 logger_round(void) {
+    u32 count   = atomic_load_explicit(&ctx.ring_count, memory_order_acquire);
+    u32 written = 0;
+
+    ctx.heap_size = 0;
+    for (u32 i = 0; i < count; i++) {
+        ctx.cursors[i] = atomic_load_explicit(&ctx.rings[i].tail, memory_order_relaxed);
+        ctx.limits[i]  = atomic_load_explicit(&ctx.rings[i].head, memory_order_acquire);
+        if (skip_padding(i))
+            heap_push(i);
+    }
+
+    while (ctx.heap_size > 0) {
+        u32 ring                        = ctx.heap[0].ring;
+        const struct log_record* record = cursor_record(ring);
+        output_record(record);
+        written++;
+
+        ctx.cursors[ring] += record->size;
+        if (skip_padding(ring)) {
+            ctx.heap[0].timestamp = cursor_record(ring)->timestamp;
+        } else {
+            ctx.heap[0] = ctx.heap[--ctx.heap_size];
+        }
+        heap_sift_down(0);
+    }
+    flush_output();
+
+    // Hand the space over to the producers once the messages are written.
+    for (u32 i = 0; i < count; i++) {
+        atomic_store_explicit(&ctx.rings[i].tail, ctx.cursors[i], memory_order_release);
+    }
+    return written;
+}
+
+static bool rings_empty(void) {
+    u32 count = atomic_load_explicit(&ctx.ring_count, memory_order_acquire);
+    for (u32 i = 0; i < count; i++) {
+        if (atomic_load_explicit(&ctx.rings[i].head, memory_order_relaxed) !=
+            atomic_load_explicit(&ctx.rings[i].tail, memory_order_relaxed))
+            return FALSE;
+    }
+    return TRUE;
+}
+
+/**
+ * Sleeps until a producer wakes the logger thread up, or for the poll interval.
+ */
+static void logger_wait(void) {
+    mcmutex_lock(&ctx.mutex);
+    atomic_store(&ctx.idle, TRUE);
+    atomic_thread_fence(memory_order_seq_cst);
+    if (rings_empty() && atomic_load(&ctx.running)) {
+        mcvar_timed_wait(&ctx.wake, &ctx.mutex, LOGGER_POLL_INTERVAL_NS);
+    }
+    atomic_store(&ctx.idle, FALSE);
+    mcmutex_unlock(&ctx.mutex);
+}
+
+static void* logger_run(void* arg) {
+    (void) arg;
+    mcthread_set_name("logger");
+    bypass_rings = TRUE;
+
+    // The logger starts before signals are blocked: leave them to the signal handling thread.
+    platform_block_signals();
+
+    u64 last_scan = get_monotonic_ns();
+    while (TRUE) {
+        bool running = atomic_load(&ctx.running);
+        u64 now      = get_monotonic_ns();
+        if (now - last_scan >= LOGGER_LIMITER_SCAN_NS) {
+            summarize_limiters(FALSE);
+            last_scan = now;
+        }
+        if (logger_round() > 0)
+            continue;
+        if (!running)
+            break;
+        logger_wait();
+    }
+    summarize_limiters(TRUE);
+    return NULL;
+}
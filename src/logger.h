@@ -7,11 +7,33 @@
  * This file defines an interface to the logging system.
  * Log messages can be of several @ref LogLevel "priority levels".
  * Priority levels define prefixes and colors of messages, as well as their output stream.
+ *
+ * Logging is asynchronous: each thread copies the format string pointer and the arguments of its
+ * messages into its own lock-free ring, and a logger thread formats them, merges them in
+ * timestamp order, and writes them in batches. Format strings must therefore be string literals;
+ * string arguments are copied and may be freed as soon as the call returns.
+ *
+ * Messages logged before @ref logger_system_init, after @ref logger_system_cleanup, or by threads
+ * which could not get a ring, are written directly.
+ *
+ * Each @ref LogSubsystem "subsystem" has its own level, which can be changed at runtime.
+ * Source files choose their subsystem by defining `LOG_SUBSYSTEM` before including any header;
+ * others log as @ref LOG_SUBSYSTEM_CORE. Messages above the level of their subsystem cost a single
+ * load and branch, and their arguments are not evaluated.
+ *
+ * Messages which can be repeated at a high rate, e.g. once per connection or per packet, should
+ * use @ref log_limitedf or @ref log_sampledf: messages over the limit are counted instead of
+ * logged, and a summary of suppressed messages is logged at most once per @ref LOG_LIMIT_WINDOW_NS.
+ * The logger thread also logs the summaries of statements which stopped being called.
  */
 
 #ifndef LOGGER_H
 #define LOGGER_H
 
+#include "definitions.h"
+
+#include <stdatomic.h>
+
 enum LogLevel {
     /** Errors which prevent the server from running at all.
      * The server will always crash after raising this kind of error.
@@ -33,49 +55,193 @@ enum LogLevel {
     /** Basic information about the running server.
      */
     LOG_LEVEL_INFO,
-#ifdef DEBUG
-    /** Details about the running server. Only available on debug builds.
+    /** Details about the running server. Enabled by default on debug builds.
      */
     LOG_LEVEL_DEBUG,
-#endif
-#ifdef TRACE
     /** Very verbose or lower level detail information.
-     * Only available on debug builds with trace log level enabled.
+     * Enabled by default on builds with the `TRACE` macro defined.
      */
     LOG_LEVEL_TRACE,
-#endif
     _LOG_LEVEL_COUNT
 };
 
-#ifdef TRACE
-#define log_trace(msg) _log_msg(LOG_LEVEL_TRACE, msg)
-#define log_tracef(msg, ...) _log_msgf(LOG_LEVEL_TRACE, msg, __VA_ARGS__)
-#else
-#define log_trace(msg)
-#define log_tracef(msg, ...)
-#endif
+/**
+ * Parts of the server whose log levels can be set independently.
+ */
+enum LogSubsystem {
+    LOG_SUBSYSTEM_CORE,
+    LOG_SUBSYSTEM_NETWORK,
+    LOG_SUBSYSTEM_EVENT,
+    LOG_SUBSYSTEM_MEMORY,
+    LOG_SUBSYSTEM_NBT,
+    LOG_SUBSYSTEM_JSON,
+    LOG_SUBSYSTEM_REGISTRY,
+    LOG_SUBSYSTEM_PLATFORM,
+    _LOG_SUBSYSTEM_COUNT
+};
 
-#ifdef DEBUG
-#define log_debug(msg) _log_msg(LOG_LEVEL_DEBUG, msg)
-#define log_debugf(msg, ...) _log_msgf(LOG_LEVEL_DEBUG, msg, __VA_ARGS__)
-#else
-#define log_debug(msg)
-#define log_debugf(msg, ...)
+#ifndef LOG_SUBSYSTEM
+#define LOG_SUBSYSTEM LOG_SUBSYSTEM_CORE
 #endif
 
-#define log_info(msg) _log_msg(LOG_LEVEL_INFO, msg)
-#define log_warn(msg) _log_msg(LOG_LEVEL_WARN, msg)
-#define log_error(msg) _log_msg(LOG_LEVEL_ERROR, msg)
+/**
+ * Most verbose level enabled for each subsystem.
+ *
+ * Only written by the functions below; read by the logging macros.
+ */
+extern _Atomic u8 log_levels[_LOG_SUBSYSTEM_COUNT];
+
+/**
+ * Tells whether messages of a level are logged by the subsystem of the calling file.
+ *
+ * Useful to skip computing what is only needed by log messages.
+ */
+#define log_enabled(lvl)                                                                           \
+    __builtin_expect(                                                                              \
+        (lvl) <= atomic_load_explicit(&log_levels[LOG_SUBSYSTEM], memory_order_relaxed),           \
+        (lvl) <= LOG_LEVEL_INFO)
+
+#define _log_at(lvl, msg)                                                                          \
+    do {                                                                                           \
+        if (log_enabled(lvl))                                                                      \
+            _log_msg(lvl, msg);                                                                    \
+    } while (0)
+
+#define _log_atf(lvl, msg, ...)                                                                    \
+    do {                                                                                           \
+        if (log_enabled(lvl))                                                                      \
+            _log_msgf(lvl, msg, __VA_ARGS__);                                                      \
+    } while (0)
+
+#define log_trace(msg) _log_at(LOG_LEVEL_TRACE, msg)
+#define log_debug(msg) _log_at(LOG_LEVEL_DEBUG, msg)
+#define log_info(msg) _log_at(LOG_LEVEL_INFO, msg)
+#define log_warn(msg) _log_at(LOG_LEVEL_WARN, msg)
+#define log_error(msg) _log_at(LOG_LEVEL_ERROR, msg)
+// Fatal messages are always logged.
 #define log_fatal(msg) _log_msg(LOG_LEVEL_FATAL, msg)
 
-#define log_infof(msg, ...) _log_msgf(LOG_LEVEL_INFO, msg, __VA_ARGS__)
-#define log_warnf(msg, ...) _log_msgf(LOG_LEVEL_WARN, msg, __VA_ARGS__)
-#define log_errorf(msg, ...) _log_msgf(LOG_LEVEL_ERROR, msg, __VA_ARGS__)
+#define log_tracef(msg, ...) _log_atf(LOG_LEVEL_TRACE, msg, __VA_ARGS__)
+#define log_debugf(msg, ...) _log_atf(LOG_LEVEL_DEBUG, msg, __VA_ARGS__)
+#define log_infof(msg, ...) _log_atf(LOG_LEVEL_INFO, msg, __VA_ARGS__)
+#define log_warnf(msg, ...) _log_atf(LOG_LEVEL_WARN, msg, __VA_ARGS__)
+#define log_errorf(msg, ...) _log_atf(LOG_LEVEL_ERROR, msg, __VA_ARGS__)
 #define log_fatalf(msg, ...) _log_msgf(LOG_LEVEL_FATAL, msg, __VA_ARGS__)
 
+/** Length of the windows in which limited messages are counted, in nanoseconds. */
+#define LOG_LIMIT_WINDOW_NS 1000000000UL
+
+/**
+ * State of a limited log statement.
+ *
+ * Each limited statement has its own, so different messages do not suppress each other.
+ */
+typedef struct LogLimiter {
+    /** Messages logged per window, at most. */
+    const u32 burst;
+    /** One message out of this many is considered for logging. */
+    const u32 sample;
+    /** Level of the statement, also used by the summaries. */
+    const enum LogLevel level;
+    /** Message or format of the statement, quoted by the summaries. */
+    const char* const message;
+    _Atomic u64 window_start;
+    _Atomic u32 passed;
+    _Atomic u32 calls;
+    _Atomic u32 suppressed;
+    /** Set once the limiter is in the list scanned by the logger thread. */
+    _Atomic bool listed;
+    struct LogLimiter* next;
+} LogLimiter;
+
+#define _log_limited_at(lvl, burst_, sample_, msg, log_call)                                       \
+    do {                                                                                           \
+        static LogLimiter _log_limiter = {                                                         \
+            .burst = (burst_), .sample = (sample_), .level = (lvl), .message = (msg)};             \
+        if (log_enabled(lvl) && _log_limit(&_log_limiter))                                         \
+            log_call;                                                                              \
+    } while (0)
+
+/**
+ * Logs a message, unless this statement already logged @p per_window messages in the current
+ * window.
+ */
+#define log_limited(lvl, per_window, msg)                                                          \
+    _log_limited_at(lvl, per_window, 1, msg, _log_msg(lvl, msg))
+#define log_limitedf(lvl, per_window, msg, ...)                                                    \
+    _log_limited_at(lvl, per_window, 1, msg, _log_msgf(lvl, msg, __VA_ARGS__))
+/**
+ * Logs one message out of @p one_in calls of this statement.
+ */
+#define log_sampled(lvl, one_in, msg)                                                              \
+    _log_limited_at(lvl, UINT32_MAX, one_in, msg, _log_msg(lvl, msg))
+#define log_sampledf(lvl, one_in, msg, ...)                                                        \
+    _log_limited_at(lvl, UINT32_MAX, one_in, msg, _log_msgf(lvl, msg, __VA_ARGS__))
+
+/**
+ * Starts the logger thread.
+ */
 void logger_system_init(void);
+/**
+ * Writes out all pending messages and stops the logger thread.
+ *
+ * No other thread may log while the logging system is being cleaned up.
+ */
 void logger_system_cleanup(void);
 
+/**
+ * Sets the level of a subsystem.
+ *
+ * @param subsystem The subsystem, or @ref _LOG_SUBSYSTEM_COUNT for all of them.
+ * @param lvl The most verbose level to log.
+ */
+void logger_set_level(enum LogSubsystem subsystem, enum LogLevel lvl);
+
+/**
+ * Sets levels from a comma-separated list of `level` or `subsystem=level` items,
+ * e.g. `info,network=trace`. A bare level applies to all subsystems.
+ *
+ * Levels are only changed if the whole list is valid. They become the levels restored by
+ * @ref logger_cycle_verbosity.
+ *
+ * @param spec The list of levels.
+ * @return @ref TRUE if the list is valid.
+ */
+bool logger_parse_levels(const char* spec);
+
+/**
+ * Sets levels from the contents of a file, in the format of @ref logger_parse_levels.
+ *
+ * The file is remembered for @ref logger_reload_levels.
+ *
+ * @param path The path of the file. Must stay valid until the logging system is cleaned up.
+ * @return @ref TRUE if the file was read and is valid.
+ */
+bool logger_load_levels(const char* path);
+
+/**
+ * Reads the file given to @ref logger_load_levels again, and logs the new levels.
+ */
+void logger_reload_levels(void);
+
+/**
+ * Makes all subsystems log at the debug level, then at the trace level, then goes back to the
+ * configured levels, one step per call.
+ */
+void logger_cycle_verbosity(void);
+
+/**
+ * Logs the level of each subsystem.
+ */
+void logger_dump_levels(void);
+
+/**
+ * Waits until all messages logged before the call, by any thread, are written.
+ *
+ * Fatal messages are always flushed this way.
+ */
+void logger_flush(void);
+
 /**
  * @brief Log a message with the given level.
  *
@@ -84,4 +250,13 @@ void logger_system_cleanup(void);
 void _log_msg(enum LogLevel lvl, char* msg);
 void _log_msgf(enum LogLevel lvl, char* format, ...);
 
+/**
+ * Tells whether a limited message should be logged, counting it as suppressed otherwise.
+ *
+ * The first message logged in a new window is preceded by the number of messages suppressed
+ * since the previous summary. A limiter which suppressed a message is added to the list the logger
+ * thread scans, so that the summary is logged even if the statement is not called again.
+ */
+bool _log_limit(LogLimiter* limiter);
+
 #endif /* ! LOGGER_H */
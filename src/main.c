@@ -4,7 +4,16 @@
 #include "network/network.h"
 #include "platform/platform.h"
 #include "registry/registry.h"
+#include "trace.h"
+#include "memory/dyn_arena.h"
 #include "memory/mem_tags.h"
+#include "utils/hash.h"
+#include "utils/intern.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define DEFAULT_KEY_PATH "server-key.pem"
 
 typedef struct server_ctx {
     bool running;
@@ -12,17 +21,98 @@ typedef struct server_ctx {
 
 static ServerContext server_ctx;
 
-static i32 init(char* host, i32 port, u64 max_connections) {
+static bool parse_arguments(int argc, char** argv, NetworkConfig* config) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--regen-key") == 0) {
+            config->regenerate_key = TRUE;
+        } else if (strcmp(argv[i], "--key-file") == 0) {
+            if (i + 1 >= argc) {
+                log_fatal("Missing value for option '--key-file'.");
+                return FALSE;
+            }
+            config->key_path = argv[++i];
+        } else if (strcmp(argv[i], "--forwarding-secret") == 0) {
+            if (i + 1 >= argc) {
+                log_fatal("Missing value for option '--forwarding-secret'.");
+                return FALSE;
+            }
+            config->forwarding_secret = argv[++i];
+        } else if (strcmp(argv[i], "--capture") == 0) {
+            if (i + 1 >= argc) {
+                log_fatal("Missing value for option '--capture'.");
+                return FALSE;
+            }
+            config->capture_path = argv[++i];
+        } else if (strcmp(argv[i], "--memory-sampling") == 0) {
+            if (i + 1 >= argc) {
+                log_fatal("Missing value for option '--memory-sampling'.");
+                return FALSE;
+            }
+            memory_set_sampling(strtoul(argv[++i], NULL, 10));
+        } else if (strcmp(argv[i], "--trace") == 0) {
+            if (i + 1 >= argc) {
+                log_fatal("Missing value for option '--trace'.");
+                return FALSE;
+            }
+            if (!trace_start(argv[++i]))
+                return FALSE;
+        } else if (strcmp(argv[i], "--log-level") == 0) {
+            if (i + 1 >= argc) {
+                log_fatal("Missing value for option '--log-level'.");
+                return FALSE;
+            }
+            if (!logger_parse_levels(argv[++i]))
+                return FALSE;
+        } else if (strcmp(argv[i], "--log-level-file") == 0) {
+            if (i + 1 >= argc) {
+                log_fatal("Missing value for option '--log-level-file'.");
+                return FALSE;
+            }
+            if (!logger_load_levels(argv[++i]))
+                return FALSE;
+        } else if (strcmp(argv[i], "--random-hash-seed") == 0) {
+            hash_randomize_seed();
+        } else if (strcmp(argv[i], "--offline") == 0) {
+            config->offline = TRUE;
+        } else if (strcmp(argv[i], "--no-key-file") == 0) {
+            config->key_path = NULL;
+        } else {
+            log_fatalf("Unknown option '%s'.", argv[i]);
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+static i32 init(int argc, char** argv) {
     i32 code = 0;
 
     logger_system_init();
 
+    NetworkConfig config = {
+        .host = "0.0.0.0",
+        .port = 25565,
+        .max_connections = 10,
+        .key_path = DEFAULT_KEY_PATH,
+        .regenerate_key = FALSE,
+        .offline = FALSE,
+        .forwarding_secret = NULL,
+        .capture_path = NULL,
+    };
+    if (!parse_arguments(argc, argv, &config)) {
+        logger_system_cleanup();
+        return 1;
+    }
+
     memory_stats_init();
     platform_init();
 
+    intern_system_init();
     event_system_init();
     registry_system_init();
-    code = network_init(host, port, max_connections);
+    // All registries are filled while bootstrapping, they are read-only afterwards.
+    registry_freeze();
+    code = network_init(&config);
 
     if (code != 0) {
         log_fatal("Failed to initialize the server.");
@@ -39,17 +129,20 @@ static void cleanup(void) {
     network_stop();
     registry_system_cleanup();
     event_system_cleanup();
+    intern_system_cleanup();
 
     platform_cleanup();
+    dynarena_cache_cleanup();
+    // The logger thread records spans until it exits, so the rings are freed after it is joined.
+    trace_stop();
     logger_system_cleanup();
+    trace_system_cleanup();
 }
 
 int main(int argc, char** argv) {
-    (void) argc;
-    (void) argv;
     i32 res = 0;
 
-    res = init("0.0.0.0", 25565, 10);
+    res = init(argc, argv);
 
     if (res != 0) {
         return res;
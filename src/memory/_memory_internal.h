@@ -8,9 +8,36 @@
 #include "definitions.h"
 #include "mem_tags.h"
 
-i64 register_block(void* blk, u64 size, enum MemoryBlockTag tag);
-void unregister_block(i64 idx);
-void register_alloc(i64 arena_idx, u64 start, u64 end, enum AllocTag tag);
-void unregister_allocs(i64 arena_idx, u64 start);
+typedef struct BlockTracker BlockTracker;
+
+#ifdef MEMORY_TRACKING_ENABLED
+
+BlockTracker* register_block(u64 size, enum MemoryBlockTag tag);
+void unregister_block(BlockTracker* tracker);
+void register_alloc(BlockTracker* tracker, u64 start, u64 end, enum AllocTag tag);
+void unregister_allocs(BlockTracker* tracker, u64 start);
+
+#else
+
+static inline BlockTracker* register_block(u64 size, enum MemoryBlockTag tag) {
+    (void) size;
+    (void) tag;
+    return NULL;
+}
+static inline void unregister_block(BlockTracker* tracker) {
+    (void) tracker;
+}
+static inline void register_alloc(BlockTracker* tracker, u64 start, u64 end, enum AllocTag tag) {
+    (void) tracker;
+    (void) start;
+    (void) end;
+    (void) tag;
+}
+static inline void unregister_allocs(BlockTracker* tracker, u64 start) {
+    (void) tracker;
+    (void) start;
+}
+
+#endif
 
 #endif /* ! _MEMORY_INTERNAL_H */
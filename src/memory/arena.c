@@ -1,13 +1,30 @@
+#define LOG_SUBSYSTEM LOG_SUBSYSTEM_MEMORY
+
 #include "arena.h"
 #include "logger.h"
 #include "utils/bitwise.h"
 #include "utils/math.h"
 #include "_memory_internal.h"
+#include "platform/platform.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+/**
+ * Reserved arenas commit memory by chunks of at least this size, to limit the number of system
+ * calls. Chunks are never smaller than a page.
+ */
+#define ARENA_COMMIT_GRANULARITY 65536
+/**
+ * Arenas backed by huge pages commit memory by whole huge pages: a huge page can only back a range
+ * whose pages all have the same protection.
+ */
+#define ARENA_HUGE_COMMIT_GRANULARITY 2097152
+/** Committed memory kept after the allocated memory when decommitting pages. */
+#define ARENA_RETAINED_SIZE 1048576
+/** Minimum amount of unused committed memory, after the retained memory, to decommit pages. */
+#define ARENA_DECOMMIT_THRESHOLD 4194304
 
 Arena arena_create(u64 size, enum MemoryBlockTag tag) {
     void* block = malloc(size);
@@ -15,15 +32,15 @@ Arena arena_create(u64 size, enum MemoryBlockTag tag) {
     if (!block)
         return (Arena){0};
 
-    i64 idx = register_block(block, size, tag);
+    BlockTracker* tracker = register_block(size, tag);
     log_tracef("Created arena %p of %zu bytes.", block, size);
 
     return (Arena){
         .block = block,
         .capacity = size,
         .length = 0,
-        .saved_length = ~0,
-        .stats_index = idx,
+        .committed = size,
+        .tracker = tracker,
         .logging = TRUE,
     };
 }
@@ -34,22 +51,78 @@ Arena arena_create_silent(u64 size, enum MemoryBlockTag tag) {
     if (!block)
         return (Arena){0};
 
-    i64 idx = register_block(block, size, tag);
+    BlockTracker* tracker = register_block(size, tag);
+
+    return (Arena){
+        .block = block,
+        .capacity = size,
+        .length = 0,
+        .committed = size,
+        .tracker = tracker,
+        .logging = TRUE,
+    };
+}
+
+static u64 commit_granularity(bool huge_pages) {
+    u64 granularity = huge_pages ? ARENA_HUGE_COMMIT_GRANULARITY : ARENA_COMMIT_GRANULARITY;
+    u64 page_size = get_page_size();
+    return page_size > granularity ? page_size : granularity;
+}
+
+Arena arena_create_reserved(u64 size, enum MemoryBlockTag tag, bool huge_pages) {
+    u64 granularity = commit_granularity(huge_pages);
+    size = ceil_u64(size, granularity);
+    void* block = platform_mem_reserve(size, huge_pages);
+
+    if (!block)
+        return (Arena){0};
+
+    BlockTracker* tracker = register_block(size, tag);
+    log_tracef("Reserved arena %p of %zu bytes.", block, size);
 
     return (Arena){
         .block = block,
         .capacity = size,
         .length = 0,
-        .saved_length = ~0,
-        .stats_index = idx,
+        .committed = 0,
+        .granularity = granularity,
+        .tracker = tracker,
         .logging = TRUE,
+        .reserved = TRUE,
     };
 }
 
+static void commit(Arena* arena, u64 length) {
+    u64 committed = ceil_u64(length, arena->granularity);
+    if (committed > arena->capacity)
+        committed = arena->capacity;
+
+    if (!platform_mem_commit(offset(arena->block, arena->committed), committed - arena->committed)) {
+        log_errorf("Could not commit memory of arena %p: %s", arena->block, get_last_error());
+        abort();
+    }
+    arena->committed = committed;
+}
+
+static void decommit_unused(Arena* arena) {
+    u64 retained = ceil_u64(arena->length + ARENA_RETAINED_SIZE, arena->granularity);
+    if (arena->committed < retained + ARENA_DECOMMIT_THRESHOLD)
+        return;
+
+    platform_mem_decommit(offset(arena->block, retained), arena->committed - retained);
+    if (arena->logging) {
+        log_tracef("Decommitted %zu bytes of arena %p.", arena->committed - retained, arena->block);
+    }
+    arena->committed = retained;
+}
+
 void arena_destroy(Arena* arena) {
-    unregister_block(arena->stats_index);
+    unregister_block(arena->tracker);
 
-    free(arena->block);
+    if (arena->reserved)
+        platform_mem_release(arena->block, arena->capacity);
+    else
+        free(arena->block);
     if (arena->logging) {
         log_tracef("Destroyed arena %p (%zu / %zu).", arena->block, arena->length, arena->capacity);
     }
@@ -71,8 +144,11 @@ void* arena_allocate(Arena* arena, u64 bytes, enum AllocTag tags) {
         return NULL;
     }
 
+    if (arena->length + bytes > arena->committed)
+        commit(arena, arena->length + bytes);
+
     void* ptr = offset(arena->block, arena->length);
-    register_alloc(arena->stats_index, arena->length, arena->length + bytes, tags);
+    register_alloc(arena->tracker, arena->length, arena->length + bytes, tags);
     arena->length += bytes;
     if (arena->logging) {
         log_tracef("Allocated %zu bytes from %p (%zu/%zu).",
@@ -95,7 +171,7 @@ void arena_free(Arena* arena, u64 bytes) {
         bytes = arena->length;
 
     arena->length -= bytes;
-    unregister_allocs(arena->stats_index, arena->length);
+    unregister_allocs(arena->tracker, arena->length);
     if (arena->logging) {
         log_tracef("Freed %zu bytes from %p (%zu/%zu).",
                    bytes,
@@ -109,28 +185,18 @@ void arena_free_ptr(Arena* arena, void* ptr) {
     if (ptr < arena->block || ptr >= offsetu(arena->block, arena->length))
         return;
     arena->length = ptr - arena->block;
-    unregister_allocs(arena->stats_index, arena->length);
-}
-
-void arena_save(Arena* arena) {
-    if (arena->saved_length != ~0ULL) {
-        log_debug("Arena pointer save would discard previously saved pointer.");
-        return;
-    }
-    arena->saved_length = arena->length;
+    unregister_allocs(arena->tracker, arena->length);
 }
 
-void arena_restore(Arena* arena) {
-    if (arena->length >= arena->saved_length)
-        arena_free(arena, arena->length - arena->saved_length);
-
-    arena->saved_length = ~0;
-}
-
-void* arena_recent_pos(Arena* arena) {
-    return offsetu(arena->block, arena->saved_length);
+ArenaSave arena_save(const Arena* arena) {
+    return (ArenaSave){
+        .length = arena->length,
+    };
 }
 
-u64 arena_recent_length(Arena* arena) {
-    return arena->length - arena->saved_length;
+void arena_restore(Arena* arena, ArenaSave save) {
+    if (arena->length >= save.length)
+        arena_free(arena, arena->length - save.length);
+    if (arena->reserved)
+        decommit_unused(arena);
 }
@@ -9,20 +9,39 @@
 #include "definitions.h"
 #include "mem_tags.h"
 
+typedef struct BlockTracker BlockTracker;
+
 /**
    Simple linear allocator.
 
    The allocated memory is contiguous, but is limited.
+
+   Reserved arenas only reserve their capacity in the virtual address space, and commit memory
+   as they grow. They can be sized generously, without using physical memory they never touch.
  */
 typedef struct arena {
     void* block;
     u64 capacity;
     u64 length;
-    u64 saved_length;
-    i64 stats_index;
+    /** Number of usable bytes at the start of the block. Equal to the capacity for non-reserved arenas. */
+    u64 committed;
+    /** Size of the chunks by which reserved arenas commit memory. */
+    u64 granularity;
+    BlockTracker* tracker;
     bool logging;
+    bool reserved;
 } Arena;
 
+/**
+ * Position of an arena, to restore it later.
+ *
+ * Save points are plain values kept by the caller, so they can be nested at any depth
+ * and cost nothing to create.
+ */
+typedef struct arena_save {
+    u64 length;
+} ArenaSave;
+
 /**
  * Creates an arena allocator of the specified size.
  *
@@ -42,6 +61,19 @@ Arena arena_create(u64 size, enum MemoryBlockTag tag);
  * @return The new arena allocator.
  */
 Arena arena_create_silent(u64 size, enum MemoryBlockTag tag);
+/**
+ * Creates an arena allocator which reserves the specified size of virtual memory.
+ *
+ * Memory is committed on demand when allocating. When restoring a saved pointer frees a lot of
+ * memory, the unused pages are given back to the system.
+ *
+ * @param size The number of bytes to reserve for the arena.
+ * @param tag
+ * @param huge_pages @ref TRUE to back the arena with transparent huge pages when possible.
+ *                   Only worth it for big and long-lived arenas.
+ * @return The new arena allocator.
+ */
+Arena arena_create_reserved(u64 size, enum MemoryBlockTag tag, bool huge_pages);
 /**
  * Frees all memory associated with an arena.
  *
@@ -91,40 +123,24 @@ void arena_free(Arena* arena, u64 bytes);
 void arena_free_ptr(Arena* arena, void* ptr);
 
 /**
- * Saves the current pointer to available memory.
- *
- * If another pointer is saved, it is discarded and replaced by the current one.
- *
- * @param arena The arena of which to save the current pointer.
- */
-void arena_save(Arena* arena);
-/**
- * Restores the available memory pointer that was previously saved.
+ * Saves the current position of an arena.
  *
- * Note that calling this function before saving any available memory pointer simply
- * restores the pointer to the start of the underlying memory, i.e. frees all memory.
+ * Save points can be nested: restoring a save point discards the save points created after it,
+ * but not the ones created before.
  *
- * @param arena The arena of which to restore the available memory pointer.
+ * @param[in] arena The arena of which to save the position.
+ * @return The current position, to give to @ref arena_restore.
  */
-void arena_restore(Arena* arena);
-
+ArenaSave arena_save(const Arena* arena);
 /**
- * Returns the number of bytes saved.
- *
- * After restoring the saved pointer, the arena will have the same amount
- * of allocated bytes as the number returned by this function.
+ * Frees all memory allocated since the specified position was saved.
  *
- * @param arena The arena from which to get the saved pointer.
- * @return The amount of saved bytes.
- */
-u64 arena_recent_length(Arena* arena);
-/**
- * Returns the saved available memory pointer.
+ * Reserved arenas decommit their unused pages if enough memory is freed.
  *
- * @param arena The arena from which to get the saved pointer.
- * @return The saved pointer.
+ * @param arena The arena to restore.
+ * @param save A position of @p arena returned by @ref arena_save.
  */
-void* arena_recent_pos(Arena* arena);
+void arena_restore(Arena* arena, ArenaSave save);
 
 /**
  * Indicates whether two arenas share the same memory block or not.
@@ -1,134 +1,244 @@
+#define LOG_SUBSYSTEM LOG_SUBSYSTEM_MEMORY
+
 #include "dyn_arena.h"
-#include "../utils/bitwise.h"
-#include "arena.h"
+#include "_memory_internal.h"
+
+#include "logger.h"
+#include "utils/math.h"
 
-#include <stdio.h>
+#include <stdatomic.h>
 #include <stdlib.h>
 #include <string.h>
-#define BLOCK_SIZE 4096
 
-static void ensure_capacity(DynamicArena* arena, size_t capacity) {
-    if (capacity <= arena->block_capacity)
-        return;
-    size_t new_cap = ceil_two_pow(capacity);
-    Arena* new_block_array = realloc(arena->blocks, new_cap * sizeof(Arena));
-    if (!new_block_array)
-        return;
+/** Size class of blocks larger than the largest size class. These are never cached. */
+#define OVERSIZED_CLASS DYNARENA_SIZE_CLASSES
+
+/**
+ * Header at the start of each block, followed by the allocated memory.
+ */
+typedef struct dynarena_block {
+    struct dynarena_block* previous;
+    BlockTracker* tracker;
+    u64 capacity;
+    u64 length;
+    u32 size_class;
+} DynamicArenaBlock;
+
+#define HEADER_SIZE ceil_u64(sizeof(DynamicArenaBlock), 16)
+
+/**
+ * Free blocks shared by all threads, sorted by size class.
+ *
+ * Blocks keep the tag they were created with when they are reused.
+ * The cache is protected by a spin lock, which is only held to push or pop a pointer.
+ * Blocks which would make the cache hold more than @ref DYNARENA_CACHED_BYTES are freed instead.
+ */
+static struct block_cache {
+    atomic_flag lock;
+    DynamicArenaBlock* blocks[DYNARENA_SIZE_CLASSES][DYNARENA_CACHED_BLOCKS];
+    u32 counts[DYNARENA_SIZE_CLASSES];
+    u64 bytes;
+} cache = {
+    .lock = ATOMIC_FLAG_INIT,
+};
+
+static void* block_data(DynamicArenaBlock* block) {
+    return (u8*) block + HEADER_SIZE;
+}
 
-    arena->blocks = new_block_array;
-    arena->block_capacity = new_cap;
+static u64 class_size(u32 size_class) {
+    return (u64) DYNARENA_MIN_BLOCK_SIZE << size_class;
 }
 
-static Arena* add_block(DynamicArena* arena, size_t size) {
-    ensure_capacity(arena, arena->block_count + 1);
-    Arena* blk = &arena->blocks[arena->block_count];
-    *blk = arena_create(BLOCK_SIZE * ((BLOCK_SIZE - 1 + size) / BLOCK_SIZE), BLK_TAG_MEMORY);
-    arena->block_count++;
-#ifdef DEBUG
-    printf("Added block with capacity %zu bytes.\n", blk->capacity);
-#endif
-    return blk;
+static void cache_lock(void) {
+    while (atomic_flag_test_and_set_explicit(&cache.lock, memory_order_acquire)) {
+    }
 }
 
-static void remove_block(DynamicArena* arena, size_t idx) {
-    arena_destroy(&arena->blocks[idx]);
-    memmove(arena->blocks + idx, arena->blocks + idx + 1, arena->block_count - idx - 1);
-    arena->block_count--;
-#ifdef DEBUG
-    puts("Removed block");
-#endif
+static void cache_unlock(void) {
+    atomic_flag_clear_explicit(&cache.lock, memory_order_release);
 }
 
-static long get_enclosing_block(const DynamicArena* arena, void* ptr) {
-    for (size_t i = 0; i < arena->block_count; i++) {
-        Arena* blk = &arena->blocks[i];
-        if (ptr >= blk->block && ptr < offset(blk->block, blk->length))
-            return i;
+static DynamicArenaBlock* cache_take(u32 size_class) {
+    if (size_class == OVERSIZED_CLASS)
+        return NULL;
+
+    DynamicArenaBlock* block = NULL;
+    cache_lock();
+    if (cache.counts[size_class] > 0) {
+        block = cache.blocks[size_class][--cache.counts[size_class]];
+        cache.bytes -= block->capacity;
     }
-    return -1;
+    cache_unlock();
+    return block;
 }
 
-static Arena* find_suitable_block(const DynamicArena* arena, size_t size) {
-    Arena* suitable = NULL;
-    for (size_t i = 0; i < arena->block_count; i++) {
-        Arena* block = &arena->blocks[i];
-        if (block->capacity - block->length >= size) {
-            suitable = block;
-            break;
-        }
+static bool cache_give(DynamicArenaBlock* block) {
+    if (block->size_class == OVERSIZED_CLASS)
+        return FALSE;
+
+    bool cached = FALSE;
+    cache_lock();
+    if (cache.counts[block->size_class] < DYNARENA_CACHED_BLOCKS &&
+        cache.bytes + block->capacity <= DYNARENA_CACHED_BYTES) {
+        cache.blocks[block->size_class][cache.counts[block->size_class]++] = block;
+        cache.bytes += block->capacity;
+        cached = TRUE;
     }
-    return suitable;
+    cache_unlock();
+    return cached;
 }
 
-#ifdef DEBUG
-static size_t total_size(const DynamicArena* arena) {
-    size_t res = 0;
-    for (size_t i = 0; i < arena->block_count; i++) {
-        res += arena->blocks[i].length;
+static void release_block(DynamicArenaBlock* block) {
+    unregister_allocs(block->tracker, 0);
+    block->length = 0;
+    block->previous = NULL;
+    if (cache_give(block))
+        return;
+
+    unregister_block(block->tracker);
+    free(block);
+}
+
+static DynamicArenaBlock* acquire_block(u32 size_class, u64 capacity, enum MemoryBlockTag tag) {
+    DynamicArenaBlock* block = cache_take(size_class);
+    if (block)
+        return block;
+
+    block = malloc(HEADER_SIZE + capacity);
+    if (!block) {
+        log_errorf("Could not allocate a memory block of %zu bytes.", HEADER_SIZE + capacity);
+        abort();
     }
-    return res;
+    *block = (DynamicArenaBlock){
+        .previous = NULL,
+        .tracker = register_block(capacity, tag),
+        .capacity = capacity,
+        .length = 0,
+        .size_class = size_class,
+    };
+    return block;
 }
-#endif
 
-DynamicArena dynarena_create() {
-    DynamicArena res = {.blocks = malloc(sizeof(Arena) * 4), .block_capacity = 4, .block_count = 0};
+/**
+ * Adds a block able to hold at least the specified amount of bytes at the end of the chain.
+ */
+static DynamicArenaBlock* add_block(DynamicArena* arena, u64 bytes) {
+    u32 size_class = arena->current ? arena->current->size_class + 1 : 0;
+    while (size_class < DYNARENA_SIZE_CLASSES && class_size(size_class) < bytes) {
+        size_class++;
+    }
+
+    u64 capacity;
+    if (size_class < DYNARENA_SIZE_CLASSES) {
+        capacity = class_size(size_class);
+    } else if (bytes <= class_size(DYNARENA_SIZE_CLASSES - 1)) {
+        size_class = DYNARENA_SIZE_CLASSES - 1;
+        capacity = class_size(size_class);
+    } else {
+        size_class = OVERSIZED_CLASS;
+        capacity = bytes;
+    }
+
+    DynamicArenaBlock* block = acquire_block(size_class, capacity, arena->tag);
+    block->previous = arena->current;
+    arena->current = block;
+    return block;
+}
 
-    return res;
+DynamicArena dynarena_create(enum MemoryBlockTag tag) {
+    return (DynamicArena){
+        .current = NULL,
+        .length = 0,
+        .tag = tag,
+    };
 }
 
 void dynarena_destroy(DynamicArena* arena) {
-    for (size_t i = 0; i < arena->block_count; i++) {
-        arena_destroy(&arena->blocks[i]);
-    }
-    free(arena->blocks);
+    dynarena_restore(arena, (DynamicArenaSave){0});
 }
 
-void dynarena_reserve(DynamicArena* arena, size_t bytes) {
-    Arena* blk = find_suitable_block(arena, bytes);
-    if (blk == NULL)
+void dynarena_reserve(DynamicArena* arena, u64 bytes) {
+    bytes = ceil_u64(bytes, sizeof(uintptr_t));
+    DynamicArenaBlock* block = arena->current;
+    if (!block || block->capacity - block->length < bytes)
         add_block(arena, bytes);
 }
 
-void* dynarena_allocate(DynamicArena* arena, size_t bytes) {
+void* dynarena_allocate(DynamicArena* arena, u64 bytes, enum AllocTag tag) {
     if (bytes == 0)
         return NULL;
 
-    Arena* suitable = find_suitable_block(arena, bytes);
-    if (suitable == NULL)
-        suitable = add_block(arena, bytes);
+    // Alignment
+    bytes = ceil_u64(bytes, sizeof(uintptr_t));
 
-    void* ptr = arena_allocate(suitable, bytes, 0);
-
-#ifdef DEBUG
-    printf("Allocated %zu bytes, now %zu bytes.\n", bytes, total_size(arena));
-#endif
+    DynamicArenaBlock* block = arena->current;
+    if (!block || block->capacity - block->length < bytes)
+        block = add_block(arena, bytes);
 
+    void* ptr = (u8*) block_data(block) + block->length;
+    register_alloc(block->tracker, block->length, block->length + bytes, tag);
+    block->length += bytes;
+    arena->length += bytes;
     return ptr;
 }
 
-void* dynarena_callocate(DynamicArena* arena, size_t bytes) {
-    void* ptr = dynarena_allocate(arena, bytes);
+void* dynarena_callocate(DynamicArena* arena, u64 bytes, enum AllocTag tag) {
+    void* ptr = dynarena_allocate(arena, bytes, tag);
+    if (!ptr)
+        return NULL;
     return memset(ptr, 0, bytes);
 }
 
-void dynarena_free(DynamicArena* arena, size_t bytes) {
-    Arena* blk = &arena->blocks[arena->block_count];
-    arena_free(blk, bytes);
-    if (blk->length == 0)
-        remove_block(arena, arena->block_count - 1);
+void dynarena_free_ptr(DynamicArena* arena, void* ptr) {
+    u64 length = arena->length;
+    for (DynamicArenaBlock* block = arena->current; block; block = block->previous) {
+        u8* data = block_data(block);
+        length -= block->length;
+        if ((u8*) ptr >= data && (u8*) ptr < data + block->length) {
+            u64 block_length = (u8*) ptr - data;
+            dynarena_restore(arena,
+                             (DynamicArenaSave){
+                                 .block = block,
+                                 .block_length = block_length,
+                                 .length = length + block_length,
+                             });
+            return;
+        }
+    }
+}
 
-#ifdef DEBUG
-    printf("Freed %zu bytes, now %zu bytes.\n", bytes, total_size(arena));
-#endif
+DynamicArenaSave dynarena_save(const DynamicArena* arena) {
+    return (DynamicArenaSave){
+        .block = arena->current,
+        .block_length = arena->current ? arena->current->length : 0,
+        .length = arena->length,
+    };
 }
 
-void dynarena_free_ptr(DynamicArena* arena, void* ptr) {
-    long idx = get_enclosing_block(arena, ptr);
-    if (idx == -1)
-        return;
+void dynarena_restore(DynamicArena* arena, DynamicArenaSave save) {
+    while (arena->current && arena->current != save.block) {
+        DynamicArenaBlock* block = arena->current;
+        arena->current = block->previous;
+        release_block(block);
+    }
+
+    if (arena->current) {
+        arena->current->length = save.block_length;
+        unregister_allocs(arena->current->tracker, save.block_length);
+    }
+    arena->length = save.length;
+}
 
-    Arena* blk = &arena->blocks[idx];
-    arena_free_ptr(blk, ptr);
-    if (blk->length == 0)
-        remove_block(arena, arena->block_count - 1);
+void dynarena_cache_cleanup(void) {
+    cache_lock();
+    for (u32 i = 0; i < DYNARENA_SIZE_CLASSES; i++) {
+        for (u32 j = 0; j < cache.counts[i]; j++) {
+            unregister_block(cache.blocks[i][j]->tracker);
+            free(cache.blocks[i][j]);
+        }
+        cache.counts[i] = 0;
+    }
+    cache.bytes = 0;
+    cache_unlock();
 }
@@ -1,3 +1,8 @@
+/**
+ * @file
+ *
+ * A growable linear memory allocator.
+ */
 #ifndef LINALLOC_H
 #define LINALLOC_H
 
@@ -5,27 +10,121 @@
 #include "arena.h"
 #include <stddef.h>
 
+/** Size of the blocks of the smallest size class. */
+#define DYNARENA_MIN_BLOCK_SIZE 65536
+/** Number of size classes. The largest blocks are 2^(DYNARENA_SIZE_CLASSES - 1) times larger than the smallest. */
+#define DYNARENA_SIZE_CLASSES 12
+/** Maximum number of free blocks kept by the block cache for each size class. */
+#define DYNARENA_CACHED_BLOCKS 8
+/** Maximum number of bytes kept by the block cache, all size classes included. */
+#define DYNARENA_CACHED_BYTES (64L << 20)
+
+struct dynarena_block;
+
 /**
-   A more complex allocatr than an @{Arena}.
+   A more complex allocator than an @ref Arena.
 
    The allocated memory is not guaranteed to be continuous,
    but there is no limit to how many memory can be allocated.
 
-   This is basically a vector of Arenas.
+   Memory is allocated in a chain of blocks. Each new block belongs to a size class at least one
+   larger than the previous block, so the number of blocks grows logarithmically with the
+   allocated memory. Blocks which are not used anymore are given to a global block cache shared by
+   all threads, and are reused by other dynamic arenas.
  */
 typedef struct linalloc {
-    Arena* blocks;
-    size_t block_count;
-    size_t block_capacity;
+    struct dynarena_block* current; /**< Last block of the chain, the one memory is allocated from. */
+    u64 length;                     /**< Total number of bytes allocated. */
+    enum MemoryBlockTag tag;        /**< Tag of the memory blocks, for memory instrumentation. */
 } DynamicArena;
 
-DynamicArena dynarena_create();
-void dynarena_reserve(DynamicArena* arena, size_t bytes);
+/**
+ * Position of a dynamic arena, to restore it later.
+ *
+ * Several positions can be saved and restored in a LIFO order.
+ */
+typedef struct dynarena_save {
+    struct dynarena_block* block;
+    u64 block_length;
+    u64 length;
+} DynamicArenaSave;
+
+/**
+ * Creates an empty dynamic arena.
+ *
+ * No memory is allocated until the first allocation.
+ *
+ * @param tag The tag of the memory blocks of the arena.
+ * @return The new dynamic arena.
+ */
+DynamicArena dynarena_create(enum MemoryBlockTag tag);
+/**
+ * Gives all the blocks of a dynamic arena back to the block cache.
+ *
+ * @param arena The arena to destroy.
+ */
 void dynarena_destroy(DynamicArena* arena);
+/**
+ * Makes sure the next allocation of the specified size does not need a new block.
+ *
+ * @param arena The arena to reserve memory in.
+ * @param bytes The amount of bytes to reserve.
+ */
+void dynarena_reserve(DynamicArena* arena, u64 bytes);
 
-void* dynarena_allocate(DynamicArena* arena, size_t bytes);
-void* dynarena_callocate(DynamicArena* arena, size_t bytes);
-void dynarena_free(DynamicArena* arena, size_t bytes);
+/**
+ * Allocates memory in a dynamic arena.
+ *
+ * Allocated memory is not initialized. If no memory is available, abort() is called.
+ *
+ * @param arena The arena to use to allocate memory.
+ * @param bytes The amount of bytes to allocate.
+ * @param tag Tag of the allocation. Used by memory instrumentation.
+ * @return A pointer to the allocated memory, or NULL if @p bytes is 0.
+ */
+void* dynarena_allocate(DynamicArena* arena, u64 bytes, enum AllocTag tag);
+/**
+ * Allocates memory in a dynamic arena and fills it with 0.
+ *
+ * @param arena The arena to use to allocate memory.
+ * @param bytes The amount of bytes to allocate.
+ * @param tag Tag of the allocation. Used by memory instrumentation.
+ * @return A pointer to the allocated memory, or NULL if @p bytes is 0.
+ */
+void* dynarena_callocate(DynamicArena* arena, u64 bytes, enum AllocTag tag);
+/**
+ * Frees the memory allocated at and after the specified pointer.
+ *
+ * Nothing is freed if the pointer was not allocated from the arena.
+ *
+ * @param arena The arena to free memory from.
+ * @param ptr A pointer previously returned by an allocation from @p arena.
+ */
 void dynarena_free_ptr(DynamicArena* arena, void* ptr);
 
+/**
+ * Gets the current position of a dynamic arena.
+ *
+ * @param[in] arena The arena of which to save the position.
+ * @return The current position, to give to @ref dynarena_restore.
+ */
+DynamicArenaSave dynarena_save(const DynamicArena* arena);
+/**
+ * Frees all memory allocated since the specified position was saved.
+ *
+ * Blocks added after the position was saved are given back to the block cache.
+ * Positions saved after @p save become invalid.
+ *
+ * @param arena The arena to restore.
+ * @param save A position of @p arena returned by @ref dynarena_save.
+ */
+void dynarena_restore(DynamicArena* arena, DynamicArenaSave save);
+
+/**
+ * Frees all the blocks kept by the global block cache.
+ *
+ * Called when the server stops. Dynamic arenas can still be used afterwards.
+ */
+void dynarena_cache_cleanup(void);
+
 #endif /* ! LINALLOC_H */
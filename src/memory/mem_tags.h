@@ -1,6 +1,16 @@
 #ifndef MEM_TAGS_H
 #define MEM_TAGS_H
 
+#include "definitions.h"
+
+/*
+  Memory tracking is compiled in debug builds, and in other builds only if MEMORY_TRACKING is
+  defined. Otherwise, tagging allocations costs nothing.
+ */
+#if defined(DEBUG) || defined(MEMORY_TRACKING)
+#define MEMORY_TRACKING_ENABLED
+#endif
+
 typedef struct str string;
 
 enum AllocTag {
@@ -33,6 +43,26 @@ string get_blk_tag_name(enum MemoryBlockTag tag);
 
 //void set_global_tags(i32 tags);
 void memory_stats_init(void);
+/**
+ * Sets how often allocations are sampled.
+ *
+ * Each thread remembers the size and tags of one allocation out of @p period,
+ * in a small ring of recent samples logged by @ref memory_dump_stats.
+ *
+ * @param period The number of allocations between two samples, or 0 to disable sampling.
+ */
+void memory_set_sampling(u32 period);
+/**
+ * Logs the memory in use like @ref memory_dump_snapshot, followed by the sampled allocations.
+ */
 void memory_dump_stats(void);
+/**
+ * Logs the memory in use, aggregated per block tag and per allocation tag.
+ *
+ * Counters are kept per thread and merged here. Memory freed by another thread than
+ * the one which allocated it is still accounted correctly, but peak values are the sums of the
+ * peaks of each thread, which is an upper bound of the real peak.
+ */
+void memory_dump_snapshot(void);
 
 #endif /* ! MEM_TAGS_H */
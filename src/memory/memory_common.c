@@ -2,34 +2,71 @@
 // Created by bmorino on 06/01/2025.
 //
 
+#define LOG_SUBSYSTEM LOG_SUBSYSTEM_MEMORY
+
 #include "_memory_internal.h"
 #include "mem_tags.h"
 
-#include "containers/object_pool.h"
-#include "containers/vector.h"
 #include "definitions.h"
 #include "logger.h"
-#include "platform/mc_mutex.h"
-#include "platform/mc_thread.h"
 #include "utils/ansi_codes.h"
+#include "utils/string.h"
 
+#include <stdatomic.h>
 #include <stdlib.h>
 
-#define TRACKER_BUF_SIZE (1 << 24)
+/** Maximum number of threads with their own counters. Other threads are not tracked. */
+#define MEMORY_MAX_THREADS 64
+/** Number of allocation samples remembered by each thread. */
+#define MEMORY_SAMPLE_COUNT 16
 
-struct alloc_track {
-    enum AllocTag tag;
+/**
+ * Run of contiguous allocations with the same tag inside a block.
+ * The run ends where the next one starts, or at the end of the tracked allocations.
+ */
+struct tag_run {
     u64 start;
-    u64 end;
+    enum AllocTag tag;
 };
 
-struct blk_track {
-    Vector allocs;
-    const void* block;
+/**
+ * Allocations of a memory block.
+ *
+ * Trackers are shared by all copies of an arena, and are only touched by the thread
+ * using the arena, so no synchronization is needed.
+ * A new allocation discards everything tracked after its start, which also drops the allocations
+ * made by discarded copies of the arena.
+ */
+struct BlockTracker {
+    struct tag_run* runs;
+    u64 run_count;
+    u64 run_capacity;
+    u64 length;
     u64 size;
     enum MemoryBlockTag tag;
 };
 
+struct tag_counters {
+    _Atomic i64 in_use;
+    _Atomic i64 peak;
+    _Atomic i64 count;
+};
+
+/**
+ * Counters of a single thread. Only the owning thread writes to them, without atomic
+ * read-modify-write operations; other threads only read them.
+ */
+struct thread_stats {
+    struct tag_counters allocs[_ALLOC_TAG_COUNT];
+    struct tag_counters blocks[_BLK_TAG_COUNT];
+    _Atomic i64 block_sizes[_BLK_TAG_COUNT];
+
+    u32 sample_countdown;
+    _Atomic u64 sample_head;
+    /** Packed samples: size in the 48 low bits, then the allocation tag and the block tag. */
+    _Atomic u64 samples[MEMORY_SAMPLE_COUNT];
+};
+
 static const char* ALLOC_TAG_NAMES[] = {
     [ALLOC_TAG_UNKNOWN] = "Unknown",
     [ALLOC_TAG_VECTOR] = "Vector",
@@ -52,11 +89,7 @@ static const char* BLK_TAG_NAMES[] = {
     [BLK_TAG_MEMORY] = "Memory",
 };
 
-static u8 arena_buf[TRACKER_BUF_SIZE];
-static Arena stats_arena;
-static ObjectPool arenas;
-static bool tracker_initialized = FALSE;
-static MCMutex stats_mutex;
+static atomic_uint sample_period;
 
 string get_alloc_tag_name(enum AllocTag tag) {
     if (tag >= _ALLOC_TAG_COUNT || tag < ALLOC_TAG_UNKNOWN)
@@ -71,145 +104,274 @@ string get_blk_tag_name(enum MemoryBlockTag tag) {
     return str_create_view(BLK_TAG_NAMES[tag]);
 }
 
-static Arena arena_create_from(void* buf, u64 size) {
-    return (Arena){
-        .block = buf,
-        .capacity = size,
-        .length = 0,
-        .stats_index = -1,
-        .saved_length = ~0,
-        .logging = FALSE,
-    };
+void memory_stats_init(void) {
+#ifdef MEMORY_TRACKING_ENABLED
+    log_debug("Memory tracking is enabled.");
+#else
+    log_debug("Memory tracking is disabled in this build.");
+#endif
 }
 
-void memory_stats_init(void) {
-    if (tracker_initialized)
-        return;
-    tracker_initialized = TRUE;
-    mcmutex_create(&stats_mutex);
-    stats_arena = arena_create_from(arena_buf, TRACKER_BUF_SIZE);
-    objpool_init_dynamic(&arenas, &stats_arena, 8, sizeof(struct blk_track));
+void memory_set_sampling(u32 period) {
+    atomic_store(&sample_period, period);
+}
+
+#ifdef MEMORY_TRACKING_ENABLED
+
+static _Atomic(struct thread_stats*) thread_slots[MEMORY_MAX_THREADS];
+static atomic_uint thread_slot_count;
+static _Thread_local struct thread_stats* local_stats;
+static _Thread_local bool local_stats_unavailable;
+
+static struct thread_stats* get_local_stats(void) {
+    if (local_stats || local_stats_unavailable)
+        return local_stats;
+
+    // Set first: logging may allocate memory.
+    local_stats_unavailable = TRUE;
+    u32 index = atomic_fetch_add(&thread_slot_count, 1);
+    if (index >= MEMORY_MAX_THREADS) {
+        log_warn("Memory: Too many threads, allocations of this thread are not tracked.");
+        return NULL;
+    }
+
+    struct thread_stats* stats = calloc(1, sizeof *stats);
+    if (!stats)
+        return NULL;
+    atomic_store_explicit(&thread_slots[index], stats, memory_order_release);
+    local_stats = stats;
+    local_stats_unavailable = FALSE;
+    return stats;
 }
 
-i64 register_block(void* blk, u64 size, enum MemoryBlockTag tag) {
-    i64 idx;
-    mcmutex_lock(&stats_mutex);
-    struct blk_track* track = objpool_add(&arenas, &idx);
-    track->block = blk;
-    track->size = size;
-    track->tag = tag;
-    vect_init_dynamic(&track->allocs, &stats_arena, 64, sizeof(struct alloc_track));
-    mcmutex_unlock(&stats_mutex);
-    return idx;
+static void add_relaxed(_Atomic i64* counter, i64 value) {
+    atomic_store_explicit(
+        counter, atomic_load_explicit(counter, memory_order_relaxed) + value, memory_order_relaxed);
 }
 
-void unregister_block(i64 idx) {
-    mcmutex_lock(&stats_mutex);
-    objpool_remove(&arenas, idx);
-    mcmutex_unlock(&stats_mutex);
+static void counters_add(struct tag_counters* counters, i64 size) {
+    i64 in_use = atomic_load_explicit(&counters->in_use, memory_order_relaxed) + size;
+    atomic_store_explicit(&counters->in_use, in_use, memory_order_relaxed);
+    if (in_use > atomic_load_explicit(&counters->peak, memory_order_relaxed))
+        atomic_store_explicit(&counters->peak, in_use, memory_order_relaxed);
 }
 
-void register_alloc(i64 arena_idx, u64 start, u64 end, enum AllocTag tag) {
-    if (arena_idx < 0)
+static void sample_alloc(struct thread_stats* stats, u64 size, enum AllocTag tag, enum MemoryBlockTag blk_tag) {
+    u32 period = atomic_load_explicit(&sample_period, memory_order_relaxed);
+    if (period == 0)
         return;
 
-    if (start >= end) {
-        log_error("Memory: The start offset of an allocation must be strictly less than its end !");
+    if (stats->sample_countdown == 0 || stats->sample_countdown > period)
+        stats->sample_countdown = period;
+    if (--stats->sample_countdown != 0)
         return;
+
+    u64 sample = (size & 0xFFFFFFFFFFFF) | ((u64) tag << 48) | ((u64) blk_tag << 56);
+    u64 head = atomic_load_explicit(&stats->sample_head, memory_order_relaxed);
+    atomic_store_explicit(&stats->samples[head % MEMORY_SAMPLE_COUNT], sample, memory_order_relaxed);
+    atomic_store_explicit(&stats->sample_head, head + 1, memory_order_release);
+}
+
+BlockTracker* register_block(u64 size, enum MemoryBlockTag tag) {
+    BlockTracker* tracker = calloc(1, sizeof *tracker);
+    if (!tracker)
+        return NULL;
+    tracker->size = size;
+    tracker->tag = tag;
+
+    struct thread_stats* stats = get_local_stats();
+    if (stats) {
+        add_relaxed(&stats->blocks[tag].count, 1);
+        add_relaxed(&stats->block_sizes[tag], size);
     }
+    return tracker;
+}
 
-    struct alloc_track alloc = {
-        .start = start,
-        .end = end,
-        .tag = tag,
-    };
-
-    mcmutex_lock(&stats_mutex);
-    struct blk_track* track = objpool_get(&arenas, arena_idx);
-    struct alloc_track* tmp_alloc;
-    while ((tmp_alloc = vect_ref(&track->allocs, vect_size(&track->allocs) - 1))) {
-        if (tmp_alloc->start == start) {
-            tmp_alloc->end = end;
-            tmp_alloc->tag = tag;
-            mcmutex_unlock(&stats_mutex);
-            return;
-        }
+void unregister_block(BlockTracker* tracker) {
+    if (!tracker)
+        return;
 
-        if (tmp_alloc->start < start) {
-            if (tmp_alloc->end < start)
-                log_warn("Memory: A region of memory is allocated after a gap");
-            tmp_alloc->end = start;
-            break;
+    unregister_allocs(tracker, 0);
+    struct thread_stats* stats = get_local_stats();
+    if (stats) {
+        add_relaxed(&stats->blocks[tracker->tag].count, -1);
+        add_relaxed(&stats->block_sizes[tracker->tag], -(i64) tracker->size);
+    }
+    free(tracker->runs);
+    free(tracker);
+}
+
+void register_alloc(BlockTracker* tracker, u64 start, u64 end, enum AllocTag tag) {
+    if (!tracker)
+        return;
+
+    // Drop what a discarded copy of the arena may have allocated after the start.
+    if (start < tracker->length)
+        unregister_allocs(tracker, start);
+    if (start == end)
+        return;
+
+    struct tag_run* last = tracker->run_count > 0 ? &tracker->runs[tracker->run_count - 1] : NULL;
+    if (!last || last->tag != tag) {
+        if (tracker->run_count == tracker->run_capacity) {
+            u64 capacity = tracker->run_capacity ? tracker->run_capacity * 2 : 8;
+            struct tag_run* runs = realloc(tracker->runs, capacity * sizeof *runs);
+            if (!runs)
+                return;
+            tracker->runs = runs;
+            tracker->run_capacity = capacity;
         }
-        vect_pop(&track->allocs, NULL);
+        tracker->runs[tracker->run_count++] = (struct tag_run){
+            .start = start,
+            .tag = tag,
+        };
     }
-    vect_add(&track->allocs, &alloc);
-    mcmutex_unlock(&stats_mutex);
+    tracker->length = end;
+
+    struct thread_stats* stats = get_local_stats();
+    if (!stats)
+        return;
+
+    i64 size = end - start;
+    counters_add(&stats->allocs[tag], size);
+    add_relaxed(&stats->allocs[tag].count, 1);
+    counters_add(&stats->blocks[tracker->tag], size);
+    sample_alloc(stats, size, tag, tracker->tag);
 }
 
-void unregister_allocs(i64 arena_idx, u64 start) {
-    if (arena_idx < 0)
+void unregister_allocs(BlockTracker* tracker, u64 start) {
+    if (!tracker || start >= tracker->length)
         return;
 
-    struct blk_track* track = objpool_get(&arenas, arena_idx);
-    struct alloc_track* tmp_alloc;
-    while ((tmp_alloc = vect_ref(&track->allocs, vect_size(&track->allocs) - 1))) {
-        if (tmp_alloc->start < start) {
-            if (tmp_alloc->end > start)
-                tmp_alloc->end = start;
+    struct thread_stats* stats = get_local_stats();
+    u64 end = tracker->length;
+    while (tracker->run_count > 0) {
+        struct tag_run* run = &tracker->runs[tracker->run_count - 1];
+        u64 run_start = run->start > start ? run->start : start;
+        if (stats)
+            add_relaxed(&stats->allocs[run->tag].in_use, -(i64) (end - run_start));
+
+        if (run->start < start)
             break;
-        }
-        vect_pop(&track->allocs, NULL);
+        end = run->start;
+        tracker->run_count--;
     }
+
+    if (stats)
+        add_relaxed(&stats->blocks[tracker->tag].in_use, -(i64) (tracker->length - start));
+    tracker->length = start;
 }
 
-struct stat_dump_data {
-    u64 total_allocated;
-    u64 total_available;
+struct merged_counters {
+    i64 in_use;
+    i64 peak;
+    i64 count;
+};
+
+struct snapshot_data {
+    struct merged_counters blocks[_BLK_TAG_COUNT];
+    i64 block_sizes[_BLK_TAG_COUNT];
+    struct merged_counters allocs[_ALLOC_TAG_COUNT];
 };
 
-static void dump_block_stats(void* ptr, i64 idx, void* user_data) {
-    struct stat_dump_data* data = user_data;
-    struct blk_track* track = ptr;
-
-    log_infof("Block %li, " ANSI_MAGENTA "%zu" ANSI_RESET " bytes long, starting at " ANSI_CYAN
-              "0x%p" ANSI_RESET ", tagged " ANSI_BLUE "%s" ANSI_RESET ":",
-              idx,
-              track->size,
-              track->block,
-              get_blk_tag_name(track->tag).base);
-    u64 total = 0;
-    for (u64 i = 0; i < vect_size(&track->allocs); ++i) {
-        struct alloc_track* alloc = vect_ref(&track->allocs, i);
-        u64 size = alloc->end - alloc->start;
-        log_infof("- Allocated: offset " ANSI_CYAN "%i" ANSI_RESET ", size " ANSI_MAGENTA
-                  "%i" ANSI_RESET ", tag " ANSI_BLUE "%s",
-                  alloc->start,
-                  size,
-                  get_alloc_tag_name(alloc->tag).base);
-
-        total += size;
-        data->total_allocated += size;
+static void merge_counters(struct merged_counters* dst, struct tag_counters* src) {
+    dst->in_use += atomic_load_explicit(&src->in_use, memory_order_relaxed);
+    dst->peak += atomic_load_explicit(&src->peak, memory_order_relaxed);
+    dst->count += atomic_load_explicit(&src->count, memory_order_relaxed);
+}
+
+static u32 get_thread_count(void) {
+    u32 count = atomic_load(&thread_slot_count);
+    return count < MEMORY_MAX_THREADS ? count : MEMORY_MAX_THREADS;
+}
+
+static void collect_snapshot(struct snapshot_data* data) {
+    u32 thread_count = get_thread_count();
+    for (u32 i = 0; i < thread_count; i++) {
+        struct thread_stats* stats = atomic_load_explicit(&thread_slots[i], memory_order_acquire);
+        if (!stats)
+            continue;
+
+        for (u32 tag = 0; tag < _BLK_TAG_COUNT; tag++) {
+            merge_counters(&data->blocks[tag], &stats->blocks[tag]);
+            data->block_sizes[tag] +=
+                atomic_load_explicit(&stats->block_sizes[tag], memory_order_relaxed);
+        }
+        for (u32 tag = 0; tag < _ALLOC_TAG_COUNT; tag++) {
+            merge_counters(&data->allocs[tag], &stats->allocs[tag]);
+        }
+    }
+}
+
+void memory_dump_snapshot(void) {
+    struct snapshot_data data = {0};
+    collect_snapshot(&data);
+
+    log_info("=== MEMORY SNAPSHOT ===");
+    log_info("Blocks:");
+    for (u32 tag = 0; tag < _BLK_TAG_COUNT; tag++) {
+        struct merged_counters* counters = &data.blocks[tag];
+        if (counters->count == 0 && counters->peak == 0)
+            continue;
+        log_infof("- " ANSI_BLUE "%-12s" ANSI_RESET " %4li block(s), " ANSI_MAGENTA "%10li" ANSI_RESET
+                  " bytes allocated out of " ANSI_MAGENTA "%10li" ANSI_RESET ", peak " ANSI_MAGENTA
+                  "%10li" ANSI_RESET ".",
+                  get_blk_tag_name(tag).base,
+                  counters->count,
+                  counters->in_use,
+                  data.block_sizes[tag],
+                  counters->peak);
+    }
+    log_info("Allocations:");
+    for (u32 tag = 0; tag < _ALLOC_TAG_COUNT; tag++) {
+        struct merged_counters* counters = &data.allocs[tag];
+        if (counters->count == 0)
+            continue;
+        log_infof("- " ANSI_BLUE "%-12s" ANSI_RESET " %8li allocation(s), " ANSI_MAGENTA
+                  "%10li" ANSI_RESET " bytes in use, peak " ANSI_MAGENTA "%10li" ANSI_RESET ".",
+                  get_alloc_tag_name(tag).base,
+                  counters->count,
+                  counters->in_use,
+                  counters->peak);
     }
-    data->total_available += track->size;
-    log_infof("  Block total: " ANSI_MAGENTA "%zu" ANSI_RESET " bytes allocated, " ANSI_MAGENTA
-              "%zu" ANSI_RESET " bytes free.",
-              total,
-              track->size - total);
 }
 
 void memory_dump_stats(void) {
-    mcmutex_lock(&stats_mutex);
-    log_info("=== MEMORY STATISTICS ===");
+    memory_dump_snapshot();
 
-    struct stat_dump_data data = {0};
-    objpool_foreach(&arenas, &dump_block_stats, &data);
+    if (atomic_load(&sample_period) == 0)
+        return;
 
-    log_infof("Total: " ANSI_MAGENTA "%zu" ANSI_RESET " bytes allocated, " ANSI_MAGENTA
-              "%zu" ANSI_RESET " bytes free in " ANSI_MAGENTA "%zu" ANSI_RESET " block(s).",
-              data.total_allocated,
-              data.total_available,
-              objpool_size(&arenas));
+    log_info("Sampled allocations:");
+    u32 thread_count = get_thread_count();
+    for (u32 i = 0; i < thread_count; i++) {
+        struct thread_stats* stats = atomic_load_explicit(&thread_slots[i], memory_order_acquire);
+        if (!stats)
+            continue;
 
-    mcmutex_unlock(&stats_mutex);
+        u64 head = atomic_load_explicit(&stats->sample_head, memory_order_acquire);
+        u64 first = head > MEMORY_SAMPLE_COUNT ? head - MEMORY_SAMPLE_COUNT : 0;
+        for (u64 j = first; j < head; j++) {
+            u64 sample =
+                atomic_load_explicit(&stats->samples[j % MEMORY_SAMPLE_COUNT], memory_order_relaxed);
+            log_infof("- Thread %u: size " ANSI_MAGENTA "%zu" ANSI_RESET ", tag " ANSI_BLUE
+                      "%s" ANSI_RESET ", block " ANSI_BLUE "%s" ANSI_RESET,
+                      i,
+                      sample & 0xFFFFFFFFFFFF,
+                      get_alloc_tag_name((sample >> 48) & 0xFF).base,
+                      get_blk_tag_name(sample >> 56).base);
+        }
+    }
 }
+
+#else
+
+void memory_dump_snapshot(void) {
+    log_info("Memory tracking is disabled in this build.");
+}
+
+void memory_dump_stats(void) {
+    memory_dump_snapshot();
+}
+
+#endif
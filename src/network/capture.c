@@ -0,0 +1,132 @@
+#define LOG_SUBSYSTEM LOG_SUBSYSTEM_NETWORK
+
+#include "capture.h"
+
+#include "logger.h"
+#include "platform/platform.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#define CAPTURE_FILE_BUFFER_SIZE 1048576
+
+/*
+ * The capture state is only accessed by the network thread, so it needs no locking.
+ */
+static FILE* capture_file = NULL;
+static u64 capture_start_time;
+
+static void write_record(u32 connection, enum CaptureRecordType type, u32 length) {
+    u8 header[CAPTURE_RECORD_HEADER_SIZE];
+    u64 timestamp = get_monotonic_ns() - capture_start_time;
+    u8 type_byte = type;
+
+    u8* cursor = header;
+    memcpy(cursor, &timestamp, sizeof timestamp);
+    cursor += sizeof timestamp;
+    memcpy(cursor, &connection, sizeof connection);
+    cursor += sizeof connection;
+    memcpy(cursor, &type_byte, sizeof type_byte);
+    cursor += sizeof type_byte;
+    memcpy(cursor, &length, sizeof length);
+
+    fwrite(header, 1, sizeof header, capture_file);
+}
+
+bool capture_start(const char* path) {
+    capture_file = fopen(path, "wb");
+    if (!capture_file) {
+        log_errorf("Could not open the capture file '%s': %s.", path, strerror(errno));
+        return FALSE;
+    }
+    setvbuf(capture_file, NULL, _IOFBF, CAPTURE_FILE_BUFFER_SIZE);
+
+    u32 version = CAPTURE_VERSION;
+    fwrite(CAPTURE_MAGIC, 1, sizeof CAPTURE_MAGIC - 1, capture_file);
+    fwrite(&version, sizeof version, 1, capture_file);
+
+    capture_start_time = get_monotonic_ns();
+    log_infof("Capturing inbound traffic in '%s'.", path);
+    return TRUE;
+}
+
+void capture_stop(void) {
+    if (!capture_file)
+        return;
+    fclose(capture_file);
+    capture_file = NULL;
+}
+
+bool capture_is_active(void) {
+    return capture_file != NULL;
+}
+
+void capture_open(const Connection* conn) {
+    if (!capture_file)
+        return;
+    write_record(conn->table_index, CAPTURE_OPEN, conn->peer_addr.length);
+    fwrite(conn->peer_addr.base, 1, conn->peer_addr.length, capture_file);
+}
+
+void capture_bytes(const Connection* conn,
+                   enum CaptureRecordType type,
+                   const ByteBuffer* buffer,
+                   i64 start_offset) {
+    if (!capture_file)
+        return;
+
+    u64 region_count = 2;
+    BufferRegion regions[2];
+    u64 length = bytebuf_get_read_regions(buffer, regions, &region_count, start_offset);
+    if (length == 0)
+        return;
+
+    write_record(conn->table_index, type, length);
+    for (u64 i = 0; i < region_count; i++) {
+        fwrite(regions[i].start, 1, regions[i].size, capture_file);
+    }
+}
+
+void capture_close(const Connection* conn) {
+    if (!capture_file)
+        return;
+    write_record(conn->table_index, CAPTURE_CLOSE, 0);
+}
+
+bool capture_read_header(const u8* data, u64 size, u64* out_cursor) {
+    if (size < CAPTURE_FILE_HEADER_SIZE)
+        return FALSE;
+    if (memcmp(data, CAPTURE_MAGIC, sizeof CAPTURE_MAGIC - 1) != 0)
+        return FALSE;
+
+    u32 version;
+    memcpy(&version, data + sizeof CAPTURE_MAGIC - 1, sizeof version);
+    if (version != CAPTURE_VERSION)
+        return FALSE;
+
+    *out_cursor = CAPTURE_FILE_HEADER_SIZE;
+    return TRUE;
+}
+
+bool capture_read_record(const u8* data, u64 size, u64* cursor, CaptureRecord* out) {
+    if (size - *cursor < CAPTURE_RECORD_HEADER_SIZE)
+        return FALSE;
+
+    const u8* header = data + *cursor;
+    memcpy(&out->timestamp, header, sizeof out->timestamp);
+    header += sizeof out->timestamp;
+    memcpy(&out->connection, header, sizeof out->connection);
+    header += sizeof out->connection;
+    memcpy(&out->type, header, sizeof out->type);
+    header += sizeof out->type;
+    memcpy(&out->length, header, sizeof out->length);
+
+    u64 record_start = *cursor + CAPTURE_RECORD_HEADER_SIZE;
+    if (size - record_start < out->length)
+        return FALSE;
+
+    out->data = data + record_start;
+    *cursor = record_start + out->length;
+    return TRUE;
+}
@@ -0,0 +1,132 @@
+/**
+ * @file capture.h
+ * @author Bastien Morino
+ * @ingroup networking
+ *
+ * Capture of the inbound traffic of the server, to replay it offline.
+ *
+ * When a capture is started, every chunk of bytes received from a connection is appended
+ * to the capture file, before and after decryption, along with connection openings
+ * and closings. The replay tool (`make replay`) then feeds these bytes to the receiving
+ * pipeline of the server without any socket.
+ *
+ * A capture file starts with the @ref CAPTURE_MAGIC string and a 32-bit version number,
+ * followed by records. Each record has a fixed size header, followed by @ref CaptureRecord#length
+ * bytes of data. Numbers are stored in host byte order.
+ *
+ * @addtogroup networking
+ * @{
+ */
+
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include "definitions.h"
+
+#include "containers/bytebuffer.h"
+#include "network/connection.h"
+
+/** Magic string at the beginning of capture files. */
+#define CAPTURE_MAGIC "MCSRVCAP"
+/** Version of the capture file format. */
+#define CAPTURE_VERSION 1
+/** Size (in bytes) of the header of capture files. */
+#define CAPTURE_FILE_HEADER_SIZE (sizeof CAPTURE_MAGIC - 1 + sizeof(u32))
+/** Size (in bytes) of the header of each record. */
+#define CAPTURE_RECORD_HEADER_SIZE (sizeof(u64) + sizeof(u32) + sizeof(u8) + sizeof(u32))
+
+/**
+ * Types of capture records.
+ */
+enum CaptureRecordType {
+    /** A connection was accepted. The data is the address of the peer. */
+    CAPTURE_OPEN = 0,
+    /** Bytes received from the socket of a connection, as is. */
+    CAPTURE_RAW = 1,
+    /** The same bytes as the previous @ref CAPTURE_RAW record, after decryption. */
+    CAPTURE_DECRYPTED = 2,
+    /** A connection was closed. There is no data. */
+    CAPTURE_CLOSE = 3,
+};
+
+/**
+ * A single record of a capture file.
+ */
+typedef struct CaptureRecord {
+    u64 timestamp;   /**< Nanoseconds elapsed since the start of the capture. */
+    u32 connection;  /**< Index of the connection in the connection table. */
+    u8 type;         /**< The @ref CaptureRecordType "type" of the record. */
+    u32 length;      /**< Length of the data. */
+    const u8* data;  /**< The data of the record. */
+} CaptureRecord;
+
+/**
+ * Starts capturing the inbound traffic of the server into the given file.
+ *
+ * The capture functions must only be called from the network thread.
+ *
+ * @param[in] path The path of the capture file. It is overwritten if it exists.
+ * @return @ref TRUE if the capture file was opened successfully, @ref FALSE otherwise.
+ */
+bool capture_start(const char* path);
+
+/**
+ * Stops the capture, flushing records to the capture file.
+ */
+void capture_stop(void);
+
+/**
+ * Indicates whether the inbound traffic is being captured.
+ */
+bool capture_is_active(void);
+
+/**
+ * Records that a connection was accepted.
+ */
+void capture_open(const Connection* conn);
+
+/**
+ * Records bytes received from a connection.
+ *
+ * @param[in] conn The connection which received the bytes.
+ * @param type Either @ref CAPTURE_RAW or @ref CAPTURE_DECRYPTED.
+ * @param[in] buffer The receiving buffer of the connection.
+ * @param start_offset The offset, relative to the beginning of the buffer, of the first byte
+ * to record. All bytes after this offset are recorded.
+ */
+void capture_bytes(const Connection* conn,
+                   enum CaptureRecordType type,
+                   const ByteBuffer* buffer,
+                   i64 start_offset);
+
+/**
+ * Records that a connection was closed.
+ */
+void capture_close(const Connection* conn);
+
+/**
+ * Checks the header of capture file contents loaded in memory.
+ *
+ * @param[in] data The contents of the capture file.
+ * @param size The size of the contents.
+ * @param[out] out_cursor Set to the position of the first record.
+ * @return @ref TRUE if the header is valid, @ref FALSE otherwise.
+ */
+bool capture_read_header(const u8* data, u64 size, u64* out_cursor);
+
+/**
+ * Reads the next record of capture file contents loaded in memory.
+ *
+ * The data of the record is not copied, it points inside @p data.
+ *
+ * @param[in] data The contents of the capture file.
+ * @param size The size of the contents.
+ * @param[in,out] cursor The position of the record to read, advanced to the next record.
+ * @param[out] out The record.
+ * @return @ref TRUE if a complete record was read, @ref FALSE at the end of the contents.
+ */
+bool capture_read_record(const u8* data, u64 size, u64* cursor, CaptureRecord* out);
+
+#endif /* ! CAPTURE_H */
+
+/** @} */
@@ -39,6 +39,15 @@ typedef struct NetworkContext {
 
     EncryptionContext enc_ctx;
     u64 compress_threshold;
+    /** Whether players log in without encryption nor authentication. */
+    bool offline;
+    /**
+     * Secret shared with the proxy to verify forwarded player information.
+     * Empty if player information forwarding is disabled.
+     */
+    string forwarding_secret;
+    /** Identifier of the next login plugin request, so responses cannot be replayed. */
+    u32 next_message_id;
 
     string host;
     u32 port;
@@ -1,8 +1,11 @@
+#define LOG_SUBSYSTEM LOG_SUBSYSTEM_NETWORK
+
 #include "compression.h"
 #include "containers/bytebuffer.h"
 #include "logger.h"
 #include "memory/arena.h"
 #include "memory/mem_tags.h"
+#include "trace.h"
 
 #include <stdlib.h>
 #include <zlib.h>
@@ -138,11 +141,13 @@ static i64 zlib_execute(z_streamp stream,
 }
 
 i64 compression_compress(CompressionContext* ctx, ByteBuffer* out_buffer, ByteBuffer* in_buffer) {
+    TRACE_SCOPE("compress");
     return zlib_execute(
         &ctx->deflate_stream, out_buffer, in_buffer, &zlib_deflate, &zlib_reset_deflate);
 }
 
 i64 compression_decompress(CompressionContext* ctx, ByteBuffer* out_buffer, ByteBuffer* in_buffer) {
+    TRACE_SCOPE("decompress");
     return zlib_execute(
         &ctx->inflate_stream, out_buffer, in_buffer, &zlib_inflate, &zlib_reset_inflate);
 }
@@ -1,3 +1,5 @@
+#define LOG_SUBSYSTEM LOG_SUBSYSTEM_NETWORK
+
 #include "connection.h"
 #include "decoders.h"
 #include "encoders.h"
@@ -13,6 +15,11 @@
 #include "platform/mc_mutex.h"
 #include "platform/socket.h"
 
+/*
+ * The persistent and scratch arenas only hold data bounded by the protocol: the packet
+ * buffers, the compression and encryption states, and the packet being received or sent.
+ * Anything else goes in the connection's dynamic arena.
+ */
 #define CONN_PARENA_SIZE 33554432
 #define CONN_SARENA_SIZE 4194304
 #define CONN_BYTEBUF_SIZE 4194304
@@ -55,7 +62,7 @@ static PacketFunction function_table[_STATE_COUNT][_PKT_TYPE_COUNT] = {
         [PKT_LOGIN_DISCONNECT] = {
             &pkt_decode_log_start,
             &pkt_handle_log_start,
-            &pkt_encode_dummy,
+            &pkt_encode_log_disconnect,
             "LOGIN_START",
             "DISCONNECT",
         },
@@ -67,8 +74,8 @@ static PacketFunction function_table[_STATE_COUNT][_PKT_TYPE_COUNT] = {
             "CRYPT_REQUEST",
         },
         [PKT_LOGIN_SUCCESS] = {
-            NULL,
-            NULL,
+            &pkt_decode_log_custom_res,
+            &pkt_handle_log_custom_res,
             &pkt_encode_log_success,
             "LOGIN_CUSTOM_RESPONSE",
             "LOGIN_SUCCESS",
@@ -83,9 +90,9 @@ static PacketFunction function_table[_STATE_COUNT][_PKT_TYPE_COUNT] = {
         [PKT_LOGIN_CUSTOM_REQUEST] = {
             NULL,
             NULL,
-            NULL,
-            "LOGIN_CUSTOM_REQUEST",
+            &pkt_encode_log_custom_req,
             "COOKIE_RESPONSE",
+            "LOGIN_CUSTOM_REQUEST",
         },
         [PKT_LOGIN_COOKIE_REQUEST] = {
             NULL,
@@ -97,9 +104,11 @@ static PacketFunction function_table[_STATE_COUNT][_PKT_TYPE_COUNT] = {
     },
 };
 
-static PacketFunction* get_pkt_funcs(const Packet* pkt, const Connection* conn) {
-    enum PacketType type = pkt->id;
-    enum State state = conn->state;
+static PacketFunction* get_funcs(enum State state, enum PacketType type) {
+    if (state < 0 || state >= _STATE_COUNT || type < 0 || type >= _PKT_TYPE_COUNT) {
+        log_errorf("Could not get packet functions: invalid state %i or packet type %i.", state, type);
+        return NULL;
+    }
 
     PacketFunction* row = function_table[state];
     if (!row) {
@@ -109,6 +118,10 @@ static PacketFunction* get_pkt_funcs(const Packet* pkt, const Connection* conn)
     return &row[type];
 }
 
+static PacketFunction* get_pkt_funcs(const Packet* pkt, const Connection* conn) {
+    return get_funcs(conn->state, pkt->id);
+}
+
 pkt_acceptor get_pkt_handler(const Packet* pkt, Connection* conn) {
     PacketFunction* funcs = get_pkt_funcs(pkt, conn);
     if (!funcs)
@@ -130,6 +143,13 @@ pkt_encoder get_pkt_encoder(const Packet* pkt, Connection* conn) {
     return funcs->encoder;
 }
 
+const char* get_pkt_type_name(enum State state, enum PacketType type, bool clientbound) {
+    PacketFunction* funcs = get_funcs(state, type);
+    if (!funcs)
+        return NULL;
+    return clientbound ? funcs->clientbound_name : funcs->serverbound_name;
+}
+
 const char* get_pkt_name(const Packet* pkt, const Connection* conn, bool clientbound) {
     PacketFunction* funcs = get_pkt_funcs(pkt, conn);
     if (!funcs)
@@ -144,8 +164,9 @@ bool conn_is_resuming_read(const Connection* conn) {
 Connection
 conn_create(socketfd sockfd, i64 table_index, EncryptionContext* enc_ctx, string addr, u32 port) {
     Connection conn = {
-        .persistent_arena = arena_create(CONN_PARENA_SIZE, BLK_TAG_NETWORK),
-        .scratch_arena = arena_create(CONN_SARENA_SIZE, BLK_TAG_NETWORK),
+        .persistent_arena = arena_create_reserved(CONN_PARENA_SIZE, BLK_TAG_NETWORK, FALSE),
+        .scratch_arena = arena_create_reserved(CONN_SARENA_SIZE, BLK_TAG_NETWORK, FALSE),
+        .dynamic_arena = dynarena_create(BLK_TAG_NETWORK),
         .compression = FALSE,
         .encryption = FALSE,
         .state = STATE_HANDSHAKE,
@@ -156,6 +177,7 @@ conn_create(socketfd sockfd, i64 table_index, EncryptionContext* enc_ctx, string
         .recv_buffer = bytebuf_create_fixed(CONN_BYTEBUF_SIZE, &conn.persistent_arena),
         .send_buffer = bytebuf_create_fixed(CONN_BYTEBUF_SIZE, &conn.persistent_arena),
         .packet_cache = NULL,
+        .pending_message_id = -1,
         .table_index = table_index,
         .peer_addr = str_create_copy(&addr, &conn.persistent_arena),
         .peer_port = port,
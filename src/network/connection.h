@@ -17,10 +17,17 @@
 
 #include "containers/bytebuffer.h"
 #include "memory/arena.h"
+#include "memory/dyn_arena.h"
 #include "utils/string.h"
 
 #include "platform/mc_mutex.h"
 
+/**
+ * Messages logged per second, at most, by each log statement repeated for every connection or
+ * packet. Keeps logging from becoming the bottleneck during connection storms.
+ */
+#define CONNECTION_LOGS_PER_WINDOW 10
+
 /**
  * Enumeration of connection states.
  *
@@ -55,6 +62,11 @@ typedef struct Connection {
     Arena persistent_arena;
     /** Arena used to allocate temporary data, e.g. for sending / receiving packets. */
     Arena scratch_arena;
+    /**
+     * Arena used to allocate temporary data whose size is not bounded by the protocol,
+     * e.g. JSON documents. Restored once the data is not needed anymore.
+     */
+    DynamicArena dynamic_arena;
 
     bool compression; /**< Whether packet compression is enabled. */
     bool encryption;  /**< Whether packet encryption is enabled. */
@@ -75,9 +87,13 @@ typedef struct Connection {
     /** Encoded packet sending queue */
     ByteBuffer send_buffer;
     Packet* packet_cache;
+    /** Position of the scratch arena before the packet being received was allocated. */
+    ArenaSave packet_save;
 
     u64 verify_token_size;
     u8* verify_token;
+    /** Identifier of the login plugin request waiting for a response, or -1 if there is none. */
+    i32 pending_message_id;
 
     /** Index of the connection in the connection table */
     i64 table_index;
@@ -1,3 +1,5 @@
+#define LOG_SUBSYSTEM LOG_SUBSYSTEM_NETWORK
+
 #include "decoders.h"
 #include "containers/bytebuffer.h"
 #include "memory/arena.h"
@@ -63,3 +65,19 @@ PKT_DECODER(enc_res) {
 
     packet->payload = payload;
 }
+
+PKT_DECODER(log_custom_res) {
+    PacketLoginCustomRes* payload = arena_allocate(arena, sizeof *payload, ALLOC_TAG_PACKET);
+
+    i64 header_size = bytebuf_read_varint(bytes, &payload->message_id);
+    header_size += bytebuf_read(bytes, sizeof(bool), &payload->understood);
+    if (header_size <= 0 || (u64) header_size > packet->payload_length)
+        return;
+
+    // The data fills the rest of the packet.
+    payload->data_length = packet->payload_length - header_size;
+    payload->data = arena_allocate(arena, payload->data_length, ALLOC_TAG_UNKNOWN);
+    bytebuf_read(bytes, payload->data_length, payload->data);
+
+    packet->payload = payload;
+}
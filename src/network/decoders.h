@@ -39,5 +39,6 @@ PKT_DECODER(ping);
 
 PKT_DECODER(log_start);
 PKT_DECODER(enc_res);
+PKT_DECODER(log_custom_res);
 
 #endif /* ! DECODERS_H */
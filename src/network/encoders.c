@@ -1,3 +1,5 @@
+#define LOG_SUBSYSTEM LOG_SUBSYSTEM_NETWORK
+
 #include "encoders.h"
 #include "containers/bytebuffer.h"
 #include "containers/vector.h"
@@ -25,6 +27,11 @@ PKT_ENCODER(ping) {
     bytebuf_write_i64(buffer, pong->num);
 }
 
+PKT_ENCODER(log_disconnect) {
+    PacketLoginDisconnect* payload = pkt->payload;
+    encode_string(&payload->reason, buffer);
+}
+
 PKT_ENCODER(enc_req) {
     PacketEncReq* payload = pkt->payload;
 
@@ -59,3 +66,11 @@ PKT_ENCODER(log_success) {
 
     bytebuf_write(buffer, &payload->strict_errors, sizeof(bool));
 }
+
+PKT_ENCODER(log_custom_req) {
+    PacketLoginCustomReq* payload = pkt->payload;
+
+    bytebuf_write_varint(buffer, payload->message_id);
+    encode_string(&payload->channel, buffer);
+    bytebuf_write(buffer, payload->data, payload->data_length);
+}
@@ -37,8 +37,10 @@ PKT_ENCODER(dummy);
 PKT_ENCODER(status);
 PKT_ENCODER(ping);
 
+PKT_ENCODER(log_disconnect);
 PKT_ENCODER(enc_req);
 PKT_ENCODER(compress);
 PKT_ENCODER(log_success);
+PKT_ENCODER(log_custom_req);
 
 #endif /* ! ENCODERS_H */
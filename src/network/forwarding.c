@@ -0,0 +1,178 @@
+#define LOG_SUBSYSTEM LOG_SUBSYSTEM_NETWORK
+
+#include "forwarding.h"
+#include "packet.h"
+
+#include "containers/bytebuffer.h"
+#include "logger.h"
+#include "memory/mem_tags.h"
+#include "utils/bitwise.h"
+
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <string.h>
+
+/**
+ * Bounds-checked cursor over the forwarded data.
+ */
+typedef struct Reader {
+    const u8* data;
+    u64 size;
+    u64 position;
+} Reader;
+
+static bool read_varint(Reader* reader, i32* out) {
+    u32 res = 0;
+    for (u32 shift = 0; shift < 35; shift += 7) {
+        if (reader->position >= reader->size)
+            return FALSE;
+        u8 byte = reader->data[reader->position++];
+        res |= (u32) (byte & SEGMENT_BITS) << shift;
+        if ((byte & CONTINUE_BIT) == 0) {
+            *out = (i32) res;
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+static bool read_bytes(Reader* reader, u64 size, void* out) {
+    if (size > reader->size - reader->position)
+        return FALSE;
+    memcpy(out, reader->data + reader->position, size);
+    reader->position += size;
+    return TRUE;
+}
+
+static bool read_string(Reader* reader, Arena* arena, string* out) {
+    i32 length;
+    if (!read_varint(reader, &length) || length < 0)
+        return FALSE;
+    if ((u64) length > reader->size - reader->position)
+        return FALSE;
+    *out = str_create_from_buffer((const char*) reader->data + reader->position, length, arena);
+    reader->position += length;
+    return TRUE;
+}
+
+static bool sign(const string* secret, const u8* data, u64 size, u8* out_signature) {
+    u32 signature_size = 0;
+    u8* res = HMAC(EVP_sha256(),
+                   secret->base,
+                   (i32) secret->length,
+                   data,
+                   size,
+                   out_signature,
+                   &signature_size);
+    return res && signature_size == FORWARDING_SIGNATURE_SIZE;
+}
+
+bool forwarding_read_player(
+    const string* secret, Arena* arena, const u8* data, u64 size, ForwardedPlayer* out) {
+    if (size < FORWARDING_SIGNATURE_SIZE) {
+        log_error("Forwarded player information is too short to be signed.");
+        return FALSE;
+    }
+
+    u8 signature[EVP_MAX_MD_SIZE];
+    if (!sign(secret,
+              data + FORWARDING_SIGNATURE_SIZE,
+              size - FORWARDING_SIGNATURE_SIZE,
+              signature))
+        return FALSE;
+
+    if (CRYPTO_memcmp(signature, data, FORWARDING_SIGNATURE_SIZE) != 0) {
+        log_error("Forwarded player information has an invalid signature.");
+        return FALSE;
+    }
+
+    Reader reader = {
+        .data = data,
+        .size = size,
+        .position = FORWARDING_SIGNATURE_SIZE,
+    };
+
+    i32 version;
+    if (!read_varint(&reader, &version))
+        return FALSE;
+    if (version != FORWARDING_VERSION) {
+        log_errorf("Unsupported forwarding version %i.", version);
+        return FALSE;
+    }
+
+    if (!read_string(&reader, arena, &out->address))
+        return FALSE;
+    if (!read_bytes(&reader, sizeof out->uuid, out->uuid))
+        return FALSE;
+    if (!read_string(&reader, arena, &out->name))
+        return FALSE;
+
+    i32 property_count;
+    if (!read_varint(&reader, &property_count) || property_count < 0)
+        return FALSE;
+
+    vect_init(&out->properties, arena, property_count, sizeof(PlayerProperty));
+    for (i32 i = 0; i < property_count; i++) {
+        PlayerProperty* property = vect_reserve(&out->properties);
+        if (!read_string(&reader, arena, &property->name))
+            return FALSE;
+        if (!read_string(&reader, arena, &property->value))
+            return FALSE;
+        if (!read_bytes(&reader, sizeof(bool), &property->is_signed))
+            return FALSE;
+        if (property->is_signed && !read_string(&reader, arena, &property->signature))
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+static u64 string_size(const string* str) {
+    return VARINT_MAX_SIZE + str->length;
+}
+
+static void write_string(ByteBuffer* buffer, const string* str) {
+    bytebuf_write_varint(buffer, str->length);
+    bytebuf_write(buffer, str->base, str->length);
+}
+
+u8* forwarding_write_player(const string* secret,
+                            Arena* arena,
+                            const ForwardedPlayer* player,
+                            u64* out_size) {
+    u64 capacity = FORWARDING_SIGNATURE_SIZE + VARINT_MAX_SIZE + string_size(&player->address) +
+                   sizeof player->uuid + string_size(&player->name) + VARINT_MAX_SIZE;
+    for (u64 i = 0; i < player->properties.size; i++) {
+        PlayerProperty* property = vect_ref(&player->properties, i);
+        capacity += string_size(&property->name) + string_size(&property->value) + sizeof(bool) +
+                    string_size(&property->signature);
+    }
+
+    // The buffer is new, so its content is contiguous.
+    ByteBuffer buffer = bytebuf_create_fixed(capacity, arena);
+    u8 signature[EVP_MAX_MD_SIZE] = {0};
+    bytebuf_write(&buffer, signature, FORWARDING_SIGNATURE_SIZE);
+    bytebuf_write_varint(&buffer, FORWARDING_VERSION);
+    write_string(&buffer, &player->address);
+    bytebuf_write(&buffer, player->uuid, sizeof player->uuid);
+    write_string(&buffer, &player->name);
+    bytebuf_write_varint(&buffer, player->properties.size);
+    for (u64 i = 0; i < player->properties.size; i++) {
+        PlayerProperty* property = vect_ref(&player->properties, i);
+        write_string(&buffer, &property->name);
+        write_string(&buffer, &property->value);
+        bytebuf_write(&buffer, &property->is_signed, sizeof(bool));
+        if (property->is_signed)
+            write_string(&buffer, &property->signature);
+    }
+
+    u8* data = buffer.buf;
+    u64 size = bytebuf_size(&buffer);
+    if (!sign(secret, data + FORWARDING_SIGNATURE_SIZE, size - FORWARDING_SIGNATURE_SIZE, signature))
+        return NULL;
+    memcpy(data, signature, FORWARDING_SIGNATURE_SIZE);
+
+    *out_size = size;
+    return data;
+}
@@ -0,0 +1,82 @@
+/**
+ * @file forwarding.h
+ * @author Bastien Morino
+ * @ingroup networking
+ *
+ * Player information forwarding from a proxy, compatible with Velocity's "modern" forwarding.
+ *
+ * When the server runs behind a proxy, the proxy authenticates players and encrypts
+ * the connection with clients. Backend servers receive the real address, UUID, name and
+ * properties of players through a login plugin request on the @ref FORWARDING_CHANNEL channel.
+ * The forwarded data is signed with an HMAC-SHA256 using a secret shared between the proxy
+ * and its backends.
+ *
+ * Forwarded data has the following layout:
+ * - the 32-byte signature of the rest of the data,
+ * - the forwarding version, as a VarInt,
+ * - the address of the player, as a string,
+ * - the UUID of the player (16 bytes),
+ * - the name of the player, as a string,
+ * - the properties of the player, as in the @ref PacketLoginSuccess "login success" packet.
+ *
+ * @addtogroup networking
+ * @{
+ */
+
+#ifndef FORWARDING_H
+#define FORWARDING_H
+
+#include "definitions.h"
+
+#include "containers/vector.h"
+#include "memory/arena.h"
+#include "utils/string.h"
+
+/** Identifier of the plugin channel used to query forwarded player information. */
+#define FORWARDING_CHANNEL "velocity:player_info"
+/** The forwarding version requested by the server. Version 1 does not include chat keys. */
+#define FORWARDING_VERSION 1
+/** Size (in bytes) of the signature at the beginning of forwarded data. */
+#define FORWARDING_SIGNATURE_SIZE 32
+
+/**
+ * Player information forwarded by a proxy.
+ */
+typedef struct ForwardedPlayer {
+    string address; /**< Address of the player, as seen by the proxy. */
+    u64 uuid[2];    /**< UUID of the player, as given by Mojang's authentication server. */
+    string name;    /**< Name of the player. */
+    Vector properties; /**< Vector of @ref PlayerProperty. */
+} ForwardedPlayer;
+
+/**
+ * Verifies the signature of forwarded player information, and decodes it.
+ *
+ * @param[in] secret The secret shared with the proxy.
+ * @param arena The arena used to allocate the decoded strings and properties.
+ * @param[in] data The forwarded data, beginning with its signature.
+ * @param size The size of the forwarded data.
+ * @param[out] out The decoded player information.
+ * @return @ref TRUE if the signature is valid and the data was decoded successfully,
+ * @ref FALSE otherwise.
+ */
+bool forwarding_read_player(
+    const string* secret, Arena* arena, const u8* data, u64 size, ForwardedPlayer* out);
+
+/**
+ * Encodes and signs player information, as a proxy would do.
+ *
+ * @param[in] secret The secret shared with the backend servers.
+ * @param arena The arena used to allocate the encoded data.
+ * @param[in] player The player information to forward.
+ * @param[out] out_size The size of the encoded data.
+ * @return A pointer to the signed data, allocated using the given arena.
+ */
+u8* forwarding_write_player(const string* secret,
+                            Arena* arena,
+                            const ForwardedPlayer* player,
+                            u64* out_size);
+
+#endif /* ! FORWARDING_H */
+
+/** @} */
@@ -1,6 +1,9 @@
+#define LOG_SUBSYSTEM LOG_SUBSYSTEM_NETWORK
+
 #include "handlers.h"
 #include "compression.h"
 #include "connection.h"
+#include "forwarding.h"
 #include "network.h"
 #include "packet.h"
 #include "packet_codec.h"
@@ -12,8 +15,10 @@
 #include "logger.h"
 #include "memory/arena.h"
 #include "memory/mem_tags.h"
+#include "platform/network.h"
 #include "utils/string.h"
 
+#include <stdio.h>
 #include <string.h>
 #include <zlib.h>
 
@@ -48,8 +53,9 @@ PKT_HANDLER(status) {
     PacketStatusResponse response;
 
     JSON json;
-    Arena arena = conn->scratch_arena;
-    json_create(&json, &arena);
+    DynamicArena* arena = &conn->dynamic_arena;
+    DynamicArenaSave save = dynarena_save(arena);
+    json_create(&json, arena);
     json_set_root(&json, json_node_create(&json, JSON_OBJECT));
 
     JSONNode* nodes[4];
@@ -87,11 +93,12 @@ PKT_HANDLER(status) {
     nodes[0] = json_node_put(&json, json.root, "previewsChat", JSON_BOOL);
     json_set_bool(nodes[0], FALSE);
 
-    json_stringify(&json, &response.data, &arena);
+    json_stringify(&json, &response.data, arena);
     log_tracef("%s", response.data.base);
     Packet out_pkt = {.id = PKT_STATUS, .payload = &response};
     send_packet(ctx, &out_pkt, conn);
     json_destroy(&json);
+    dynarena_restore(arena, save);
     return TRUE;
 }
 
@@ -104,6 +111,101 @@ PKT_HANDLER(ping) {
     return TRUE;
 }
 
+static bool enable_compression(NetworkContext* ctx, Connection* conn) {
+
+    PacketSetCompress payload = {
+        .threshold = COMPRESS_THRESHOLD,
+    };
+
+    Packet cmprss_pkt = {
+        .id = PKT_LOGIN_COMPRESS,
+        .payload = &payload,
+    };
+
+    send_packet(ctx, &cmprss_pkt, conn);
+
+    if (!compression_init(&conn->cmprss_ctx, &conn->persistent_arena))
+        return FALSE;
+
+    conn->compression = TRUE;
+    log_infof("Protocol compression successfully initialized for connection %i.",
+              conn->peer_socket);
+    return TRUE;
+}
+
+static bool send_login_success(NetworkContext* ctx,
+                               Connection* conn,
+                               PacketLoginSuccess* login_success) {
+    if (!enable_compression(ctx, conn))
+        return FALSE;
+
+    Packet pkt = {
+        .id = PKT_LOGIN_SUCCESS,
+        .payload = login_success,
+    };
+
+    send_packet(ctx, &pkt, conn);
+
+    return TRUE;
+}
+
+/**
+ * Logs the player in without encryption nor authentication, with a UUID derived from
+ * their name the same way vanilla offline servers do.
+ */
+static bool login_offline(NetworkContext* ctx, Connection* conn) {
+    PacketLoginSuccess login_success = {
+        .username = conn->player_name,
+        .strict_errors = TRUE,
+    };
+    if (!encryption_offline_uuid(&conn->player_name, login_success.uuid))
+        return FALSE;
+    vect_init(&login_success.properties, &conn->scratch_arena, 0, sizeof(PlayerProperty));
+
+    return send_login_success(ctx, conn, &login_success);
+}
+
+/**
+ * Asks the proxy for the real information of the player.
+ * The response is handled by @ref pkt_handle_log_custom_res.
+ */
+static bool request_forwarded_player(NetworkContext* ctx, Connection* conn) {
+    u8 version = FORWARDING_VERSION;
+    conn->pending_message_id = (i32) (ctx->next_message_id++ & INT32_MAX);
+    PacketLoginCustomReq req = {
+        .message_id = conn->pending_message_id,
+        .channel = str_create_view(FORWARDING_CHANNEL),
+        .data_length = sizeof version,
+        .data = &version,
+    };
+
+    Packet pkt = {
+        .id = PKT_LOGIN_CUSTOM_REQUEST,
+        .payload = &req,
+    };
+
+    send_packet(ctx, &pkt, conn);
+    return TRUE;
+}
+
+/**
+ * Sends the reason why a player cannot log in. The connection is closed by the caller.
+ */
+static void disconnect_login(NetworkContext* ctx, Connection* conn, const char* reason) {
+    char text[256];
+    snprintf(text, sizeof text, "{\"text\":\"%s\"}", reason);
+    PacketLoginDisconnect payload = {
+        .reason = str_create_view(text),
+    };
+    Packet pkt = {
+        .id = PKT_LOGIN_DISCONNECT,
+        .payload = &payload,
+    };
+    send_packet(ctx, &pkt, conn);
+    // The packet may have been queued, but the connection is closed right after this.
+    empty_buffer(ctx, conn);
+}
+
 PKT_HANDLER(log_start) {
     PacketLoginStart* payload = pkt->payload;
 
@@ -112,6 +214,26 @@ PKT_HANDLER(log_start) {
     log_infof("Player '%s' is attempting to connect.", payload->player_name.base);
     log_infof("Has UUID: %016x-%016x.", payload->uuid[0], payload->uuid[1]);
 
+    if (ctx->forwarding_secret.length > 0)
+        return request_forwarded_player(ctx, conn);
+    if (ctx->offline)
+        return login_offline(ctx, conn);
+
+    // Waiting for the key pair would stall every other connection of the network thread.
+    switch (encryption_key_state(conn->global_enc_ctx)) {
+    case KEY_PENDING:
+        log_limited(LOG_LEVEL_WARN,
+                    CONNECTION_LOGS_PER_WINDOW,
+                    "Refusing a login: the server's RSA key pair is still being generated.");
+        disconnect_login(ctx, conn, "The server is starting, please try again in a moment.");
+        return FALSE;
+    case KEY_FAILED:
+        log_error("Cannot log the player in: the server's RSA key pair is unavailable.");
+        return FALSE;
+    case KEY_READY:
+        break;
+    }
+
     PacketEncReq* req = arena_callocate(&conn->scratch_arena, sizeof *req, ALLOC_TAG_PACKET);
     *req = (PacketEncReq){
         .server_id = str_create_view(""),
@@ -136,42 +258,18 @@ PKT_HANDLER(log_start) {
     return TRUE;
 }
 
-static bool enable_compression(NetworkContext* ctx, Connection* conn) {
-
-    PacketSetCompress payload = {
-        .threshold = COMPRESS_THRESHOLD,
-    };
-
-    Packet cmprss_pkt = {
-        .id = PKT_LOGIN_COMPRESS,
-        .payload = &payload,
-    };
-
-    send_packet(ctx, &cmprss_pkt, conn);
-
-    if (!compression_init(&conn->cmprss_ctx, &conn->persistent_arena))
-        return FALSE;
-
-    conn->compression = TRUE;
-    log_infof("Protocol compression successfully initialized for connection %i.",
-              conn->peer_socket);
-    return TRUE;
-}
-
-static bool send_login_success(NetworkContext* ctx, Connection* conn, JSON* json) {
+static bool parse_login_success(Connection* conn, JSON* json, PacketLoginSuccess* out) {
     JSONNode* json_id = json_get_obj_cstr(json->root, "id");
     JSONNode* json_name = json_get_obj_cstr(json->root, "name");
     JSONNode* json_properties = json_get_obj_cstr(json->root, "properties");
 
-#ifdef DEBUG
-
-    string str;
-    json_stringify(json, &str, &conn->scratch_arena);
+    if (log_enabled(LOG_LEVEL_TRACE)) {
+        string str;
+        json_stringify(json, &str, &conn->dynamic_arena);
 
-    log_trace("Login success response: ");
-    log_trace(str.base);
-
-#endif
+        log_trace("Login success response: ");
+        log_trace(str.base);
+    }
 
     if (!json_id)
         return FALSE;
@@ -184,34 +282,34 @@ static bool send_login_success(NetworkContext* ctx, Connection* conn, JSON* json
     if (!name)
         return FALSE;
 
-    PacketLoginSuccess login_success = {
-        .username = str_create_copy(name, &conn->scratch_arena),
+    *out = (PacketLoginSuccess){
+        .username = *name,
         .strict_errors = TRUE,
     };
     string* uuid = json_get_str(json_id);
-    if (!parse_uuid(uuid, login_success.uuid))
+    if (!parse_uuid(uuid, out->uuid))
         return FALSE;
 
     i64 property_count = json_get_length(json_properties);
     if (property_count == -1)
         return FALSE;
 
-    vect_init(
-        &login_success.properties, &conn->scratch_arena, property_count, sizeof(PlayerProperty));
+    vect_init_dynarena(
+        &out->properties, &conn->dynamic_arena, property_count, sizeof(PlayerProperty));
 
     for (i64 i = 0; i < property_count; i++) {
-        PlayerProperty* property = vect_reserve(&login_success.properties);
+        PlayerProperty* property = vect_reserve(&out->properties);
         JSONNode* json_property = json_get_array(json_properties, i);
         if (!json_property)
             return FALSE;
 
         JSONNode* json_prop_name = json_get_obj_cstr(json_property, "name");
         string* prop_name = json_get_str(json_prop_name);
-        property->name = str_create_copy(prop_name, &conn->scratch_arena);
+        property->name = *prop_name;
 
         JSONNode* json_prop_value = json_get_obj_cstr(json_property, "value");
         string* prop_value = json_get_str(json_prop_value);
-        property->value = str_create_copy(prop_value, &conn->scratch_arena);
+        property->value = *prop_value;
 
         JSONNode* json_prop_sig = json_get_obj_cstr(json_property, "signature");
         if (json_prop_sig) {
@@ -222,19 +320,21 @@ static bool send_login_success(NetworkContext* ctx, Connection* conn, JSON* json
             property->is_signed = FALSE;
     }
 
-    Packet pkt = {
-        .id = PKT_LOGIN_SUCCESS,
-        .payload = &login_success,
-    };
-
-    send_packet(ctx, &pkt, conn);
-
     return TRUE;
 }
 
 PKT_HANDLER(enc_res) {
     PacketEncRes* payload = pkt->payload;
 
+    // Only answer an encryption request we sent, which implies the key pair is ready.
+    if (ctx->offline || !conn->verify_token ||
+        encryption_key_state(conn->global_enc_ctx) != KEY_READY) {
+        log_limited(LOG_LEVEL_ERROR,
+                    CONNECTION_LOGS_PER_WINDOW,
+                    "Received an unexpected encryption response.");
+        return FALSE;
+    }
+
     u64 ss_size;
     u8* decrypted_ss = encryption_decrypt(conn->global_enc_ctx,
                                           &conn->scratch_arena,
@@ -267,6 +367,7 @@ PKT_HANDLER(enc_res) {
     }
 
     arena_free_ptr(&conn->persistent_arena, conn->verify_token);
+    conn->verify_token = NULL;
     if (!encryption_init_peer(&conn->peer_enc_ctx, &conn->persistent_arena, decrypted_ss))
         return FALSE;
 
@@ -274,18 +375,65 @@ PKT_HANDLER(enc_res) {
 
     log_infof("Protocol encryption successfully initialized for connection %i.", conn->peer_socket);
 
+    // The profile sent back is built from the strings of the session server's response.
+    DynamicArenaSave save = dynarena_save(&conn->dynamic_arena);
     JSON json;
     bool res = encryption_authenticate_player(conn, &json);
-    if (!res)
-        return FALSE;
-
-    res = enable_compression(ctx, conn);
-    if (!res)
+    if (!res) {
+        dynarena_restore(&conn->dynamic_arena, save);
         return FALSE;
+    }
 
-    res = send_login_success(ctx, conn, &json);
+    PacketLoginSuccess login_success;
+    res = parse_login_success(conn, &json, &login_success);
+    if (res)
+        res = send_login_success(ctx, conn, &login_success);
 
     json_destroy(&json);
+    dynarena_restore(&conn->dynamic_arena, save);
 
     return res;
 }
+
+PKT_HANDLER(log_custom_res) {
+    PacketLoginCustomRes* payload = pkt->payload;
+    if (!payload)
+        return FALSE;
+
+    // Only the response to the request sent by request_forwarded_player is accepted, once.
+    if (ctx->forwarding_secret.length == 0 || conn->pending_message_id < 0 ||
+        payload->message_id != conn->pending_message_id) {
+        log_errorf("Received an unexpected login plugin response (message ID %i).",
+                   payload->message_id);
+        return FALSE;
+    }
+    conn->pending_message_id = -1;
+
+    if (!payload->understood) {
+        log_error("The peer did not forward player information. Is it connected through a proxy?");
+        return FALSE;
+    }
+
+    ForwardedPlayer player;
+    if (!forwarding_read_player(&ctx->forwarding_secret,
+                                &conn->scratch_arena,
+                                payload->data,
+                                payload->data_length,
+                                &player))
+        return FALSE;
+
+    conn->peer_addr = str_create_copy(&player.address, &conn->persistent_arena);
+    conn->player_name = str_create_copy(&player.name, &conn->persistent_arena);
+    log_infof("Player '%s' connected through a proxy from [%s].",
+              conn->player_name.base,
+              conn->peer_addr.base);
+
+    PacketLoginSuccess login_success = {
+        .username = conn->player_name,
+        .properties = player.properties,
+        .strict_errors = TRUE,
+    };
+    memcpy(login_success.uuid, player.uuid, sizeof login_success.uuid);
+
+    return send_login_success(ctx, conn, &login_success);
+}
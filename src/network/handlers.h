@@ -41,5 +41,6 @@ PKT_HANDLER(ping);
 
 PKT_HANDLER(log_start);
 PKT_HANDLER(enc_res);
+PKT_HANDLER(log_custom_res);
 
 #endif /* ! HANDLER_H */
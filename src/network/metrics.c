@@ -0,0 +1,177 @@
+#define LOG_SUBSYSTEM LOG_SUBSYSTEM_NETWORK
+
+#include "metrics.h"
+#include "packet_codec.h"
+
+#include "logger.h"
+#include "utils/bitwise.h"
+
+#include <stdlib.h>
+
+/** Maximum number of threads recording metrics. Other threads do not record anything. */
+#define METRICS_MAX_THREADS 32
+
+static _Atomic(NetworkMetrics*) slots[METRICS_MAX_THREADS];
+static atomic_uint slot_count;
+static _Thread_local NetworkMetrics* local_slot;
+static _Thread_local bool local_slot_unavailable;
+
+static const char* direction_names[_PKT_DIR_COUNT] = {
+    [PKT_DIR_SERVERBOUND] = "IN",
+    [PKT_DIR_CLIENTBOUND] = "OUT",
+};
+
+static const char* latency_names[_PKT_DIR_COUNT][2] = {
+    [PKT_DIR_SERVERBOUND] = {"decode", "handle"},
+    [PKT_DIR_CLIENTBOUND] = {"compress", "encrypt"},
+};
+
+static NetworkMetrics* get_local_slot(void) {
+    if (local_slot || local_slot_unavailable)
+        return local_slot;
+
+    u32 index = atomic_fetch_add(&slot_count, 1);
+    if (index >= METRICS_MAX_THREADS) {
+        log_warn("Too many threads are recording network metrics, ignoring this one.");
+        local_slot_unavailable = TRUE;
+        return NULL;
+    }
+
+    local_slot = calloc(1, sizeof *local_slot);
+    if (!local_slot) {
+        local_slot_unavailable = TRUE;
+        return NULL;
+    }
+    atomic_store_explicit(&slots[index], local_slot, memory_order_release);
+    return local_slot;
+}
+
+static PacketMetrics* get_packet_metrics(enum PacketDirection direction,
+                                         enum State state,
+                                         enum PacketType type) {
+    if (state < 0 || state >= _STATE_COUNT || type < 0 || type >= _PKT_TYPE_COUNT)
+        return NULL;
+
+    NetworkMetrics* slot = get_local_slot();
+    if (!slot)
+        return NULL;
+    return &slot->packets[direction][state][type];
+}
+
+static void add_relaxed(_Atomic u64* counter, u64 value) {
+    atomic_store_explicit(
+        counter, atomic_load_explicit(counter, memory_order_relaxed) + value, memory_order_relaxed);
+}
+
+static void record(PacketMetrics* metrics,
+                   u64 wire_bytes,
+                   u64 uncompressed_bytes,
+                   u64 first_latency,
+                   u64 second_latency) {
+    add_relaxed(&metrics->count, 1);
+    add_relaxed(&metrics->wire_bytes, wire_bytes);
+    add_relaxed(&metrics->uncompressed_bytes, uncompressed_bytes);
+    if (first_latency != METRICS_SKIPPED)
+        histogram_record(&metrics->latency[0], first_latency);
+    if (second_latency != METRICS_SKIPPED)
+        histogram_record(&metrics->latency[1], second_latency);
+}
+
+static u64 varint_size(u64 n) {
+    u64 size = 1;
+    while (n >= CONTINUE_BIT) {
+        n >>= 7;
+        size++;
+    }
+    return size;
+}
+
+void metrics_record_received(enum State state, const Packet* pkt, u64 decode_time, u64 handle_time) {
+    PacketMetrics* metrics = get_packet_metrics(PKT_DIR_SERVERBOUND, state, pkt->id);
+    if (!metrics)
+        return;
+
+    u64 wire_bytes = varint_size(pkt->total_length) + pkt->total_length;
+    u64 uncompressed_bytes = varint_size(pkt->id) + pkt->payload_length;
+    record(metrics, wire_bytes, uncompressed_bytes, decode_time, handle_time);
+}
+
+void metrics_record_sent(enum State state,
+                         enum PacketType type,
+                         u64 wire_bytes,
+                         u64 uncompressed_bytes,
+                         u64 compress_time,
+                         u64 encrypt_time) {
+    PacketMetrics* metrics = get_packet_metrics(PKT_DIR_CLIENTBOUND, state, type);
+    if (!metrics)
+        return;
+    record(metrics, wire_bytes, uncompressed_bytes, compress_time, encrypt_time);
+}
+
+void metrics_collect(NetworkMetrics* out) {
+    u32 count = atomic_load(&slot_count);
+    if (count > METRICS_MAX_THREADS)
+        count = METRICS_MAX_THREADS;
+
+    for (u32 i = 0; i < count; i++) {
+        NetworkMetrics* slot = atomic_load_explicit(&slots[i], memory_order_acquire);
+        if (!slot)
+            continue;
+
+        for (u32 dir = 0; dir < _PKT_DIR_COUNT; dir++) {
+            for (u32 state = 0; state < _STATE_COUNT; state++) {
+                for (u32 type = 0; type < _PKT_TYPE_COUNT; type++) {
+                    PacketMetrics* src = &slot->packets[dir][state][type];
+                    PacketMetrics* dst = &out->packets[dir][state][type];
+                    add_relaxed(&dst->count, atomic_load_explicit(&src->count, memory_order_relaxed));
+                    add_relaxed(&dst->wire_bytes,
+                                atomic_load_explicit(&src->wire_bytes, memory_order_relaxed));
+                    add_relaxed(&dst->uncompressed_bytes,
+                                atomic_load_explicit(&src->uncompressed_bytes, memory_order_relaxed));
+                    histogram_merge(&dst->latency[0], &src->latency[0]);
+                    histogram_merge(&dst->latency[1], &src->latency[1]);
+                }
+            }
+        }
+    }
+}
+
+static void dump_latency(const char* name, const Histogram* histogram) {
+    if (histogram->count == 0)
+        return;
+    log_infof("      %-8s p50 %8.2fus | p99 %8.2fus | max %8.2fus",
+              name,
+              histogram_percentile(histogram, 50) / 1e3,
+              histogram_percentile(histogram, 99) / 1e3,
+              histogram->max / 1e3);
+}
+
+void metrics_dump(void) {
+    NetworkMetrics* metrics = calloc(1, sizeof *metrics);
+    if (!metrics)
+        return;
+    metrics_collect(metrics);
+
+    log_info("=== Network metrics ===");
+    for (u32 dir = 0; dir < _PKT_DIR_COUNT; dir++) {
+        for (u32 state = 0; state < _STATE_COUNT; state++) {
+            for (u32 type = 0; type < _PKT_TYPE_COUNT; type++) {
+                PacketMetrics* packet = &metrics->packets[dir][state][type];
+                if (packet->count == 0)
+                    continue;
+
+                const char* name = get_pkt_type_name(state, type, dir == PKT_DIR_CLIENTBOUND);
+                log_infof("  %-3s %-24s count %8zu | wire %10zu B | uncompressed %10zu B",
+                          direction_names[dir],
+                          name ? name : "?",
+                          packet->count,
+                          packet->wire_bytes,
+                          packet->uncompressed_bytes);
+                dump_latency(latency_names[dir][0], &packet->latency[0]);
+                dump_latency(latency_names[dir][1], &packet->latency[1]);
+            }
+        }
+    }
+
+    free(metrics);
+}
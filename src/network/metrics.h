@@ -0,0 +1,108 @@
+/**
+ * @file metrics.h
+ * @author Bastien Morino
+ * @ingroup networking
+ *
+ * Per-packet-type metrics of the network sub-system.
+ *
+ * For each combination of connection state, packet type and direction, the number of packets,
+ * the bytes sent over the wire and the uncompressed bytes are counted.
+ * Latency histograms are kept for decoding and handling received packets,
+ * and for compressing and encrypting sent packets.
+ *
+ * Each thread records metrics in its own slot, without locks nor atomic read-modify-write
+ * operations. Slots are merged when metrics are read.
+ *
+ * @addtogroup networking
+ * @{
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include "definitions.h"
+
+#include "network/connection.h"
+#include "network/packet.h"
+#include "utils/histogram.h"
+
+/** Latency of a step which did not run, and is not recorded. */
+#define METRICS_SKIPPED ((u64) -1)
+
+/**
+ * Direction of packets.
+ */
+enum PacketDirection {
+    PKT_DIR_SERVERBOUND, /**< Packets received by the server. */
+    PKT_DIR_CLIENTBOUND, /**< Packets sent by the server. */
+    _PKT_DIR_COUNT
+};
+
+/**
+ * Metrics of a single packet type.
+ */
+typedef struct PacketMetrics {
+    _Atomic u64 count;              /**< Number of packets. */
+    _Atomic u64 wire_bytes;         /**< Bytes sent over the wire, including the packet length. */
+    _Atomic u64 uncompressed_bytes; /**< Bytes of the packet ID and payload, uncompressed. */
+    /**
+     * Latency histograms, in nanoseconds.
+     * - Server-bound packets: decoding, then handling.
+     * - Client-bound packets: compression, then encryption.
+     */
+    Histogram latency[2];
+} PacketMetrics;
+
+/**
+ * Metrics of all packet types.
+ */
+typedef struct NetworkMetrics {
+    PacketMetrics packets[_PKT_DIR_COUNT][_STATE_COUNT][_PKT_TYPE_COUNT];
+} NetworkMetrics;
+
+/**
+ * Records a packet received by the server.
+ *
+ * @param state The state of the connection when the packet was decoded.
+ * @param[in] pkt The decoded packet.
+ * @param decode_time The time spent decoding the packet, in nanoseconds.
+ * @param handle_time The time spent handling the packet, in nanoseconds.
+ */
+void metrics_record_received(enum State state, const Packet* pkt, u64 decode_time, u64 handle_time);
+
+/**
+ * Records a packet sent by the server.
+ *
+ * @param state The state of the connection when the packet was encoded.
+ * @param type The type of the packet.
+ * @param wire_bytes The size of the packet sent over the wire.
+ * @param uncompressed_bytes The size of the packet ID and payload, uncompressed.
+ * @param compress_time The time spent compressing the packet, in nanoseconds, or
+ * @ref METRICS_SKIPPED if it was not compressed.
+ * @param encrypt_time The time spent encrypting the packet, in nanoseconds, or
+ * @ref METRICS_SKIPPED if it was not encrypted.
+ */
+void metrics_record_sent(enum State state,
+                         enum PacketType type,
+                         u64 wire_bytes,
+                         u64 uncompressed_bytes,
+                         u64 compress_time,
+                         u64 encrypt_time);
+
+/**
+ * Merges the metrics of all threads.
+ *
+ * @param[out] out The merged metrics. It should be zero-initialized.
+ */
+void metrics_collect(NetworkMetrics* out);
+
+/**
+ * Logs the merged metrics of all packet types which were sent or received at least once.
+ *
+ * Called when the network sub-system stops, and on SIGUSR1.
+ */
+void metrics_dump(void);
+
+#endif /* ! METRICS_H */
+
+/** @} */
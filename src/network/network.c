@@ -5,11 +5,15 @@
  * Main loop of the network sub-system.
  */
 
+#define LOG_SUBSYSTEM LOG_SUBSYSTEM_NETWORK
+
 #include "network.h"
+#include "capture.h"
 #include "common_types.h"
 #include "connection.h"
 
 #include "logger.h"
+#include "metrics.h"
 
 #include "memory/mem_tags.h"
 #include "platform/mc_thread.h"
@@ -55,24 +59,35 @@ i32 create_server_socket(NetworkContext* ctx, char* host, i32 port) {
     return 0;
 }
 
-i32 network_init(char* host, i32 port, u64 max_connections) {
+i32 network_init(const NetworkConfig* config) {
 
     ctx.arena = arena_create(40960, BLK_TAG_NETWORK);
-    objpool_init(&ctx.connections, &ctx.arena, max_connections, sizeof(Connection));
-    ctx.host = str_create_view(host);
-    ctx.port = port;
+    objpool_init(&ctx.connections, &ctx.arena, config->max_connections, sizeof(Connection));
+    ctx.host = str_create_view(config->host);
+    ctx.port = config->port;
     ctx.code = 0;
+    ctx.forwarding_secret =
+        str_create_view(config->forwarding_secret ? config->forwarding_secret : "");
+    ctx.offline = config->offline || ctx.forwarding_secret.length > 0;
 
-    i32 res = network_platform_init(&ctx, max_connections);
+    i32 res = network_platform_init(&ctx, config->max_connections);
     if (res)
         return res;
 
-    res = create_server_socket(&ctx, host, port);
+    res = create_server_socket(&ctx, config->host, config->port);
     if (res)
         return res;
 
-    if (!encryption_init(&ctx.enc_ctx))
+    if (ctx.forwarding_secret.length > 0) {
+        log_info("Player information is forwarded by a proxy.");
+    } else if (ctx.offline) {
+        log_warn("The server is in offline mode: players will not be authenticated.");
+    } else if (!encryption_init(&ctx.enc_ctx, config->key_path, config->regenerate_key)) {
         return 3;
+    }
+
+    if (config->capture_path && !capture_start(config->capture_path))
+        return 4;
 
     ctx.should_continue = TRUE;
     log_debug("Network subsystem initialized.");
@@ -84,5 +99,7 @@ i32 network_init(char* host, i32 port, u64 max_connections) {
 void network_stop(void) {
     platform_network_stop();
     mcthread_join(&ctx.thread, NULL);
+    capture_stop();
+    metrics_dump();
     log_debug("Network thread exited.");
 }
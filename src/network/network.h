@@ -15,16 +15,44 @@
 #include "definitions.h"
 
 /**
- * Initializes the network sub-system and sets the server's host, port and
- * maximum amount of simultaneous connections.
+ * Settings used to initialize the network sub-system.
+ */
+typedef struct NetworkConfig {
+    /** The host IPv4 address to use. */
+    char* host;
+    /** The TCP port the server will listen to. */
+    i32 port;
+    /** The maximum amount of simultaneous connections to the server. */
+    u64 max_connections;
+    /** Path of the file caching the server's RSA key pair, or `NULL` to never cache it. */
+    const char* key_path;
+    /** Whether to generate a new RSA key pair even if a valid one is cached. */
+    bool regenerate_key;
+    /**
+     * Whether to skip encryption and authentication during login.
+     * Only use this behind a trusted proxy or for testing purposes.
+     */
+    bool offline;
+    /**
+     * Secret shared with the proxy forwarding player information, or `NULL` if the server
+     * is not behind a proxy. Implies that players are not authenticated by this server.
+     */
+    const char* forwarding_secret;
+    /** Path of the file to capture inbound traffic into, or `NULL` to disable the capture. */
+    const char* capture_path;
+} NetworkConfig;
+
+/**
+ * Initializes the network sub-system using the given configuration.
+ *
+ * The server socket is ready to accept connections when this function returns,
+ * even if the RSA key pair is still being generated.
  *
- * @param[in] host The host IPv4 address to use.
- * @param[in] port The TCP port the server will listen to.
- * @param[in] max_connections The maximum amount of simultaneous connections to the server.
+ * @param[in] config The settings of the network sub-system.
  *
  * @return Zero if the sub-system was initialized correctly, else a non-zero error code.
  */
-i32 network_init(char* host, i32 port, u64 max_connections);
+i32 network_init(const NetworkConfig* config);
 
 /**
  * Stops the network sub-system.
@@ -180,6 +180,13 @@ typedef struct {
     u64 uuid[2];
 } PacketLoginStart;
 
+/**
+ * Packet sent to refuse a player during the login sequence.
+ */
+typedef struct {
+    string reason; /**< JSON text component shown to the player. */
+} PacketLoginDisconnect;
+
 /**
  * Packet sent to enable encryption of packets.
  */
@@ -221,6 +228,29 @@ typedef struct {
     i64 threshold;
 } PacketSetCompress;
 
+/**
+ * Packet sent to query custom data from the client during login.
+ *
+ * Vanilla clients always answer that they did not understand the request.
+ * Proxies use this packet to forward player information to backend servers.
+ */
+typedef struct {
+    i32 message_id;  /**< Identifier of the request, echoed back in the response. */
+    string channel;  /**< Identifier of the plugin channel. */
+    u64 data_length; /**< Length of the channel-specific data. */
+    u8* data;        /**< Channel-specific data. */
+} PacketLoginCustomReq;
+
+/**
+ * Packet received in response to a @ref PacketLoginCustomReq "login plugin request".
+ */
+typedef struct {
+    i32 message_id;  /**< Identifier of the request this packet responds to. */
+    bool understood; /**< Whether the client understood the request. */
+    u64 data_length; /**< Length of the channel-specific data. */
+    u8* data;        /**< Channel-specific data. Only present if the request was understood. */
+} PacketLoginCustomRes;
+
 /**
  *
  */
@@ -91,6 +91,17 @@ pkt_encoder get_pkt_encoder(const Packet* pkt, Connection* conn);
  * for this packet - connection combination.
  */
 const char* get_pkt_name(const Packet* pkt, const Connection* conn, bool clientbound);
+/**
+ * Get the name of a packet type in the given connection state.
+ *
+ * @param state The state of the connection.
+ * @param type The type of the packet.
+ * @param[in] clientbound @ref TRUE if the client-bound name should be returned, @ref FALSE if the
+ *                        server-bound name should be taken.
+ * @return The name of the packet's type, or NULL if no name was registered
+ * for this state - packet type combination.
+ */
+const char* get_pkt_type_name(enum State state, enum PacketType type, bool clientbound);
 
 
 /**
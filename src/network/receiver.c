@@ -1,3 +1,5 @@
+#define LOG_SUBSYSTEM LOG_SUBSYSTEM_NETWORK
+
 #include "connection.h"
 #include "containers/bytebuffer.h"
 #include "logger.h"
@@ -5,8 +7,11 @@
 #include "memory/mem_tags.h"
 #include "network/common_types.h"
 #include "network/compression.h"
+#include "network/metrics.h"
 #include "packet.h"
 #include "packet_codec.h"
+#include "platform/platform.h"
+#include "trace.h"
 
 #include <stdio.h>
 
@@ -68,7 +73,7 @@ static enum IOCode decode_common_data(RecvContext* ctx, Packet* out_pkt) {
     i32 id;
     i64 id_size = bytebuf_read_varint(ctx->pkt_buffer, &id);
     if (id_size < 0) {
-        log_error("Received invalid packet id");
+        log_limited(LOG_LEVEL_ERROR, CONNECTION_LOGS_PER_WINDOW, "Received invalid packet id");
         return IOC_ERROR;
     }
 
@@ -94,7 +99,8 @@ static enum IOCode decode_packet(ByteBuffer* bytes, Connection* conn, Packet* ou
 
     pkt_decoder decoder = get_pkt_decoder(out_pkt, conn);
     if (!decoder) {
-        log_error("Received packet is not supported yet !");
+        log_limited(
+            LOG_LEVEL_ERROR, CONNECTION_LOGS_PER_WINDOW, "Received packet is not supported yet !");
         return IOC_ERROR;
     }
 
@@ -121,6 +127,7 @@ static bool handle_packet(NetworkContext* ctx, const Packet* pkt, Connection* co
 }
 
 enum IOCode receive_packet(NetworkContext* ctx, Connection* conn) {
+    TRACE_SCOPE("receive_packet");
 
     enum IOCode code = IOC_OK;
 
@@ -128,22 +135,30 @@ enum IOCode receive_packet(NetworkContext* ctx, Connection* conn) {
 
     while (code == IOC_OK) {
         if (!conn_is_resuming_read(conn)) {
-            arena_save(&conn->scratch_arena);
+            conn->packet_save = arena_save(&conn->scratch_arena);
             conn->packet_cache = arena_callocate(&conn->scratch_arena, sizeof *conn->packet_cache, ALLOC_TAG_PACKET);
             conn->packet_cache->id = PKT_INVALID;
         }
 
         log_trace("Trying to receive packet.");
+        u64 decode_start = get_monotonic_ns();
         code = decode_packet(&conn->recv_buffer, conn, conn->packet_cache);
         log_tracef("RESULT : %i", code);
         if (code != IOC_OK)
             return code;
 
+        // Handlers may switch the connection to another state.
+        enum State state = conn->state;
+        u64 handle_start = get_monotonic_ns();
         if (!handle_packet(ctx, conn->packet_cache, conn))
             return IOC_ERROR;
+        u64 handle_end = get_monotonic_ns();
+
+        metrics_record_received(
+            state, conn->packet_cache, handle_start - decode_start, handle_end - handle_start);
 
         conn->packet_cache = NULL;
-        arena_restore(&conn->scratch_arena);
+        arena_restore(&conn->scratch_arena, conn->packet_save);
     }
 
     return code;
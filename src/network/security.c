@@ -1,3 +1,5 @@
+#define LOG_SUBSYSTEM LOG_SUBSYSTEM_NETWORK
+
 #include "security.h"
 #include "data/json.h"
 #include "containers/bytebuffer.h"
@@ -5,6 +7,7 @@
 #include "memory/arena.h"
 #include "memory/mem_tags.h"
 #include "network/connection.h"
+#include "trace.h"
 #include "utils/string.h"
 
 #include <curl/curl.h>
@@ -12,11 +15,18 @@
 #include <openssl/encoder.h>
 #include <openssl/err.h>
 #include <openssl/evp.h>
+#include <openssl/pem.h>
+
+#include <errno.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <time.h>
 #include <unistd.h>
 
 #define SHARED_SECRET_SIZE 16
+#define RSA_KEY_BITS 1024
 
 static void encryption_get_errors(void) {
     u64 code;
@@ -27,27 +37,93 @@ static void encryption_get_errors(void) {
     }
 }
 
-bool encryption_init(EncryptionContext* ctx) {
+static EVP_PKEY* generate_key_pair(void) {
+    EVP_PKEY* key_pair = NULL;
     EVP_PKEY_CTX* keygen_ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_RSA, NULL);
     if (!keygen_ctx) {
         log_fatal("Failed to create the RSA key context.");
-        return FALSE;
+        return NULL;
     }
 
     if (EVP_PKEY_keygen_init(keygen_ctx) <= 0) {
         log_fatal("Failed to initialize the RSA key context for key generation.");
-        return FALSE;
+        EVP_PKEY_CTX_free(keygen_ctx);
+        return NULL;
     }
-    if (EVP_PKEY_CTX_set_rsa_keygen_bits(keygen_ctx, 1024) <= 0) {
+    if (EVP_PKEY_CTX_set_rsa_keygen_bits(keygen_ctx, RSA_KEY_BITS) <= 0) {
         log_fatal("Failed to set the RSA key length to 1024 bits.");
-        return FALSE;
+        EVP_PKEY_CTX_free(keygen_ctx);
+        return NULL;
     }
 
-    if (EVP_PKEY_keygen(keygen_ctx, &ctx->key_pair) <= 0) {
+    if (EVP_PKEY_keygen(keygen_ctx, &key_pair) <= 0) {
         log_fatal("Failed to generate the RSA key pair.");
-        return FALSE;
+        key_pair = NULL;
+    }
+
+    EVP_PKEY_CTX_free(keygen_ctx);
+    return key_pair;
+}
+
+static EVP_PKEY* load_key_pair(const char* path) {
+    struct stat file_stat;
+    if (stat(path, &file_stat) != 0)
+        return NULL;
+
+    if (time(NULL) - file_stat.st_mtime > RSA_KEY_MAX_AGE) {
+        log_infof("The cached RSA key pair '%s' has expired.", path);
+        return NULL;
+    }
+
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        log_warnf("Could not open the cached RSA key pair '%s': %s.", path, strerror(errno));
+        return NULL;
+    }
+
+    EVP_PKEY* key_pair = PEM_read_PrivateKey(file, NULL, NULL, NULL);
+    fclose(file);
+    if (!key_pair) {
+        encryption_get_errors();
+        log_warnf("Could not read the cached RSA key pair '%s'.", path);
+        return NULL;
+    }
+
+    if (!EVP_PKEY_is_a(key_pair, "RSA") || EVP_PKEY_get_bits(key_pair) != RSA_KEY_BITS) {
+        log_warnf("The cached key pair '%s' is not a %i-bit RSA key pair.", path, RSA_KEY_BITS);
+        EVP_PKEY_free(key_pair);
+        return NULL;
+    }
+
+    return key_pair;
+}
+
+static void save_key_pair(EVP_PKEY* key_pair, const char* path) {
+    // The private key must only be readable by the server.
+    i32 fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) {
+        log_warnf("Could not cache the RSA key pair in '%s': %s.", path, strerror(errno));
+        return;
+    }
+
+    FILE* file = fdopen(fd, "wb");
+    if (!file) {
+        log_warnf("Could not cache the RSA key pair in '%s': %s.", path, strerror(errno));
+        close(fd);
+        return;
+    }
+
+    if (!PEM_write_PrivateKey(file, key_pair, NULL, NULL, 0, NULL, NULL)) {
+        encryption_get_errors();
+        log_warnf("Could not cache the RSA key pair in '%s'.", path);
     }
+    fclose(file);
+}
 
+/**
+ * Encodes the public key in DER format and prepares the decryption context.
+ */
+static bool setup_key_pair(EncryptionContext* ctx) {
     OSSL_ENCODER_CTX* encoder_ctx = OSSL_ENCODER_CTX_new_for_pkey(
         ctx->key_pair,
         OSSL_KEYMGMT_SELECT_PUBLIC_KEY | OSSL_KEYMGMT_SELECT_DOMAIN_PARAMETERS,
@@ -62,10 +138,10 @@ bool encryption_init(EncryptionContext* ctx) {
 
     if (OSSL_ENCODER_to_data(encoder_ctx, &ctx->encoded_key, &ctx->encoded_key_size) <= 0) {
         log_fatal("Could not encode the generated RSA key pair to DER.");
+        OSSL_ENCODER_CTX_free(encoder_ctx);
         return FALSE;
     }
 
-    EVP_PKEY_CTX_free(keygen_ctx);
     OSSL_ENCODER_CTX_free(encoder_ctx);
 
     ctx->key_ctx = EVP_PKEY_CTX_new(ctx->key_pair, NULL);
@@ -84,10 +160,79 @@ bool encryption_init(EncryptionContext* ctx) {
     return TRUE;
 }
 
+static void set_ready(EncryptionContext* ctx, bool success) {
+    mcmutex_lock(&ctx->mutex);
+    ctx->ready = success;
+    ctx->failed = !success;
+    mcmutex_unlock(&ctx->mutex);
+}
+
+static void* keygen_routine(void* param) {
+    EncryptionContext* ctx = param;
+    mcthread_set_name("keygen");
+
+    log_info("Generating a new RSA key pair...");
+    ctx->key_pair = generate_key_pair();
+    if (!ctx->key_pair) {
+        set_ready(ctx, FALSE);
+        return NULL;
+    }
+
+    if (ctx->key_path)
+        save_key_pair(ctx->key_pair, ctx->key_path);
+
+    bool success = setup_key_pair(ctx);
+    if (success)
+        log_info("RSA key pair generated.");
+    set_ready(ctx, success);
+    return NULL;
+}
+
+bool encryption_init(EncryptionContext* ctx, const char* key_path, bool regenerate) {
+    ctx->key_pair = NULL;
+    ctx->key_ctx = NULL;
+    ctx->encoded_key = NULL;
+    ctx->encoded_key_size = 0;
+    ctx->key_path = key_path;
+    ctx->generating = FALSE;
+    ctx->ready = FALSE;
+    ctx->failed = FALSE;
+    mcmutex_create(&ctx->mutex);
+
+    if (key_path && !regenerate)
+        ctx->key_pair = load_key_pair(key_path);
+
+    if (ctx->key_pair) {
+        log_debugf("Loaded the cached RSA key pair '%s'.", key_path);
+        if (!setup_key_pair(ctx))
+            return FALSE;
+        ctx->ready = TRUE;
+        return TRUE;
+    }
+
+    // Key generation takes a while, do not delay the server socket.
+    if (mcthread_create(&ctx->keygen_thread, &keygen_routine, ctx) != 0)
+        return FALSE;
+    ctx->generating = TRUE;
+    return TRUE;
+}
+
+enum KeyState encryption_key_state(EncryptionContext* ctx) {
+    // The mutex orders the writes of the key generation thread before the reads of the caller.
+    mcmutex_lock(&ctx->mutex);
+    enum KeyState state = ctx->ready ? KEY_READY : ctx->failed ? KEY_FAILED : KEY_PENDING;
+    mcmutex_unlock(&ctx->mutex);
+    return state;
+}
+
 void encryption_cleanup(EncryptionContext* ctx) {
+    if (ctx->generating)
+        mcthread_join(&ctx->keygen_thread, NULL);
+
     EVP_PKEY_CTX_free(ctx->key_ctx);
     EVP_PKEY_free(ctx->key_pair);
     OPENSSL_free(ctx->encoded_key);
+    mcmutex_destroy(&ctx->mutex);
 }
 
 u8* encryption_decrypt(EncryptionContext* ctx, Arena* arena, u64* out_size, u8* in, u64 in_size) {
@@ -150,6 +295,7 @@ void encryption_cleanup_peer(PeerEncryptionContext* ctx) {
 }
 
 bool encryption_cipher(PeerEncryptionContext* ctx, ByteBuffer* buffer, u64 offset) {
+    TRACE_SCOPE("encrypt");
 
     u64 region_count = 2;
     BufferRegion regions[2];
@@ -173,6 +319,7 @@ bool encryption_cipher(PeerEncryptionContext* ctx, ByteBuffer* buffer, u64 offse
 }
 
 bool encryption_decipher(PeerEncryptionContext* ctx, ByteBuffer* buffer, u64 offset) {
+    TRACE_SCOPE("decrypt");
 
     u64 region_count = 2;
     BufferRegion regions[2];
@@ -280,7 +427,8 @@ bool encryption_authenticate_player(Connection* conn, JSON* json) {
         return FALSE;
     }
 
-    ByteBuffer buffer = bytebuf_create_fixed(8192, &conn->scratch_arena);
+    // Profiles have no size limit, so the response buffer grows as needed.
+    ByteBuffer buffer = bytebuf_create(8192);
     char url[2048];
     char* error_buffer = arena_callocate(&conn->scratch_arena, CURL_ERROR_SIZE, ALLOC_TAG_STRING);
     snprintf(url,
@@ -309,20 +457,49 @@ bool encryption_authenticate_player(Connection* conn, JSON* json) {
 
     if (res_code != 200) {
         log_errorf("Failed request to sessionserver.mojang.com: %li", res_code);
+        bytebuf_destroy(&buffer);
         return FALSE;
     }
 
     bytebuf_write_varint(&buffer, 0);
 
-    *json = json_parse(&buffer, &conn->scratch_arena);
+    *json = json_parse(&buffer, &conn->dynamic_arena);
+    bytebuf_destroy(&buffer);
     if (json->arena == NULL)
         return FALSE;
 
-#ifdef TRACE
-    string str;
-    json_stringify(json, &str, &conn->scratch_arena);
-    log_tracef("%s", str.base);
-#endif
+    if (log_enabled(LOG_LEVEL_TRACE)) {
+        string str;
+        json_stringify(json, &str, &conn->dynamic_arena);
+        log_tracef("%s", str.base);
+    }
 
     return res_code == 200;
 }
+
+bool encryption_offline_uuid(const string* player_name, u64* out) {
+    static const char prefix[] = "OfflinePlayer:";
+
+    EVP_MD_CTX* md_ctx = EVP_MD_CTX_new();
+    if (!md_ctx)
+        return FALSE;
+
+    u8 hash[EVP_MAX_MD_SIZE];
+    u32 size;
+    bool success = EVP_DigestInit_ex(md_ctx, EVP_md5(), NULL) > 0 &&
+                   EVP_DigestUpdate(md_ctx, prefix, sizeof prefix - 1) > 0 &&
+                   EVP_DigestUpdate(md_ctx, player_name->base, player_name->length) > 0 &&
+                   EVP_DigestFinal_ex(md_ctx, hash, &size) > 0;
+    EVP_MD_CTX_free(md_ctx);
+
+    if (!success) {
+        encryption_get_errors();
+        return FALSE;
+    }
+
+    // Set the version (3) and the variant (IETF) bits.
+    hash[6] = (hash[6] & 0x0f) | 0x30;
+    hash[8] = (hash[8] & 0x3f) | 0x80;
+    memcpy(out, hash, 16);
+    return TRUE;
+}
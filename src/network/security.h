@@ -10,6 +10,8 @@
 #include "definitions.h"
 #include "memory/arena.h"
 #include "data/json.h"
+#include "platform/mc_mutex.h"
+#include "platform/mc_thread.h"
 
 #include <openssl/encoder.h>
 #include <openssl/evp.h>
@@ -17,11 +19,32 @@
 
 typedef struct Connection Connection;
 
+/** Maximum age (in seconds) of a cached RSA key pair before a new one is generated. */
+#define RSA_KEY_MAX_AGE (7 * 24 * 3600)
+
+/**
+ * Availability of the RSA key pair of an encryption context.
+ */
+enum KeyState {
+    KEY_PENDING, /**< The key pair is being generated. */
+    KEY_READY,   /**< The key pair can be used. */
+    KEY_FAILED,  /**< The key pair could not be generated. */
+};
+
 typedef struct {
     EVP_PKEY* key_pair;
     EVP_PKEY_CTX* key_ctx;
     u8* encoded_key;
     u64 encoded_key_size;
+
+    /** Path of the file caching the RSA key pair, or `NULL` to never cache it. */
+    const char* key_path;
+    /** Thread generating the key pair when no valid cached key pair was found. */
+    MCThread keygen_thread;
+    MCMutex mutex;
+    bool generating; /**< Whether the key generation thread has been started. */
+    bool ready;      /**< Whether the key pair can be used. Protected by the mutex. */
+    bool failed;     /**< Whether the key generation failed. Protected by the mutex. */
 } EncryptionContext;
 
 typedef struct {
@@ -33,14 +56,31 @@ typedef struct {
 /**
  * Initializes an encryption context.
  *
- * This function generates a new RSA key pair using OpenSSL, and encodes
- * it in DER format.
+ * This function loads the RSA key pair cached at @p key_path. If there is no such file,
+ * if the cached key pair is older than @ref RSA_KEY_MAX_AGE or if @p regenerate is set,
+ * a new key pair is generated using OpenSSL on a separate thread, and saved
+ * at @p key_path once generated. The key pair is encoded in DER format.
+ *
+ * Because the key pair may not be available when this function returns, callers must check
+ * encryption_key_state() before using the context.
  *
  * @param[out] ctx The context structure to initialize.
+ * @param[in] key_path The path of the file caching the key pair. Can be `NULL`.
+ * @param regenerate @ref TRUE to ignore the cached key pair and generate a new one.
  * @return @ref TRUE if the encryption context was initialized successfully, or @ref FALSE if
  * errors occurred.
  */
-bool encryption_init(EncryptionContext* ctx);
+bool encryption_init(EncryptionContext* ctx, const char* key_path, bool regenerate);
+/**
+ * Tells whether the RSA key pair of an encryption context is available, without waiting.
+ *
+ * Once @ref KEY_READY is returned, the key pair and its decryption context can be used by the
+ * calling thread.
+ *
+ * @param[in] ctx The encryption context to check.
+ * @return The state of the key pair.
+ */
+enum KeyState encryption_key_state(EncryptionContext* ctx);
 /**
  * Frees resources associated with an encryption context.
  *
@@ -101,4 +141,16 @@ bool encryption_decipher(PeerEncryptionContext* ctx, ByteBuffer* buffer, u64 off
 
 bool encryption_authenticate_player(Connection* conn, JSON* json);
 
+/**
+ * Computes the UUID of a player that did not authenticate.
+ *
+ * Like vanilla servers in offline mode, this is the version 3 (name-based) UUID of the string
+ * `OfflinePlayer:<name>`.
+ *
+ * @param[in] player_name The name of the player.
+ * @param[out] out The output buffer that will contain the UUID. Should be at least 16 bytes long.
+ * @return @ref TRUE if the UUID was computed successfully, @ref FALSE otherwise.
+ */
+bool encryption_offline_uuid(const string* player_name, u64* out);
+
 #endif /* ! ENCRYPTION_H */
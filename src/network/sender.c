@@ -1,5 +1,8 @@
+#define LOG_SUBSYSTEM LOG_SUBSYSTEM_NETWORK
+
 #include "compression.h"
 #include "network/common_types.h"
+#include "network/metrics.h"
 #include "security.h"
 #include "packet.h"
 #include "packet_codec.h"
@@ -10,16 +13,19 @@
 #include "utils/bitwise.h"
 #include "utils/math.h"
 #include "platform/network.h"
+#include "platform/platform.h"
+#include "trace.h"
 
 #define MAX_PACKET_SIZE 2097151
 
 void send_packet(NetworkContext* ctx, const Packet* pkt, Connection* conn) {
+    TRACE_SCOPE("send_packet");
     pkt_encoder encoder = get_pkt_encoder(pkt, conn);
     if (!encoder)
         return;
 
     mcmutex_lock(&conn->mutex);
-    arena_save(&conn->scratch_arena);
+    ArenaSave save = arena_save(&conn->scratch_arena);
     ByteBuffer scratch = bytebuf_create_fixed(MAX_PACKET_SIZE, &conn->scratch_arena);
 
     bytebuf_write_varint(&scratch, pkt->id);
@@ -27,12 +33,17 @@ void send_packet(NetworkContext* ctx, const Packet* pkt, Connection* conn) {
 
     log_debugf("Packet OUT: %s", get_pkt_name(pkt, conn, TRUE));
 
+    u64 uncompressed_size = scratch.size;
+    u64 compress_time = METRICS_SKIPPED;
+    u64 encrypt_time = METRICS_SKIPPED;
+
     if (conn->compression) {
         if (scratch.size >= conn->cmprss_ctx.threshold) {
-            u64 uncompressed_size = scratch.size;
             ByteBuffer compressed_scratch =
                 bytebuf_create_fixed(uncompressed_size, &conn->scratch_arena);
+            u64 compress_start = get_monotonic_ns();
             compression_compress(&conn->cmprss_ctx, &compressed_scratch, &scratch);
+            compress_time = get_monotonic_ns() - compress_start;
 
             bytebuf_prepend_varint(&compressed_scratch, uncompressed_size);
             scratch = compressed_scratch;
@@ -44,10 +55,18 @@ void send_packet(NetworkContext* ctx, const Packet* pkt, Connection* conn) {
     bytebuf_prepend_varint(&scratch, scratch.size);
 
     if (conn->encryption) {
-        if (!encryption_cipher(&conn->peer_enc_ctx, &scratch, 0))
+        u64 encrypt_start = get_monotonic_ns();
+        if (!encryption_cipher(&conn->peer_enc_ctx, &scratch, 0)) {
+            arena_restore(&conn->scratch_arena, save);
+            mcmutex_unlock(&conn->mutex);
             return;
+        }
+        encrypt_time = get_monotonic_ns() - encrypt_start;
     }
 
+    metrics_record_sent(
+        conn->state, pkt->id, scratch.size, uncompressed_size, compress_time, encrypt_time);
+
     bytebuf_write_buffer(&conn->send_buffer, &scratch);
 
     if(!conn->pending_send) {
@@ -60,6 +79,6 @@ void send_packet(NetworkContext* ctx, const Packet* pkt, Connection* conn) {
     }
 
 
-    arena_restore(&conn->scratch_arena);
+    arena_restore(&conn->scratch_arena, save);
     mcmutex_unlock(&conn->mutex);
 }
@@ -1,13 +1,21 @@
 #ifdef MC_PLATFORM_LINUX
 
+#define LOG_SUBSYSTEM LOG_SUBSYSTEM_PLATFORM
+
 #include "platform/mc_cond_var.h"
 
 #include "logger.h"
 
 #include <errno.h>
+#include <time.h>
 
 bool mcvar_create(MCCondVar* cond_var) {
-    pthread_cond_init(cond_var, NULL);
+    // Timed waits must not be affected by changes of the wall clock.
+    pthread_condattr_t attributes;
+    pthread_condattr_init(&attributes);
+    pthread_condattr_setclock(&attributes, CLOCK_MONOTONIC);
+    pthread_cond_init(cond_var, &attributes);
+    pthread_condattr_destroy(&attributes);
     return TRUE;
 }
 
@@ -27,6 +35,18 @@ void mcvar_wait(MCCondVar* cond_var, MCMutex* mutex) {
     pthread_cond_wait(cond_var, mutex);
 }
 
+bool mcvar_timed_wait(MCCondVar* cond_var, MCMutex* mutex, u64 timeout_ns) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += timeout_ns / 1000000000;
+    deadline.tv_nsec += timeout_ns % 1000000000;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+    return pthread_cond_timedwait(cond_var, mutex, &deadline) != ETIMEDOUT;
+}
+
 void mcvar_signal(MCCondVar* cond_var) {
     pthread_cond_signal(cond_var);
 }
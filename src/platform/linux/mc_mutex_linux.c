@@ -1,5 +1,7 @@
 #ifdef MC_PLATFORM_LINUX
 
+#define LOG_SUBSYSTEM LOG_SUBSYSTEM_PLATFORM
+
 #include "platform/mc_mutex.h"
 #include "logger.h"
 
@@ -1,9 +1,13 @@
 #ifdef MC_PLATFORM_LINUX
 
+#define LOG_SUBSYSTEM LOG_SUBSYSTEM_PLATFORM
+
 #include "platform/mc_thread.h"
 #include "logger.h"
 
 #include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
 #include <string.h>
 #include <sys/prctl.h>
 #include <errno.h>
@@ -12,7 +16,7 @@ static MCThreadKey self_key;
 static pthread_once_t once_control;
 
 static void init_routine(void) {
-    mcthread_create_attachment(&self_key);
+    mcthread_create_attachment(&self_key, NULL);
 }
 
 i32 mcthread_create(MCThread* thread, mcthread_routine routine, void* arg) {
@@ -32,12 +36,21 @@ bool mcthread_set_name(const char* name) {
     return prctl(PR_SET_NAME, name, 0) == 0;
 }
 
+bool mcthread_get_name(char* out_name, u64 size) {
+    // Names are at most 16 bytes long, including the terminator.
+    char name[16];
+    if (size == 0 || prctl(PR_GET_NAME, name) != 0)
+        return FALSE;
+    snprintf(out_name, size, "%s", name);
+    return TRUE;
+}
+
 void mcthread_destroy(MCThread* thread) {
     pthread_cancel(*thread);
 }
 
-bool mcthread_create_attachment(MCThreadKey* out_key) {
-    i32 res = pthread_key_create(out_key, NULL);
+bool mcthread_create_attachment(MCThreadKey* out_key, mcthread_destructor destructor) {
+    i32 res = pthread_key_create(out_key, destructor);
     if (res) {
         log_fatalf("Failed to create thread attachment: %s.", strerror(res));
         return FALSE;
@@ -45,7 +58,7 @@ bool mcthread_create_attachment(MCThreadKey* out_key) {
     return TRUE;
 }
 
-bool mcthread_delete_attachment(MCThreadKey key) {
+bool mcthread_destroy_attachment(MCThreadKey key) {
     i32 res = pthread_key_delete(key);
     if (res) {
         log_fatalf("Failed to destroy thread attachment: %s.", strerror(res));
@@ -90,4 +103,8 @@ bool mcthread_join(MCThread* thread, void** out_return) {
     }
 }
 
+void mcthread_yield(void) {
+    sched_yield();
+}
+
 #endif
@@ -1,9 +1,12 @@
 #ifdef MC_PLATFORM_LINUX
 
+#define LOG_SUBSYSTEM LOG_SUBSYSTEM_NETWORK
+
 #include "containers/bytebuffer.h"
 #include "containers/object_pool.h"
 #include "definitions.h"
 #include "logger.h"
+#include "network/capture.h"
 #include "network/common_types.h"
 #include "network/connection.h"
 #include "network/packet_codec.h"
@@ -12,6 +15,7 @@
 #include "platform/network.h"
 #include "platform/socket.h"
 #include "platform/platform.h"
+#include "trace.h"
 
 #include <errno.h>
 #include <fcntl.h>
@@ -213,8 +217,10 @@ enum IOCode fill_buffer(NetworkContext* ctx, Connection* conn) {
             conn->pending_recv = TRUE;
     }
 
+    capture_bytes(conn, CAPTURE_RAW, &conn->recv_buffer, starting_pos);
     if(conn->encryption) {
         encryption_decipher(&conn->peer_enc_ctx, &conn->recv_buffer, starting_pos);
+        capture_bytes(conn, CAPTURE_DECRYPTED, &conn->recv_buffer, starting_pos);
     }
 
     /*
@@ -283,6 +289,7 @@ i32 network_platform_init(NetworkContext* ctx, u64 max_connections) {
 }
 
 static enum IOCode accept_connection(NetworkContext* ctx) {
+    TRACE_SCOPE("accept_connection");
     SocketAddress peer_address;
     socketfd peer_socket;
     enum IOCode code = sock_accept(ctx->server_socket, &peer_socket, &peer_address);
@@ -299,7 +306,9 @@ static enum IOCode accept_connection(NetworkContext* ctx) {
     i64 index;
     Connection* conn = objpool_add(&ctx->connections, &index);
     if (!conn) {
-        log_warn("Reached maximum connection amount, rejecting.");
+        log_limited(LOG_LEVEL_WARN,
+                    CONNECTION_LOGS_PER_WINDOW,
+                    "Reached maximum connection amount, rejecting.");
         sock_close(peer_socket);
         return IOC_CLOSED;
     }
@@ -319,17 +328,28 @@ static enum IOCode accept_connection(NetworkContext* ctx) {
     *conn = conn_create(peer_socket, index, &ctx->enc_ctx, peer_host, peer_port);
     conn->pending_recv = TRUE;
     conn->pending_send = TRUE;
+    capture_open(conn);
 
-    log_infof("Accepted connection from [%s:%i].", peer_host.base, peer_port);
+    log_limitedf(LOG_LEVEL_INFO,
+                 CONNECTION_LOGS_PER_WINDOW,
+                 "Accepted connection from [%s:%i].",
+                 peer_host.base,
+                 peer_port);
     return IOC_OK;
 }
 
 void close_connection(NetworkContext* ctx, Connection* conn) {
     struct epoll_event placeholder;
-    log_infof("Closing connection to [%s:%i].", conn->peer_addr.base, conn->peer_port);
+    log_limitedf(LOG_LEVEL_INFO,
+                 CONNECTION_LOGS_PER_WINDOW,
+                 "Closing connection to [%s:%i].",
+                 conn->peer_addr.base,
+                 conn->peer_port);
 
     //TODO: Send a `DISCONNECT` packet when closing a connection.
 
+    capture_close(conn);
+
     if (conn->encryption) {
         encryption_cleanup_peer(&conn->peer_enc_ctx);
     }
@@ -337,6 +357,7 @@ void close_connection(NetworkContext* ctx, Connection* conn) {
     sock_close(conn->peer_socket);
     epoll_ctl(platform_ctx.epollfd, EPOLL_CTL_DEL, conn->peer_socket, &placeholder);
     arena_destroy(&conn->scratch_arena);
+    dynarena_destroy(&conn->dynamic_arena);
     arena_destroy(&conn->persistent_arena);
     mcmutex_destroy(&conn->mutex);
     conn->peer_socket = SOCKFD_INVALID;
@@ -345,7 +366,8 @@ void close_connection(NetworkContext* ctx, Connection* conn) {
 
 static void network_finish(NetworkContext* ctx) {
 
-    encryption_cleanup(&ctx->enc_ctx);
+    if (!ctx->offline)
+        encryption_cleanup(&ctx->enc_ctx);
 
     for (i64 i = 0; i < ctx->connections.capacity; i++) {
         Connection* conn = objpool_get(&ctx->connections, i);
@@ -361,6 +383,7 @@ static void network_finish(NetworkContext* ctx) {
 }
 
 static enum IOCode handle_connection_io(NetworkContext* ctx, Connection* conn, i32 events) {
+    TRACE_SCOPE("handle_connection_io");
     enum IOCode io_code = IOC_OK;
     if (events & EPOLLIN && conn->pending_recv) {
         conn->pending_recv = FALSE;
@@ -372,11 +395,13 @@ static enum IOCode handle_connection_io(NetworkContext* ctx, Connection* conn, i
         }
         switch (io_code) {
         case IOC_CLOSED:
-            log_warn("Peer closed connection.");
+            log_limited(LOG_LEVEL_WARN, CONNECTION_LOGS_PER_WINDOW, "Peer closed connection.");
             close_connection(ctx, conn);
             break;
         case IOC_ERROR:
-            log_error("An error occurred while processing a connection.");
+            log_limited(LOG_LEVEL_ERROR,
+                        CONNECTION_LOGS_PER_WINDOW,
+                        "An error occurred while processing a connection.");
             close_connection(ctx, conn);
             break;
         default:
@@ -423,7 +448,6 @@ void* network_handle(void* params) {
                 ctx->should_continue = FALSE;
             else {
                 Connection* conn = objpool_get(&ctx->connections, e->data.u64);
-                memory_dump_stats();
                 handle_connection_io(ctx, conn, e->events);
             }
         }
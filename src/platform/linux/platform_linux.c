@@ -7,6 +7,10 @@
 #include <signal.h>
 #include <errno.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
 
 void platform_init(void) {
     sigset_t global_sigmask;
@@ -30,4 +34,88 @@ const char* get_error_from_code(i64 code) {
     return strerror(code);
 }
 
+u64 get_monotonic_ns(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (u64) time.tv_sec * 1000000000 + time.tv_nsec;
+}
+
+u64 get_page_size(void) {
+    return sysconf(_SC_PAGESIZE);
+}
+
+u32 get_process_id(void) {
+    return getpid();
+}
+
+void* platform_mem_reserve(u64 size, bool huge_pages) {
+    void* addr = mmap(NULL, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (addr == MAP_FAILED)
+        return NULL;
+
+#ifdef MADV_HUGEPAGE
+    if (huge_pages)
+        madvise(addr, size, MADV_HUGEPAGE);
+#else
+    (void) huge_pages;
+#endif
+    return addr;
+}
+
+bool platform_mem_commit(void* addr, u64 size) {
+    return mprotect(addr, size, PROT_READ | PROT_WRITE) == 0;
+}
+
+void platform_mem_decommit(void* addr, u64 size) {
+    madvise(addr, size, MADV_DONTNEED);
+    mprotect(addr, size, PROT_NONE);
+}
+
+void platform_mem_release(void* addr, u64 size) {
+    munmap(addr, size);
+}
+
+/** Number of pieces of text given to each writev call. */
+#define CONSOLE_IOV_COUNT 256
+
+static void write_all(i32 fd, struct iovec* iov, u32 count) {
+    while (count > 0) {
+        ssize_t written = writev(fd, iov, (int) count);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            return;
+        }
+        while (count > 0 && (u64) written >= iov->iov_len) {
+            written -= (ssize_t) iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0) {
+            iov->iov_base = (u8*) iov->iov_base + written;
+            iov->iov_len -= written;
+        }
+    }
+}
+
+void platform_console_write(enum ConsoleStream stream, const ConsoleChunk* chunks, u32 count) {
+    i32 fd = stream == CONSOLE_STDERR ? STDERR_FILENO : STDOUT_FILENO;
+    struct iovec iov[CONSOLE_IOV_COUNT];
+    while (count > 0) {
+        u32 batch = count < CONSOLE_IOV_COUNT ? count : CONSOLE_IOV_COUNT;
+        for (u32 i = 0; i < batch; i++) {
+            iov[i] = (struct iovec){(void*) chunks[i].base, chunks[i].length};
+        }
+        write_all(fd, iov, batch);
+        chunks += batch;
+        count -= batch;
+    }
+}
+
+void platform_block_signals(void) {
+    sigset_t sigmask;
+    sigfillset(&sigmask);
+    pthread_sigmask(SIG_BLOCK, &sigmask, NULL);
+}
+
 #endif
@@ -1,9 +1,14 @@
 #ifdef MC_PLATFORM_LINUX
 
+#define LOG_SUBSYSTEM LOG_SUBSYSTEM_PLATFORM
+
 #include "signal-handler.h"
 #include "definitions.h"
 #include "event/event.h"
 #include "logger.h"
+#include "memory/mem_tags.h"
+#include "network/metrics.h"
+#include "trace.h"
 
 #include <errno.h>
 #include <linux/prctl.h>
@@ -40,6 +45,9 @@ static void* handle_signals(void* param) {
     sigemptyset(&sigmask);
     sigaddset(&sigmask, SIGINT);
     sigaddset(&sigmask, SIGTERM);
+    sigaddset(&sigmask, SIGUSR1);
+    sigaddset(&sigmask, SIGUSR2);
+    sigaddset(&sigmask, SIGHUP);
 
     i32 signal  = 0;
     EventInfo e = {
@@ -48,12 +56,24 @@ static void* handle_signals(void* param) {
 
 test_label:
     while ((signal = sigwaitinfo(&sigmask, NULL)) != -1) {
+        TRACE_SCOPE("handle_signal");
         log_debugf("Received signal '%s'.", strsignal(signal));
         switch (signal) {
         case SIGINT:
         case SIGTERM:
             event_trigger(BEVENT_STOP, e);
             return NULL;
+        case SIGUSR1:
+            memory_dump_stats();
+            metrics_dump();
+            trace_dump();
+            break;
+        case SIGUSR2:
+            logger_cycle_verbosity();
+            break;
+        case SIGHUP:
+            logger_reload_levels();
+            break;
         }
     }
     goto test_label;
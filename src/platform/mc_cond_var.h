@@ -16,6 +16,13 @@ bool mcvar_create(MCCondVar* cond_var);
 bool mcvar_destroy(MCCondVar* cond_var);
 
 void mcvar_wait(MCCondVar* cond_var, MCMutex* mutex);
+/**
+ * Waits on a condition variable, for at most the specified time.
+ *
+ * @param timeout_ns The maximum time to wait, in nanoseconds.
+ * @return @ref FALSE if the time ran out.
+ */
+bool mcvar_timed_wait(MCCondVar* cond_var, MCMutex* mutex, u64 timeout_ns);
 void mcvar_signal(MCCondVar* cond_var);
 void mcvar_broadcast(MCCondVar* cond_var);
 
@@ -14,13 +14,31 @@
 #endif
 
 typedef void* (*mcthread_routine)(void* arg);
+/** Called with the data attached to a thread when the thread exits, if the data is not `NULL`. */
+typedef void (*mcthread_destructor)(void* data);
 
 i32 mcthread_create(MCThread* thread, mcthread_routine routine, void* arg);
 void mcthread_destroy(MCThread* thread);
 
 bool mcthread_set_name(const char* name);
-
-bool mcthread_create_attachment(MCThreadKey* out_key);
+/**
+ * Gets the name of the calling thread.
+ *
+ * @param[out] out_name Set to the name, truncated to fit @p size bytes including the terminator.
+ * @param size The size of @p out_name.
+ * @return @ref TRUE if the name could be read.
+ */
+bool mcthread_get_name(char* out_name, u64 size);
+
+/**
+ * Creates a key to attach data to threads.
+ *
+ * @param[out] out_key Set to the new key.
+ * @param destructor Called when a thread with attached data exits, or `NULL`. On Windows, it is
+ * also called for the data of running threads when the key is destroyed.
+ * @return @ref TRUE if the key was created.
+ */
+bool mcthread_create_attachment(MCThreadKey* out_key, mcthread_destructor destructor);
 bool mcthread_destroy_attachment(MCThreadKey key);
 void mcthread_attach_data(MCThreadKey key, void* data);
 void* mcthread_get_data(MCThreadKey key);
@@ -31,4 +49,9 @@ bool mcthread_is_running(MCThread* thread);
 
 bool mcthread_join(MCThread* thread, void** out_return);
 
+/**
+ * Lets other threads run before the calling thread.
+ */
+void mcthread_yield(void);
+
 #endif /* ! MC_THREADS_H */
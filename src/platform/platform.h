@@ -16,4 +16,92 @@ void platform_cleanup(void);
 const char* get_last_error(void);
 const char* get_error_from_code(i64 code);
 
+/**
+ * Gets the current time of a monotonic clock, with a nanosecond resolution.
+ *
+ * @return A timestamp in nanoseconds, only meaningful when compared to other timestamps.
+ */
+u64 get_monotonic_ns(void);
+
+/**
+ * Gets the size of a memory page.
+ *
+ * @return The size of a page in bytes.
+ */
+u64 get_page_size(void);
+
+/**
+ * Gets the identifier of the server process.
+ */
+u32 get_process_id(void);
+
+/**
+ * Reserves a range of virtual memory, without making it usable.
+ *
+ * Reserved memory does not use any physical memory until it is committed.
+ *
+ * @param size The number of bytes to reserve, a multiple of the page size.
+ * @param huge_pages @ref TRUE to ask the system to back the range with huge pages when possible.
+ * @return The start of the reserved range, or NULL if it could not be reserved.
+ */
+void* platform_mem_reserve(u64 size, bool huge_pages);
+/**
+ * Makes a part of a reserved range readable and writable.
+ *
+ * Physical memory is only used once committed pages are touched.
+ *
+ * @param addr The start of the part to commit, aligned on a page.
+ * @param size The number of bytes to commit, a multiple of the page size.
+ * @return @ref TRUE if the memory was committed, @ref FALSE otherwise.
+ */
+bool platform_mem_commit(void* addr, u64 size);
+/**
+ * Gives the physical memory backing a part of a reserved range back to the system.
+ *
+ * The part must be committed again before being used.
+ *
+ * @param addr The start of the part to decommit, aligned on a page.
+ * @param size The number of bytes to decommit, a multiple of the page size.
+ */
+void platform_mem_decommit(void* addr, u64 size);
+/**
+ * Releases a whole range of virtual memory previously reserved.
+ *
+ * @param addr The start of the range, as returned by @ref platform_mem_reserve.
+ * @param size The size of the range, as given to @ref platform_mem_reserve.
+ */
+void platform_mem_release(void* addr, u64 size);
+
+/**
+ * Streams of the console.
+ */
+enum ConsoleStream {
+    CONSOLE_STDOUT,
+    CONSOLE_STDERR,
+};
+
+/**
+ * A piece of text to write to the console.
+ */
+typedef struct ConsoleChunk {
+    const void* base;
+    u64 length;
+} ConsoleChunk;
+
+/**
+ * Writes pieces of text to a console stream, with as few system calls as possible.
+ *
+ * Partial writes are retried until all the text is written, or an error occurs.
+ *
+ * @param stream The stream to write to.
+ * @param[in] chunks The pieces of text, written in order.
+ * @param count The number of pieces of text.
+ */
+void platform_console_write(enum ConsoleStream stream, const ConsoleChunk* chunks, u32 count);
+
+/**
+ * Blocks all signals on the calling thread, leaving them to the signal handling thread.
+ */
+void platform_block_signals(void);
+
 #endif /* ! PLATFORM_H */
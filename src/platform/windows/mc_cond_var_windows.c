@@ -21,6 +21,12 @@ void mcvar_wait(MCCondVar* cond_var, MCMutex* mutex) {
     SleepConditionVariableCS(cond_var, mutex, INFINITE);
 }
 
+bool mcvar_timed_wait(MCCondVar* cond_var, MCMutex* mutex, u64 timeout_ns) {
+    // Round up, so short waits do not turn into busy loops.
+    DWORD timeout_ms = (DWORD) ((timeout_ns + 999999) / 1000000);
+    return SleepConditionVariableCS(cond_var, mutex, timeout_ms);
+}
+
 void mcvar_signal(MCCondVar* cond_var) {
     WakeConditionVariable(cond_var);
 }
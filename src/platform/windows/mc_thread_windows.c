@@ -1,3 +1,5 @@
+#define LOG_SUBSYSTEM LOG_SUBSYSTEM_PLATFORM
+
 #include <memory/mem_tags.h>
 #include <platform/platform.h>
 #ifdef MC_PLATFORM_WINDOWS
@@ -104,9 +106,18 @@ bool mcthread_set_name(const char* name) {
     return FALSE;
 }
 
-bool mcthread_create_attachment(MCThreadKey* out_key) {
-    i64 key = TlsAlloc();
-    if(key == TLS_OUT_OF_INDEXES) {
+bool mcthread_get_name(char* out_name, u64 size) {
+    UNUSED(out_name);
+    UNUSED(size);
+    // TODO
+    return FALSE;
+}
+
+// Fiber local storage behaves like thread local storage for threads which do not use fibers,
+// and is the only one to call a destructor when a thread exits.
+bool mcthread_create_attachment(MCThreadKey* out_key, mcthread_destructor destructor) {
+    i64 key = FlsAlloc((PFLS_CALLBACK_FUNCTION) destructor);
+    if(key == FLS_OUT_OF_INDEXES) {
         log_fatalf("Failed to create thread attachment: %s.", get_last_error());
         return FALSE;
     }
@@ -116,7 +127,7 @@ bool mcthread_create_attachment(MCThreadKey* out_key) {
 }
 
 bool mcthread_destroy_attachment(MCThreadKey key) {
-    bool res = TlsFree(key);
+    bool res = FlsFree(key);
     if (!res) {
         log_fatalf("Failed to destroy thread attachment: %s.", get_last_error());
         return FALSE;
@@ -124,12 +135,12 @@ bool mcthread_destroy_attachment(MCThreadKey key) {
     return TRUE;
 }
 void mcthread_attach_data(MCThreadKey key, void* data) {
-    if(!TlsSetValue(key, data))
+    if(!FlsSetValue(key, data))
         log_errorf("Failed to attach data to thread: %s", get_last_error());
 }
 
 void* mcthread_get_data(MCThreadKey key) {
-    void* res = TlsGetValue(key);
+    void* res = FlsGetValue(key);
     if(res == NULL)  {
         i64 ecode = GetLastError();
         if(ecode != ERROR_SUCCESS) {
@@ -170,4 +181,8 @@ bool mcthread_join(MCThread* thread, void** out_return) {
     return TRUE;
 }
 
+void mcthread_yield(void) {
+    SwitchToThread();
+}
+
 #endif
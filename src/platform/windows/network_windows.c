@@ -3,6 +3,8 @@
 //
 #ifdef MC_PLATFORM_WINDOWS
 
+#define LOG_SUBSYSTEM LOG_SUBSYSTEM_NETWORK
+
 #include "logger.h"
 #include "memory/mem_tags.h"
 #include "network/packet_codec.h"
@@ -233,7 +235,8 @@ i32 platform_socket_init(socketfd server_socket) {
 
 static void network_finish(NetworkContext* ctx) {
 
-    encryption_cleanup(&ctx->enc_ctx);
+    if (!ctx->offline)
+        encryption_cleanup(&ctx->enc_ctx);
 
     for (i64 i = 0; i < ctx->connections.capacity; i++) {
         PlatformConnection* pconn = objpool_get(&ctx->connections, i);
@@ -337,11 +340,11 @@ static enum IOCode handle_connection_io(NetworkContext* ctx,
     }
 
     if (code == IOC_ERROR) {
-        log_error("Errored connection.");
+        log_limited(LOG_LEVEL_ERROR, CONNECTION_LOGS_PER_WINDOW, "Errored connection.");
     }
 
     if (code == IOC_CLOSED) {
-        log_warn("Peer closed connection.");
+        log_limited(LOG_LEVEL_WARN, CONNECTION_LOGS_PER_WINDOW, "Peer closed connection.");
     }
 
     return code;
@@ -375,7 +378,9 @@ static enum IOCode accept_connection(NetworkContext* ctx, PlatformConnection** o
     PlatformConnection* pconn = objpool_add(&ctx->connections, &index);
     if (!pconn) {
         sock_close(peer_socket_cache);
-        log_warn("Reached maximum connection amount, rejecting.");
+        log_limited(LOG_LEVEL_WARN,
+                    CONNECTION_LOGS_PER_WINDOW,
+                    "Reached maximum connection amount, rejecting.");
         return IOC_CLOSED;
     }
 
@@ -398,7 +403,11 @@ static enum IOCode accept_connection(NetworkContext* ctx, PlatformConnection** o
     }
 
     peer_socket_cache = SOCKFD_INVALID;
-    log_infof("Accepted connection from [%s:%i].", peer_host.base, peer_port);
+    log_limitedf(LOG_LEVEL_INFO,
+                 CONNECTION_LOGS_PER_WINDOW,
+                 "Accepted connection from [%s:%i].",
+                 peer_host.base,
+                 peer_port);
 
     *out_pconn = pconn;
 
@@ -420,10 +429,15 @@ static enum IOCode try_accept(NetworkContext* ctx) {
 }
 
 void close_connection(NetworkContext* ctx, Connection* conn) {
-    log_infof("Closing connection to [%s:%i].", conn->peer_addr.base, conn->peer_port);
+    log_limitedf(LOG_LEVEL_INFO,
+                 CONNECTION_LOGS_PER_WINDOW,
+                 "Closing connection to [%s:%i].",
+                 conn->peer_addr.base,
+                 conn->peer_port);
     sock_close(conn->peer_socket);
 
     arena_destroy(&conn->scratch_arena);
+    dynarena_destroy(&conn->dynamic_arena);
     arena_destroy(&conn->persistent_arena);
     mcmutex_destroy(&conn->mutex);
     conn->peer_socket = SOCKFD_INVALID;
@@ -3,6 +3,7 @@
 #include "platform/platform.h"
 #include "definitions.h"
 
+#include <stdio.h>
 #include <windows.h>
 
 void mcthread_init(void);
@@ -33,5 +34,58 @@ const char* get_error_from_code(i64 code) {
 
 }
 
+u64 get_monotonic_ns(void) {
+    static LARGE_INTEGER frequency;
+    if (frequency.QuadPart == 0)
+        QueryPerformanceFrequency(&frequency);
+
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    u64 seconds = counter.QuadPart / frequency.QuadPart;
+    u64 remainder = counter.QuadPart % frequency.QuadPart;
+    return seconds * 1000000000 + remainder * 1000000000 / frequency.QuadPart;
+}
+
+u64 get_page_size(void) {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwPageSize;
+}
+
+u32 get_process_id(void) {
+    return GetCurrentProcessId();
+}
+
+void* platform_mem_reserve(u64 size, bool huge_pages) {
+    // Large pages require a privilege and must be committed at once, they are not used.
+    (void) huge_pages;
+    return VirtualAlloc(NULL, size, MEM_RESERVE, PAGE_NOACCESS);
+}
+
+bool platform_mem_commit(void* addr, u64 size) {
+    return VirtualAlloc(addr, size, MEM_COMMIT, PAGE_READWRITE) != NULL;
+}
+
+void platform_mem_decommit(void* addr, u64 size) {
+    VirtualFree(addr, size, MEM_DECOMMIT);
+}
+
+void platform_mem_release(void* addr, u64 size) {
+    (void) size;
+    VirtualFree(addr, 0, MEM_RELEASE);
+}
+
+
+void platform_console_write(enum ConsoleStream stream, const ConsoleChunk* chunks, u32 count) {
+    FILE* file = stream == CONSOLE_STDERR ? stderr : stdout;
+    for (u32 i = 0; i < count; i++) {
+        fwrite(chunks[i].base, 1, chunks[i].length, file);
+    }
+    fflush(file);
+}
+
+void platform_block_signals(void) {
+    // Console control events are delivered on a thread of their own, there is nothing to block.
+}
 
 #endif
@@ -1,43 +1,310 @@
+#define LOG_SUBSYSTEM LOG_SUBSYSTEM_REGISTRY
+
 #include "registry.h"
-#include "containers/dict.h"
+#include "containers/dict_template.h"
+#include "containers/vector.h"
 #include "logger.h"
 #include "memory/arena.h"
+#include "memory/mem_tags.h"
 #include "resource/resource_id.h"
+#include "utils/hash.h"
+
 #include <stdlib.h>
+#include <string.h>
+
+#define REGISTRY_ARENA_SIZE (64L << 20)
+#define MAX_REGISTRY_COUNT 100
 
-#define REGISTRY_ARENA_SIZE 1048576
+/** Average number of keys per bucket of perfect hash tables. */
+#define PHF_BUCKET_SIZE 4
+/** Maximum displacement tried for a bucket before giving up. */
+#define PHF_MAX_DISPLACEMENT (1 << 20)
 
-typedef struct registry {
+/*
+  Frozen registries find entries with a minimal perfect hash function, built with the
+  "hash and displace" method: keys are split in buckets by their hash, and each bucket gets a
+  displacement, chosen so that all keys of the bucket land in distinct free slots.
+  Buckets are placed from the largest to the smallest, while there are still many free slots.
+  A lookup takes a single probe: hash the key, read the displacement of its bucket, and compare
+  the key of the resulting slot (identifiers which are not in the registry also land in some slot).
+ */
+struct perfect_hash {
+    u32* displacements;
+    u32* slots; /**< Numeric ID of the entry of each slot. */
+    u32 bucket_count;
+};
+
+DICT_DEFINE(EntryMap, entrymap, ResourceID, u32, resid_hash, resid_equals)
+
+struct registry {
     ResourceID name;
-    Dict entries;
-} Registry;
+    u64 stride;
+    u32 size;
+    bool frozen;
+
+    // Until the registry is frozen.
+    Vector names;
+    Vector entries;
+    EntryMap map;
 
-static Registry root;
+    // Once the registry is frozen.
+    ResourceID* ids;
+    u8* data;
+    struct perfect_hash phf;
+};
+
+DICT_DEFINE(RegistryMap, regmap, ResourceID, Registry*, resid_hash, resid_equals)
+
+static RegistryMap root;
 static Arena arena;
+static bool frozen;
 
 void registry_system_init(void) {
-    arena = arena_create(REGISTRY_ARENA_SIZE, BLK_TAG_REGISTRY);
-    root.name = resid_default_cstr("root");
-    dict_init_fixed(&root.entries, NULL, &arena, 100, sizeof(ResourceID), sizeof(Registry));
+    // Registries are never freed, and are read on every lookup once frozen.
+    arena = arena_create_reserved(REGISTRY_ARENA_SIZE, BLK_TAG_REGISTRY, TRUE);
+    regmap_init_fixed(&root, &arena, MAX_REGISTRY_COUNT);
+    frozen = FALSE;
 
     log_debug("Registry subsystem initialized.");
 }
 
 void registry_system_cleanup(void) {
+    u64 cursor = 0;
+    RegistryMap_slot* slot;
+    while ((slot = regmap_next(&root, &cursor))) {
+        if (!slot->value->frozen)
+            entrymap_destroy(&slot->value->map);
+    }
     arena_destroy(&arena);
 }
 
 bool registry_create(ResourceID name, u64 stride) {
-    Registry reg = {.name = name};
-    dict_init_fixed(&reg.entries, NULL, &arena, 512, sizeof(ResourceID), stride);
+    if (frozen) {
+        log_errorf("Can not create registry '%s:%s', registries are frozen.",
+                   resid_namespace(name).base,
+                   resid_path(name).base);
+        return FALSE;
+    }
+    if (regmap_ref(&root, &name))
+        return FALSE;
+
+    Registry* reg = arena_callocate(&arena, sizeof *reg, ALLOC_TAG_UNKNOWN);
+    reg->name = name;
+    reg->stride = stride;
+    vect_init_dynamic(&reg->names, &arena, 64, sizeof(ResourceID));
+    vect_init_dynamic(&reg->entries, &arena, 64, stride);
+    entrymap_init(&reg->map);
+
+    if (!regmap_put(&root, &name, &reg)) {
+        entrymap_destroy(&reg->map);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+bool registry_register(ResourceID registry_name, ResourceID id, void* instance) {
+    if (frozen) {
+        log_errorf("Can not register '%s:%s', registries are frozen.",
+                   resid_namespace(id).base,
+                   resid_path(id).base);
+        return FALSE;
+    }
+
+    Registry** reg = regmap_ref(&root, &registry_name);
+    if (!reg || entrymap_ref(&(*reg)->map, &id))
+        return FALSE;
+
+    u32 numeric_id = (*reg)->size;
+    if (!entrymap_put(&(*reg)->map, &id, &numeric_id))
+        return FALSE;
+    vect_add(&(*reg)->names, &id);
+    vect_add(&(*reg)->entries, instance);
+    (*reg)->size++;
+    return TRUE;
+}
+
+static u32 reduce(u32 hash, u32 range) {
+    return ((u64) hash * range) >> 32;
+}
+
+static u32 phf_bucket(const struct perfect_hash* phf, u64 hash) {
+    return reduce(hash >> 32, phf->bucket_count);
+}
+
+static u32 phf_position(u64 hash, u32 displacement, u32 size) {
+    return reduce(hash_mix(hash ^ HASH_SECRET2, HASH_SECRET3 + displacement), size);
+}
+
+/**
+ * Builds the perfect hash table of a registry, whose identifiers are already in `ids`.
+ *
+ * @return @ref TRUE if the table was built, @ref FALSE if no displacement could be found for a
+ * bucket (i.e. some identifiers have the same hash).
+ */
+static bool build_perfect_hash(Registry* reg) {
+    struct perfect_hash* phf = &reg->phf;
+    u32 size = reg->size;
+    phf->bucket_count = size / PHF_BUCKET_SIZE + 1;
+    phf->displacements = arena_callocate(&arena, phf->bucket_count * sizeof(u32), ALLOC_TAG_DICT);
+    phf->slots = arena_allocate(&arena, size * sizeof(u32), ALLOC_TAG_DICT);
+
+    u64* hashes = malloc(size * sizeof(u64));
+    u32* bucket_sizes = calloc(phf->bucket_count, sizeof(u32));
+    u32* bucket_starts = calloc(phf->bucket_count + 1, sizeof(u32));
+    u32* members = malloc(size * sizeof(u32));
+    u32* buckets = malloc(phf->bucket_count * sizeof(u32));
+    u32* positions = malloc(size * sizeof(u32));
+    bool* taken = calloc(size, sizeof(bool));
 
-    return dict_put(&root.entries, &name, &reg);
+    // Group keys by bucket.
+    for (u32 i = 0; i < size; i++) {
+        hashes[i] = resid_hash(&reg->ids[i]);
+        bucket_sizes[phf_bucket(phf, hashes[i])]++;
+    }
+    u32 max_bucket_size = 0;
+    for (u32 b = 0; b < phf->bucket_count; b++) {
+        bucket_starts[b + 1] = bucket_starts[b] + bucket_sizes[b];
+        if (bucket_sizes[b] > max_bucket_size)
+            max_bucket_size = bucket_sizes[b];
+    }
+    for (u32 i = 0; i < size; i++) {
+        u32 b = phf_bucket(phf, hashes[i]);
+        members[bucket_starts[b + 1] - bucket_sizes[b]] = i;
+        bucket_sizes[b]--;
+    }
+    // Sort buckets by decreasing size.
+    u32 sorted = 0;
+    for (u32 bucket_size = max_bucket_size; bucket_size > 0; bucket_size--) {
+        for (u32 b = 0; b < phf->bucket_count; b++) {
+            if (bucket_starts[b + 1] - bucket_starts[b] == bucket_size)
+                buckets[sorted++] = b;
+        }
+    }
+
+    bool success = TRUE;
+    for (u32 i = 0; i < sorted && success; i++) {
+        u32 b = buckets[i];
+        u32 count = bucket_starts[b + 1] - bucket_starts[b];
+        const u32* keys = members + bucket_starts[b];
+
+        u32 displacement = 0;
+        while (TRUE) {
+            u32 placed = 0;
+            while (placed < count) {
+                u32 pos = phf_position(hashes[keys[placed]], displacement, size);
+                if (taken[pos])
+                    break;
+                taken[pos] = TRUE;
+                positions[placed++] = pos;
+            }
+            if (placed == count)
+                break;
+
+            for (u32 j = 0; j < placed; j++) {
+                taken[positions[j]] = FALSE;
+            }
+            if (++displacement == PHF_MAX_DISPLACEMENT) {
+                success = FALSE;
+                break;
+            }
+        }
+
+        phf->displacements[b] = displacement;
+        for (u32 j = 0; j < count && success; j++) {
+            phf->slots[positions[j]] = keys[j];
+        }
+    }
+
+    free(taken);
+    free(positions);
+    free(buckets);
+    free(members);
+    free(bucket_starts);
+    free(bucket_sizes);
+    free(hashes);
+    return success;
+}
+
+static void freeze_registry(Registry* reg) {
+    reg->ids = arena_allocate(&arena, reg->size * sizeof(ResourceID), ALLOC_TAG_UNKNOWN);
+    reg->data = arena_allocate(&arena, reg->size * reg->stride, ALLOC_TAG_UNKNOWN);
+    for (u32 i = 0; i < reg->size; i++) {
+        vect_get(&reg->names, i, &reg->ids[i]);
+        vect_get(&reg->entries, i, reg->data + i * reg->stride);
+    }
+
+    // Keep the dictionary in the very unlikely case where identifiers have the same hash.
+    if (!build_perfect_hash(reg)) {
+        log_warnf("Could not build the perfect hash table of registry '%s:%s'.",
+                  resid_namespace(reg->name).base,
+                  resid_path(reg->name).base);
+        return;
+    }
+
+    entrymap_destroy(&reg->map);
+    reg->frozen = TRUE;
 }
 
-void registry_register(ResourceID registry_name, ResourceID id, void* instance) {
-    Registry reg;
-    if (dict_get(&root.entries, &registry_name, &reg) < 0)
-        abort();
+void registry_freeze(void) {
+    if (frozen)
+        return;
+
+    u64 cursor = 0;
+    RegistryMap_slot* slot;
+    u32 count = 0;
+    while ((slot = regmap_next(&root, &cursor))) {
+        freeze_registry(slot->value);
+        count++;
+    }
+    frozen = TRUE;
+
+    log_debugf("Froze %u registries.", count);
+}
+
+const Registry* registry_get(ResourceID name) {
+    Registry** reg = regmap_ref(&root, &name);
+    return reg ? *reg : NULL;
+}
+
+u32 registry_size(const Registry* registry) {
+    return registry->size;
+}
+
+i64 registry_get_id(const Registry* registry, ResourceID id) {
+    if (!registry->frozen) {
+        u32* numeric_id = entrymap_ref(&registry->map, &id);
+        return numeric_id ? (i64) *numeric_id : -1;
+    }
+    if (registry->size == 0)
+        return -1;
+
+    const struct perfect_hash* phf = &registry->phf;
+    u64 hash = resid_hash(&id);
+    u32 displacement = phf->displacements[phf_bucket(phf, hash)];
+    u32 numeric_id = phf->slots[phf_position(hash, displacement, registry->size)];
+    return resid_equals(&registry->ids[numeric_id], &id) ? (i64) numeric_id : -1;
+}
+
+const void* registry_get_entry(const Registry* registry, u32 numeric_id) {
+    if (numeric_id >= registry->size)
+        return NULL;
+    if (!registry->frozen)
+        return vect_ref(&registry->entries, numeric_id);
+    return registry->data + numeric_id * registry->stride;
+}
+
+bool registry_get_name(const Registry* registry, u32 numeric_id, ResourceID* out_id) {
+    if (numeric_id >= registry->size)
+        return FALSE;
+    if (!registry->frozen)
+        return vect_get(&registry->names, numeric_id, out_id);
+    *out_id = registry->ids[numeric_id];
+    return TRUE;
+}
 
-    dict_put(&reg.entries, &id, instance);
+const void* registry_lookup(const Registry* registry, ResourceID id) {
+    i64 numeric_id = registry_get_id(registry, id);
+    if (numeric_id < 0)
+        return NULL;
+    return registry_get_entry(registry, numeric_id);
 }
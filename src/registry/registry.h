@@ -1,14 +1,106 @@
+/**
+ * @file
+ *
+ * Registries of game resources (blocks, items, biomes, ...).
+ *
+ * Registries are created and filled while bootstrapping the server, then frozen with
+ * @ref registry_freeze. Frozen registries are read-only: they can be read from any thread
+ * without locking, and their lookups use a perfect hash table.
+ *
+ * Each entry of a registry has a numeric ID, the index at which it was registered. These IDs are
+ * the ones used by the network protocol, and getting an entry from its ID is an array access.
+ */
 #ifndef REGISTRY_H
 #define REGISTRY_H
 
 #include "definitions.h"
 #include "resource/resource_id.h"
 
+typedef struct registry Registry;
+
 void registry_system_init(void);
 void registry_system_cleanup(void);
 
+/**
+ * Creates a new registry.
+ *
+ * @param name The name of the registry.
+ * @param stride The size (in bytes) of the entries of the registry.
+ * @return @ref TRUE if the registry was created, @ref FALSE if registries are frozen or a registry
+ * with the same name exists.
+ */
 bool registry_create(ResourceID name, u64 stride);
 
-void registry_register(ResourceID registry_name, ResourceID id, void* instance);
+/**
+ * Adds an entry to a registry.
+ *
+ * The entry is copied, and gets the next numeric ID of the registry.
+ *
+ * @param registry_name The name of the registry.
+ * @param id The identifier of the entry.
+ * @param[in] instance The entry to copy.
+ * @return @ref TRUE if the entry was added, @ref FALSE if registries are frozen, the registry does
+ * not exist, or an entry with the same identifier exists.
+ */
+bool registry_register(ResourceID registry_name, ResourceID id, void* instance);
+
+/**
+ * Freezes all registries.
+ *
+ * Each registry is compacted into a contiguous array of entries, indexed by numeric IDs, and a
+ * minimal perfect hash table mapping identifiers to numeric IDs.
+ * Afterwards, registries can not be created or modified anymore.
+ */
+void registry_freeze(void);
+
+/**
+ * Gets a registry.
+ *
+ * @param name The name of the registry.
+ * @return The registry, or `NULL` if no registry has this name.
+ */
+const Registry* registry_get(ResourceID name);
+
+/**
+ * Gets the number of entries of a registry.
+ */
+u32 registry_size(const Registry* registry);
+
+/**
+ * Gets the numeric ID of an entry.
+ *
+ * @param[in] registry The registry.
+ * @param id The identifier of the entry.
+ * @return The numeric ID of the entry, or `-1` if the registry has no such entry.
+ */
+i64 registry_get_id(const Registry* registry, ResourceID id);
+
+/**
+ * Gets an entry from its numeric ID.
+ *
+ * @param[in] registry The registry.
+ * @param numeric_id The numeric ID of the entry.
+ * @return A pointer to the entry, or `NULL` if @p numeric_id is out of bounds.
+ */
+const void* registry_get_entry(const Registry* registry, u32 numeric_id);
+
+/**
+ * Gets the identifier of an entry from its numeric ID.
+ *
+ * @param[in] registry The registry.
+ * @param numeric_id The numeric ID of the entry.
+ * @param[out] out_id The identifier of the entry.
+ * @return @ref TRUE if the entry exists, @ref FALSE if @p numeric_id is out of bounds.
+ */
+bool registry_get_name(const Registry* registry, u32 numeric_id, ResourceID* out_id);
+
+/**
+ * Gets an entry from its identifier.
+ *
+ * @param[in] registry The registry.
+ * @param id The identifier of the entry.
+ * @return A pointer to the entry, or `NULL` if the registry has no such entry.
+ */
+const void* registry_lookup(const Registry* registry, ResourceID id);
 
 #endif /* ! REGISTRY_H */
@@ -1,24 +1,42 @@
 #include "resource_id.h"
+#include "utils/hash.h"
 #include "utils/string.h"
 
-ResourceID resid_create(const string* namespace, const string* path, Arena* arena) {
+#define DEFAULT_NAMESPACE "minecraft"
+
+ResourceID resid_create(const string* namespace, const string* path) {
     return (ResourceID){
-        .namespace = str_create_copy(namespace, arena),
-        .path      = str_create_copy(path, arena),
+        .namespace = intern(namespace),
+        .path      = intern(path),
     };
 }
 
-ResourceID resid_default(const string* path, Arena* arena) {
+ResourceID resid_default(const string* path) {
     return (ResourceID){
-        .namespace = str_create_view("minecraft"),
-        .path      = str_create_copy(path, arena),
+        .namespace = intern_cstr(DEFAULT_NAMESPACE),
+        .path      = intern(path),
     };
 }
 
 ResourceID resid_default_cstr(const char* path) {
     return (ResourceID){
-        .namespace = str_create_view("minecraft"),
-        .path      = str_create_view(path),
+        .namespace = intern_cstr(DEFAULT_NAMESPACE),
+        .path      = intern_cstr(path),
     };
 }
 
+string resid_namespace(ResourceID id) {
+    return intern_string(id.namespace);
+}
+
+string resid_path(ResourceID id) {
+    return intern_string(id.path);
+}
+
+u64 resid_hash(const ResourceID* id) {
+    return hash_u64(((u64) id->namespace << 32) | id->path);
+}
+
+bool resid_equals(const ResourceID* lhs, const ResourceID* rhs) {
+    return lhs->namespace == rhs->namespace && lhs->path == rhs->path;
+}
@@ -1,15 +1,39 @@
 #ifndef RESOURCE_ID_H
 #define RESOURCE_ID_H
 
+#include "utils/intern.h"
 #include "utils/string.h"
 
+/**
+ * Identifier of a resource, made of a namespace and a path (`namespace:path`).
+ *
+ * Both parts are interned strings, so resource IDs are compared and hashed as integers.
+ */
 typedef struct resid {
-    string namespace;
-    string path;
+    InternID namespace;
+    InternID path;
 } ResourceID;
 
-ResourceID resid_create(const string* namespace, const string* path, Arena* arena);
-ResourceID resid_default(const string* path, Arena* arena);
+ResourceID resid_create(const string* namespace, const string* path);
+ResourceID resid_default(const string* path);
 ResourceID resid_default_cstr(const char* path);
 
+/**
+ * Gets the namespace of a resource ID.
+ */
+string resid_namespace(ResourceID id);
+/**
+ * Gets the path of a resource ID.
+ */
+string resid_path(ResourceID id);
+
+/**
+ * Hashes a resource ID, using the handles of its namespace and path.
+ */
+u64 resid_hash(const ResourceID* id);
+/**
+ * Checks whether two resource IDs have the same namespace and path.
+ */
+bool resid_equals(const ResourceID* lhs, const ResourceID* rhs);
+
 #endif /* ! RESOURCE_ID_H */
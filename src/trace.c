@@ -0,0 +1,281 @@
+#include "trace.h"
+
+#include "data/json.h"
+#include "logger.h"
+#include "memory/arena.h"
+#include "memory/dyn_arena.h"
+#include "memory/mem_tags.h"
+#include "platform/mc_mutex.h"
+#include "platform/mc_thread.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+/** Room for the spans of a ring, and the JSON of a single span. */
+#define TRACE_THREAD_NAME_SIZE 16
+
+/**
+ * A recorded span.
+ *
+ * Fields are atomic because the dumping thread may read a span while its thread overwrites it.
+ */
+typedef struct TraceSpan {
+    _Atomic(const char*) name;
+    _Atomic u64 start;
+    _Atomic u64 duration;
+} TraceSpan;
+
+typedef struct TraceSpanCopy {
+    const char* name;
+    u64 start;
+    u64 duration;
+} TraceSpanCopy;
+
+/**
+ * Spans of a single thread. Only this thread writes into it.
+ *
+ * `reserved` is incremented before a span is written, `committed` after, so a dump can tell
+ * which spans it copied were overwritten meanwhile.
+ */
+typedef struct TraceRing {
+    TraceSpan spans[TRACE_RING_CAPACITY];
+    _Atomic u64 reserved;
+    _Atomic u64 committed;
+    char thread_name[TRACE_THREAD_NAME_SIZE];
+} TraceRing;
+
+_Atomic bool trace_active;
+
+static struct {
+    Arena arena;
+    /**
+     * Rings are kept until the tracing system is cleaned up, so spans of exited threads can still
+     * be dumped. `NULL` before tracing starts.
+     */
+    TraceRing* rings;
+    _Atomic u32 ring_count;
+    /** Incremented each time tracing starts, to invalidate the rings cached by threads. */
+    _Atomic u32 generation;
+    u64 start_time;
+    const char* path;
+    MCMutex dump_mutex;
+} ctx;
+
+static _Thread_local TraceRing* local_ring;
+static _Thread_local u32 local_generation;
+/** Set if the thread could not get a ring. */
+static _Thread_local bool untraced;
+
+bool trace_start(const char* path) {
+    if (atomic_load_explicit(&trace_active, memory_order_relaxed))
+        return TRUE;
+    // Threads may still record into the rings of a stopped trace, they cannot be replaced yet.
+    if (ctx.rings) {
+        log_error("Tracing cannot be restarted before the tracing system is cleaned up.");
+        return FALSE;
+    }
+
+    ctx.arena = arena_create_reserved(
+        (u64) TRACE_MAX_THREADS * sizeof(TraceRing), BLK_TAG_UNKNOWN, FALSE);
+    ctx.rings = arena_callocate(
+        &ctx.arena, (u64) TRACE_MAX_THREADS * sizeof(TraceRing), ALLOC_TAG_UNKNOWN);
+    if (!ctx.rings) {
+        log_error("Could not allocate the trace rings.");
+        arena_destroy(&ctx.arena);
+        return FALSE;
+    }
+    atomic_init(&ctx.ring_count, 0);
+    mcmutex_create(&ctx.dump_mutex);
+    ctx.path       = path;
+    ctx.start_time = get_monotonic_ns();
+    atomic_fetch_add_explicit(&ctx.generation, 1, memory_order_relaxed);
+    atomic_store_explicit(&trace_active, TRUE, memory_order_release);
+    log_infof("Tracing spans, written to '%s' on SIGUSR1 and at exit.", path);
+    return TRUE;
+}
+
+static TraceRing* take_ring(void) {
+    u32 generation = atomic_load_explicit(&ctx.generation, memory_order_relaxed);
+    if (local_generation == generation) {
+        return untraced ? NULL : local_ring;
+    }
+    local_generation = generation;
+    local_ring       = NULL;
+    untraced         = FALSE;
+
+    u32 index = atomic_fetch_add_explicit(&ctx.ring_count, 1, memory_order_relaxed);
+    if (index >= TRACE_MAX_THREADS) {
+        atomic_fetch_sub_explicit(&ctx.ring_count, 1, memory_order_relaxed);
+        untraced = TRUE;
+        return NULL;
+    }
+
+    TraceRing* ring = &ctx.rings[index];
+    if (!mcthread_get_name(ring->thread_name, sizeof ring->thread_name))
+        snprintf(ring->thread_name, sizeof ring->thread_name, "thread %u", index);
+    local_ring = ring;
+    return ring;
+}
+
+void _trace_record(const char* name, u64 start) {
+    u64 end         = get_monotonic_ns();
+    TraceRing* ring = take_ring();
+    if (!ring)
+        return;
+
+    u64 index = atomic_load_explicit(&ring->reserved, memory_order_relaxed);
+    atomic_store_explicit(&ring->reserved, index + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    TraceSpan* span = &ring->spans[index % TRACE_RING_CAPACITY];
+    atomic_store_explicit(&span->name, name, memory_order_relaxed);
+    atomic_store_explicit(&span->start, start, memory_order_relaxed);
+    atomic_store_explicit(&span->duration, end - start, memory_order_relaxed);
+    atomic_store_explicit(&ring->committed, index + 1, memory_order_release);
+}
+
+/**
+ * Copies the spans of a ring which were not overwritten while they were copied.
+ *
+ * @return The number of copied spans.
+ */
+static u64 copy_spans(TraceRing* ring, TraceSpanCopy* out) {
+    u64 end   = atomic_load_explicit(&ring->committed, memory_order_acquire);
+    u64 begin = end > TRACE_RING_CAPACITY ? end - TRACE_RING_CAPACITY : 0;
+    for (u64 i = begin; i < end; i++) {
+        TraceSpan* span = &ring->spans[i % TRACE_RING_CAPACITY];
+        out[i - begin]  = (TraceSpanCopy){
+             .name     = atomic_load_explicit(&span->name, memory_order_relaxed),
+             .start    = atomic_load_explicit(&span->start, memory_order_relaxed),
+             .duration = atomic_load_explicit(&span->duration, memory_order_relaxed),
+        };
+    }
+    atomic_thread_fence(memory_order_acquire);
+
+    // Spans before `overwritten` may have been replaced while being copied.
+    u64 reserved    = atomic_load_explicit(&ring->reserved, memory_order_relaxed);
+    u64 overwritten = reserved > TRACE_RING_CAPACITY ? reserved - TRACE_RING_CAPACITY : 0;
+    if (overwritten <= begin)
+        return end - begin;
+    if (overwritten >= end)
+        return 0;
+    memmove(out, out + (overwritten - begin), (end - overwritten) * sizeof *out);
+    return end - overwritten;
+}
+
+/** Chrome trace timestamps are in microseconds. */
+static f64 to_trace_time(u64 timestamp) {
+    return (f64) (timestamp - ctx.start_time) / 1000.0;
+}
+
+static void put_int(JSON* json, JSONNode* obj, const char* name, i64 value) {
+    json_set_int(json_node_put(json, obj, name, JSON_INT), value);
+}
+
+static void put_str(JSON* json, JSONNode* obj, const char* name, const char* value) {
+    json_set_cstr(json, json_node_put(json, obj, name, JSON_STRING), value);
+}
+
+/**
+ * Writes a single trace event, built by the caller in @p json.
+ */
+static void write_event(FILE* file, JSON* json, DynamicArena* arena, bool first) {
+    string text;
+    json_stringify(json, &text, arena);
+    if (!first)
+        fputc(',', file);
+    fwrite(text.base, 1, text.length, file);
+    json_destroy(json);
+}
+
+static void write_thread(FILE* file, DynamicArena* arena, u32 tid, TraceRing* ring, bool first) {
+    DynamicArenaSave save = dynarena_save(arena);
+    JSON json;
+    json_create(&json, arena);
+    json_set_root(&json, json_node_create(&json, JSON_OBJECT));
+    put_str(&json, json.root, "name", "thread_name");
+    put_str(&json, json.root, "ph", "M");
+    put_int(&json, json.root, "pid", get_process_id());
+    put_int(&json, json.root, "tid", tid);
+    JSONNode* args = json_node_put(&json, json.root, "args", JSON_OBJECT);
+    put_str(&json, args, "name", ring->thread_name);
+    write_event(file, &json, arena, first);
+    dynarena_restore(arena, save);
+}
+
+static void write_span(FILE* file, DynamicArena* arena, u32 tid, const TraceSpanCopy* span) {
+    DynamicArenaSave save = dynarena_save(arena);
+    JSON json;
+    json_create(&json, arena);
+    json_set_root(&json, json_node_create(&json, JSON_OBJECT));
+    put_str(&json, json.root, "name", span->name);
+    put_str(&json, json.root, "ph", "X");
+    json_set_double(json_node_put(&json, json.root, "ts", JSON_FLOAT), to_trace_time(span->start));
+    json_set_double(json_node_put(&json, json.root, "dur", JSON_FLOAT), span->duration / 1000.0);
+    put_int(&json, json.root, "pid", get_process_id());
+    put_int(&json, json.root, "tid", tid);
+    write_event(file, &json, arena, FALSE);
+    dynarena_restore(arena, save);
+}
+
+bool trace_dump(void) {
+    if (!atomic_load_explicit(&trace_active, memory_order_acquire))
+        return FALSE;
+
+    mcmutex_lock(&ctx.dump_mutex);
+    FILE* file = fopen(ctx.path, "w");
+    if (!file) {
+        log_errorf("Could not open the trace file '%s': %s.", ctx.path, strerror(errno));
+        mcmutex_unlock(&ctx.dump_mutex);
+        return FALSE;
+    }
+
+    DynamicArena arena   = dynarena_create(BLK_TAG_UNKNOWN);
+    TraceSpanCopy* spans = dynarena_allocate(
+        &arena, TRACE_RING_CAPACITY * sizeof(TraceSpanCopy), ALLOC_TAG_UNKNOWN);
+
+    // Each event is built and written on its own, so dumps need little memory.
+    fputs("{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n", file);
+    u32 ring_count = atomic_load_explicit(&ctx.ring_count, memory_order_relaxed);
+    if (ring_count > TRACE_MAX_THREADS)
+        ring_count = TRACE_MAX_THREADS;
+    u64 span_count = 0;
+    for (u32 i = 0; i < ring_count; i++) {
+        TraceRing* ring = &ctx.rings[i];
+        u64 count       = copy_spans(ring, spans);
+        write_thread(file, &arena, i + 1, ring, i == 0);
+        for (u64 j = 0; j < count; j++) {
+            write_span(file, &arena, i + 1, &spans[j]);
+        }
+        span_count += count;
+    }
+    fputs("]}\n", file);
+
+    bool success = !ferror(file);
+    fclose(file);
+    dynarena_destroy(&arena);
+    mcmutex_unlock(&ctx.dump_mutex);
+
+    if (success)
+        log_infof("Wrote %zu spans of %u threads to '%s'.", (size_t) span_count, ring_count, ctx.path);
+    else
+        log_errorf("Could not write the trace file '%s'.", ctx.path);
+    return success;
+}
+
+void trace_stop(void) {
+    if (!atomic_load_explicit(&trace_active, memory_order_relaxed))
+        return;
+    trace_dump();
+    atomic_store_explicit(&trace_active, FALSE, memory_order_relaxed);
+}
+
+void trace_system_cleanup(void) {
+    trace_stop();
+    if (!ctx.rings)
+        return;
+    mcmutex_destroy(&ctx.dump_mutex);
+    arena_destroy(&ctx.arena);
+    ctx.rings = NULL;
+}
@@ -0,0 +1,102 @@
+/**
+ * @file trace.h
+ * @author Bastien Morino
+ *
+ * @brief Span tracing across threads.
+ *
+ * A @ref TRACE_SCOPE records how long the enclosing block took. Each thread records its spans into
+ * its own ring, without locks, which keeps the last @ref TRACE_RING_CAPACITY spans of the thread.
+ * Rings are dumped on demand, in the Chrome trace event format, to a JSON file that
+ * `chrome://tracing` and Perfetto (https://ui.perfetto.dev) can open.
+ *
+ * While tracing is disabled, entering a scope costs a load and a branch, and leaving it a test
+ * of a local variable.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "definitions.h"
+
+#include "platform/platform.h"
+
+#include <stdatomic.h>
+
+/** Number of spans kept by each thread. */
+#define TRACE_RING_CAPACITY 4096
+/** Number of threads which can record spans. Others are not traced. */
+#define TRACE_MAX_THREADS 32
+
+/**
+ * Whether spans are recorded. Only written by @ref trace_start and @ref trace_stop.
+ */
+extern _Atomic bool trace_active;
+
+/**
+ * A span being recorded.
+ */
+typedef struct TraceScope {
+    const char* name;
+    /** Start timestamp, or 0 if tracing was disabled when the scope was entered. */
+    u64 start;
+} TraceScope;
+
+#define _TRACE_CONCAT(a, b) a##b
+#define _TRACE_SCOPE_VAR(line) _TRACE_CONCAT(_trace_scope_, line)
+
+/**
+ * Records a span from this point to the end of the enclosing block.
+ *
+ * @param span_name The name of the span. Must be a string literal.
+ */
+#define TRACE_SCOPE(span_name)                                                                     \
+    __attribute__((cleanup(_trace_scope_end))) TraceScope _TRACE_SCOPE_VAR(__LINE__) = {           \
+        .name  = (span_name),                                                                      \
+        .start = __builtin_expect(atomic_load_explicit(&trace_active, memory_order_relaxed), 0)    \
+                     ? get_monotonic_ns()                                                          \
+                     : 0,                                                                          \
+    }
+
+void _trace_record(const char* name, u64 start);
+
+static inline void _trace_scope_end(TraceScope* scope) {
+    if (__builtin_expect(scope->start != 0, 0))
+        _trace_record(scope->name, scope->start);
+}
+
+/**
+ * Starts recording spans.
+ *
+ * Once stopped, tracing can only be started again after @ref trace_system_cleanup.
+ *
+ * @param path The file written by @ref trace_dump. Must stay valid until the tracing system is
+ * cleaned up.
+ * @return @ref TRUE if tracing started, or was already started.
+ */
+bool trace_start(const char* path);
+
+/**
+ * Writes the spans kept by all threads to the trace file, overwriting it.
+ *
+ * Threads keep recording spans meanwhile. Does nothing if tracing was not started.
+ *
+ * @return @ref TRUE if the file was written.
+ */
+bool trace_dump(void);
+
+/**
+ * Dumps the spans a last time and stops tracing.
+ *
+ * Scopes entered before tracing stopped are still recorded when they end, so the rings are kept
+ * until @ref trace_system_cleanup.
+ */
+void trace_stop(void);
+
+/**
+ * Stops tracing if needed, and frees the rings.
+ *
+ * Every thread which recorded spans, including the logger thread, must have exited.
+ */
+void trace_system_cleanup(void);
+
+#endif /* ! TRACE_H */
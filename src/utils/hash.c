@@ -1,19 +1,85 @@
 #include "hash.h"
+#include "platform/platform.h"
+
 #include <string.h>
+#include <time.h>
+
+// Value set by hash_set_seed(HASH_DEFAULT_SEED).
+u64 hash_mixed_seed = 0xd40c2e640a327deaULL;
+
+static u64 read64(const u8* p) {
+    u64 v;
+    memcpy(&v, p, sizeof v);
+    return v;
+}
+
+static u64 read32(const u8* p) {
+    u32 v;
+    memcpy(&v, p, sizeof v);
+    return v;
+}
+
+static u64 read_small(const u8* p, u64 size) {
+    return ((u64) p[0] << 16) | ((u64) p[size >> 1] << 8) | p[size - 1];
+}
+
+void hash_set_seed(u64 seed) {
+    hash_mixed_seed = seed ^ hash_mix(seed ^ HASH_SECRET0, HASH_SECRET1);
+}
+
+void hash_randomize_seed(void) {
+    // Addresses are randomized by ASLR, and the timers differ between runs.
+    u64 local;
+    u64 entropy = hash_mix((u64) &local ^ HASH_SECRET2, (u64) time(NULL) ^ HASH_SECRET3);
+    hash_set_seed(hash_mix(entropy, get_monotonic_ns() ^ HASH_SECRET0));
+}
 
-// Hash function used in sdbm
-// Adapted to work on arbitrary data
+// wyhash (final version 4), by Wang Yi, released in the public domain.
 u64 default_hash(const void* data, u64 size) {
-    const u8* bytes = data;
-    u64 hash = 37;
-    u8 b;
+    const u8* p = data;
+    u64 seed = hash_mixed_seed;
+    u64 a;
+    u64 b;
 
-    for (u64 i = 0; i < size; i++) {
-        b = bytes[i];
-        hash = b + (hash << 6) + (hash << 16) - hash;
+    if (size <= 16) {
+        if (size >= 4) {
+            u64 shift = (size >> 3) << 2;
+            a = (read32(p) << 32) | read32(p + shift);
+            b = (read32(p + size - 4) << 32) | read32(p + size - 4 - shift);
+        } else if (size > 0) {
+            a = read_small(p, size);
+            b = 0;
+        } else {
+            a = 0;
+            b = 0;
+        }
+    } else {
+        u64 i = size;
+        if (i > 48) {
+            u64 see1 = seed;
+            u64 see2 = seed;
+            do {
+                seed = hash_mix(read64(p) ^ HASH_SECRET1, read64(p + 8) ^ seed);
+                see1 = hash_mix(read64(p + 16) ^ HASH_SECRET2, read64(p + 24) ^ see1);
+                see2 = hash_mix(read64(p + 32) ^ HASH_SECRET3, read64(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16) {
+            seed = hash_mix(read64(p) ^ HASH_SECRET1, read64(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+        a = read64(p + i - 16);
+        b = read64(p + i - 8);
     }
 
-    return hash;
+    a ^= HASH_SECRET1;
+    b ^= seed;
+    hash_mum(&a, &b);
+    return hash_mix(a ^ HASH_SECRET0 ^ size, b ^ HASH_SECRET1);
 }
 
 i32 default_cmp(const void* lhs, const void* rhs, u64 size) {
@@ -1,3 +1,17 @@
+/**
+ * @file
+ *
+ * Hash functions and comparators.
+ *
+ * Hashing is done with a word-at-a-time hash of the wyhash family: keys are read 4 or 8 bytes
+ * at a time and mixed with 64x64 -> 128 bits multiplications.
+ * Fast paths are provided for keys of 4, 8 and 16 bytes, and give the same results as
+ * @ref default_hash on the corresponding bytes (in little-endian order).
+ *
+ * All hashes depend on a seed, fixed by default so hashes are reproducible between runs.
+ * It can be changed with @ref hash_set_seed or @ref hash_randomize_seed, but only before any hash
+ * is stored (e.g. in dictionaries).
+ */
 #ifndef HASH_H
 #define HASH_H
 
@@ -11,6 +25,82 @@ typedef struct {
     comparison_function comp;
 } Comparator;
 
+#define HASH_SECRET0 0xa0761d6478bd642fULL
+#define HASH_SECRET1 0xe7037ed1a0b428dbULL
+#define HASH_SECRET2 0x8ebc6af09c88c6e3ULL
+#define HASH_SECRET3 0x589965cc75374cc3ULL
+
+/** The default seed of hash functions. */
+#define HASH_DEFAULT_SEED 0x2d358dccaa6c78a5ULL
+
+/**
+ * The current seed, already mixed with the secrets. Use @ref hash_set_seed to change it.
+ */
+extern u64 hash_mixed_seed;
+
+/**
+ * Multiplies two 64-bit integers, and returns the 128-bit product in @p a (low bits) and @p b (high bits).
+ */
+static inline void hash_mum(u64* a, u64* b) {
+    __uint128_t r = (__uint128_t) *a * *b;
+    *a = (u64) r;
+    *b = (u64) (r >> 64);
+}
+
+/**
+ * Multiplies two 64-bit integers, and folds the 128-bit product into 64 bits.
+ */
+static inline u64 hash_mix(u64 a, u64 b) {
+    hash_mum(&a, &b);
+    return a ^ b;
+}
+
+static inline u64 hash_finish(u64 a, u64 b, u64 length) {
+    a ^= HASH_SECRET1;
+    b ^= hash_mixed_seed;
+    hash_mum(&a, &b);
+    return hash_mix(a ^ HASH_SECRET0 ^ length, b ^ HASH_SECRET1);
+}
+
+/**
+ * Hashes a 4-byte key.
+ */
+static inline u64 hash_u32(u32 key) {
+    u64 k = ((u64) key << 32) | key;
+    return hash_finish(k, k, sizeof(u32));
+}
+
+/**
+ * Hashes an 8-byte key.
+ */
+static inline u64 hash_u64(u64 key) {
+    u64 lo = (u32) key;
+    u64 hi = key >> 32;
+    return hash_finish((lo << 32) | hi, (hi << 32) | lo, sizeof(u64));
+}
+
+/**
+ * Hashes a 16-byte key, made of two 8-byte halves.
+ */
+static inline u64 hash_u128(u64 low, u64 high) {
+    return hash_finish(((low & 0xFFFFFFFF) << 32) | (high & 0xFFFFFFFF),
+                       ((high >> 32) << 32) | (low >> 32),
+                       2 * sizeof(u64));
+}
+
+/**
+ * Sets the seed of all hash functions.
+ *
+ * @param seed The new seed.
+ */
+void hash_set_seed(u64 seed);
+/**
+ * Sets the seed of all hash functions to a value specific to the current process.
+ *
+ * This makes the distribution of keys in hash tables unpredictable from outside of the process.
+ */
+void hash_randomize_seed(void);
+
 u64 default_hash(const void* data, u64 size);
 i32 default_cmp(const void* lhs, const void* rhs, u64 size);
 
@@ -0,0 +1,74 @@
+#include "histogram.h"
+
+#define SUB_BUCKET_BITS 3
+
+static u32 bucket_index(u64 value) {
+    if (value < HISTOGRAM_SUB_BUCKETS)
+        return value;
+
+    u32 exponent = 63 - __builtin_clzll(value);
+    if (exponent >= HISTOGRAM_MAX_EXPONENT)
+        return HISTOGRAM_BUCKETS - 1;
+
+    u32 sub_bucket = (value >> (exponent - SUB_BUCKET_BITS)) & (HISTOGRAM_SUB_BUCKETS - 1);
+    return (exponent - SUB_BUCKET_BITS + 1) * HISTOGRAM_SUB_BUCKETS + sub_bucket;
+}
+
+/**
+ * Gets the highest value counted in a bucket.
+ */
+static u64 bucket_upper_bound(u32 index) {
+    if (index < HISTOGRAM_SUB_BUCKETS)
+        return index;
+
+    u32 exponent = index / HISTOGRAM_SUB_BUCKETS + SUB_BUCKET_BITS - 1;
+    u64 sub_bucket = index % HISTOGRAM_SUB_BUCKETS;
+    u64 width = 1ull << (exponent - SUB_BUCKET_BITS);
+    return (1ull << exponent) + (sub_bucket + 1) * width - 1;
+}
+
+static void add_relaxed(_Atomic u64* counter, u64 value) {
+    atomic_store_explicit(
+        counter, atomic_load_explicit(counter, memory_order_relaxed) + value, memory_order_relaxed);
+}
+
+void histogram_record(Histogram* histogram, u64 value) {
+    add_relaxed(&histogram->buckets[bucket_index(value)], 1);
+    add_relaxed(&histogram->count, 1);
+    add_relaxed(&histogram->sum, value);
+    if (value > atomic_load_explicit(&histogram->max, memory_order_relaxed))
+        atomic_store_explicit(&histogram->max, value, memory_order_relaxed);
+}
+
+void histogram_merge(Histogram* dst, const Histogram* src) {
+    for (u32 i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        add_relaxed(&dst->buckets[i], atomic_load_explicit(&src->buckets[i], memory_order_relaxed));
+    }
+    add_relaxed(&dst->count, atomic_load_explicit(&src->count, memory_order_relaxed));
+    add_relaxed(&dst->sum, atomic_load_explicit(&src->sum, memory_order_relaxed));
+
+    u64 max = atomic_load_explicit(&src->max, memory_order_relaxed);
+    if (max > atomic_load_explicit(&dst->max, memory_order_relaxed))
+        atomic_store_explicit(&dst->max, max, memory_order_relaxed);
+}
+
+u64 histogram_percentile(const Histogram* histogram, f64 percentile) {
+    u64 count = atomic_load_explicit(&histogram->count, memory_order_relaxed);
+    if (count == 0)
+        return 0;
+
+    u64 max = atomic_load_explicit(&histogram->max, memory_order_relaxed);
+    u64 rank = (u64) (percentile / 100.0 * count + 0.5);
+    if (rank == 0)
+        rank = 1;
+
+    u64 seen = 0;
+    for (u32 i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        seen += atomic_load_explicit(&histogram->buckets[i], memory_order_relaxed);
+        if (seen >= rank) {
+            u64 value = bucket_upper_bound(i);
+            return value < max ? value : max;
+        }
+    }
+    return max;
+}
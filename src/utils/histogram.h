@@ -0,0 +1,64 @@
+/**
+ * @file histogram.h
+ * @author Bastien Morino
+ *
+ * Log-linear latency histograms, in the style of HDR histograms.
+ *
+ * Values are counted in buckets: each power of two is split in @ref HISTOGRAM_SUB_BUCKETS
+ * linear buckets, giving a relative precision of about 12% over the whole range.
+ * Values larger than the range are counted in the last bucket.
+ *
+ * Histograms are meant to be written by a single thread, and read by any thread:
+ * counters are atomic, but updates are not read-modify-write operations.
+ * To combine histograms written by several threads, merge them on read.
+ */
+
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include "definitions.h"
+
+#include <stdatomic.h>
+
+/** Number of linear buckets per power of two. */
+#define HISTOGRAM_SUB_BUCKETS 8
+/** Largest power of two with its own buckets. 2^36 nanoseconds is a bit more than a minute. */
+#define HISTOGRAM_MAX_EXPONENT 36
+/** Total number of buckets of a histogram. */
+#define HISTOGRAM_BUCKETS ((HISTOGRAM_MAX_EXPONENT - 2) * HISTOGRAM_SUB_BUCKETS)
+
+typedef struct Histogram {
+    _Atomic u64 buckets[HISTOGRAM_BUCKETS];
+    _Atomic u64 count;
+    _Atomic u64 sum;
+    _Atomic u64 max;
+} Histogram;
+
+/**
+ * Records a value in a histogram.
+ *
+ * Only the thread owning the histogram may call this function.
+ *
+ * @param histogram The histogram to record the value in.
+ * @param value The value to record.
+ */
+void histogram_record(Histogram* histogram, u64 value);
+
+/**
+ * Adds the values of a histogram to another one.
+ *
+ * @param[out] dst The histogram to add values to. It must not be written concurrently.
+ * @param[in] src The histogram to read values from. It may be written concurrently.
+ */
+void histogram_merge(Histogram* dst, const Histogram* src);
+
+/**
+ * Estimates a percentile of the values recorded in a histogram.
+ *
+ * @param[in] histogram The histogram.
+ * @param percentile The percentile, between 0 and 100.
+ * @return The estimated value, or 0 if the histogram is empty.
+ */
+u64 histogram_percentile(const Histogram* histogram, f64 percentile);
+
+#endif /* ! HISTOGRAM_H */
@@ -0,0 +1,182 @@
+#include "intern.h"
+#include "containers/_array_internal.h"
+#include "logger.h"
+#include "memory/arena.h"
+#include "memory/mem_tags.h"
+#include "platform/mc_mutex.h"
+#include "utils/hash.h"
+
+#include <stdatomic.h>
+#include <string.h>
+
+#define INTERN_ARENA_SIZE (256L << 20)
+#define INITIAL_CAPACITY 4096
+#define SEGMENT_BASE_LOG2 10
+
+/*
+  Interned strings are stored in a segmented array, so they never move, and the handle of a string
+  is its index in the array plus one.
+  Handles are found with an open-addressing table (linear probing, at most half full). Each slot
+  holds the highest 32 bits of the hash of a string and its handle, or 0 if it is empty.
+
+  Readers never lock: slots and the table pointer are published with release stores, after the
+  entry they refer to is written. When the table grows, a new table is published, and the old one
+  is kept until cleanup, as readers may still be using it.
+ */
+
+struct intern_entry {
+    u64 hash;
+    string str;
+};
+
+struct intern_table {
+    u64 capacity;
+    _Atomic u64 slots[];
+};
+
+static struct {
+    Arena arena;
+    MCMutex mutex;
+    _Atomic(struct intern_table*) table;
+    _Atomic(struct intern_entry*) segments[SEGMENT_MAX_COUNT];
+    _Atomic u32 count;
+} ctx;
+
+static struct intern_table* create_table(u64 capacity) {
+    struct intern_table* table = arena_callocate(
+        &ctx.arena, sizeof(struct intern_table) + capacity * sizeof(u64), ALLOC_TAG_DICT);
+    table->capacity = capacity;
+    return table;
+}
+
+void intern_system_init(void) {
+    // Interned strings live until the server stops, and lookups hit them all over the arena.
+    ctx.arena = arena_create_reserved(INTERN_ARENA_SIZE, BLK_TAG_REGISTRY, TRUE);
+    mcmutex_create(&ctx.mutex);
+    atomic_store(&ctx.table, create_table(INITIAL_CAPACITY));
+    for (u32 i = 0; i < SEGMENT_MAX_COUNT; i++) {
+        atomic_store(&ctx.segments[i], NULL);
+    }
+    atomic_store(&ctx.count, 0);
+
+    log_debug("Interning subsystem initialized.");
+}
+
+void intern_system_cleanup(void) {
+    mcmutex_destroy(&ctx.mutex);
+    arena_destroy(&ctx.arena);
+}
+
+static struct intern_entry* get_entry(InternID id) {
+    u64 local;
+    u32 segment = segment_of(id - 1, SEGMENT_BASE_LOG2, &local);
+    return &atomic_load_explicit(&ctx.segments[segment], memory_order_acquire)[local];
+}
+
+static u64 make_slot(u64 hash, InternID id) {
+    return (hash & 0xFFFFFFFF00000000) | id;
+}
+
+static InternID lookup(const struct intern_table* table, const string* str, u64 hash) {
+    u64 mask = table->capacity - 1;
+    for (u64 idx = hash & mask;; idx = (idx + 1) & mask) {
+        u64 slot = atomic_load_explicit(&table->slots[idx], memory_order_acquire);
+        if (slot == 0)
+            return INTERN_NONE;
+        if ((slot ^ hash) >> 32)
+            continue;
+
+        InternID id = (u32) slot;
+        const struct intern_entry* entry = get_entry(id);
+        if (entry->str.length == str->length && memcmp(entry->str.base, str->base, str->length) == 0)
+            return id;
+    }
+}
+
+static void place(struct intern_table* table, u64 hash, InternID id) {
+    u64 mask = table->capacity - 1;
+    u64 idx = hash & mask;
+    while (atomic_load_explicit(&table->slots[idx], memory_order_relaxed) != 0) {
+        idx = (idx + 1) & mask;
+    }
+    atomic_store_explicit(&table->slots[idx], make_slot(hash, id), memory_order_release);
+}
+
+static void grow(struct intern_table* table, u32 count) {
+    struct intern_table* new_table = create_table(table->capacity << 1);
+    for (InternID id = 1; id <= count; id++) {
+        place(new_table, get_entry(id)->hash, id);
+    }
+    atomic_store_explicit(&ctx.table, new_table, memory_order_release);
+}
+
+/**
+ * Adds a new string. Must be called with the mutex locked.
+ */
+static InternID insert(const string* str, u64 hash) {
+    u32 index = atomic_load_explicit(&ctx.count, memory_order_relaxed);
+    u64 local;
+    u32 segment = segment_of(index, SEGMENT_BASE_LOG2, &local);
+    struct intern_entry* entries = atomic_load_explicit(&ctx.segments[segment], memory_order_relaxed);
+    if (!entries) {
+        entries = arena_allocate(&ctx.arena,
+                                 segment_capacity(segment, SEGMENT_BASE_LOG2) * sizeof *entries,
+                                 ALLOC_TAG_DICT);
+        atomic_store_explicit(&ctx.segments[segment], entries, memory_order_release);
+    }
+
+    entries[local] = (struct intern_entry){
+        .hash = hash,
+        .str = str_create_from_buffer(str->base, str->length, &ctx.arena),
+    };
+    InternID id = index + 1;
+    atomic_store_explicit(&ctx.count, id, memory_order_release);
+
+    struct intern_table* table = atomic_load_explicit(&ctx.table, memory_order_relaxed);
+    if ((u64) id * 2 > table->capacity)
+        grow(table, id);
+    else
+        place(table, hash, id);
+    return id;
+}
+
+InternID intern(const string* str) {
+    u64 hash = default_hash(str->base, str->length);
+    InternID id = lookup(atomic_load_explicit(&ctx.table, memory_order_acquire), str, hash);
+    if (id != INTERN_NONE)
+        return id;
+
+    mcmutex_lock(&ctx.mutex);
+    // Another thread may have interned the string in the meantime.
+    id = lookup(atomic_load_explicit(&ctx.table, memory_order_relaxed), str, hash);
+    if (id == INTERN_NONE)
+        id = insert(str, hash);
+    mcmutex_unlock(&ctx.mutex);
+    return id;
+}
+
+InternID intern_cstr(const char* cstr) {
+    string str = str_create_view(cstr);
+    return intern(&str);
+}
+
+InternID intern_find(const string* str) {
+    u64 hash = default_hash(str->base, str->length);
+    return lookup(atomic_load_explicit(&ctx.table, memory_order_acquire), str, hash);
+}
+
+string intern_string(InternID id) {
+    if (id == INTERN_NONE || id > atomic_load_explicit(&ctx.count, memory_order_acquire))
+        return str_create_view("");
+    return get_entry(id)->str;
+}
+
+u64 intern_hash(InternID id) {
+    if (id == INTERN_NONE || id > atomic_load_explicit(&ctx.count, memory_order_acquire))
+        return 0;
+    return get_entry(id)->hash;
+}
+
+u32 intern_count(void) {
+    return atomic_load_explicit(&ctx.count, memory_order_acquire);
+}
@@ -0,0 +1,76 @@
+/**
+ * @file
+ *
+ * Interning of identifier strings.
+ *
+ * Interned strings are stored once, and identified by a stable 32-bit handle: two strings with the
+ * same contents always get the same handle. Handles can then be compared and hashed as integers.
+ * The hash of the contents of each interned string is also computed once and kept.
+ *
+ * Interned strings are never removed, so only strings from a bounded set should be interned
+ * (identifiers, resource IDs, ...), never arbitrary data received from clients.
+ *
+ * All functions can be called from any thread. Lookups of already interned strings do not take
+ * any lock; only interning a new string does.
+ */
+#ifndef INTERN_H
+#define INTERN_H
+
+#include "definitions.h"
+#include "utils/string.h"
+
+/**
+ * Handle of an interned string. `0` (@ref INTERN_NONE) is never a valid handle.
+ */
+typedef u32 InternID;
+
+#define INTERN_NONE 0
+
+void intern_system_init(void);
+void intern_system_cleanup(void);
+
+/**
+ * Interns a string.
+ *
+ * The contents of the string are copied if they were not interned yet.
+ *
+ * @param[in] str The string to intern.
+ * @return The handle of the interned string.
+ */
+InternID intern(const string* str);
+/**
+ * Interns a null-terminated string.
+ *
+ * @see intern
+ */
+InternID intern_cstr(const char* cstr);
+/**
+ * Gets the handle of a string, without interning it.
+ *
+ * @param[in] str The string to search.
+ * @return The handle of the string, or @ref INTERN_NONE if it was not interned.
+ */
+InternID intern_find(const string* str);
+
+/**
+ * Gets the contents of an interned string.
+ *
+ * The returned string is null-terminated, and valid until @ref intern_system_cleanup is called.
+ *
+ * @param id The handle of the interned string.
+ * @return The interned string, or an empty string if @p id is not a valid handle.
+ */
+string intern_string(InternID id);
+/**
+ * Gets the hash of the contents of an interned string, as computed by @ref default_hash.
+ *
+ * @param id The handle of the interned string.
+ * @return The hash of the interned string, or `0` if @p id is not a valid handle.
+ */
+u64 intern_hash(InternID id);
+/**
+ * Gets the number of interned strings.
+ */
+u32 intern_count(void);
+
+#endif /* ! INTERN_H */
@@ -0,0 +1,92 @@
+#include "memory/arena.h"
+
+#include "logger.h"
+#include "memory/mem_tags.h"
+
+#include <assert.h>
+#include <string.h>
+
+#define RESERVED_SIZE (64L << 20)
+#define LARGE_SIZE (16L << 20)
+
+static bool check(const u8* ptr, u64 size, u8 value) {
+    for (u64 i = 0; i < size; i++) {
+        if (ptr[i] != value)
+            return FALSE;
+    }
+    return TRUE;
+}
+
+static void test_commit_on_demand(void) {
+    Arena arena = arena_create_reserved(RESERVED_SIZE, BLK_TAG_UNKNOWN, FALSE);
+    assert(arena.block != NULL);
+    assert(arena.committed == 0);
+
+    u8* ptr = arena_allocate(&arena, 100, ALLOC_TAG_UNKNOWN);
+    memset(ptr, 1, 100);
+    assert(arena.committed >= 100);
+    assert(arena.committed % arena.granularity == 0);
+    assert(arena.committed < LARGE_SIZE);
+
+    arena_destroy(&arena);
+}
+
+static void test_restore_decommits(void) {
+    Arena arena = arena_create_reserved(RESERVED_SIZE, BLK_TAG_UNKNOWN, FALSE);
+    ArenaSave save = arena_save(&arena);
+
+    u8* ptr = arena_allocate(&arena, LARGE_SIZE, ALLOC_TAG_UNKNOWN);
+    memset(ptr, 0xAB, LARGE_SIZE);
+    assert(arena.committed >= LARGE_SIZE);
+
+    // Restoring gives most of the pages back, but keeps some for the next allocations.
+    arena_restore(&arena, save);
+    assert(arena.length == 0);
+    assert(arena.committed > 0);
+    assert(arena.committed < LARGE_SIZE);
+    u64 retained = arena.committed;
+
+    // Allocating again commits the pages back. Pages given back to the system are zeroed.
+    u8* again = arena_allocate(&arena, LARGE_SIZE, ALLOC_TAG_UNKNOWN);
+    assert(again == ptr);
+    assert(arena.committed >= LARGE_SIZE);
+    assert(check(again, retained, 0xAB));
+    assert(check(again + retained, LARGE_SIZE - retained, 0));
+    memset(again, 0xCD, LARGE_SIZE);
+    assert(check(again, LARGE_SIZE, 0xCD));
+
+    // Freeing a little memory keeps the pages committed.
+    save = arena_save(&arena);
+    arena_allocate(&arena, 4096, ALLOC_TAG_UNKNOWN);
+    u64 committed = arena.committed;
+    arena_restore(&arena, save);
+    assert(arena.committed == committed);
+
+    arena_destroy(&arena);
+}
+
+static void test_huge_pages(void) {
+    Arena arena = arena_create_reserved(RESERVED_SIZE, BLK_TAG_UNKNOWN, TRUE);
+    assert(arena.block != NULL);
+
+    // Memory is committed by whole huge pages.
+    u8* ptr = arena_allocate(&arena, 100, ALLOC_TAG_UNKNOWN);
+    memset(ptr, 1, 100);
+    assert(arena.committed >= 2L << 20);
+    assert(arena.committed % arena.granularity == 0);
+
+    arena_destroy(&arena);
+}
+
+int main(void) {
+    logger_system_init();
+    memory_stats_init();
+
+    test_commit_on_demand();
+    test_restore_decommits();
+    test_huge_pages();
+
+    memory_dump_stats();
+    logger_system_cleanup();
+    return 0;
+}
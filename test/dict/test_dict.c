@@ -0,0 +1,215 @@
+#include "containers/dict.h"
+#include "containers/dict_template.h"
+
+#include "logger.h"
+#include "memory/arena.h"
+#include "utils/hash.h"
+#include "utils/string.h"
+
+#include <assert.h>
+
+static void count_mappings(const Dict* dict, u64 idx, void* key, void* value, void* data) {
+    u64* count = data;
+    assert(idx == *count);
+    assert(idx < dict->size);
+    assert(*(u64*) value == *(u32*) key * 3);
+    (*count)++;
+}
+
+static void test_dynamic(void) {
+    Dict dict;
+    assert(dict_init(&dict, NULL, sizeof(u32), sizeof(u64)));
+
+    for (u32 i = 0; i < 10000; i++) {
+        u64 value = (u64) i * 3;
+        assert(dict_put(&dict, &i, &value) >= 0);
+    }
+    assert(dict.size == 10000);
+
+    // Replacing a value does not add a mapping.
+    u32 key = 42;
+    u64 value = 126;
+    assert(dict_put(&dict, &key, &value) >= 0);
+    assert(dict.size == 10000);
+
+    for (u32 i = 0; i < 10000; i++) {
+        u64 out;
+        i64 idx = dict_get(&dict, &i, &out);
+        assert(idx >= 0);
+        assert(out == (u64) i * 3);
+        assert(*(u64*) dict_ref(&dict, idx) == out);
+    }
+    key = 10000;
+    assert(dict_get(&dict, &key, NULL) == -1);
+
+    u64 count = 0;
+    dict_foreach(&dict, &count_mappings, &count);
+    assert(count == 10000);
+
+    // Remove odd keys, the remaining keys must still be found past tombstones.
+    for (u32 i = 1; i < 10000; i += 2) {
+        u64 out;
+        assert(dict_remove(&dict, &i, &out) >= 0);
+        assert(out == (u64) i * 3);
+        assert(dict_remove(&dict, &i, NULL) == -1);
+    }
+    assert(dict.size == 5000);
+    for (u32 i = 0; i < 10000; i++) {
+        assert((dict_get(&dict, &i, NULL) >= 0) == (i % 2 == 0));
+    }
+
+    // Shrinking keeps all mappings.
+    for (u32 i = 0; i < 9900; i += 2) {
+        assert(dict_remove(&dict, &i, NULL) >= 0);
+    }
+    assert(dict.size == 50);
+    for (u32 i = 9900; i < 10000; i += 2) {
+        assert(dict_get(&dict, &i, NULL) >= 0);
+    }
+
+    dict_destroy(&dict);
+}
+
+static void test_fixed(Arena* arena) {
+    Dict dict;
+    dict_init_fixed(&dict, NULL, arena, 100, sizeof(u32), sizeof(u64));
+
+    for (u32 i = 0; i < 100; i++) {
+        u64 value = (u64) i * 3;
+        assert(dict_put(&dict, &i, &value) >= 0);
+    }
+
+    // Churn: removing and adding keys leaves tombstones, which must be reclaimed.
+    for (u32 i = 100; i < 100000; i++) {
+        u32 old = i - 100;
+        assert(dict_remove(&dict, &old, NULL) >= 0);
+        u64 value = (u64) i * 3;
+        assert(dict_put(&dict, &i, &value) >= 0);
+    }
+    assert(dict.size == 100);
+    for (u32 i = 99900; i < 100000; i++) {
+        u64 out;
+        assert(dict_get(&dict, &i, &out) >= 0);
+        assert(out == (u64) i * 3);
+    }
+
+    // The table is full once it holds the maximum number of mappings it can contain.
+    u64 value = 0;
+    u32 key = 100000;
+    while (dict_put(&dict, &key, &value) >= 0) {
+        key++;
+    }
+    assert(dict.size >= 100);
+    assert(dict.size < dict.capacity);
+}
+
+static void test_strings(void) {
+    Dict dict;
+    assert(dict_init(&dict, &CMP_STRING, sizeof(string), sizeof(u64)));
+
+    const char* names[] = {"type", "name", "value", "description", "id", "children", "parent"};
+    for (u64 i = 0; i < sizeof names / sizeof *names; i++) {
+        string key = str_create_view(names[i]);
+        assert(dict_put(&dict, &key, &i) >= 0);
+    }
+    for (u64 i = 0; i < sizeof names / sizeof *names; i++) {
+        string key = str_create_view(names[i]);
+        u64 out;
+        assert(dict_get(&dict, &key, &out) >= 0);
+        assert(out == i);
+    }
+    string missing = str_create_view("nope");
+    assert(dict_get(&dict, &missing, NULL) == -1);
+
+    dict_destroy(&dict);
+}
+
+static inline u64 code_hash(const u32* code) {
+    return *code;
+}
+
+static inline bool code_equals(const u32* lhs, const u32* rhs) {
+    return *lhs == *rhs;
+}
+
+DICT_DEFINE(CodeMap, codemap, u32, u64, code_hash, code_equals)
+
+static void test_specialized(Arena* arena) {
+    CodeMap map;
+    codemap_init(&map);
+
+    for (u32 i = 0; i < 10000; i++) {
+        u64 value = (u64) i * 3;
+        assert(*codemap_put(&map, &i, &value) == value);
+    }
+    assert(map.size == 10000);
+    for (u32 i = 0; i < 10000; i += 2) {
+        u64 out;
+        assert(codemap_remove(&map, &i, &out));
+        assert(out == (u64) i * 3);
+    }
+    for (u32 i = 0; i < 10000; i++) {
+        u64* value = codemap_ref(&map, &i);
+        assert((value != NULL) == (i % 2 == 1));
+        assert(!value || *value == (u64) i * 3);
+    }
+
+    u64 cursor = 0;
+    u64 count = 0;
+    CodeMap_slot* slot;
+    while ((slot = codemap_next(&map, &cursor))) {
+        assert(slot->key % 2 == 1);
+        count++;
+    }
+    assert(count == 5000);
+    codemap_destroy(&map);
+
+    // Fixed maps reclaim tombstones.
+    codemap_init_fixed(&map, arena, 50);
+    for (u32 i = 0; i < 10000; i++) {
+        u64 value = i;
+        assert(codemap_put(&map, &i, &value));
+        if (i >= 50) {
+            u32 old = i - 50;
+            assert(codemap_remove(&map, &old, NULL));
+        }
+    }
+    assert(map.size == 50);
+}
+
+static void test_hash_fast_paths(void) {
+    u64 random = 0x9E3779B97F4A7C15;
+    for (u32 i = 0; i < 1000; i++) {
+        random ^= random << 13;
+        random ^= random >> 7;
+        random ^= random << 17;
+
+        u32 small = random;
+        assert(hash_u32(small) == default_hash(&small, sizeof small));
+        assert(hash_u64(random) == default_hash(&random, sizeof random));
+        u64 pair[2] = {random, ~random * 31};
+        assert(hash_u128(pair[0], pair[1]) == default_hash(pair, sizeof pair));
+    }
+    // Seeds change hashes.
+    u64 key = 42;
+    u64 hash = hash_u64(key);
+    hash_set_seed(1);
+    assert(hash_u64(key) != hash);
+    hash_set_seed(HASH_DEFAULT_SEED);
+    assert(hash_u64(key) == hash);
+}
+
+int main(void) {
+    logger_system_init();
+    Arena arena = arena_create(1 << 20, BLK_TAG_UNKNOWN);
+
+    test_hash_fast_paths();
+    test_dynamic();
+    test_fixed(&arena);
+    test_strings();
+    test_specialized(&arena);
+
+    arena_destroy(&arena);
+    logger_system_cleanup();
+    return 0;
+}
@@ -0,0 +1,105 @@
+#include "memory/dyn_arena.h"
+
+#include "logger.h"
+#include "memory/mem_tags.h"
+
+#include <assert.h>
+#include <string.h>
+
+static void fill(u8* ptr, u64 size, u8 value) {
+    memset(ptr, value, size);
+}
+
+static bool check(const u8* ptr, u64 size, u8 value) {
+    for (u64 i = 0; i < size; i++) {
+        if (ptr[i] != value)
+            return FALSE;
+    }
+    return TRUE;
+}
+
+static void test_growth(void) {
+    DynamicArena arena = dynarena_create(BLK_TAG_UNKNOWN);
+    assert(dynarena_allocate(&arena, 0, ALLOC_TAG_UNKNOWN) == NULL);
+
+    // Allocate far more than the smallest block, without ever running out of memory.
+    u8* ptrs[256];
+    for (u32 i = 0; i < 256; i++) {
+        ptrs[i] = dynarena_allocate(&arena, 4096, ALLOC_TAG_UNKNOWN);
+        assert(ptrs[i] != NULL);
+        fill(ptrs[i], 4096, i);
+    }
+    for (u32 i = 0; i < 256; i++) {
+        assert(check(ptrs[i], 4096, i));
+    }
+    assert(arena.length == 256 * 4096);
+
+    // Allocations larger than the largest size class.
+    u64 huge = (u64) DYNARENA_MIN_BLOCK_SIZE << DYNARENA_SIZE_CLASSES;
+    u8* big = dynarena_allocate(&arena, huge, ALLOC_TAG_UNKNOWN);
+    fill(big, huge, 0xAB);
+    assert(check(ptrs[255], 4096, 255));
+
+    dynarena_destroy(&arena);
+    assert(arena.current == NULL);
+    assert(arena.length == 0);
+}
+
+static void test_save_restore(void) {
+    DynamicArena arena = dynarena_create(BLK_TAG_UNKNOWN);
+
+    u8* first = dynarena_allocate(&arena, 100, ALLOC_TAG_UNKNOWN);
+    fill(first, 100, 1);
+
+    DynamicArenaSave outer = dynarena_save(&arena);
+    dynarena_allocate(&arena, DYNARENA_MIN_BLOCK_SIZE, ALLOC_TAG_UNKNOWN);
+
+    DynamicArenaSave inner = dynarena_save(&arena);
+    u8* crossing = dynarena_allocate(&arena, 4 * DYNARENA_MIN_BLOCK_SIZE, ALLOC_TAG_UNKNOWN);
+    fill(crossing, 4 * DYNARENA_MIN_BLOCK_SIZE, 2);
+
+    // Nested restore across a block boundary.
+    dynarena_restore(&arena, inner);
+    assert(arena.length == inner.length);
+    assert(arena.current == inner.block);
+
+    dynarena_restore(&arena, outer);
+    assert(arena.length == outer.length);
+    assert(arena.current == outer.block);
+
+    // Memory allocated after a restore starts where the saved position was.
+    u8* second = dynarena_allocate(&arena, 8, ALLOC_TAG_UNKNOWN);
+    assert(second == first + 104);
+    assert(check(first, 100, 1));
+
+    dynarena_free_ptr(&arena, second);
+    assert(arena.length == outer.length);
+
+    dynarena_destroy(&arena);
+}
+
+static void test_block_cache(void) {
+    DynamicArena arena = dynarena_create(BLK_TAG_UNKNOWN);
+    u8* ptr = dynarena_allocate(&arena, 16, ALLOC_TAG_UNKNOWN);
+    dynarena_destroy(&arena);
+
+    // The freed block is reused by the next arena.
+    DynamicArena other = dynarena_create(BLK_TAG_UNKNOWN);
+    assert(dynarena_allocate(&other, 16, ALLOC_TAG_UNKNOWN) == ptr);
+    dynarena_destroy(&other);
+
+    dynarena_cache_cleanup();
+}
+
+int main(void) {
+    logger_system_init();
+    memory_stats_init();
+
+    test_growth();
+    test_save_restore();
+    test_block_cache();
+
+    memory_dump_stats();
+    logger_system_cleanup();
+    return 0;
+}
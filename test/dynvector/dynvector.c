@@ -38,11 +38,45 @@ static void test1(void) {
     arena_destroy(&arena);
 }
 
+static void test_segments(void) {
+    Arena arena = arena_create(1 << 20, BLK_TAG_UNKNOWN);
+
+    Vector vector;
+    vect_init_dynamic(&vector, &arena, 3, sizeof(u32));
+
+    for (u32 i = 0; i < 1000; i++) {
+        vect_add_imm(&vector, i, u32);
+    }
+    u32* first = vect_ref(&vector, 0);
+
+    // Insert and remove elements in the first segment, shifting elements across all segments.
+    vect_insert_imm(&vector, 5000, 1, u32);
+    assert(vect_size(&vector) == 1001);
+    assert(*(u32*) vect_ref(&vector, 1) == 5000);
+    for (u32 i = 2; i < 1001; i++) {
+        assert(*(u32*) vect_ref(&vector, i) == i - 1);
+    }
+
+    u32 num;
+    assert(vect_remove(&vector, 1, &num));
+    assert(num == 5000);
+    for (u32 i = 0; i < 1000; i++) {
+        assert(*(u32*) vect_ref(&vector, i) == i);
+    }
+
+    // Growing never moves elements.
+    assert(vect_ref(&vector, 0) == first);
+    assert(vect_peek(&vector, &num) && num == 999);
+
+    arena_destroy(&arena);
+}
+
 int main(void) {
 
     logger_system_init();
 
     test1();
+    test_segments();
 
     logger_system_cleanup();
     
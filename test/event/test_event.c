@@ -0,0 +1,334 @@
+#include "event/event.h"
+
+#include "containers/mpsc_queue.h"
+#include "logger.h"
+#include "memory/arena.h"
+#include "platform/mc_thread.h"
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+
+#define PRODUCER_COUNT 4
+#define EVENTS_PER_PRODUCER 20000
+
+#define TEST_EVENT 1
+#define OTHER_EVENT 2
+#define FAN_OUT_EVENT 3
+#define PAYLOAD_EVENT 4
+/** More than the capacity of the event queue. */
+#define FAN_OUT_COUNT 10000
+
+typedef struct Received {
+    u64 next[PRODUCER_COUNT];
+    u64 total;
+    u64 other;
+} Received;
+
+/** State of listeners running outside of the event handling thread. */
+typedef struct AsyncReceived {
+    u64 next[PRODUCER_COUNT];
+    _Atomic u64 total;
+    pthread_t thread;
+} AsyncReceived;
+
+static pthread_t main_thread;
+
+static void test_queue(void) {
+    Arena arena = arena_create(1 << 16, BLK_TAG_UNKNOWN);
+    MPSCQueue queue = mpscq_create(5, sizeof(u64), &arena);
+    assert(queue.mask == 7);
+    assert(mpscq_is_empty(&queue));
+
+    // Several laps, to check that cells are handed back to producers.
+    u64 next_in = 0;
+    u64 next_out = 0;
+    for (u32 lap = 0; lap < 10; lap++) {
+        while (mpscq_try_enqueue(&queue, &next_in))
+            next_in++;
+        assert(next_in - next_out == 8);
+
+        u64 values[3];
+        assert(mpscq_dequeue_batch(&queue, values, 3) == 3);
+        for (u32 i = 0; i < 3; i++) {
+            assert(values[i] == next_out++);
+        }
+        u64 value;
+        while (mpscq_dequeue(&queue, &value))
+            assert(value == next_out++);
+        assert(mpscq_is_empty(&queue));
+        assert(next_in == next_out);
+    }
+
+    arena_destroy(&arena);
+}
+
+static bool on_test_event(u32 event, void* user_data, EventInfo info) {
+    assert(event == TEST_EVENT);
+    Received* received = user_data;
+    u64 producer = info.event_data.u64[0];
+    // Events of the same producer are dispatched in order.
+    assert(info.event_data.u64[1] == received->next[producer]);
+    received->next[producer]++;
+    received->total++;
+    return TRUE;
+}
+
+static bool on_other_event(u32 event, void* user_data, EventInfo info) {
+    (void) info;
+    assert(event == OTHER_EVENT);
+    ((Received*) user_data)->other++;
+    return TRUE;
+}
+
+static void* produce(void* arg) {
+    EventInfo info = {0};
+    info.event_data.u64[0] = (u64) arg;
+    info.key = (u64) arg + 1;
+    for (u64 i = 0; i < EVENTS_PER_PRODUCER; i++) {
+        info.event_data.u64[1] = i;
+        event_trigger(TEST_EVENT, info);
+        if (i % 1000 == 0)
+            event_trigger(OTHER_EVENT, info);
+    }
+    return NULL;
+}
+
+static void* run_producers(void* arg) {
+    (void) arg;
+    MCThread threads[PRODUCER_COUNT];
+    for (u64 i = 0; i < PRODUCER_COUNT; i++) {
+        mcthread_create(&threads[i], &produce, (void*) i);
+    }
+    for (u64 i = 0; i < PRODUCER_COUNT; i++) {
+        mcthread_join(&threads[i], NULL);
+    }
+    event_trigger(BEVENT_STOP, (EventInfo){0});
+    return NULL;
+}
+
+static bool on_worker_event(u32 event, void* user_data, EventInfo info) {
+    assert(event == TEST_EVENT);
+    assert(!pthread_equal(pthread_self(), main_thread));
+    AsyncReceived* received = user_data;
+    u64 producer = info.event_data.u64[0];
+    // Events with the same key are handled in order, by the same worker.
+    assert(info.event_data.u64[1] == received->next[producer]);
+    received->next[producer]++;
+    atomic_fetch_add(&received->total, 1);
+    return TRUE;
+}
+
+static bool on_serial_event(u32 event, void* user_data, EventInfo info) {
+    (void) event;
+    AsyncReceived* received = user_data;
+    // A serial executor always runs on the same thread.
+    if (atomic_fetch_add(&received->total, 1) == 0)
+        received->thread = pthread_self();
+    assert(pthread_equal(pthread_self(), received->thread));
+    assert(!pthread_equal(pthread_self(), main_thread));
+
+    u64 producer = info.event_data.u64[0];
+    if (event == TEST_EVENT) {
+        assert(info.event_data.u64[1] == received->next[producer]);
+        received->next[producer]++;
+    }
+    return TRUE;
+}
+
+static void test_affinity(void) {
+    event_system_init();
+    event_register_event(TEST_EVENT, str_create_view("TEST"));
+    event_register_event(OTHER_EVENT, str_create_view("OTHER"));
+
+    Received received = {0};
+    AsyncReceived worker = {0};
+    AsyncReceived serial = {0};
+    event_register_listener(TEST_EVENT, &on_test_event, &received);
+    event_register_listener_on(TEST_EVENT, &on_worker_event, &worker, EVENT_ON_WORKER);
+    event_register_listener_on(TEST_EVENT, &on_serial_event, &serial, EVENT_ON_EXECUTOR("test"));
+    event_register_listener_on(OTHER_EVENT, &on_serial_event, &serial, EVENT_ON_EXECUTOR("test"));
+
+    MCThread launcher;
+    mcthread_create(&launcher, &run_producers, NULL);
+    event_handle();
+    mcthread_join(&launcher, NULL);
+    // Executors run their remaining tasks before stopping.
+    event_system_cleanup();
+
+    u64 count = (u64) PRODUCER_COUNT * EVENTS_PER_PRODUCER;
+    assert(received.total == count);
+    assert(atomic_load(&worker.total) == count);
+    assert(atomic_load(&serial.total) == count + PRODUCER_COUNT * (EVENTS_PER_PRODUCER / 1000));
+    for (u32 i = 0; i < PRODUCER_COUNT; i++) {
+        assert(worker.next[i] == EVENTS_PER_PRODUCER);
+        assert(serial.next[i] == EVENTS_PER_PRODUCER);
+    }
+}
+
+static bool fan_out(u32 event, void* user_data, EventInfo info) {
+    (void) event;
+    // Triggering from listeners must not wait for the queue to drain: it would never happen.
+    EventInfo chained = {0};
+    chained.event_data.u64[0] = info.event_data.u64[0] * 2 + (user_data != NULL);
+    for (u64 i = 0; i < FAN_OUT_COUNT; i++) {
+        chained.event_data.u64[1] = i;
+        event_trigger(TEST_EVENT, chained);
+    }
+    return TRUE;
+}
+
+static bool stop_when_done(u32 event, void* user_data, EventInfo info) {
+    (void) event;
+    (void) info;
+    Received* received = user_data;
+    if (received->total == 4 * FAN_OUT_COUNT)
+        event_trigger(BEVENT_STOP, (EventInfo){0});
+    return TRUE;
+}
+
+static void test_reentrant_trigger(void) {
+    event_system_init();
+    event_register_event(TEST_EVENT, str_create_view("TEST"));
+    event_register_event(FAN_OUT_EVENT, str_create_view("FAN_OUT"));
+
+    Received received = {0};
+    event_register_listener(TEST_EVENT, &on_test_event, &received);
+    event_register_listener(TEST_EVENT, &stop_when_done, &received);
+    event_register_listener(FAN_OUT_EVENT, &fan_out, NULL);
+    event_register_listener_on(FAN_OUT_EVENT, &fan_out, &received, EVENT_ON_WORKER);
+
+    EventInfo info = {0};
+    event_trigger(FAN_OUT_EVENT, info);
+    info.event_data.u64[0] = 1;
+    event_trigger(FAN_OUT_EVENT, info);
+    event_handle();
+    event_system_cleanup();
+
+    // Events triggered by the handling thread and by a worker stay in order.
+    for (u32 i = 0; i < 4; i++) {
+        assert(received.next[i] == FAN_OUT_COUNT);
+    }
+}
+
+static u64 payload_size(u64 producer, u64 index) {
+    // Mostly small payloads, with a few larger than the payload rings.
+    if (index % 5000 == 4999)
+        return (1 << 20) + producer;
+    return 1 + (index * 37 + producer * 11) % 2000;
+}
+
+static void fill_payload(u8* payload, u64 size, u64 producer, u64 index) {
+    for (u64 i = 0; i < size; i++) {
+        payload[i] = (u8) (i + producer * 7 + index);
+    }
+}
+
+static void check_payload(const EventInfo* info) {
+    u64 producer = info->event_data.u64[0];
+    u64 index = info->event_data.u64[1];
+    u64 size = payload_size(producer, index);
+    assert(info->payload != NULL);
+    assert(((u64) info->payload & 15) == 0);
+    assert(info->payload_size == size);
+    const u8* payload = info->payload;
+    for (u64 i = 0; i < size; i++) {
+        assert(payload[i] == (u8) (i + producer * 7 + index));
+    }
+}
+
+static bool on_payload_event(u32 event, void* user_data, EventInfo info) {
+    assert(event == PAYLOAD_EVENT);
+    check_payload(&info);
+    if (user_data)
+        atomic_fetch_add((_Atomic u64*) user_data, 1);
+    return TRUE;
+}
+
+static void* produce_payloads(void* arg) {
+    u64 producer = (u64) arg;
+    EventInfo info = {0};
+    info.event_data.u64[0] = producer;
+    info.key = producer + 1;
+    for (u64 i = 0; i < EVENTS_PER_PRODUCER; i++) {
+        u64 size = payload_size(producer, i);
+        info.event_data.u64[1] = i;
+        info.payload = event_payload_alloc(size);
+        fill_payload(info.payload, size, producer, i);
+        event_trigger(PAYLOAD_EVENT, info);
+    }
+    return NULL;
+}
+
+static void* run_payload_producers(void* arg) {
+    (void) arg;
+    MCThread threads[PRODUCER_COUNT];
+    for (u64 i = 0; i < PRODUCER_COUNT; i++) {
+        mcthread_create(&threads[i], &produce_payloads, (void*) i);
+    }
+    for (u64 i = 0; i < PRODUCER_COUNT; i++) {
+        mcthread_join(&threads[i], NULL);
+    }
+    event_trigger(BEVENT_STOP, (EventInfo){0});
+    return NULL;
+}
+
+static void test_payloads(void) {
+    event_system_init();
+    event_register_event(PAYLOAD_EVENT, str_create_view("PAYLOAD"));
+
+    // Payloads stay valid until listeners of all threads have run.
+    _Atomic u64 handled = 0;
+    event_register_listener(PAYLOAD_EVENT, &on_payload_event, NULL);
+    event_register_listener_on(PAYLOAD_EVENT, &on_payload_event, NULL, EVENT_ON_WORKER);
+    event_register_listener_on(PAYLOAD_EVENT, &on_payload_event, &handled, EVENT_ON_EXECUTOR("payloads"));
+
+    MCThread launcher;
+    mcthread_create(&launcher, &run_payload_producers, NULL);
+    event_handle();
+    mcthread_join(&launcher, NULL);
+    event_system_cleanup();
+
+    assert(atomic_load(&handled) == (u64) PRODUCER_COUNT * EVENTS_PER_PRODUCER);
+}
+
+static void test_dispatch(void) {
+    event_system_init();
+    event_register_event(TEST_EVENT, str_create_view("TEST"));
+    event_register_event(OTHER_EVENT, str_create_view("OTHER"));
+
+    Received received = {0};
+    event_register_listener(TEST_EVENT, &on_test_event, &received);
+    event_register_listener(OTHER_EVENT, &on_other_event, &received);
+    event_register_listener(OTHER_EVENT, &on_other_event, &received);
+
+    // More events than the queue can hold: producers must wait instead of dropping events.
+    MCThread launcher;
+    mcthread_create(&launcher, &run_producers, NULL);
+    event_handle();
+    mcthread_join(&launcher, NULL);
+
+    assert(received.total == (u64) PRODUCER_COUNT * EVENTS_PER_PRODUCER);
+    for (u32 i = 0; i < PRODUCER_COUNT; i++) {
+        assert(received.next[i] == EVENTS_PER_PRODUCER);
+    }
+    assert(received.other == 2 * PRODUCER_COUNT * (EVENTS_PER_PRODUCER / 1000));
+
+    event_system_cleanup();
+}
+
+int main(void) {
+    logger_system_init();
+    main_thread = pthread_self();
+
+    test_queue();
+    test_dispatch();
+    test_affinity();
+    test_reentrant_trigger();
+    test_payloads();
+
+    logger_system_cleanup();
+    return 0;
+}
@@ -0,0 +1,150 @@
+#include "network/forwarding.h"
+#include "network/packet.h"
+
+#include "logger.h"
+#include "memory/arena.h"
+#include "memory/mem_tags.h"
+
+#include <assert.h>
+#include <string.h>
+
+/*
+ * Plays the role of the proxy: encodes and signs player information the same way Velocity
+ * does, then checks that the backend accepts it, and rejects anything that was tampered with.
+ */
+
+/*
+ * Player information as a Velocity proxy sends it, signed with `velocity_secret`.
+ * The bytes were produced independently of the server, with HMAC-SHA256 over Velocity's encoding.
+ */
+static const char* velocity_secret = "velocity-forwarding-secret";
+static const u8 velocity_data[] = {
+    // Signature.
+    0x68, 0xbe, 0x7b, 0x69, 0xc7, 0xab, 0x6e, 0x2b, 0x24, 0x3d, 0x1b, 0xc5, 0x6b, 0xb2, 0x9f, 0xdb,
+    0xe2, 0x0f, 0xba, 0x64, 0x99, 0xa4, 0x3e, 0x7a, 0xe5, 0x35, 0xd0, 0x54, 0x06, 0x41, 0x47, 0x38,
+    // Version 1, then address "127.0.0.1".
+    0x01, 0x09, 0x31, 0x32, 0x37, 0x2e, 0x30, 0x2e, 0x30, 0x2e, 0x31,
+    // UUID 069a79f4-44e9-4726-a5be-fca90e38aaf5.
+    0x06, 0x9a, 0x79, 0xf4, 0x44, 0xe9, 0x47, 0x26, 0xa5, 0xbe, 0xfc, 0xa9, 0x0e, 0x38, 0xaa, 0xf5,
+    // Name "Notch", then a single property.
+    0x05, 0x4e, 0x6f, 0x74, 0x63, 0x68, 0x01,
+    // "textures", its value, and its signature.
+    0x08, 0x74, 0x65, 0x78, 0x74, 0x75, 0x72, 0x65, 0x73, 0x1c, 0x65, 0x77, 0x6f, 0x67, 0x49, 0x43,
+    0x4a, 0x30, 0x61, 0x57, 0x31, 0x6c, 0x63, 0x33, 0x52, 0x68, 0x62, 0x58, 0x41, 0x69, 0x49, 0x44,
+    0x6f, 0x67, 0x4d, 0x41, 0x70, 0x39, 0x01, 0x0c, 0x63, 0x32, 0x6c, 0x6e, 0x62, 0x6d, 0x46, 0x30,
+    0x64, 0x58, 0x4a, 0x6c,
+};
+static const u8 velocity_uuid[] = {
+    0x06, 0x9a, 0x79, 0xf4, 0x44, 0xe9, 0x47, 0x26, 0xa5, 0xbe, 0xfc, 0xa9, 0x0e, 0x38, 0xaa, 0xf5,
+};
+
+static ForwardedPlayer make_player(Arena* arena) {
+    ForwardedPlayer player = {
+        .address = str_create_view("203.0.113.42"),
+        .uuid = {0x0123456789abcdef, 0xfedcba9876543210},
+        .name = str_create_view("Notch"),
+    };
+    vect_init(&player.properties, arena, 2, sizeof(PlayerProperty));
+
+    PlayerProperty* textures = vect_reserve(&player.properties);
+    *textures = (PlayerProperty){
+        .name = str_create_view("textures"),
+        .value = str_create_view("eyJ0aW1lc3RhbXAiOjB9"),
+        .is_signed = TRUE,
+        .signature = str_create_view("c2lnbmF0dXJl"),
+    };
+    PlayerProperty* other = vect_reserve(&player.properties);
+    *other = (PlayerProperty){
+        .name = str_create_view("other"),
+        .value = str_create_view("value"),
+        .is_signed = FALSE,
+    };
+
+    return player;
+}
+
+static void assert_same_player(const ForwardedPlayer* expected, const ForwardedPlayer* actual) {
+    assert(str_compare(&expected->address, &actual->address) == 0);
+    assert(memcmp(expected->uuid, actual->uuid, sizeof expected->uuid) == 0);
+    assert(str_compare(&expected->name, &actual->name) == 0);
+    assert(expected->properties.size == actual->properties.size);
+    for (u64 i = 0; i < expected->properties.size; i++) {
+        PlayerProperty* lhs = vect_ref(&expected->properties, i);
+        PlayerProperty* rhs = vect_ref(&actual->properties, i);
+        assert(str_compare(&lhs->name, &rhs->name) == 0);
+        assert(str_compare(&lhs->value, &rhs->value) == 0);
+        assert(lhs->is_signed == rhs->is_signed);
+        if (lhs->is_signed)
+            assert(str_compare(&lhs->signature, &rhs->signature) == 0);
+    }
+}
+
+/*
+ * Checks the server against data signed by a real proxy, rather than by its own encoder.
+ */
+static void test_velocity_data(Arena* arena) {
+    string secret = str_create_view(velocity_secret);
+
+    ForwardedPlayer received;
+    assert(forwarding_read_player(&secret, arena, velocity_data, sizeof velocity_data, &received));
+    string address = str_create_view("127.0.0.1");
+    string name = str_create_view("Notch");
+    assert(str_compare(&received.address, &address) == 0);
+    assert(memcmp(received.uuid, velocity_uuid, sizeof velocity_uuid) == 0);
+    assert(str_compare(&received.name, &name) == 0);
+    assert(received.properties.size == 1);
+    PlayerProperty* textures = vect_ref(&received.properties, 0);
+    string textures_name = str_create_view("textures");
+    string textures_value = str_create_view("ewogICJ0aW1lc3RhbXAiIDogMAp9");
+    string textures_signature = str_create_view("c2lnbmF0dXJl");
+    assert(str_compare(&textures->name, &textures_name) == 0);
+    assert(str_compare(&textures->value, &textures_value) == 0);
+    assert(textures->is_signed);
+    assert(str_compare(&textures->signature, &textures_signature) == 0);
+
+    // The server encodes the same player exactly like the proxy.
+    u64 size;
+    u8* data = forwarding_write_player(&secret, arena, &received, &size);
+    assert(data);
+    assert(size == sizeof velocity_data);
+    assert(memcmp(data, velocity_data, size) == 0);
+    log_info("Player information forwarded by Velocity accepted.");
+}
+
+int main(void) {
+    logger_system_init();
+    memory_stats_init();
+    Arena arena = arena_create(1 << 20, BLK_TAG_UNKNOWN);
+
+    test_velocity_data(&arena);
+
+    string secret = str_create_view("s3cr3t-sh4r3d-w1th-th3-pr0xy");
+    string wrong_secret = str_create_view("not-the-secret");
+
+    ForwardedPlayer player = make_player(&arena);
+    u64 size;
+    u8* data = forwarding_write_player(&secret, &arena, &player, &size);
+    assert(data);
+    assert(size > FORWARDING_SIGNATURE_SIZE);
+
+    ForwardedPlayer received;
+    assert(forwarding_read_player(&secret, &arena, data, size, &received));
+    assert_same_player(&player, &received);
+    log_info("Forwarded player information accepted.");
+
+    assert(!forwarding_read_player(&wrong_secret, &arena, data, size, &received));
+    assert(!forwarding_read_player(&secret, &arena, data, FORWARDING_SIGNATURE_SIZE - 1, &received));
+    assert(!forwarding_read_player(&secret, &arena, data, size - 1, &received));
+
+    for (u64 i = 0; i < size; i++) {
+        data[i] ^= 0x20;
+        assert(!forwarding_read_player(&secret, &arena, data, size, &received));
+        data[i] ^= 0x20;
+    }
+    log_info("Tampered player information rejected.");
+
+    arena_destroy(&arena);
+    logger_system_cleanup();
+
+    return 0;
+}
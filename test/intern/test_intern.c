@@ -0,0 +1,85 @@
+#include "utils/intern.h"
+
+#include "logger.h"
+#include "platform/mc_thread.h"
+#include "resource/resource_id.h"
+#include "utils/hash.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#define THREAD_COUNT 4
+#define STRING_COUNT 20000
+
+static void test_basic(void) {
+    InternID stone = intern_cstr("stone");
+    assert(stone != INTERN_NONE);
+    assert(intern_cstr("stone") == stone);
+    assert(intern_cstr("dirt") != stone);
+
+    string str = intern_string(stone);
+    assert(str.length == 5);
+    assert(strcmp(str.base, "stone") == 0);
+    assert(intern_hash(stone) == default_hash("stone", 5));
+
+    string missing = str_create_view("not interned");
+    assert(intern_find(&missing) == INTERN_NONE);
+    assert(intern_string(INTERN_NONE).length == 0);
+    assert(intern_hash(intern_count() + 1) == 0);
+
+    ResourceID a = resid_default_cstr("oak_planks");
+    string ns = str_create_view("minecraft");
+    string path = str_create_view("oak_planks");
+    ResourceID b = resid_create(&ns, &path);
+    assert(resid_equals(&a, &b));
+    assert(resid_hash(&a) == resid_hash(&b));
+    assert(strcmp(resid_path(a).base, "oak_planks") == 0);
+    assert(strcmp(resid_namespace(a).base, "minecraft") == 0);
+}
+
+static void* intern_many(void* arg) {
+    u32* ids = arg;
+    char name[32];
+    for (u32 i = 0; i < STRING_COUNT; i++) {
+        snprintf(name, sizeof name, "minecraft:block_%u", i);
+        ids[i] = intern_cstr(name);
+    }
+    return NULL;
+}
+
+static void test_concurrent(void) {
+    static u32 ids[THREAD_COUNT][STRING_COUNT];
+    MCThread threads[THREAD_COUNT];
+    u32 before = intern_count();
+
+    // All threads intern the same strings, growing the table concurrently.
+    for (u32 i = 0; i < THREAD_COUNT; i++) {
+        assert(mcthread_create(&threads[i], &intern_many, ids[i]) == 0);
+    }
+    for (u32 i = 0; i < THREAD_COUNT; i++) {
+        mcthread_join(&threads[i], NULL);
+    }
+
+    assert(intern_count() == before + STRING_COUNT);
+    char name[32];
+    for (u32 i = 0; i < STRING_COUNT; i++) {
+        for (u32 j = 1; j < THREAD_COUNT; j++) {
+            assert(ids[j][i] == ids[0][i]);
+        }
+        snprintf(name, sizeof name, "minecraft:block_%u", i);
+        assert(strcmp(intern_string(ids[0][i]).base, name) == 0);
+    }
+}
+
+int main(void) {
+    logger_system_init();
+    intern_system_init();
+
+    test_basic();
+    test_concurrent();
+
+    intern_system_cleanup();
+    logger_system_cleanup();
+    return 0;
+}
@@ -1,9 +1,9 @@
 #include "containers/bytebuffer.h"
 #include "logger.h"
 #include "memory/arena.h"
+#include "memory/dyn_arena.h"
 #include "data/json.h"
 #include "utils/str_builder.h"
-#include "platform/platform.h"
 
 #include <dirent.h>
 #include <errno.h>
@@ -40,26 +40,36 @@ int parse_json(const char* file) {
             break;
     }
 
-    Arena arena = arena_create(1 << 15, BLK_TAG_UNKNOWN);
+    DynamicArena arena = dynarena_create(BLK_TAG_UNKNOWN);
 
     JSON json = json_parse(&buffer, &arena);
     if (!json.arena) {
-        arena_destroy(&arena);
+        dynarena_destroy(&arena);
         fclose(f);
         bytebuf_destroy(&buffer);
         return 2;
     }
 
-    /*
+    // The text of a parsed tree must parse back.
     string out;
-    json_stringify(&json, &out, 1 << 14, &arena);
-
-    printf("%s\n", out.base);
-    */
+    json_stringify(&json, &out, &arena);
+    ByteBuffer text = bytebuf_create(out.length + 1);
+    bytebuf_write(&text, out.base, out.length + 1);
+    JSON copy = json_parse(&text, &arena);
+    bytebuf_destroy(&text);
+    if (!copy.arena) {
+        log_errorf("JSON: The text of '%s' could not be parsed back.", file);
+        json_destroy(&json);
+        dynarena_destroy(&arena);
+        fclose(f);
+        bytebuf_destroy(&buffer);
+        return 3;
+    }
+    json_destroy(&copy);
 
     json_destroy(&json);
 
-    arena_destroy(&arena);
+    dynarena_destroy(&arena);
     fclose(f);
     bytebuf_destroy(&buffer);
     return 0;
@@ -110,7 +120,6 @@ static void test_dir(const char* path, bool error_test) {
 int main(void) {
 
     memory_stats_init();
-    platform_init();
 
     logger_system_init();
 
@@ -119,7 +128,6 @@ int main(void) {
 
     memory_dump_stats();
     logger_system_cleanup();
-    platform_cleanup();
 
     return 0;
 }
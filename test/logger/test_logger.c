@@ -0,0 +1,239 @@
+#include "logger.h"
+
+#include "platform/mc_thread.h"
+
+#include <assert.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define THREAD_COUNT 4
+#define MESSAGES_PER_THREAD 5000
+#define OUTPUT_SIZE (4L << 20)
+
+static const char* stdout_path = "test_logger_stdout.txt";
+static const char* stderr_path = "test_logger_stderr.txt";
+
+static char output[OUTPUT_SIZE];
+
+static void redirect(i32 fd, const char* path) {
+    i32 file = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    assert(file >= 0);
+    dup2(file, fd);
+    close(file);
+}
+
+/**
+ * Reads everything written to a file since the start of the test.
+ */
+static u64 read_output(const char* path) {
+    logger_flush();
+    FILE* file = fopen(path, "r");
+    assert(file);
+    u64 length = fread(output, 1, OUTPUT_SIZE - 1, file);
+    output[length] = 0;
+    fclose(file);
+    return length;
+}
+
+static void expect_line(const char* lines, const char* prefix, const char* message) {
+    char line[1024];
+    snprintf(line, sizeof line, "%s %s\x1b[0m\n", prefix, message);
+    if (!strstr(lines, line)) {
+        fprintf(stderr, "Missing line: %s", line);
+        abort();
+    }
+}
+
+static void test_formats(void) {
+    char buffer[64];
+    strcpy(buffer, "temporary");
+    log_infof("string %s, padded [%-12s] [%8s], cut %.3s", buffer, "left", "right", "abcdef");
+    // The logger copies strings: changing them afterwards does not change the message.
+    strcpy(buffer, "overwritten");
+    log_infof("int %i %d %u %x %08X %hhx %c", -42, 7, 3000000000u, 255, 48879, 0x1ff, 'z');
+    log_infof("long %li %lu %lli %zu %8zu %td %jd", -1L, 2UL, -3LL, (size_t) 4, (size_t) 5,
+              (ptrdiff_t) -6, (intmax_t) 7);
+    log_infof("float %f %8.2f %e %g %Lf", 1.5, 3.14159, 0.001, 100000.0, (long double) 2.25);
+    log_infof("stars [%*d] [%-*d] [%.*s] [%*.*f]", 5, 42, 4, 7, 2, "xyz", 8, 3, 1.0);
+    log_infof("pointer %p, null %s, percent 100%%", (void*) 0x1234, (char*) NULL);
+    log_info("plain message with % signs");
+    log_warnf("warning %u", 1);
+
+    read_output(stdout_path);
+    expect_line(output, "\x1b[0m[ INFO]", "string temporary, padded [left        ] [   right], cut abc");
+    expect_line(output, "\x1b[0m[ INFO]", "int -42 7 3000000000 ff 0000BEEF ff z");
+    expect_line(output, "\x1b[0m[ INFO]", "long -1 2 -3 4        5 -6 7");
+    expect_line(output, "\x1b[0m[ INFO]", "float 1.500000     3.14 1.000000e-03 100000 2.250000");
+    expect_line(output, "\x1b[0m[ INFO]", "stars [   42] [7   ] [xy] [   1.000]");
+
+    char line[128];
+    snprintf(line, sizeof line, "pointer %p, null %s, percent 100%%", (void*) 0x1234, (char*) NULL);
+    expect_line(output, "\x1b[0m[ INFO]", line);
+    expect_line(output, "\x1b[0m[ INFO]", "plain message with % signs");
+    expect_line(output, "\x1b[33m[ WARN]", "warning 1");
+}
+
+static void test_long_string(void) {
+    char* string = malloc(20000);
+    memset(string, 'a', 19999);
+    string[19999] = 0;
+    log_infof("long %s string %i", string, 12);
+    log_info(string);
+    free(string);
+
+    u64 length = read_output(stdout_path);
+    // Truncated, but not lost.
+    assert(length < OUTPUT_SIZE - 1);
+    assert(strstr(output, "long aaaa"));
+}
+
+static void test_streams(void) {
+    log_errorf("error %i", 1);
+    log_error("second error");
+
+    read_output(stderr_path);
+    expect_line(output, "\x1b[31m[ERROR]", "error 1");
+    expect_line(output, "\x1b[31m[ERROR]", "second error");
+}
+
+static u32 evaluations;
+
+static u32 count_evaluation(void) {
+    return ++evaluations;
+}
+
+static void test_levels(void) {
+    assert(logger_parse_levels("info, network=trace,event=warn\n"));
+    assert(log_levels[LOG_SUBSYSTEM_CORE] == LOG_LEVEL_INFO);
+    assert(log_levels[LOG_SUBSYSTEM_NETWORK] == LOG_LEVEL_TRACE);
+    assert(log_levels[LOG_SUBSYSTEM_EVENT] == LOG_LEVEL_WARN);
+    assert(log_levels[LOG_SUBSYSTEM_NBT] == LOG_LEVEL_INFO);
+
+    // Invalid lists change nothing.
+    assert(!logger_parse_levels("debug,network=loud"));
+    assert(!logger_parse_levels("nothing=debug"));
+    assert(log_levels[LOG_SUBSYSTEM_CORE] == LOG_LEVEL_INFO);
+
+    // Disabled messages do not evaluate their arguments.
+    log_debugf("hidden debug %u", count_evaluation());
+    log_infof("shown info %u", count_evaluation());
+    assert(evaluations == 1);
+
+    logger_cycle_verbosity();
+    assert(log_levels[LOG_SUBSYSTEM_CORE] == LOG_LEVEL_DEBUG);
+    assert(log_levels[LOG_SUBSYSTEM_EVENT] == LOG_LEVEL_DEBUG);
+    assert(log_levels[LOG_SUBSYSTEM_NETWORK] == LOG_LEVEL_TRACE);
+    log_debugf("shown debug %u", count_evaluation());
+    logger_cycle_verbosity();
+    assert(log_levels[LOG_SUBSYSTEM_EVENT] == LOG_LEVEL_TRACE);
+    logger_cycle_verbosity();
+    assert(log_levels[LOG_SUBSYSTEM_EVENT] == LOG_LEVEL_WARN);
+
+    read_output(stdout_path);
+    assert(!strstr(output, "hidden debug"));
+    expect_line(output, "\x1b[0m[ INFO]", "shown info 1");
+    expect_line(output, "\x1b[32;3m[DEBUG]", "shown debug 2");
+    assert(strstr(output, "Log levels: core=debug network=trace event=debug"));
+
+    assert(logger_parse_levels("debug"));
+}
+
+static void log_limited_messages(u32 count) {
+    for (u32 i = 0; i < count; i++) {
+        log_limitedf(LOG_LEVEL_INFO, 5, "limited %u", i);
+    }
+}
+
+static void log_sampled_messages(u32 count) {
+    for (u32 i = 0; i < count; i++) {
+        log_sampledf(LOG_LEVEL_WARN, 10, "sampled %u", i);
+    }
+}
+
+static u32 count_occurrences(const char* text, const char* pattern) {
+    u32 count = 0;
+    for (const char* found = strstr(text, pattern); found; found = strstr(found + 1, pattern)) {
+        count++;
+    }
+    return count;
+}
+
+static void test_limits(void) {
+    log_limited_messages(1000);
+    log_sampled_messages(100);
+    read_output(stdout_path);
+    assert(count_occurrences(output, "limited ") == 5);
+    expect_line(output, "\x1b[0m[ INFO]", "limited 4");
+    assert(count_occurrences(output, "sampled ") == 10);
+    expect_line(output, "\x1b[33m[ WARN]", "sampled 90");
+    assert(!strstr(output, "suppressed"));
+
+    // The logger thread sums suppressed messages up once the window is over, without another call.
+    usleep(LOG_LIMIT_WINDOW_NS / 1000 * 3 / 2);
+    read_output(stdout_path);
+    expect_line(output, "\x1b[0m[ INFO]", "995 similar messages suppressed: limited %u");
+    expect_line(output, "\x1b[33m[ WARN]", "90 similar messages suppressed: sampled %u");
+    assert(count_occurrences(output, "suppressed") == 2);
+
+    log_limited_messages(1);
+    log_sampled_messages(1);
+    read_output(stdout_path);
+    assert(count_occurrences(output, "limited 0") == 2);
+    assert(count_occurrences(output, "sampled 0") == 2);
+    assert(count_occurrences(output, "suppressed") == 2);
+}
+
+static void* log_messages(void* arg) {
+    u64 thread = (u64) arg;
+    for (u32 i = 0; i < MESSAGES_PER_THREAD; i++) {
+        log_infof("thread %zu message %u", thread, i);
+    }
+    return NULL;
+}
+
+static void test_threads(void) {
+    MCThread threads[THREAD_COUNT];
+    for (u64 i = 0; i < THREAD_COUNT; i++) {
+        mcthread_create(&threads[i], &log_messages, (void*) i);
+    }
+    for (u64 i = 0; i < THREAD_COUNT; i++) {
+        mcthread_join(&threads[i], NULL);
+    }
+
+    read_output(stdout_path);
+    u32 next[THREAD_COUNT] = {0};
+    for (const char* line = strstr(output, "thread "); line; line = strstr(line + 1, "thread ")) {
+        u64 thread;
+        u32 message;
+        if (sscanf(line, "thread %zu message %u", &thread, &message) != 2)
+            continue;
+        assert(thread < THREAD_COUNT);
+        // Messages of a thread are written in order.
+        assert(message == next[thread]);
+        next[thread]++;
+    }
+    for (u32 i = 0; i < THREAD_COUNT; i++) {
+        assert(next[i] == MESSAGES_PER_THREAD);
+    }
+}
+
+int main(void) {
+    redirect(STDOUT_FILENO, stdout_path);
+    redirect(STDERR_FILENO, stderr_path);
+    logger_system_init();
+
+    test_formats();
+    test_long_string();
+    test_streams();
+    test_levels();
+    test_limits();
+    test_threads();
+
+    logger_system_cleanup();
+    unlink(stdout_path);
+    unlink(stderr_path);
+    return 0;
+}
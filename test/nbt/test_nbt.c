@@ -1,5 +1,5 @@
 #include "logger.h"
-#include "memory/arena.h"
+#include "memory/dyn_arena.h"
 #include "data/nbt.h"
 #include "utils/string.h"
 
@@ -22,9 +22,9 @@ static bool str_ends_with(const char* str, const char* substr) {
 */
 
 static int test_write1(const char* file) {
-    Arena arena = arena_create(1 << 24, BLK_TAG_UNKNOWN);
+    DynamicArena arena = dynarena_create(BLK_TAG_UNKNOWN);
 
-    NBT nbt = nbt_create(&arena, 1024);
+    NBT nbt = nbt_create(&arena);
 
     string tmp = str_create_view("test");
     nbt_put_simple(&nbt, &tmp, NBT_INT, (union NBTSimpleValue){.integer = 8274744});
@@ -32,14 +32,14 @@ static int test_write1(const char* file) {
     string out_path = str_create_view(file);
     nbt_write(&nbt, &out_path);
 
-    arena_destroy(&arena);
+    dynarena_destroy(&arena);
     return 0;
 }
 
 static int test_write2(const char* file) {
-    Arena arena = arena_create(1 << 24, BLK_TAG_UNKNOWN);
+    DynamicArena arena = dynarena_create(BLK_TAG_UNKNOWN);
 
-    NBT nbt = nbt_create(&arena, 1024);
+    NBT nbt = nbt_create(&arena);
 
     string tmp = str_create_view("data");
     nbt_put(&nbt, &tmp, NBT_COMPOUND);
@@ -51,14 +51,14 @@ static int test_write2(const char* file) {
     string out_path = str_create_view(file);
     nbt_write(&nbt, &out_path);
 
-    arena_destroy(&arena);
+    dynarena_destroy(&arena);
     return 0;
 }
 
 static int test_write3(const char* file) {
-    Arena arena = arena_create(1 << 24, BLK_TAG_UNKNOWN);
+    DynamicArena arena = dynarena_create(BLK_TAG_UNKNOWN);
 
-    NBT nbt = nbt_create(&arena, 1024);
+    NBT nbt = nbt_create(&arena);
 
     string tmp = str_create_view("data");
     nbt_put(&nbt, &tmp, NBT_COMPOUND);
@@ -74,23 +74,23 @@ static int test_write3(const char* file) {
     string out_path = str_create_view(file);
     nbt_write(&nbt, &out_path);
 
-    arena_destroy(&arena);
+    dynarena_destroy(&arena);
     return 0;
 }
 
 static int test_read3(const char* file) {
-    Arena arena = arena_create(1 << 24, BLK_TAG_UNKNOWN);
+    DynamicArena arena = dynarena_create(BLK_TAG_UNKNOWN);
     NBT nbt;
 
     string in_path = str_create_view(file);
-    nbt_parse(&arena, 1024, &in_path, &nbt);
+    nbt_parse(&arena, &in_path, &nbt);
 
     string out_path = str_create_view("inout3.nbt.gz");
     nbt_write(&nbt, &out_path);
     out_path = str_create_view("level.txt");
     nbt_write_snbt(&nbt, &out_path);
 
-    arena_destroy(&arena);
+    dynarena_destroy(&arena);
     return 0;
 }
 /*
@@ -146,6 +146,7 @@ int main(void) {
 
     test_read3("out3.nbt.gz");
 
+    dynarena_cache_cleanup();
     memory_dump_stats();
 
     logger_system_cleanup();
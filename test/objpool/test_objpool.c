@@ -0,0 +1,93 @@
+#include "containers/object_pool.h"
+
+#include "logger.h"
+#include "memory/arena.h"
+
+#include <assert.h>
+#include <stdalign.h>
+
+typedef struct Object {
+    u64 id;
+    u8 flag;
+} Object;
+
+static void count_objects(void* ptr, i64 index, void* user_data) {
+    Object* obj = ptr;
+    u64* count = user_data;
+    assert(obj->id == (u64) index);
+    (*count)++;
+}
+
+static void test_static(Arena* arena) {
+    ObjectPool pool;
+    objpool_init(&pool, arena, 10, sizeof(u8));
+
+    i64 indices[10];
+    for (u32 i = 0; i < 10; i++) {
+        u8* ptr = objpool_add(&pool, &indices[i]);
+        assert(ptr != NULL);
+        assert(indices[i] == i);
+        *ptr = i;
+    }
+    assert(objpool_add(&pool, NULL) == NULL);
+    assert(objpool_size(&pool) == 10);
+
+    // Freed slots are reused.
+    assert(objpool_remove(&pool, 3));
+    assert(!objpool_remove(&pool, 3));
+    assert(objpool_get(&pool, 3) == NULL);
+    i64 index;
+    objpool_add(&pool, &index);
+    assert(index == 3);
+
+    objpool_clear(&pool);
+    assert(objpool_size(&pool) == 0);
+    assert(objpool_get(&pool, 0) == NULL);
+}
+
+static void test_dynamic(Arena* arena) {
+    ObjectPool pool;
+    objpool_init_dynamic(&pool, arena, 5, sizeof(Object));
+
+    Object* first = NULL;
+    for (u64 i = 0; i < 1000; i++) {
+        i64 index;
+        Object* obj = objpool_add(&pool, &index);
+        assert(obj != NULL);
+        assert((uintptr_t) obj % alignof(u64) == 0);
+        assert(index == (i64) i);
+        obj->id = i;
+        if (i == 0)
+            first = obj;
+    }
+    // Growing never moves elements.
+    assert(objpool_get(&pool, 0) == first);
+    assert(first->id == 0);
+
+    for (u64 i = 0; i < 1000; i += 3) {
+        assert(objpool_remove(&pool, i));
+    }
+    for (u64 i = 0; i < 1000; i++) {
+        Object* obj = objpool_get(&pool, i);
+        assert((obj == NULL) == (i % 3 == 0));
+        if (obj)
+            assert(obj->id == i);
+    }
+
+    u64 count = 0;
+    objpool_foreach(&pool, &count_objects, &count);
+    assert(count == objpool_size(&pool));
+    assert(count == 1000 - 334);
+}
+
+int main(void) {
+    logger_system_init();
+    Arena arena = arena_create(1 << 20, BLK_TAG_UNKNOWN);
+
+    test_static(&arena);
+    test_dynamic(&arena);
+
+    arena_destroy(&arena);
+    logger_system_cleanup();
+    return 0;
+}
@@ -0,0 +1,80 @@
+#include "registry/registry.h"
+
+#include "logger.h"
+#include "memory/mem_tags.h"
+#include "utils/intern.h"
+
+#include <assert.h>
+#include <stdio.h>
+
+#define BLOCK_COUNT 5000
+
+typedef struct Block {
+    u32 hardness;
+    u32 light;
+} Block;
+
+static ResourceID block_id(u32 i) {
+    char path[32];
+    snprintf(path, sizeof path, "block_%u", i);
+    return resid_default_cstr(path);
+}
+
+static void check_blocks(const Registry* blocks) {
+    assert(registry_size(blocks) == BLOCK_COUNT);
+    for (u32 i = 0; i < BLOCK_COUNT; i++) {
+        ResourceID id = block_id(i);
+        assert(registry_get_id(blocks, id) == i);
+
+        const Block* block = registry_lookup(blocks, id);
+        assert(block && block->hardness == i && block->light == i % 16);
+        assert(registry_get_entry(blocks, i) == block);
+
+        ResourceID name;
+        assert(registry_get_name(blocks, i, &name));
+        assert(resid_equals(&name, &id));
+    }
+
+    ResourceID missing = resid_default_cstr("missing");
+    assert(registry_get_id(blocks, missing) == -1);
+    assert(registry_lookup(blocks, missing) == NULL);
+    assert(registry_get_entry(blocks, BLOCK_COUNT) == NULL);
+}
+
+int main(void) {
+    logger_system_init();
+    memory_stats_init();
+    intern_system_init();
+    registry_system_init();
+
+    ResourceID blocks_name = resid_default_cstr("block");
+    ResourceID empty_name = resid_default_cstr("empty");
+    assert(registry_create(blocks_name, sizeof(Block)));
+    assert(!registry_create(blocks_name, sizeof(Block)));
+    assert(registry_create(empty_name, sizeof(Block)));
+
+    for (u32 i = 0; i < BLOCK_COUNT; i++) {
+        Block block = {.hardness = i, .light = i % 16};
+        assert(registry_register(blocks_name, block_id(i), &block));
+    }
+    Block block = {0};
+    assert(!registry_register(blocks_name, block_id(0), &block));
+
+    const Registry* blocks = registry_get(blocks_name);
+    assert(blocks);
+    check_blocks(blocks);
+
+    registry_freeze();
+    check_blocks(blocks);
+    assert(!registry_register(blocks_name, block_id(BLOCK_COUNT), &block));
+    assert(!registry_create(resid_default_cstr("item"), sizeof(Block)));
+
+    const Registry* empty = registry_get(empty_name);
+    assert(registry_size(empty) == 0);
+    assert(registry_get_id(empty, block_id(0)) == -1);
+
+    registry_system_cleanup();
+    intern_system_cleanup();
+    logger_system_cleanup();
+    return 0;
+}
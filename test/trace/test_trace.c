@@ -0,0 +1,137 @@
+#include "trace.h"
+
+#include "logger.h"
+#include "platform/mc_thread.h"
+
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define THREAD_COUNT 4
+#define SPANS_PER_THREAD (TRACE_RING_CAPACITY + 100)
+#define OUTPUT_SIZE (16L << 20)
+
+static const char* trace_path = "test_trace.json";
+
+static char output[OUTPUT_SIZE];
+static _Atomic bool recording;
+static _Atomic bool stop_recording;
+
+static u64 read_trace(void) {
+    FILE* file = fopen(trace_path, "r");
+    assert(file);
+    u64 length = fread(output, 1, OUTPUT_SIZE - 1, file);
+    output[length] = 0;
+    fclose(file);
+    return length;
+}
+
+static u32 count_occurrences(const char* text, const char* pattern) {
+    u32 count = 0;
+    for (const char* found = strstr(text, pattern); found; found = strstr(found + 1, pattern)) {
+        count++;
+    }
+    return count;
+}
+
+static void record_nested(void) {
+    TRACE_SCOPE("outer");
+    {
+        TRACE_SCOPE("inner");
+        usleep(100);
+    }
+}
+
+static void* record_spans(void* arg) {
+    char name[16];
+    snprintf(name, sizeof name, "tracer %zu", (size_t) arg);
+    mcthread_set_name(name);
+    for (u32 i = 0; i < SPANS_PER_THREAD; i++) {
+        TRACE_SCOPE("loop");
+    }
+    return NULL;
+}
+
+static void* record_until_stopped(void* arg) {
+    (void) arg;
+    while (!atomic_load(&stop_recording)) {
+        {
+            TRACE_SCOPE("busy");
+        }
+        atomic_store(&recording, TRUE);
+    }
+    return NULL;
+}
+
+static void test_disabled(void) {
+    // Nothing is recorded before tracing starts.
+    record_nested();
+    assert(!trace_dump());
+}
+
+static void test_spans(void) {
+    record_nested();
+
+    MCThread threads[THREAD_COUNT];
+    for (u64 i = 0; i < THREAD_COUNT; i++) {
+        mcthread_create(&threads[i], &record_spans, (void*) i);
+    }
+    for (u64 i = 0; i < THREAD_COUNT; i++) {
+        mcthread_join(&threads[i], NULL);
+    }
+
+    assert(trace_dump());
+    read_trace();
+    assert(strncmp(output, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [", 42) == 0);
+    assert(strstr(output, "]}\n"));
+    assert(count_occurrences(output, "\"name\": \"outer\"") == 1);
+    assert(count_occurrences(output, "\"name\": \"inner\"") == 1);
+    // Rings keep the latest spans of each thread.
+    assert(count_occurrences(output, "\"name\": \"loop\"") == THREAD_COUNT * TRACE_RING_CAPACITY);
+    // The logger thread may have written messages too.
+    assert(count_occurrences(output, "\"ph\": \"M\"") >= THREAD_COUNT + 1);
+    for (u32 i = 0; i < THREAD_COUNT; i++) {
+        char name[32];
+        snprintf(name, sizeof name, "\"name\": \"tracer %u\"", i);
+        assert(strstr(output, name));
+    }
+}
+
+static void test_dump_while_recording(void) {
+    MCThread thread;
+    mcthread_create(&thread, &record_until_stopped, NULL);
+    while (!atomic_load(&recording))
+        usleep(100);
+    for (u32 i = 0; i < 3; i++) {
+        assert(trace_dump());
+    }
+    atomic_store(&stop_recording, TRUE);
+    mcthread_join(&thread, NULL);
+
+    assert(trace_dump());
+    read_trace();
+    assert(count_occurrences(output, "\"name\": \"busy\"") > 0);
+}
+
+int main(void) {
+    logger_system_init();
+
+    test_disabled();
+    assert(trace_start(trace_path));
+    test_spans();
+    test_dump_while_recording();
+    trace_stop();
+    assert(!trace_dump());
+    // The rings of the stopped trace are still in use.
+    assert(!trace_start(trace_path));
+
+    logger_system_cleanup();
+    trace_system_cleanup();
+    assert(trace_start(trace_path));
+    trace_system_cleanup();
+    unlink(trace_path);
+    return 0;
+}
@@ -1,4 +1,14 @@
 MAIN_TESTS := $(TEST_DIR)/json/test_json.c \
 			  $(TEST_DIR)/nbt/test_nbt.c \
 			  $(TEST_DIR)/string/test_string.c \
-			  $(TEST_DIR)/dynvector/dynvector.c
+			  $(TEST_DIR)/dynvector/dynvector.c \
+			  $(TEST_DIR)/forwarding/test_forwarding.c \
+			  $(TEST_DIR)/arena/test_arena.c \
+			  $(TEST_DIR)/dynarena/test_dynarena.c \
+			  $(TEST_DIR)/objpool/test_objpool.c \
+			  $(TEST_DIR)/dict/test_dict.c \
+			  $(TEST_DIR)/intern/test_intern.c \
+			  $(TEST_DIR)/registry/test_registry.c \
+			  $(TEST_DIR)/event/test_event.c \
+			  $(TEST_DIR)/logger/test_logger.c \
+			  $(TEST_DIR)/trace/test_trace.c
@@ -0,0 +1,50 @@
+/**
+ * @file bench.h
+ * @author Bastien Morino
+ *
+ * Helpers shared by the micro-benchmarks of the containers.
+ *
+ * Each benchmark is a standalone program printing one line per measured operation,
+ * with the average time per operation.
+ */
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "definitions.h"
+#include "platform/platform.h"
+
+#include <stdio.h>
+
+/**
+ * Pseudo-random number generator (xorshift64), so benchmarks are reproducible.
+ */
+static inline u64 bench_random(u64* state) {
+    u64 x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return x;
+}
+
+/**
+ * Prints the average time of an operation.
+ *
+ * @param name The name of the operation.
+ * @param count The number of times the operation was performed.
+ * @param start The timestamp taken before performing the operations, from @ref get_monotonic_ns.
+ */
+static inline void bench_report(const char* name, u64 count, u64 start) {
+    u64 elapsed = get_monotonic_ns() - start;
+    printf("  %-32s %10llu ops %10.2f ns/op\n",
+           name,
+           (unsigned long long) count,
+           count ? (f64) elapsed / count : 0.0);
+}
+
+/**
+ * Prevents the compiler from optimizing away a computed value.
+ */
+#define bench_keep(value) __asm__ volatile("" : : "r"(value) : "memory")
+
+#endif /* ! BENCH_H */
@@ -0,0 +1,278 @@
+/**
+ * @file bench_dict.c
+ *
+ * Benchmark of dictionaries, on the workloads of the event registry, the registries and JSON objects.
+ *
+ * Each workload is also run with a copy of the previous dictionary implementation (an array of
+ * `[hash | key | value]` records probed with `idx = (5 * idx + 1) % capacity`), as a baseline.
+ * The baseline is only used with fixed capacities, since it can not be resized reliably.
+ * Its functions are not inlined, like the functions of the library.
+ *
+ * The event registry and registry workloads are also run with dictionaries specialized with
+ * @ref DICT_DEFINE, like the ones used by the event and registry subsystems.
+ */
+
+#include "bench.h"
+
+#include "containers/dict.h"
+#include "containers/dict_template.h"
+#include "logger.h"
+#include "memory/arena.h"
+#include "resource/resource_id.h"
+#include "utils/string.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct LegacyDict {
+    u8* base;
+    const Comparator* comparator;
+    u64 capacity;
+    u64 size;
+    u64 key_stride;
+    u64 value_stride;
+} LegacyDict;
+
+static void legacy_init(LegacyDict* map, const Comparator* cmp, u64 capacity, u64 key_stride, u64 value_stride) {
+    map->base = calloc(capacity, sizeof(u64) + key_stride + value_stride);
+    map->comparator = cmp;
+    map->capacity = capacity;
+    map->size = 0;
+    map->key_stride = key_stride;
+    map->value_stride = value_stride;
+}
+
+static u8* legacy_node(const LegacyDict* map, u64 idx) {
+    return map->base + idx * (sizeof(u64) + map->key_stride + map->value_stride);
+}
+
+__attribute__((noinline)) static void legacy_put(LegacyDict* map, const void* key, const void* value) {
+    u64 h = cmp_hash(map->comparator, key, map->key_stride);
+    u64 idx = h % map->capacity;
+    u8* node = legacy_node(map, idx);
+    while (*(u64*) node != 0 &&
+           (*(u64*) node != h ||
+            cmp_compare(map->comparator, node + sizeof(u64), key, map->key_stride) != 0)) {
+        idx = (5 * idx + 1) % map->capacity;
+        node = legacy_node(map, idx);
+    }
+    *(u64*) node = h;
+    memcpy(node + sizeof(u64), key, map->key_stride);
+    memcpy(node + sizeof(u64) + map->key_stride, value, map->value_stride);
+    map->size++;
+}
+
+__attribute__((noinline)) static void* legacy_ref(const LegacyDict* map, const void* key) {
+    u64 h = cmp_hash(map->comparator, key, map->key_stride);
+    u64 idx = h % map->capacity;
+    u64 count = 0;
+    u8* node = legacy_node(map, idx);
+    while (*(u64*) node == 0 || *(u64*) node != h ||
+           cmp_compare(map->comparator, node + sizeof(u64), key, map->key_stride) != 0) {
+        if (*(u64*) node != 0)
+            count++;
+        if (count == map->size)
+            return NULL;
+        idx = (5 * idx + 1) % map->capacity;
+        node = legacy_node(map, idx);
+    }
+    return node + sizeof(u64) + map->key_stride;
+}
+
+/** Value of event registry entries: a vector of listeners and a name. */
+typedef struct EventValue {
+    u64 data[7];
+} EventValue;
+
+static inline u64 code_hash(const u32* code) {
+    return *code;
+}
+
+static inline bool code_equals(const u32* lhs, const u32* rhs) {
+    return *lhs == *rhs;
+}
+
+DICT_DEFINE(EventMap, eventmap, u32, EventValue, code_hash, code_equals)
+DICT_DEFINE(IdMap, idmap, ResourceID, u64, resid_hash, resid_equals)
+
+static void bench_events(void) {
+    const u32 count = 64;
+    const u64 lookups = 1000000;
+    printf("Event registry (%u events, fixed capacity 256):\n", count);
+
+    Arena arena = arena_create(1 << 20, BLK_TAG_UNKNOWN);
+    Dict dict;
+    dict_init_fixed(&dict, NULL, &arena, 256, sizeof(u32), sizeof(EventValue));
+    LegacyDict legacy;
+    legacy_init(&legacy, NULL, 256, sizeof(u32), sizeof(EventValue));
+    EventMap specialized;
+    eventmap_init_fixed(&specialized, &arena, 256);
+
+    EventValue value = {0};
+    for (u32 i = 0; i < count; i++) {
+        value.data[0] = i;
+        dict_put(&dict, &i, &value);
+        legacy_put(&legacy, &i, &value);
+        eventmap_put(&specialized, &i, &value);
+    }
+
+    u64 random = 0x9E3779B97F4A7C15;
+    u64 sum = 0;
+    u64 start = get_monotonic_ns();
+    for (u64 i = 0; i < lookups; i++) {
+        u32 code = bench_random(&random) % count;
+        EventValue* entry = dict_ref(&dict, dict_get(&dict, &code, NULL));
+        sum += entry->data[0];
+    }
+    bench_keep(sum);
+    bench_report("get + ref", lookups, start);
+
+    start = get_monotonic_ns();
+    for (u64 i = 0; i < lookups; i++) {
+        u32 code = bench_random(&random) % count;
+        EventValue* entry = legacy_ref(&legacy, &code);
+        sum += entry->data[0];
+    }
+    bench_keep(sum);
+    bench_report("get + ref (previous dict)", lookups, start);
+
+    start = get_monotonic_ns();
+    for (u64 i = 0; i < lookups; i++) {
+        u32 code = bench_random(&random) % count;
+        EventValue* entry = eventmap_ref(&specialized, &code);
+        sum += entry->data[0];
+    }
+    bench_keep(sum);
+    bench_report("ref (specialized)", lookups, start);
+
+    free(legacy.base);
+    arena_destroy(&arena);
+}
+
+static void bench_registry(void) {
+    const u32 count = 400;
+    const u64 lookups = 1000000;
+    printf("Registry (%u resource IDs, fixed capacity 512):\n", count);
+
+    Arena arena = arena_create(1 << 20, BLK_TAG_UNKNOWN);
+    Dict dict;
+    dict_init_fixed(&dict, NULL, &arena, 512, sizeof(ResourceID), sizeof(u64));
+    LegacyDict legacy;
+    legacy_init(&legacy, NULL, 512, sizeof(ResourceID), sizeof(u64));
+    IdMap specialized;
+    idmap_init_fixed(&specialized, &arena, 512);
+
+    ResourceID* ids = arena_allocate(&arena, count * sizeof(ResourceID), ALLOC_TAG_UNKNOWN);
+    char name[32];
+    for (u32 i = 0; i < count; i++) {
+        snprintf(name, sizeof name, "block_%u", i);
+        ids[i] = resid_default_cstr(name);
+    }
+
+    u64 start = get_monotonic_ns();
+    for (u64 i = 0; i < count; i++) {
+        dict_put(&dict, &ids[i], &i);
+    }
+    bench_report("put", count, start);
+
+    start = get_monotonic_ns();
+    for (u64 i = 0; i < count; i++) {
+        legacy_put(&legacy, &ids[i], &i);
+    }
+    bench_report("put (previous dict)", count, start);
+
+    start = get_monotonic_ns();
+    for (u64 i = 0; i < count; i++) {
+        idmap_put(&specialized, &ids[i], &i);
+    }
+    bench_report("put (specialized)", count, start);
+
+    u64 random = 0x9E3779B97F4A7C15;
+    u64 sum = 0;
+    start = get_monotonic_ns();
+    for (u64 i = 0; i < lookups; i++) {
+        u64 out;
+        dict_get(&dict, &ids[bench_random(&random) % count], &out);
+        sum += out;
+    }
+    bench_keep(sum);
+    bench_report("get", lookups, start);
+
+    start = get_monotonic_ns();
+    for (u64 i = 0; i < lookups; i++) {
+        sum += *(u64*) legacy_ref(&legacy, &ids[bench_random(&random) % count]);
+    }
+    bench_keep(sum);
+    bench_report("get (previous dict)", lookups, start);
+
+    start = get_monotonic_ns();
+    for (u64 i = 0; i < lookups; i++) {
+        sum += *idmap_ref(&specialized, &ids[bench_random(&random) % count]);
+    }
+    bench_keep(sum);
+    bench_report("ref (specialized)", lookups, start);
+
+    free(legacy.base);
+    arena_destroy(&arena);
+}
+
+static void bench_json_objects(void) {
+    static const char* const properties[] = {
+        "name", "id", "type", "value", "description", "enabled", "children", "parent",
+    };
+    const u32 property_count = sizeof properties / sizeof *properties;
+    const u64 objects = 100000;
+    printf("JSON objects (%llu objects of %u properties):\n", (unsigned long long) objects, property_count);
+
+    string keys[sizeof properties / sizeof *properties];
+    for (u32 i = 0; i < property_count; i++) {
+        keys[i] = str_create_view(properties[i]);
+    }
+
+    // Objects are built, queried once per property, then destroyed, like parsed JSON documents.
+    u64 sum = 0;
+    u64 start = get_monotonic_ns();
+    for (u64 i = 0; i < objects; i++) {
+        Dict dict;
+        dict_init(&dict, &CMP_STRING, sizeof(string), sizeof(u64));
+        for (u64 j = 0; j < property_count; j++) {
+            dict_put(&dict, &keys[j], &j);
+        }
+        for (u64 j = 0; j < property_count; j++) {
+            u64 out;
+            dict_get(&dict, &keys[j], &out);
+            sum += out;
+        }
+        dict_destroy(&dict);
+    }
+    bench_keep(sum);
+    bench_report("build + get + destroy", objects, start);
+
+    start = get_monotonic_ns();
+    for (u64 i = 0; i < objects; i++) {
+        LegacyDict legacy;
+        legacy_init(&legacy, &CMP_STRING, 16, sizeof(string), sizeof(u64));
+        for (u64 j = 0; j < property_count; j++) {
+            legacy_put(&legacy, &keys[j], &j);
+        }
+        for (u64 j = 0; j < property_count; j++) {
+            sum += *(u64*) legacy_ref(&legacy, &keys[j]);
+        }
+        free(legacy.base);
+    }
+    bench_keep(sum);
+    bench_report("build + get + destroy (previous dict)", objects, start);
+}
+
+int main(void) {
+    logger_system_init();
+    intern_system_init();
+
+    bench_events();
+    bench_registry();
+    bench_json_objects();
+
+    intern_system_cleanup();
+    logger_system_cleanup();
+    return 0;
+}
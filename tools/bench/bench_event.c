@@ -0,0 +1,245 @@
+/**
+ * @file bench_event.c
+ *
+ * Benchmark of event queues, with 8 producer threads and a single consumer.
+ *
+ * The lock-free MPSC queue is compared to the previous design, a ring queue protected by a mutex,
+ * then events go through the whole event sub-system (trigger, batch dispatch to a listener running
+ * on the event handling thread, on workers, or on a serial executor).
+ */
+
+#include "bench.h"
+
+#include "containers/mpsc_queue.h"
+#include "containers/ring_queue.h"
+#include "event/event.h"
+#include "logger.h"
+#include "memory/arena.h"
+#include "platform/mc_thread.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PRODUCER_COUNT 8
+#define EVENTS_PER_PRODUCER 500000
+#define QUEUE_CAPACITY 4096
+#define BATCH_SIZE 64
+
+#define BENCH_EVENT 1
+#define PAYLOAD_SIZE 256
+
+/** How events carry their payload. */
+enum PayloadMode {
+    PAYLOAD_NONE,
+    PAYLOAD_RING, /**< Allocated with event_payload_alloc. */
+    PAYLOAD_HEAP, /**< Allocated with malloc by the producer, freed by the listener. */
+};
+
+static enum PayloadMode payload_mode;
+
+typedef struct Item {
+    u64 payload[4];
+} Item;
+
+typedef struct LockedQueue {
+    pthread_mutex_t mutex;
+    RingQueue queue;
+} LockedQueue;
+
+static MPSCQueue lock_free_queue;
+static LockedQueue locked_queue;
+static _Atomic u32 started_producers;
+
+static void start_together(void) {
+    atomic_fetch_add(&started_producers, 1);
+    while (atomic_load(&started_producers) < PRODUCER_COUNT)
+        sched_yield();
+}
+
+static void report_rate(const char* name, u64 count, u64 start) {
+    u64 elapsed = get_monotonic_ns() - start;
+    bench_report(name, count, start);
+    printf("  %-32s %10.2f M events/s\n", "", (f64) count * 1000.0 / (f64) elapsed);
+}
+
+static void* lock_free_producer(void* arg) {
+    Item item = {.payload = {(u64) arg}};
+    start_together();
+    for (u64 i = 0; i < EVENTS_PER_PRODUCER; i++) {
+        item.payload[1] = i;
+        while (!mpscq_try_enqueue(&lock_free_queue, &item))
+            sched_yield();
+    }
+    return NULL;
+}
+
+static void* locked_producer(void* arg) {
+    Item item = {.payload = {(u64) arg}};
+    start_together();
+    for (u64 i = 0; i < EVENTS_PER_PRODUCER; i++) {
+        item.payload[1] = i;
+        while (TRUE) {
+            pthread_mutex_lock(&locked_queue.mutex);
+            bool enqueued = locked_queue.queue.length < locked_queue.queue.capacity &&
+                            rqueue_enqueue(&locked_queue.queue, &item);
+            pthread_mutex_unlock(&locked_queue.mutex);
+            if (enqueued)
+                break;
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static void start_producers(MCThread* threads, mcthread_routine routine) {
+    atomic_store(&started_producers, 0);
+    for (u64 i = 0; i < PRODUCER_COUNT; i++) {
+        mcthread_create(&threads[i], routine, (void*) i);
+    }
+}
+
+static void join_producers(MCThread* threads) {
+    for (u64 i = 0; i < PRODUCER_COUNT; i++) {
+        mcthread_join(&threads[i], NULL);
+    }
+}
+
+static void bench_lock_free_queue(void) {
+    Arena arena = arena_create_reserved(1L << 20, BLK_TAG_UNKNOWN, FALSE);
+    lock_free_queue = mpscq_create(QUEUE_CAPACITY, sizeof(Item), &arena);
+    MCThread threads[PRODUCER_COUNT];
+    Item batch[BATCH_SIZE];
+    u64 total = (u64) PRODUCER_COUNT * EVENTS_PER_PRODUCER;
+
+    u64 start = get_monotonic_ns();
+    start_producers(threads, &lock_free_producer);
+    u64 sum = 0;
+    for (u64 received = 0; received < total;) {
+        u32 count = mpscq_dequeue_batch(&lock_free_queue, batch, BATCH_SIZE);
+        for (u32 i = 0; i < count; i++) {
+            sum += batch[i].payload[1];
+        }
+        received += count;
+        if (count == 0)
+            sched_yield();
+    }
+    report_rate("lock-free MPSC queue", total, start);
+    bench_keep(sum);
+
+    join_producers(threads);
+    arena_destroy(&arena);
+}
+
+static void bench_locked_queue(void) {
+    Arena arena = arena_create_reserved(1L << 20, BLK_TAG_UNKNOWN, FALSE);
+    locked_queue.queue = rqueue_create(QUEUE_CAPACITY, sizeof(Item), &arena);
+    pthread_mutex_init(&locked_queue.mutex, NULL);
+    MCThread threads[PRODUCER_COUNT];
+    u64 total = (u64) PRODUCER_COUNT * EVENTS_PER_PRODUCER;
+
+    u64 start = get_monotonic_ns();
+    start_producers(threads, &locked_producer);
+    u64 sum = 0;
+    for (u64 received = 0; received < total;) {
+        Item item;
+        pthread_mutex_lock(&locked_queue.mutex);
+        bool dequeued = locked_queue.queue.length > 0 && rqueue_dequeue(&locked_queue.queue, &item);
+        pthread_mutex_unlock(&locked_queue.mutex);
+        if (dequeued) {
+            sum += item.payload[1];
+            received++;
+        } else {
+            sched_yield();
+        }
+    }
+    report_rate("mutex + ring queue (baseline)", total, start);
+    bench_keep(sum);
+
+    join_producers(threads);
+    pthread_mutex_destroy(&locked_queue.mutex);
+    arena_destroy(&arena);
+}
+
+static bool count_event(u32 event, void* user_data, EventInfo info) {
+    (void) event;
+    *(u64*) user_data += info.event_data.u64[1];
+    if (payload_mode != PAYLOAD_NONE) {
+        u64* payload = info.payload;
+        *(u64*) user_data += payload[PAYLOAD_SIZE / sizeof(u64) - 1];
+    }
+    if (payload_mode == PAYLOAD_HEAP)
+        free(info.payload);
+    return TRUE;
+}
+
+static bool count_event_atomic(u32 event, void* user_data, EventInfo info) {
+    (void) event;
+    atomic_fetch_add((_Atomic u64*) user_data, info.event_data.u64[1]);
+    return TRUE;
+}
+
+static void* event_producer(void* arg) {
+    EventInfo info = {.sender = arg, .key = (u64) arg + 1};
+    start_together();
+    for (u64 i = 0; i < EVENTS_PER_PRODUCER; i++) {
+        info.event_data.u64[1] = i;
+        if (payload_mode == PAYLOAD_RING)
+            info.payload = event_payload_alloc(PAYLOAD_SIZE);
+        else if (payload_mode == PAYLOAD_HEAP)
+            info.payload = malloc(PAYLOAD_SIZE);
+        if (payload_mode != PAYLOAD_NONE)
+            memset(info.payload, (u8) i, PAYLOAD_SIZE);
+        event_trigger(BENCH_EVENT, info);
+    }
+    return NULL;
+}
+
+static void* run_event_producers(void* arg) {
+    (void) arg;
+    MCThread threads[PRODUCER_COUNT];
+    start_producers(threads, &event_producer);
+    join_producers(threads);
+
+    event_trigger(BEVENT_STOP, (EventInfo){0});
+    return NULL;
+}
+
+static void bench_event_system(const char* name, EventAffinity affinity, enum PayloadMode mode) {
+    payload_mode = mode;
+    event_system_init();
+    event_register_event(BENCH_EVENT, str_create_view("BENCH"));
+    _Atomic u64 sum = 0;
+    if (affinity.type == EVENT_AFFINITY_MAIN)
+        event_register_listener(BENCH_EVENT, &count_event, &sum);
+    else
+        event_register_listener_on(BENCH_EVENT, &count_event_atomic, &sum, affinity);
+
+    MCThread launcher;
+    u64 start = get_monotonic_ns();
+    mcthread_create(&launcher, &run_event_producers, NULL);
+    event_handle();
+    mcthread_join(&launcher, NULL);
+    // Wait for executors to run all listeners.
+    event_system_cleanup();
+    report_rate(name, (u64) PRODUCER_COUNT * EVENTS_PER_PRODUCER, start);
+    bench_keep(atomic_load(&sum));
+}
+
+int main(void) {
+    logger_system_init();
+
+    printf("%d producers, %d events each:\n", PRODUCER_COUNT, EVENTS_PER_PRODUCER);
+    bench_locked_queue();
+    bench_lock_free_queue();
+    bench_event_system("trigger + dispatch (main)", EVENT_ON_MAIN, PAYLOAD_NONE);
+    bench_event_system("trigger + dispatch (workers)", EVENT_ON_WORKER, PAYLOAD_NONE);
+    bench_event_system("trigger + dispatch (executor)", EVENT_ON_EXECUTOR("bench"), PAYLOAD_NONE);
+    bench_event_system("256 B payload (ring)", EVENT_ON_MAIN, PAYLOAD_RING);
+    bench_event_system("256 B payload (malloc)", EVENT_ON_MAIN, PAYLOAD_HEAP);
+
+    logger_system_cleanup();
+    return 0;
+}
@@ -0,0 +1,176 @@
+/**
+ * @file bench_hash.c
+ *
+ * Benchmark of hash functions, on realistic keys: resource IDs, player names and packed
+ * chunk coordinates.
+ *
+ * The current hash functions are compared with the previous default hash (sdbm, one byte at a time).
+ * For each kind of key, the throughput is measured, as well as the distribution of hashes:
+ * keys are put in as many buckets as there are keys (using the lowest bits of hashes, like hash
+ * tables do), and the number of colliding keys is compared to the number expected with a perfectly
+ * random hash function.
+ */
+
+#include "bench.h"
+
+#include "utils/hash.h"
+#include "logger.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define KEY_COUNT (1 << 16)
+#define ROUNDS 50
+
+typedef struct Key {
+    char text[48];
+    u64 length;
+} Key;
+
+__attribute__((noinline)) static u64 sdbm_hash(const void* data, u64 size) {
+    const u8* bytes = data;
+    u64 hash = 37;
+    for (u64 i = 0; i < size; i++) {
+        hash = bytes[i] + (hash << 6) + (hash << 16) - hash;
+    }
+    return hash;
+}
+
+static void report_collisions(const char* name, const u64* hashes, u64 count) {
+    u8* buckets = calloc(count, 1);
+    u64 occupied = 0;
+    u64 full_collisions = 0;
+    for (u64 i = 0; i < count; i++) {
+        u64 bucket = hashes[i] & (count - 1);
+        if (!buckets[bucket])
+            occupied++;
+        buckets[bucket] = 1;
+    }
+    // Full 64-bit collisions, between consecutive keys only, to keep this quick.
+    for (u64 i = 1; i < count; i++) {
+        if (hashes[i] == hashes[i - 1])
+            full_collisions++;
+    }
+    // With n random keys in n buckets, about n / e keys collide.
+    f64 expected = count * 0.36788;
+    printf("  %-32s %10llu colliding keys (random: %.0f), %llu equal hashes\n",
+           name,
+           (unsigned long long) (count - occupied),
+           expected,
+           (unsigned long long) full_collisions);
+    free(buckets);
+}
+
+static void bench_text_keys(const char* title, const Key* keys) {
+    printf("%s (%u keys):\n", title, KEY_COUNT);
+    u64* hashes = malloc(KEY_COUNT * sizeof(u64));
+
+    u64 start = get_monotonic_ns();
+    for (u32 round = 0; round < ROUNDS; round++) {
+        for (u32 i = 0; i < KEY_COUNT; i++) {
+            hashes[i] = sdbm_hash(keys[i].text, keys[i].length);
+        }
+        bench_keep(hashes[0]);
+    }
+    bench_report("sdbm (previous)", (u64) KEY_COUNT * ROUNDS, start);
+    report_collisions("sdbm (previous)", hashes, KEY_COUNT);
+
+    start = get_monotonic_ns();
+    for (u32 round = 0; round < ROUNDS; round++) {
+        for (u32 i = 0; i < KEY_COUNT; i++) {
+            hashes[i] = default_hash(keys[i].text, keys[i].length);
+        }
+        bench_keep(hashes[0]);
+    }
+    bench_report("default_hash", (u64) KEY_COUNT * ROUNDS, start);
+    report_collisions("default_hash", hashes, KEY_COUNT);
+
+    free(hashes);
+}
+
+static void bench_chunk_positions(void) {
+    printf("Packed chunk coordinates (%u keys):\n", KEY_COUNT);
+    u64* keys = malloc(KEY_COUNT * sizeof(u64));
+    u64* hashes = malloc(KEY_COUNT * sizeof(u64));
+    // A square of 256x256 chunks around the origin, as (x << 32) | z.
+    for (u32 i = 0; i < KEY_COUNT; i++) {
+        i32 x = (i32) (i / 256) - 128;
+        i32 z = (i32) (i % 256) - 128;
+        keys[i] = ((u64) (u32) x << 32) | (u32) z;
+    }
+
+    u64 start = get_monotonic_ns();
+    for (u32 round = 0; round < ROUNDS; round++) {
+        for (u32 i = 0; i < KEY_COUNT; i++) {
+            hashes[i] = sdbm_hash(&keys[i], sizeof(u64));
+        }
+        bench_keep(hashes[0]);
+    }
+    bench_report("sdbm (previous)", (u64) KEY_COUNT * ROUNDS, start);
+    report_collisions("sdbm (previous)", hashes, KEY_COUNT);
+
+    start = get_monotonic_ns();
+    for (u32 round = 0; round < ROUNDS; round++) {
+        for (u32 i = 0; i < KEY_COUNT; i++) {
+            hashes[i] = default_hash(&keys[i], sizeof(u64));
+        }
+        bench_keep(hashes[0]);
+    }
+    bench_report("default_hash", (u64) KEY_COUNT * ROUNDS, start);
+    report_collisions("default_hash", hashes, KEY_COUNT);
+
+    start = get_monotonic_ns();
+    for (u32 round = 0; round < ROUNDS; round++) {
+        for (u32 i = 0; i < KEY_COUNT; i++) {
+            hashes[i] = hash_u64(keys[i]);
+        }
+        bench_keep(hashes[0]);
+    }
+    bench_report("hash_u64", (u64) KEY_COUNT * ROUNDS, start);
+    report_collisions("hash_u64", hashes, KEY_COUNT);
+
+    free(hashes);
+    free(keys);
+}
+
+int main(void) {
+    logger_system_init();
+
+    static const char* const kinds[] = {"block", "item", "entity_type", "biome", "sound_event"};
+    static const char* const syllables[] = {"ka", "zu", "mi", "ro", "xx", "_", "te", "42", "Lo", "ny"};
+    Key* keys = calloc(KEY_COUNT, sizeof(Key));
+    u64 random = 0x9E3779B97F4A7C15;
+
+    for (u32 i = 0; i < KEY_COUNT; i++) {
+        keys[i].length = snprintf(keys[i].text,
+                                  sizeof keys[i].text,
+                                  "minecraft:%s/%s_%u",
+                                  kinds[i % 5],
+                                  syllables[i % 10],
+                                  i);
+    }
+    bench_text_keys("Resource IDs", keys);
+
+    // Player names have 3 to 16 characters: up to 11 letters, and a unique number of up to 5 digits.
+    for (u32 i = 0; i < KEY_COUNT; i++) {
+        u64 length = 0;
+        u64 target = 1 + bench_random(&random) % 11;
+        while (length < target) {
+            const char* syllable = syllables[bench_random(&random) % 10];
+            u64 n = strlen(syllable);
+            if (length + n > 11)
+                break;
+            memcpy(keys[i].text + length, syllable, n);
+            length += n;
+        }
+        length += snprintf(keys[i].text + length, sizeof keys[i].text - length, "%u", i);
+        keys[i].length = length;
+    }
+    bench_text_keys("Player names", keys);
+
+    bench_chunk_positions();
+
+    free(keys);
+    logger_system_cleanup();
+    return 0;
+}
@@ -0,0 +1,148 @@
+/**
+ * @file bench_log.c
+ *
+ * Benchmark of logging calls, as seen by the calling thread.
+ *
+ * The asynchronous logger is compared to the previous design, formatting with fprintf under a
+ * mutex on the calling thread. Messages are written to /dev/null.
+ *
+ * Long runs measure the throughput of the logger thread, since rings fill up. Short bursts,
+ * flushed between measurements, measure the cost of a call on the calling thread only.
+ */
+
+#include "bench.h"
+
+#include "logger.h"
+#include "platform/mc_thread.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <sched.h>
+#include <unistd.h>
+
+#define MESSAGE_COUNT 1000000
+#define THREAD_COUNT 4
+/** Messages fitting in a ring. */
+#define BURST_SIZE 1000
+
+static i32 saved_stdout;
+static FILE* null_stream;
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static _Atomic u32 started_threads;
+
+/** The previous logger. */
+static void locked_logf(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    pthread_mutex_lock(&mutex);
+    fprintf(null_stream, "%s%s ", "\x1b[0m", "[ INFO]");
+    vfprintf(null_stream, format, args);
+    fputs("\x1b[0m\n", null_stream);
+    pthread_mutex_unlock(&mutex);
+    va_end(args);
+}
+
+static void silence(void) {
+    fflush(stdout);
+    i32 null_fd = open("/dev/null", O_WRONLY);
+    dup2(null_fd, STDOUT_FILENO);
+    close(null_fd);
+}
+
+static void restore(void) {
+    logger_flush();
+    dup2(saved_stdout, STDOUT_FILENO);
+}
+
+static void* log_async(void* arg) {
+    u64 count = (u64) arg;
+    atomic_fetch_add(&started_threads, 1);
+    while (atomic_load(&started_threads) < THREAD_COUNT)
+        sched_yield();
+    for (u64 i = 0; i < count; i++) {
+        log_infof("Accepted connection %zu from %s:%u.", i, "127.0.0.1", 25565);
+    }
+    return NULL;
+}
+
+static void* log_locked(void* arg) {
+    u64 count = (u64) arg;
+    atomic_fetch_add(&started_threads, 1);
+    while (atomic_load(&started_threads) < THREAD_COUNT)
+        sched_yield();
+    for (u64 i = 0; i < count; i++) {
+        locked_logf("Accepted connection %zu from %s:%u.", i, "127.0.0.1", 25565);
+    }
+    return NULL;
+}
+
+static void bench_single_thread(const char* name, void (*log_fn)(u64)) {
+    silence();
+    u64 start = get_monotonic_ns();
+    log_fn(MESSAGE_COUNT);
+    u64 elapsed = get_monotonic_ns() - start;
+    restore();
+    printf("  %-32s %10u ops %10.2f ns/op\n", name, MESSAGE_COUNT, (f64) elapsed / MESSAGE_COUNT);
+}
+
+static void bench_bursts(const char* name, void (*log_fn)(u64)) {
+    silence();
+    u64 elapsed = 0;
+    for (u32 i = 0; i < MESSAGE_COUNT / BURST_SIZE; i++) {
+        u64 start = get_monotonic_ns();
+        log_fn(BURST_SIZE);
+        elapsed += get_monotonic_ns() - start;
+        logger_flush();
+    }
+    restore();
+    printf("  %-32s %10u ops %10.2f ns/op\n", name, MESSAGE_COUNT, (f64) elapsed / MESSAGE_COUNT);
+}
+
+static void bench_threads(const char* name, mcthread_routine routine) {
+    MCThread threads[THREAD_COUNT];
+    atomic_store(&started_threads, 0);
+    silence();
+    u64 start = get_monotonic_ns();
+    for (u64 i = 0; i < THREAD_COUNT; i++) {
+        mcthread_create(&threads[i], routine, (void*) (MESSAGE_COUNT / THREAD_COUNT));
+    }
+    for (u64 i = 0; i < THREAD_COUNT; i++) {
+        mcthread_join(&threads[i], NULL);
+    }
+    u64 elapsed = get_monotonic_ns() - start;
+    restore();
+    printf("  %-32s %10u ops %10.2f ns/op\n", name, MESSAGE_COUNT, (f64) elapsed / MESSAGE_COUNT);
+}
+
+static void run_async(u64 count) {
+    for (u64 i = 0; i < count; i++) {
+        log_infof("Accepted connection %zu from %s:%u.", i, "127.0.0.1", 25565);
+    }
+}
+
+static void run_locked(u64 count) {
+    for (u64 i = 0; i < count; i++) {
+        locked_logf("Accepted connection %zu from %s:%u.", i, "127.0.0.1", 25565);
+    }
+}
+
+int main(void) {
+    logger_system_init();
+    saved_stdout = dup(STDOUT_FILENO);
+    null_stream  = fopen("/dev/null", "w");
+
+    printf("%d messages:\n", MESSAGE_COUNT);
+    bench_single_thread("fprintf + mutex (baseline)", &run_locked);
+    bench_single_thread("async logger", &run_async);
+    bench_bursts("fprintf + mutex, bursts", &run_locked);
+    bench_bursts("async logger, bursts", &run_async);
+    bench_threads("fprintf + mutex, 4 threads", &log_locked);
+    bench_threads("async logger, 4 threads", &log_async);
+
+    fclose(null_stream);
+    close(saved_stdout);
+    logger_system_cleanup();
+    return 0;
+}
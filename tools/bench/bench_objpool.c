@@ -0,0 +1,80 @@
+/**
+ * @file bench_objpool.c
+ *
+ * Benchmark of object pools, with 10k and 100k objects.
+ */
+
+#include "bench.h"
+
+#include "containers/object_pool.h"
+#include "logger.h"
+#include "memory/arena.h"
+
+typedef struct Object {
+    u64 values[8];
+} Object;
+
+static void sum_objects(void* ptr, i64 index, void* user_data) {
+    (void) index;
+    Object* obj = ptr;
+    *(u64*) user_data += obj->values[0];
+}
+
+static void run(u64 count) {
+    printf("%llu objects:\n", (unsigned long long) count);
+
+    Arena arena = arena_create_reserved(count * sizeof(Object) * 4, BLK_TAG_UNKNOWN, FALSE);
+    ObjectPool pool;
+    objpool_init_dynamic(&pool, &arena, 64, sizeof(Object));
+    u64 random = 0x9E3779B97F4A7C15;
+
+    u64 start = get_monotonic_ns();
+    for (u64 i = 0; i < count; i++) {
+        Object* obj = objpool_add(&pool, NULL);
+        obj->values[0] = i;
+    }
+    bench_report("add", count, start);
+
+    start = get_monotonic_ns();
+    u64 sum = 0;
+    for (u64 i = 0; i < count; i++) {
+        Object* obj = objpool_get(&pool, bench_random(&random) % count);
+        sum += obj->values[0];
+    }
+    bench_keep(sum);
+    bench_report("get (random)", count, start);
+
+    // Leave one object out of 16, to make the pool sparse.
+    start = get_monotonic_ns();
+    for (u64 i = 0; i < count; i++) {
+        if (i % 16 != 0)
+            objpool_remove(&pool, i);
+    }
+    bench_report("remove", count - count / 16, start);
+
+    start = get_monotonic_ns();
+    u64 iterations = 100;
+    for (u64 i = 0; i < iterations; i++) {
+        objpool_foreach(&pool, &sum_objects, &sum);
+    }
+    bench_keep(sum);
+    bench_report("foreach (sparse, per object)", iterations * objpool_size(&pool), start);
+
+    start = get_monotonic_ns();
+    for (u64 i = 0; i < count - count / 16; i++) {
+        objpool_add(&pool, NULL);
+    }
+    bench_report("add (reusing free slots)", count - count / 16, start);
+
+    arena_destroy(&arena);
+}
+
+int main(void) {
+    logger_system_init();
+
+    run(10000);
+    run(100000);
+
+    logger_system_cleanup();
+    return 0;
+}
@@ -0,0 +1,62 @@
+/**
+ * @file bench_vector.c
+ *
+ * Benchmark of dynamic vectors, with 10k, 100k and 1M elements.
+ */
+
+#include "bench.h"
+
+#include "containers/vector.h"
+#include "logger.h"
+#include "memory/arena.h"
+
+static void run(u64 count) {
+    printf("%llu elements:\n", (unsigned long long) count);
+
+    Arena arena = arena_create_reserved(count * sizeof(u64) * 4, BLK_TAG_UNKNOWN, FALSE);
+    Vector vector;
+    vect_init_dynamic(&vector, &arena, 16, sizeof(u64));
+    u64 random = 0x9E3779B97F4A7C15;
+
+    u64 start = get_monotonic_ns();
+    for (u64 i = 0; i < count; i++) {
+        vect_add(&vector, &i);
+    }
+    bench_report("add", count, start);
+
+    start = get_monotonic_ns();
+    u64 sum = 0;
+    for (u64 i = 0; i < count; i++) {
+        sum += *(u64*) vect_ref(&vector, i);
+    }
+    bench_keep(sum);
+    bench_report("ref (sequential)", count, start);
+
+    start = get_monotonic_ns();
+    for (u64 i = 0; i < count; i++) {
+        sum += *(u64*) vect_ref(&vector, bench_random(&random) % count);
+    }
+    bench_keep(sum);
+    bench_report("ref (random)", count, start);
+
+    u64 inserts = 100;
+    start = get_monotonic_ns();
+    for (u64 i = 0; i < inserts; i++) {
+        vect_insert(&vector, &i, count / 2);
+        vect_remove(&vector, count / 2, NULL);
+    }
+    bench_report("insert + remove (middle)", inserts, start);
+
+    arena_destroy(&arena);
+}
+
+int main(void) {
+    logger_system_init();
+
+    run(10000);
+    run(100000);
+    run(1000000);
+
+    logger_system_cleanup();
+    return 0;
+}
@@ -0,0 +1,673 @@
+/**
+ * @file loadgen.c
+ * @author Bastien Morino
+ *
+ * Headless client load generator.
+ *
+ * Opens many concurrent connections to a server and runs one of the following scenarios
+ * on each of them:
+ * - `status`: handshake, status request, then ping / pong,
+ * - `login`: handshake, then login start until the login success packet is received.
+ *   The server must be in offline mode, or forward player information from a proxy,
+ *   in which case the load generator plays the role of the proxy.
+ *
+ * When all connections are done, the amount of connections per second, the latency
+ * percentiles and the CPU usage of the server are reported.
+ *
+ * The load generator only runs on Linux, as it uses EPoll directly.
+ */
+
+#include "containers/bytebuffer.h"
+#include "logger.h"
+#include "memory/arena.h"
+#include "memory/mem_tags.h"
+#include "network/compression.h"
+#include "network/forwarding.h"
+#include "network/packet.h"
+#include "network/security.h"
+#include "network/utils.h"
+#include "platform/platform.h"
+#include "platform/socket.h"
+#include "utils/bitwise.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#define PROTOCOL_VERSION 767
+#define CLIENT_RECV_BUFFER_SIZE 8192
+#define CLIENT_SEND_BUFFER_SIZE 2048
+#define SCRATCH_ARENA_SIZE 1048576
+#define CLIENT_TIMEOUT_NS (10ull * 1000000000)
+#define MAX_EVENTS 256
+
+enum Scenario {
+    SCENARIO_STATUS,
+    SCENARIO_LOGIN,
+};
+
+enum ClientState {
+    CLIENT_IDLE,
+    CLIENT_CONNECTING,
+    CLIENT_STATUS,
+    CLIENT_PING,
+    CLIENT_LOGIN,
+};
+
+typedef struct Client {
+    int fd;
+    enum ClientState state;
+    bool compression;
+    u64 id;
+    u64 start_time;
+    ByteBuffer recv_buffer;
+    ByteBuffer send_buffer;
+} Client;
+
+typedef struct Options {
+    char* host;
+    i32 port;
+    u64 concurrency;
+    u64 total;
+    enum Scenario scenario;
+    i32 server_pid;
+    const char* forwarding_secret;
+} Options;
+
+typedef struct Loadgen {
+    Options options;
+    SocketAddress address;
+    int epollfd;
+
+    Arena arena;
+    Arena scratch;
+    CompressionContext cmprss_ctx;
+    string forwarding_secret;
+
+    Client* clients;
+    u64* latencies;
+    u64 started;
+    u64 completed;
+    u64 failed;
+} Loadgen;
+
+/* ===== Packets ===== */
+
+static void write_string(ByteBuffer* buffer, const char* str) {
+    u64 length = strlen(str);
+    bytebuf_write_varint(buffer, length);
+    bytebuf_write(buffer, str, length);
+}
+
+/**
+ * Frames the given packet payload, and queues it in the sending buffer of the client.
+ */
+static void queue_packet(Client* client, i32 id, const ByteBuffer* payload) {
+    u8 id_bytes[VARINT_MAX_SIZE + 1];
+    u64 id_size = encode_varint(id, id_bytes);
+    u64 length = id_size + bytebuf_size(payload);
+
+    // Packets are small enough to never be compressed.
+    if (client->compression) {
+        bytebuf_write_varint(&client->send_buffer, length + 1);
+        bytebuf_write_varint(&client->send_buffer, 0);
+    } else {
+        bytebuf_write_varint(&client->send_buffer, length);
+    }
+    bytebuf_write(&client->send_buffer, id_bytes, id_size);
+    bytebuf_write_buffer(&client->send_buffer, payload);
+}
+
+static void queue_handshake(Loadgen* lg, Client* client, i32 next_state) {
+    ByteBuffer payload = bytebuf_create_fixed(512, &lg->scratch);
+    u16 port = htons(lg->options.port);
+
+    bytebuf_write_varint(&payload, PROTOCOL_VERSION);
+    write_string(&payload, lg->options.host);
+    bytebuf_write(&payload, &port, sizeof port);
+    bytebuf_write_varint(&payload, next_state);
+    queue_packet(client, PKT_HANDSHAKE, &payload);
+}
+
+static void player_name(const Client* client, char* out, u64 size) {
+    snprintf(out, size, "bot%llu", (unsigned long long) client->id);
+}
+
+static void start_scenario(Loadgen* lg, Client* client) {
+    if (lg->options.scenario == SCENARIO_STATUS) {
+        queue_handshake(lg, client, 1);
+        ByteBuffer empty = bytebuf_create_fixed(1, &lg->scratch);
+        queue_packet(client, PKT_STATUS, &empty);
+        client->state = CLIENT_STATUS;
+        return;
+    }
+
+    queue_handshake(lg, client, 2);
+    ByteBuffer payload = bytebuf_create_fixed(64, &lg->scratch);
+    char name[17];
+    player_name(client, name, sizeof name);
+    u64 uuid[2] = {0};
+    write_string(&payload, name);
+    bytebuf_write(&payload, uuid, sizeof uuid);
+    queue_packet(client, PKT_LOGIN_START, &payload);
+    client->state = CLIENT_LOGIN;
+}
+
+/**
+ * Answers the player information query of a server expecting to be behind a proxy.
+ */
+static bool answer_custom_request(Loadgen* lg, Client* client, ByteBuffer* payload) {
+    i32 message_id;
+    string channel;
+    if (bytebuf_read_varint(payload, &message_id) <= 0)
+        return FALSE;
+    if (bytebuf_read_mcstring(payload, &lg->scratch, &channel) <= 0)
+        return FALSE;
+
+    ByteBuffer response = bytebuf_create_fixed(1024, &lg->scratch);
+    bytebuf_write_varint(&response, message_id);
+
+    string forwarding_channel = str_create_view(FORWARDING_CHANNEL);
+    bool understood =
+        lg->forwarding_secret.length > 0 && str_compare(&channel, &forwarding_channel) == 0;
+    bytebuf_write(&response, &understood, sizeof understood);
+    if (understood) {
+        char name[17];
+        player_name(client, name, sizeof name);
+        ForwardedPlayer player = {
+            .address = str_create_view("127.0.0.1"),
+            .name = str_create_view(name),
+        };
+        if (!encryption_offline_uuid(&player.name, player.uuid))
+            return FALSE;
+        vect_init(&player.properties, &lg->scratch, 0, sizeof(PlayerProperty));
+
+        u64 size;
+        u8* data = forwarding_write_player(&lg->forwarding_secret, &lg->scratch, &player, &size);
+        if (!data)
+            return FALSE;
+        bytebuf_write(&response, data, size);
+    }
+
+    queue_packet(client, PKT_LOGIN_CUSTOM_RESPONSE, &response);
+    return TRUE;
+}
+
+/**
+ * Reacts to a packet received by a client.
+ *
+ * @return 1 if the scenario is complete, 0 if it continues, -1 if it failed.
+ */
+static i32 handle_packet(Loadgen* lg, Client* client, i32 id, ByteBuffer* payload) {
+    switch (client->state) {
+    case CLIENT_STATUS: {
+        if (id != PKT_STATUS)
+            return -1;
+        ByteBuffer ping = bytebuf_create_fixed(sizeof(i64), &lg->scratch);
+        bytebuf_write_i64(&ping, (i64) client->start_time);
+        queue_packet(client, PKT_STATUS_PING, &ping);
+        client->state = CLIENT_PING;
+        return 0;
+    }
+    case CLIENT_PING:
+        return id == PKT_STATUS_PING ? 1 : -1;
+    case CLIENT_LOGIN:
+        switch (id) {
+        case PKT_LOGIN_COMPRESS: {
+            i32 threshold;
+            if (bytebuf_read_varint(payload, &threshold) <= 0)
+                return -1;
+            client->compression = threshold >= 0;
+            return 0;
+        }
+        case PKT_LOGIN_CUSTOM_REQUEST:
+            return answer_custom_request(lg, client, payload) ? 0 : -1;
+        case PKT_LOGIN_SUCCESS:
+            return 1;
+        case PKT_LOGIN_CRYPT_REQUEST:
+            log_error("The server requested encryption, it must be in offline mode or behind a "
+                      "proxy (--forwarding-secret).");
+            return -1;
+        default:
+            return -1;
+        }
+    default:
+        return -1;
+    }
+}
+
+/**
+ * Decodes and handles all the complete packets in the receiving buffer of a client.
+ *
+ * @return 1 if the scenario is complete, 0 if it continues, -1 if it failed.
+ */
+static i32 process_packets(Loadgen* lg, Client* client) {
+    ByteBuffer* buffer = &client->recv_buffer;
+    while (TRUE) {
+        ArenaSave save = arena_save(&lg->scratch);
+
+        i32 length;
+        i64 length_size = bytebuf_read_varint(buffer, &length);
+        if (length_size == 0) {
+            arena_restore(&lg->scratch, save);
+            return 0;
+        }
+        if (length_size < 0 || length <= 0 || length > CLIENT_RECV_BUFFER_SIZE) {
+            arena_restore(&lg->scratch, save);
+            return -1;
+        }
+        if (bytebuf_size(buffer) < (u64) length) {
+            bytebuf_unread(buffer, length_size);
+            arena_restore(&lg->scratch, save);
+            return 0;
+        }
+
+        // Isolate the packet, as decompression consumes the whole input buffer.
+        ByteBuffer* packet = arena_allocate(&lg->scratch, sizeof *packet, ALLOC_TAG_BYTEBUFFER);
+        *packet = bytebuf_create_fixed(length, &lg->scratch);
+        u8* raw = arena_allocate(&lg->scratch, length, ALLOC_TAG_BYTEBUFFER);
+        bytebuf_read(buffer, length, raw);
+        bytebuf_write(packet, raw, length);
+
+        if (client->compression) {
+            i32 uncompressed_length;
+            if (bytebuf_read_varint(packet, &uncompressed_length) <= 0) {
+                arena_restore(&lg->scratch, save);
+                return -1;
+            }
+            if (uncompressed_length > 0) {
+                ByteBuffer* uncompressed =
+                    arena_allocate(&lg->scratch, sizeof *uncompressed, ALLOC_TAG_BYTEBUFFER);
+                *uncompressed = bytebuf_create_fixed(uncompressed_length, &lg->scratch);
+                if (compression_decompress(&lg->cmprss_ctx, uncompressed, packet) !=
+                    uncompressed_length) {
+                    arena_restore(&lg->scratch, save);
+                    return -1;
+                }
+                packet = uncompressed;
+            }
+        }
+
+        i32 id;
+        i32 res = -1;
+        if (bytebuf_read_varint(packet, &id) > 0)
+            res = handle_packet(lg, client, id, packet);
+
+        arena_restore(&lg->scratch, save);
+        if (res != 0)
+            return res;
+    }
+}
+
+/* ===== Connections ===== */
+
+static bool flush_client(Client* client) {
+    while (bytebuf_size(&client->send_buffer) > 0) {
+        u64 region_count = 2;
+        BufferRegion regions[2];
+        bytebuf_get_read_regions(&client->send_buffer, regions, &region_count, 0);
+
+        struct iovec iov[2];
+        for (u64 i = 0; i < region_count; i++) {
+            iov[i].iov_base = regions[i].start;
+            iov[i].iov_len = regions[i].size;
+        }
+
+        ssize_t res = writev(client->fd, iov, region_count);
+        if (res < 0)
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        bytebuf_register_read(&client->send_buffer, res);
+    }
+    return TRUE;
+}
+
+/**
+ * Reads all available bytes from the socket of a client, or until its receiving buffer is full.
+ *
+ * @return 1 if the peer closed the connection, 0 if all available bytes were read, 2 if the buffer
+ * is full and bytes may remain, -1 on error.
+ */
+static i32 fill_client(Client* client) {
+    while (bytebuf_size(&client->recv_buffer) < client->recv_buffer.capacity) {
+        u64 region_count = 2;
+        BufferRegion regions[2];
+        bytebuf_get_write_regions(&client->recv_buffer, regions, &region_count, 0);
+
+        struct iovec iov[2];
+        for (u64 i = 0; i < region_count; i++) {
+            iov[i].iov_base = regions[i].start;
+            iov[i].iov_len = regions[i].size;
+        }
+
+        ssize_t res = readv(client->fd, iov, region_count);
+        if (res == 0)
+            return 1;
+        if (res < 0)
+            return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+        bytebuf_register_write(&client->recv_buffer, res);
+    }
+    return 2;
+}
+
+static void finish_client(Loadgen* lg, Client* client, bool success) {
+    if (success)
+        lg->latencies[lg->completed++] = get_monotonic_ns() - client->start_time;
+    else
+        lg->failed++;
+
+    close(client->fd);
+    client->fd = -1;
+    client->state = CLIENT_IDLE;
+}
+
+static bool start_client(Loadgen* lg, Client* client) {
+    client->fd = socket(lg->address.data.family, SOCK_STREAM | SOCK_NONBLOCK, IPPROTO_TCP);
+    if (client->fd < 0) {
+        log_errorf("Could not create a socket: %s.", get_last_error());
+        return FALSE;
+    }
+
+    client->id = lg->started++;
+    client->start_time = get_monotonic_ns();
+    client->compression = FALSE;
+    client->recv_buffer.read_head = 0;
+    client->recv_buffer.write_head = 0;
+    client->recv_buffer.size = 0;
+    client->send_buffer.read_head = 0;
+    client->send_buffer.write_head = 0;
+    client->send_buffer.size = 0;
+
+    if (connect(client->fd, &lg->address.data.sa, lg->address.length) != 0 &&
+        errno != EINPROGRESS) {
+        log_errorf("Could not connect to the server: %s.", get_last_error());
+        finish_client(lg, client, FALSE);
+        return TRUE;
+    }
+
+    client->state = CLIENT_CONNECTING;
+    struct epoll_event event = {
+        .events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET,
+        .data.ptr = client,
+    };
+    if (epoll_ctl(lg->epollfd, EPOLL_CTL_ADD, client->fd, &event) != 0) {
+        log_errorf("Could not watch a socket: %s.", get_last_error());
+        finish_client(lg, client, FALSE);
+    }
+    return TRUE;
+}
+
+static void handle_client_event(Loadgen* lg, Client* client, u32 events) {
+    if (client->state == CLIENT_CONNECTING) {
+        i32 error = 0;
+        socklen_t length = sizeof error;
+        getsockopt(client->fd, SOL_SOCKET, SO_ERROR, &error, &length);
+        if (error != 0) {
+            log_errorf("Could not connect to the server: %s.", get_error_from_code(error));
+            finish_client(lg, client, FALSE);
+            return;
+        }
+        if (!(events & EPOLLOUT))
+            return;
+
+        ArenaSave save = arena_save(&lg->scratch);
+        start_scenario(lg, client);
+        arena_restore(&lg->scratch, save);
+    }
+
+    if (events & EPOLLIN) {
+        // Sockets are edge-triggered: no other event comes until the socket is drained, so packets
+        // are handled to make room each time the buffer fills up.
+        i32 fill_res;
+        do {
+            fill_res = fill_client(client);
+            u64 buffered = bytebuf_size(&client->recv_buffer);
+            i32 res = process_packets(lg, client);
+            if (res != 0 || (fill_res != 0 && fill_res != 2)) {
+                finish_client(lg, client, res == 1);
+                return;
+            }
+            if (fill_res == 2 && bytebuf_size(&client->recv_buffer) == buffered) {
+                log_error("A packet does not fit in the receiving buffer.");
+                finish_client(lg, client, FALSE);
+                return;
+            }
+        } while (fill_res == 2);
+    }
+
+    if (!flush_client(client))
+        finish_client(lg, client, FALSE);
+}
+
+static void expire_clients(Loadgen* lg) {
+    u64 now = get_monotonic_ns();
+    for (u64 i = 0; i < lg->options.concurrency; i++) {
+        Client* client = &lg->clients[i];
+        if (client->state != CLIENT_IDLE && now - client->start_time > CLIENT_TIMEOUT_NS) {
+            log_errorf("Connection %llu timed out.", (unsigned long long) client->id);
+            finish_client(lg, client, FALSE);
+        }
+    }
+}
+
+/* ===== Report ===== */
+
+/**
+ * Reads the CPU time used by a process, in clock ticks.
+ */
+static bool read_process_cpu_time(i32 pid, u64* out_ticks) {
+    char path[64];
+    snprintf(path, sizeof path, "/proc/%i/stat", pid);
+    FILE* file = fopen(path, "r");
+    if (!file)
+        return FALSE;
+
+    char line[1024];
+    bool success = fgets(line, sizeof line, file) != NULL;
+    fclose(file);
+    if (!success)
+        return FALSE;
+
+    // The process name may contain spaces, skip it.
+    char* fields = strrchr(line, ')');
+    if (!fields)
+        return FALSE;
+
+    unsigned long utime;
+    unsigned long stime;
+    if (sscanf(fields + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu", &utime, &stime) != 2)
+        return FALSE;
+    *out_ticks = utime + stime;
+    return TRUE;
+}
+
+static int compare_u64(const void* lhs, const void* rhs) {
+    u64 a = *(const u64*) lhs;
+    u64 b = *(const u64*) rhs;
+    return (a > b) - (a < b);
+}
+
+static f64 percentile_ms(const u64* sorted, u64 count, f64 percentile) {
+    if (count == 0)
+        return 0;
+    u64 index = (u64) (percentile / 100.0 * (count - 1) + 0.5);
+    return sorted[index] / 1e6;
+}
+
+static void report(Loadgen* lg, u64 elapsed_ns, bool has_cpu, u64 cpu_ticks) {
+    f64 elapsed = elapsed_ns / 1e9;
+    qsort(lg->latencies, lg->completed, sizeof *lg->latencies, &compare_u64);
+
+    printf("Scenario:        %s\n", lg->options.scenario == SCENARIO_STATUS ? "status" : "login");
+    printf("Connections:     %llu completed, %llu failed\n",
+           (unsigned long long) lg->completed,
+           (unsigned long long) lg->failed);
+    printf("Duration:        %.3f s\n", elapsed);
+    printf("Throughput:      %.1f conn/s\n", lg->completed / elapsed);
+    printf("Latency (ms):    p50 %.3f | p90 %.3f | p99 %.3f | p99.9 %.3f | max %.3f\n",
+           percentile_ms(lg->latencies, lg->completed, 50),
+           percentile_ms(lg->latencies, lg->completed, 90),
+           percentile_ms(lg->latencies, lg->completed, 99),
+           percentile_ms(lg->latencies, lg->completed, 99.9),
+           percentile_ms(lg->latencies, lg->completed, 100));
+    if (has_cpu) {
+        f64 cpu_seconds = (f64) cpu_ticks / sysconf(_SC_CLK_TCK);
+        printf("Server CPU:      %.2f s (%.1f%% of one core)\n",
+               cpu_seconds,
+               cpu_seconds / elapsed * 100);
+    }
+}
+
+/* ===== Main ===== */
+
+static void usage(const char* program) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  -H <host>       Address of the server (default: 127.0.0.1)\n"
+            "  -p <port>       Port of the server (default: 25565)\n"
+            "  -c <count>      Number of concurrent connections (default: 100)\n"
+            "  -n <count>      Total number of connections (default: 10000)\n"
+            "  -m <scenario>   'status' or 'login' (default: status)\n"
+            "  -P <pid>        PID of the server, to report its CPU usage\n"
+            "  -s <secret>     Forwarding secret, to log in as a proxy would\n",
+            program);
+}
+
+static bool parse_options(int argc, char** argv, Options* options) {
+    i32 opt;
+    while ((opt = getopt(argc, argv, "H:p:c:n:m:P:s:")) != -1) {
+        switch (opt) {
+        case 'H':
+            options->host = optarg;
+            break;
+        case 'p':
+            options->port = atoi(optarg);
+            break;
+        case 'c':
+            options->concurrency = strtoull(optarg, NULL, 10);
+            break;
+        case 'n':
+            options->total = strtoull(optarg, NULL, 10);
+            break;
+        case 'm':
+            if (strcmp(optarg, "status") == 0)
+                options->scenario = SCENARIO_STATUS;
+            else if (strcmp(optarg, "login") == 0)
+                options->scenario = SCENARIO_LOGIN;
+            else
+                return FALSE;
+            break;
+        case 'P':
+            options->server_pid = atoi(optarg);
+            break;
+        case 's':
+            options->forwarding_secret = optarg;
+            break;
+        default:
+            return FALSE;
+        }
+    }
+    return options->concurrency > 0 && options->total > 0;
+}
+
+int main(int argc, char** argv) {
+    Loadgen lg = {
+        .options = {
+            .host = "127.0.0.1",
+            .port = 25565,
+            .concurrency = 100,
+            .total = 10000,
+            .scenario = SCENARIO_STATUS,
+            .server_pid = 0,
+            .forwarding_secret = NULL,
+        },
+    };
+    if (!parse_options(argc, argv, &lg.options)) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (lg.options.concurrency > lg.options.total)
+        lg.options.concurrency = lg.options.total;
+
+    logger_system_init();
+    memory_stats_init();
+
+    if (!sockaddr_parse(&lg.address, lg.options.host, lg.options.port))
+        return 2;
+
+    u64 client_size = sizeof(Client) + CLIENT_RECV_BUFFER_SIZE + CLIENT_SEND_BUFFER_SIZE + 64;
+    lg.arena = arena_create(lg.options.concurrency * client_size +
+                                lg.options.total * sizeof *lg.latencies + 4096,
+                            BLK_TAG_NETWORK);
+    lg.scratch = arena_create(SCRATCH_ARENA_SIZE, BLK_TAG_NETWORK);
+    lg.latencies = arena_allocate(&lg.arena, lg.options.total * sizeof *lg.latencies, ALLOC_TAG_UNKNOWN);
+    lg.clients = arena_allocate(&lg.arena, lg.options.concurrency * sizeof *lg.clients, ALLOC_TAG_UNKNOWN);
+    for (u64 i = 0; i < lg.options.concurrency; i++) {
+        lg.clients[i] = (Client){
+            .fd = -1,
+            .state = CLIENT_IDLE,
+            .recv_buffer = bytebuf_create_fixed(CLIENT_RECV_BUFFER_SIZE, &lg.arena),
+            .send_buffer = bytebuf_create_fixed(CLIENT_SEND_BUFFER_SIZE, &lg.arena),
+        };
+    }
+    lg.forwarding_secret =
+        str_create_view(lg.options.forwarding_secret ? lg.options.forwarding_secret : "");
+
+    Arena zlib_arena = arena_create(1 << 20, BLK_TAG_NETWORK);
+    if (!compression_init(&lg.cmprss_ctx, &zlib_arena))
+        return 3;
+
+    lg.epollfd = epoll_create1(0);
+    if (lg.epollfd < 0) {
+        log_fatalf("Could not create the EPoll instance: %s.", get_last_error());
+        return 4;
+    }
+
+    u64 cpu_start = 0;
+    bool has_cpu = lg.options.server_pid > 0 && read_process_cpu_time(lg.options.server_pid, &cpu_start);
+    if (lg.options.server_pid > 0 && !has_cpu)
+        log_warnf("Could not read the CPU usage of process %i.", lg.options.server_pid);
+
+    u64 start_time = get_monotonic_ns();
+    u64 last_expiration = start_time;
+    struct epoll_event events[MAX_EVENTS];
+    while (lg.completed + lg.failed < lg.options.total) {
+        for (u64 i = 0; i < lg.options.concurrency && lg.started < lg.options.total; i++) {
+            if (lg.clients[i].state == CLIENT_IDLE && !start_client(&lg, &lg.clients[i]))
+                return 5;
+        }
+
+        i32 count = epoll_wait(lg.epollfd, events, MAX_EVENTS, 100);
+        if (count < 0 && errno != EINTR) {
+            log_fatalf("Could not wait for events: %s.", get_last_error());
+            return 6;
+        }
+        for (i32 i = 0; i < count; i++) {
+            Client* client = events[i].data.ptr;
+            if (client->state != CLIENT_IDLE)
+                handle_client_event(&lg, client, events[i].events);
+        }
+
+        u64 now = get_monotonic_ns();
+        if (now - last_expiration > 1000000000) {
+            expire_clients(&lg);
+            last_expiration = now;
+        }
+    }
+    u64 elapsed = get_monotonic_ns() - start_time;
+
+    u64 cpu_end = 0;
+    has_cpu = has_cpu && read_process_cpu_time(lg.options.server_pid, &cpu_end);
+    report(&lg, elapsed, has_cpu, cpu_end - cpu_start);
+
+    close(lg.epollfd);
+    compression_cleanup(&lg.cmprss_ctx);
+    arena_destroy(&zlib_arena);
+    arena_destroy(&lg.scratch);
+    arena_destroy(&lg.arena);
+    logger_system_cleanup();
+    return lg.failed > 0;
+}
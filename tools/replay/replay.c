@@ -0,0 +1,225 @@
+/**
+ * @file replay.c
+ * @author Bastien Morino
+ *
+ * Offline replay of inbound traffic captured with `mcsrv --capture <file>`.
+ *
+ * The captured bytes are fed to the receiving pipeline of the server (framing, decompression,
+ * decoding and handling of packets) as fast as possible, without any socket.
+ * The capture is loaded in memory beforehand, so only the pipeline itself is measured.
+ *
+ * Bytes are replayed as they were given to the pipeline, i.e. after decryption.
+ * The server is replayed in offline mode: the handlers of encryption responses can not succeed,
+ * so connections which enabled encryption are only replayed until then.
+ * Captures of offline-mode or proxied servers are replayed entirely.
+ */
+
+#include "network/capture.h"
+#include "network/common_types.h"
+#include "network/connection.h"
+#include "network/packet_codec.h"
+
+#include "logger.h"
+#include "memory/arena.h"
+#include "memory/mem_tags.h"
+#include "platform/platform.h"
+#include "platform/socket.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_CONNECTIONS 4096
+
+typedef struct ReplayStats {
+    u64 connections;
+    u64 failed_connections;
+    u64 chunks;
+    u64 bytes;
+    u64 pipeline_time;
+} ReplayStats;
+
+typedef struct Replay {
+    NetworkContext ctx;
+    Connection* connections[MAX_CONNECTIONS];
+    ReplayStats stats;
+} Replay;
+
+static u8* load_file(const char* path, u64* out_size) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        log_fatalf("Could not open '%s': %s.", path, strerror(errno));
+        return NULL;
+    }
+
+    fseek(file, 0, SEEK_END);
+    i64 size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    u8* data = malloc(size);
+    if (!data || fread(data, 1, size, file) != (u64) size) {
+        log_fatalf("Could not read '%s'.", path);
+        free(data);
+        fclose(file);
+        return NULL;
+    }
+
+    fclose(file);
+    *out_size = size;
+    return data;
+}
+
+static void close_replayed(Replay* replay, u32 index) {
+    Connection* conn = replay->connections[index];
+    if (!conn)
+        return;
+
+    if (conn->compression)
+        compression_cleanup(&conn->cmprss_ctx);
+    arena_destroy(&conn->scratch_arena);
+    dynarena_destroy(&conn->dynamic_arena);
+    arena_destroy(&conn->persistent_arena);
+    mcmutex_destroy(&conn->mutex);
+    free(conn);
+    replay->connections[index] = NULL;
+}
+
+static void open_replayed(Replay* replay, const CaptureRecord* record) {
+    close_replayed(replay, record->connection);
+
+    string address = {
+        .base = (char*) record->data,
+        .length = record->length,
+    };
+    Connection* conn = malloc(sizeof *conn);
+    *conn = conn_create(SOCKFD_INVALID, record->connection, &replay->ctx.enc_ctx, address, 0);
+    // Packets sent by handlers stay in the sending buffer, and are dropped after each chunk.
+    conn->pending_send = TRUE;
+
+    replay->connections[record->connection] = conn;
+    replay->stats.connections++;
+}
+
+/**
+ * Feeds a chunk of bytes to a connection, the same way the network thread does after
+ * filling the receiving buffer.
+ */
+static void feed_replayed(Replay* replay, const CaptureRecord* record) {
+    Connection* conn = replay->connections[record->connection];
+    if (!conn)
+        return;
+
+    u64 start = get_monotonic_ns();
+
+    bytebuf_write(&conn->recv_buffer, record->data, record->length);
+    enum IOCode code = receive_packet(&replay->ctx, conn);
+    bytebuf_register_read(&conn->send_buffer, bytebuf_size(&conn->send_buffer));
+
+    replay->stats.pipeline_time += get_monotonic_ns() - start;
+    replay->stats.chunks++;
+    replay->stats.bytes += record->length;
+
+    if (code == IOC_ERROR || code == IOC_CLOSED) {
+        replay->stats.failed_connections++;
+        close_replayed(replay, record->connection);
+    }
+}
+
+static bool replay_capture(Replay* replay, const u8* data, u64 size) {
+    u64 cursor;
+    if (!capture_read_header(data, size, &cursor)) {
+        log_fatal("Invalid capture file.");
+        return FALSE;
+    }
+
+    CaptureRecord record;
+    const CaptureRecord* pending_raw = NULL;
+    CaptureRecord raw;
+    while (capture_read_record(data, size, &cursor, &record)) {
+        if (record.connection >= MAX_CONNECTIONS) {
+            log_fatalf("Connection index %u is too large.", record.connection);
+            return FALSE;
+        }
+
+        // Raw bytes are only fed if they were not decrypted afterwards.
+        if (pending_raw && record.type != CAPTURE_DECRYPTED)
+            feed_replayed(replay, pending_raw);
+        pending_raw = NULL;
+
+        switch (record.type) {
+        case CAPTURE_OPEN:
+            open_replayed(replay, &record);
+            break;
+        case CAPTURE_RAW:
+            raw = record;
+            pending_raw = &raw;
+            break;
+        case CAPTURE_DECRYPTED:
+            feed_replayed(replay, &record);
+            break;
+        case CAPTURE_CLOSE:
+            close_replayed(replay, record.connection);
+            break;
+        default:
+            log_fatalf("Unknown record type %u.", record.type);
+            return FALSE;
+        }
+    }
+    if (pending_raw)
+        feed_replayed(replay, pending_raw);
+
+    if (cursor != size)
+        log_warn("The capture file is truncated.");
+
+    for (u32 i = 0; i < MAX_CONNECTIONS; i++) {
+        close_replayed(replay, i);
+    }
+    return TRUE;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2 || argc > 3) {
+        fprintf(stderr, "Usage: %s <capture file> [iterations]\n", argv[0]);
+        return 1;
+    }
+    u64 iterations = argc == 3 ? strtoull(argv[2], NULL, 10) : 1;
+
+    logger_system_init();
+    memory_stats_init();
+
+    u64 size;
+    u8* data = load_file(argv[1], &size);
+    if (!data)
+        return 2;
+
+    Replay* replay = calloc(1, sizeof *replay);
+    replay->ctx.offline = TRUE;
+    replay->ctx.forwarding_secret = str_create_view("");
+
+    for (u64 i = 0; i < iterations; i++) {
+        if (!replay_capture(replay, data, size))
+            return 3;
+    }
+
+    ReplayStats* stats = &replay->stats;
+    f64 seconds = stats->pipeline_time / 1e9;
+    printf("Iterations:      %llu\n", (unsigned long long) iterations);
+    printf("Connections:     %llu replayed, %llu stopped early\n",
+           (unsigned long long) stats->connections,
+           (unsigned long long) stats->failed_connections);
+    printf("Chunks:          %llu (%llu bytes)\n",
+           (unsigned long long) stats->chunks,
+           (unsigned long long) stats->bytes);
+    printf("Pipeline time:   %.3f ms\n", seconds * 1e3);
+    if (seconds > 0) {
+        printf("Throughput:      %.1f MiB/s, %.0f chunks/s\n",
+               stats->bytes / seconds / (1 << 20),
+               stats->chunks / seconds);
+    }
+
+    free(replay);
+    free(data);
+    logger_system_cleanup();
+    return 0;
+}